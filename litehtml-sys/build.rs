@@ -133,14 +133,9 @@ fn build_vendored(manifest_dir: &Path, out_dir: &Path, csrc_dir: &Path) {
         .compile("litehtml");
 
     // C wrapper (C++17)
-    cc::Build::new()
-        .cargo_metadata(false)
-        .cpp(true)
-        .file(csrc_dir.join("litehtml_c.cpp"))
+    wrapper_build(csrc_dir)
         .include(&litehtml_include)
         .include(&gumbo_include)
-        .std("c++17")
-        .warnings(false)
         .compile("litehtml_c");
 
     // Link order: dependents first
@@ -185,13 +180,8 @@ fn build_system(out_dir: &Path, csrc_dir: &Path) {
         &include_dir
     };
 
-    cc::Build::new()
-        .cargo_metadata(false)
-        .cpp(true)
-        .file(csrc_dir.join("litehtml_c.cpp"))
+    wrapper_build(csrc_dir)
         .include(effective_include)
-        .std("c++17")
-        .warnings(false)
         .compile("litehtml_c");
 
     println!("cargo:rustc-link-search=native={}", out_dir.display());
@@ -206,6 +196,21 @@ fn build_system(out_dir: &Path, csrc_dir: &Path) {
     }
 }
 
+/// Common settings for compiling the C wrapper
+fn wrapper_build(csrc_dir: &Path) -> cc::Build {
+    let mut build = cc::Build::new();
+    build
+        .cargo_metadata(false)
+        .cpp(true)
+        .file(csrc_dir.join("litehtml_c.cpp"))
+        .std("c++17")
+        .warnings(false);
+    if env::var("CARGO_FEATURE_BENCH").is_ok() {
+        build.define("LH_BENCH", None);
+    }
+    build
+}
+
 /// Search include paths for a header file, return the directory containing it
 fn find_header(name: &str) -> Option<PathBuf> {
     // Check C_INCLUDE_PATH and CPLUS_INCLUDE_PATH
@@ -259,6 +264,10 @@ fn write_bindings(csrc_dir: &Path, out_dir: &Path, vendored: bool, manifest_dir:
         .derive_debug(true)
         .derive_default(true);
 
+    if env::var("CARGO_FEATURE_BENCH").is_ok() {
+        builder = builder.clang_arg("-DLH_BENCH");
+    }
+
     if vendored {
         let vendor_dir = manifest_dir.join("vendor/litehtml");
         let litehtml_include = vendor_dir.join("include");
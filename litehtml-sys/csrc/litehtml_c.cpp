@@ -8,9 +8,17 @@
 #include "litehtml_c.h"
 #include <litehtml.h>
 #include <litehtml/render_item.h>
+#include <litehtml/el_text.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstring>
+#include <functional>
+#include <optional>
 #include <string>
 #include <type_traits>
+#include <unordered_map>
+#include <vector>
 
 /* --------------------------------------------------------------------------
  * Static assertions for types passed through opaque C pointers via
@@ -207,18 +215,553 @@ static lh_point_t to_c(const litehtml::pointF& p)
     return r;
 }
 
+/* Copy up to `capacity` gradient stops into a caller-provided buffer and
+   return the total number of stops. */
+template <typename Gradient>
+static int copy_color_points(const Gradient& g, lh_color_point_t* points, int capacity)
+{
+    int total = static_cast<int>(g.color_points.size());
+    if (points) {
+        int n = std::min(total, capacity);
+        for (int i = 0; i < n; ++i) {
+            points[i].offset = g.color_points[i].offset;
+            points[i].color  = to_c(g.color_points[i].color);
+        }
+    }
+    return total;
+}
+
 /* --------------------------------------------------------------------------
  * Internal document wrapper
  * -------------------------------------------------------------------------- */
 
 class CDocumentContainer;
 
+/* Flat view of the element tree. litehtml keeps children in a std::list, so
+   indexed access and sibling steps are linear in the number of siblings.
+   The index is built in one pass on first use and dropped whenever the DOM
+   changes. */
+struct lh_tree_index
+{
+    struct node
+    {
+        /* Parent's children vector; null for the root. Values in an
+           unordered_map never move, so the pointer stays valid. */
+        const std::vector<litehtml::element*>* siblings = nullptr;
+        int                                    index    = -1;
+        std::vector<litehtml::element*>        children;
+    };
+
+    std::unordered_map<const litehtml::element*, node> nodes;
+    bool                                                built = false;
+
+    /* id attribute -> first element carrying it, in document order. */
+    std::unordered_map<std::string, litehtml::element*> ids;
+    bool                                                ids_built = false;
+};
+
+/* Absolute positions memoized per layout. litehtml stores render-item
+   positions relative to their parent, so every placement query otherwise
+   walks the whole ancestor chain. Both maps are cleared whenever the layout
+   generation changes. */
+struct lh_layout_cache
+{
+    struct origin
+    {
+        float x = 0;
+        float y = 0;
+    };
+
+    /* Absolute position of each render item's own m_pos origin. */
+    std::unordered_map<const litehtml::render_item*, origin>        origins;
+    std::unordered_map<const litehtml::element*, litehtml::position> placements;
+};
+
+/* What changed since the last render. litehtml always lays out the whole
+   tree, but the wrapper knows which subtrees were touched: it can skip a
+   render that would reproduce the current layout, and report the region
+   that has to be repainted afterwards. */
+struct lh_dirty_state
+{
+    /* No layout yet, or a change whose extent is unknown (styles, media,
+       element state, explicit invalidation). */
+    bool                                          full = true;
+    /* Parents passed to append_children_from_string since the last render. */
+    std::vector<std::weak_ptr<litehtml::element>> subtrees;
+    /* Union of those parents' boxes before they were mutated. */
+    bool                                          has_old_region = false;
+    litehtml::position                            old_region;
+    /* Arguments and result of the last render. */
+    float                                         width  = -1;
+    float                                         result = 0;
+    /* Region changed by the last render, if any. */
+    bool                                          has_changed = false;
+    litehtml::position                            changed;
+};
+
 struct lh_document_internal
 {
     litehtml::document::ptr  doc;
     CDocumentContainer*      container;
+    /* Stylesheets the document was created with, reused by lh_document_reset. */
+    std::string              master_css;
+    std::string              user_styles;
+    lh_tree_index            tree;
+    lh_layout_cache          layout;
+    lh_dirty_state           dirty;
+    /* Bumped by every call that can move boxes (render, DOM and style
+       changes, state changes from mouse events). */
+    uint64_t                 layout_generation = 0;
+    /* DOM and render tree part of lh_document_memory_usage, and the layout
+       generation it was measured at. */
+    lh_memory_usage_t        memory = {};
+    uint64_t                 memory_generation = UINT64_MAX;
+};
+
+/* Forget memoized positions after anything that may have moved boxes. */
+static void layout_changed(lh_document_internal* internal)
+{
+    ++internal->layout_generation;
+    internal->layout.origins.clear();
+    internal->layout.placements.clear();
+}
+
+/* Something with unknown extent changed; the next render must run. */
+static void styles_changed(lh_document_internal* internal)
+{
+    internal->dirty.full = true;
+    layout_changed(internal);
+}
+
+/* Absolute box of elem, memoized for the current layout generation. */
+static litehtml::position placement_of(lh_document_internal* internal,
+                                       litehtml::element* elem)
+{
+    auto& placements = internal->layout.placements;
+    auto it = placements.find(elem);
+    if (it == placements.end())
+        it = placements.emplace(elem, elem->get_placement()).first;
+    return it->second;
+}
+
+static void grow_region(litehtml::position& region, bool& has, const litehtml::position& box)
+{
+    if (!has) {
+        region = box;
+        has    = true;
+        return;
+    }
+    float left   = std::min(region.left(), box.left());
+    float top    = std::min(region.top(), box.top());
+    float right  = std::max(region.right(), box.right());
+    float bottom = std::max(region.bottom(), box.bottom());
+    region = litehtml::position(left, top, right - left, bottom - top);
+}
+
+/* Drop every lazily built index after a DOM mutation. */
+static void invalidate_indexes(lh_document_internal* internal)
+{
+    internal->tree.built = false;
+    internal->tree.nodes.clear();
+    internal->tree.ids_built = false;
+    internal->tree.ids.clear();
+    layout_changed(internal);
+}
+
+/* --------------------------------------------------------------------------
+ * Font sharing
+ *
+ * Fonts are shared by description for as long as any document built on the
+ * same container still uses them. lh_document_reset creates the new
+ * document before dropping the old one, so fonts whose descriptions match
+ * are handed over instead of being deleted and re-created.
+ * -------------------------------------------------------------------------- */
+
+template <typename T>
+static void append_key_bytes(std::string& key, const T& value)
+{
+    static_assert(std::is_arithmetic<T>::value, "key fields must be scalars");
+    key.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+static void append_key_color(std::string& key, const litehtml::web_color& c)
+{
+    key += static_cast<char>(c.red);
+    key += static_cast<char>(c.green);
+    key += static_cast<char>(c.blue);
+    key += static_cast<char>(c.alpha);
+    key += c.is_current_color ? '\1' : '\0';
+}
+
+/* Every field of the description, in a form usable as a hash key. */
+static void font_key(const litehtml::font_description& d, std::string& key)
+{
+    key.clear();
+    key += d.family;
+    key += '\0';
+    key += d.emphasis_style;
+    key += '\0';
+    append_key_bytes(key, static_cast<float>(d.size));
+    append_key_bytes(key, static_cast<int>(d.style));
+    append_key_bytes(key, static_cast<int>(d.weight));
+    append_key_bytes(key, static_cast<int>(d.decoration_line));
+    if (d.decoration_thickness.is_predefined()) {
+        append_key_bytes(key, 1);
+        append_key_bytes(key, static_cast<int>(d.decoration_thickness.predef()));
+    } else {
+        append_key_bytes(key, 0);
+        append_key_bytes(key, static_cast<float>(d.decoration_thickness.val()));
+    }
+    append_key_bytes(key, static_cast<int>(d.decoration_style));
+    append_key_color(key, d.decoration_color);
+    append_key_color(key, d.emphasis_color);
+    append_key_bytes(key, static_cast<int>(d.emphasis_position));
+}
+
+struct lh_font_cache
+{
+    struct entry
+    {
+        litehtml::uint_ptr    handle;
+        litehtml::font_metrics metrics;
+    };
+
+    struct handle_refs
+    {
+        int refs    = 0; /* live create_font results handed to litehtml */
+        int created = 0; /* create_font calls forwarded to the container */
+    };
+
+    std::unordered_map<std::string, entry>               by_key;
+    std::unordered_map<litehtml::uint_ptr, handle_refs> handles;
+    std::string                                          scratch;
+};
+
+/* --------------------------------------------------------------------------
+ * Work budgets
+ * -------------------------------------------------------------------------- */
+
+/* The cancel flag is a Rust AtomicBool/AtomicU8 read through this type. */
+static_assert(sizeof(std::atomic<uint8_t>) == sizeof(uint8_t),
+              "std::atomic<uint8_t> must have the layout of uint8_t");
+static_assert(std::atomic<uint8_t>::is_always_lock_free,
+              "std::atomic<uint8_t> must be lock-free");
+
+/* Thrown from a safe point once the budget has run out; caught by the
+   budgeted entry points. */
+struct lh_budget_exceeded {};
+
+/* Thrown from the first parser callback after the tree is complete, to
+   leave createFromString before it applies any style; see lh_dom_parse. */
+struct lh_parse_only_done {};
+
+/* Progress of one budgeted call. */
+struct lh_budget_state
+{
+    const lh_budget_t&                    limits;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    uint64_t                              steps   = 0;
+    int                                   tripped = LH_ABORT_NONE;
+    /* Whether safe points may unwind. Creation and reset discard the
+       document they abort, so they may; render keeps its document, and
+       litehtml's layout code is not exception-safe, so it drains instead. */
+    bool                                  unwind  = true;
+
+    explicit lh_budget_state(const lh_budget_t& l) : limits(l) {}
+
+    /* Count one step. Throws if a limit has been hit and unwinding from the
+       caller is safe; otherwise only records the reason, so the next safe
+       point that may throw does. */
+    void step(bool may_throw)
+    {
+        if (tripped == LH_ABORT_NONE) {
+            ++steps;
+            if (limits.cancel_flag &&
+                reinterpret_cast<const std::atomic<uint8_t>*>(limits.cancel_flag)
+                    ->load(std::memory_order_relaxed))
+                tripped = LH_ABORT_CANCELLED;
+            else if (limits.max_steps && steps > limits.max_steps)
+                tripped = LH_ABORT_STEPS;
+            else if (limits.max_micros &&
+                     std::chrono::steady_clock::now() - start >
+                         std::chrono::microseconds(limits.max_micros))
+                tripped = LH_ABORT_TIME;
+        }
+        if (tripped != LH_ABORT_NONE && may_throw) throw lh_budget_exceeded{};
+    }
+};
+
+/* --------------------------------------------------------------------------
+ * Resource limits
+ * -------------------------------------------------------------------------- */
+
+/* Stands in for every element past the node limit. It is hidden, and drops
+   whatever the parser appends to it, so the rest of its subtree is freed as
+   soon as it has been built instead of being styled and laid out. */
+class lh_pruned_element : public litehtml::html_tag
+{
+public:
+    explicit lh_pruned_element(const std::shared_ptr<litehtml::document>& doc)
+        : html_tag(doc)
+    {
+        html_tag::set_attr("style", "display:none");
+    }
+
+    bool appendChild(const litehtml::element::ptr& /*el*/) override { return false; }
+    /* Keep the parser's attributes from overriding the hidden style. */
+    void set_attr(const char* /*name*/, const char* /*val*/) override {}
+};
+
+/* Drop the children of every element at max_depth. Iterative, so the walk
+   itself cannot overflow the stack on pathological nesting. Returns true
+   if anything was removed. */
+static bool prune_depth(litehtml::element* root, uint32_t max_depth)
+{
+    bool pruned = false;
+    std::vector<std::pair<litehtml::element*, uint32_t>> stack;
+    stack.emplace_back(root, 1);
+    while (!stack.empty()) {
+        auto [elem, depth] = stack.back();
+        stack.pop_back();
+        if (elem->children().empty()) continue;
+        if (depth >= max_depth) {
+            elem->clearRecursive();
+            pruned = true;
+            continue;
+        }
+        for (const auto& child : elem->children())
+            stack.emplace_back(child.get(), depth + 1);
+    }
+    return pruned;
+}
+
+/* litehtml builds its tree by recursing over gumbo's output, one native
+   frame per nesting level, before any callback can tell how deep it is. So
+   deep input is flattened first: a tag scan follows the parser's open
+   elements (void and raw-text elements, the common implied end tags) and
+   drops every start tag past max_depth, with its end tag. prune_depth still
+   applies the exact limit to the finished tree; the scan only has to keep
+   the recursion bounded. */
+namespace nesting {
+
+using names = const char* const*;
+
+static bool is_tag_char(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+           c == '-' || c == ':' || c == '_';
+}
+
+static bool is_letter(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+static char lower(char c)
+{
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+/* `list` is null-terminated. */
+static bool in(const std::string& name, names list)
+{
+    for (; list && *list; ++list)
+        if (name == *list) return true;
+    return false;
+}
+
+static const char* const void_elements[] = {
+    "area", "base", "br", "col", "embed", "hr", "img", "input", "link",
+    "meta", "param", "source", "track", "wbr", nullptr};
+static const char* const raw_text_elements[] = {
+    "script", "style", "textarea", "title", "xmp", "iframe", "noembed",
+    "noframes", "noscript", "plaintext", nullptr};
+static const char* const closes_p[] = {
+    "p", "div", "ul", "ol", "dl", "table", "pre", "blockquote", "h1", "h2",
+    "h3", "h4", "h5", "h6", "section", "article", "aside", "header",
+    "footer", "nav", "main", "form", "fieldset", "figure", "figcaption",
+    "address", "details", "menu", "center", "hr", nullptr};
+
+/* Start tags that close an open element: the tags, the elements they close
+   (with everything opened inside them) and the elements that stop the
+   search. */
+struct implied_end
+{
+    names starts;
+    names closes;
+    names scope;
+};
+
+static const char* const li[]         = {"li", nullptr};
+static const char* const list_scope[] = {"ul", "ol", "table", nullptr};
+static const char* const dt_dd[]      = {"dt", "dd", nullptr};
+static const char* const dl_scope[]   = {"dl", "table", nullptr};
+static const char* const cells[]      = {"td", "th", nullptr};
+static const char* const row_scope[]  = {"tr", "table", nullptr};
+static const char* const tr[]         = {"tr", nullptr};
+static const char* const sect_scope[] = {"thead", "tbody", "tfoot", "table", nullptr};
+static const char* const sections[]   = {"thead", "tbody", "tfoot", nullptr};
+static const char* const table[]      = {"table", nullptr};
+static const char* const options[]    = {"option", "optgroup", nullptr};
+static const char* const option[]     = {"option", nullptr};
+static const char* const opt_scope[]  = {"select", "datalist", nullptr};
+static const char* const p[]          = {"p", nullptr};
+static const char* const p_scope[]    = {
+    "button", "table", "td", "th", "caption", "object", "template", nullptr};
+
+static const implied_end implied_ends[] = {
+    {li, li, list_scope},
+    {dt_dd, dt_dd, dl_scope},
+    {cells, cells, row_scope},
+    {tr, tr, sect_scope},
+    {sections, sections, table},
+    {options, option, opt_scope},
+    {closes_p, p, p_scope},
+};
+
+struct open_element
+{
+    std::string name;
+    bool        dropped;
+};
+
+struct open_elements
+{
+    std::vector<open_element>                 stack;
+    std::unordered_map<std::string, uint32_t> counts;
+    /* Open elements that were kept, plus html and body. */
+    uint32_t depth = 2;
+
+    void push(const std::string& name, bool dropped)
+    {
+        stack.push_back({name, dropped});
+        ++counts[name];
+        if (!dropped) ++depth;
+    }
+
+    /* Pop the nearest open element named in `list`, and everything above
+       it, unless an element in `scope` comes first. Returns its dropped
+       flag, or -1 if none was open. Names with no open element are skipped
+       without a scan, so stray end tags stay cheap. */
+    int close(names list, names scope)
+    {
+        bool any = false;
+        for (names n = list; *n && !any; ++n) {
+            auto it = counts.find(*n);
+            any = it != counts.end() && it->second > 0;
+        }
+        if (!any) return -1;
+        for (size_t i = stack.size(); i-- > 0;) {
+            if (in(stack[i].name, list)) {
+                int dropped = stack[i].dropped;
+                for (size_t j = i; j < stack.size(); ++j) {
+                    --counts[stack[j].name];
+                    if (!stack[j].dropped) --depth;
+                }
+                stack.resize(i);
+                return dropped;
+            }
+            if (in(stack[i].name, scope)) break;
+        }
+        return -1;
+    }
 };
 
+/* Copy `html` into `out` without the start and end tags of elements nested
+   deeper than max_depth. Returns false, leaving `out` alone, if nothing is
+   that deep. */
+static bool flatten(const char* html, uint32_t max_depth, std::string& out)
+{
+    open_elements open;
+    std::string   name;
+    /* Byte ranges of the tags to drop. */
+    std::vector<std::pair<size_t, size_t>> cut;
+
+    const char* s = html;
+    while ((s = std::strchr(s, '<'))) {
+        const char* tag = s;
+        if (std::strncmp(s, "<!--", 4) == 0) {
+            const char* end = std::strstr(s + 4, "-->");
+            if (!end) break;
+            s = end + 3;
+            continue;
+        }
+        bool        closing = s[1] == '/';
+        const char* n       = s + (closing ? 2 : 1);
+        if (!is_letter(*n)) {
+            /* Doctype, processing instruction or a stray '<'. */
+            if (*n == '!' || *n == '?') {
+                s = std::strchr(n, '>');
+                if (!s) break;
+            } else {
+                s = n;
+            }
+            continue;
+        }
+        name.clear();
+        for (; is_tag_char(*n); ++n) name += lower(*n);
+
+        /* End of the tag, skipping quoted attribute values. */
+        char quote = 0;
+        for (s = n; *s && (quote || *s != '>'); ++s) {
+            if (quote) {
+                if (*s == quote) quote = 0;
+            } else if (*s == '"' || *s == '\'') {
+                quote = *s;
+            }
+        }
+        if (!*s) break;
+        bool self_closing = s[-1] == '/';
+        ++s;
+
+        if (closing) {
+            const char* list[] = {name.c_str(), nullptr};
+            if (open.close(list, nullptr) == 1) cut.emplace_back(tag - html, s - html);
+            continue;
+        }
+
+        for (const auto& rule : implied_ends) {
+            if (in(name, rule.starts)) {
+                open.close(rule.closes, rule.scope);
+                break;
+            }
+        }
+
+        if (in(name, raw_text_elements)) {
+            /* Its content is text up to the matching end tag. */
+            const char* q = s;
+            for (; (q = std::strchr(q, '<')); ++q) {
+                if (q[1] != '/') continue;
+                size_t i = 0;
+                while (i < name.size() && lower(q[2 + i]) == name[i]) ++i;
+                if (i == name.size() && !is_tag_char(q[2 + i])) break;
+            }
+            if (!q) break;
+            s = q;
+            continue;
+        }
+        if (self_closing || in(name, void_elements) || name == "html" || name == "head" ||
+            name == "body")
+            continue;
+
+        bool drop = open.depth >= max_depth;
+        if (drop) cut.emplace_back(tag - html, s - html);
+        open.push(name, drop);
+    }
+
+    if (cut.empty()) return false;
+    out.clear();
+    size_t from = 0;
+    for (auto [begin, end] : cut) {
+        out.append(html + from, begin - from);
+        from = end;
+    }
+    out.append(html + from);
+    return true;
+}
+
+} // namespace nesting
+
 /* --------------------------------------------------------------------------
  * CDocumentContainer -- bridges vtable calls to the C callback table
  * -------------------------------------------------------------------------- */
@@ -228,6 +771,62 @@ class CDocumentContainer : public litehtml::document_container
 public:
     lh_container_vtable_t* vtable;
     void*                  user_data;
+    /* Set once the document is created; null while it is being parsed. */
+    lh_document_internal*  owner = nullptr;
+    lh_font_cache          fonts;
+    /* Set for the duration of a budgeted create or render call. */
+    lh_budget_state*       budget = nullptr;
+    /* DOM size limits, nodes admitted so far and LH_LIMIT_* flags hit. */
+    lh_limits_t            limits = {0, 0};
+    uint64_t               nodes  = 0;
+    mutable uint32_t       limits_hit = 0;
+    /* Document being parsed, held until its tree is complete so it can be
+       pruned by depth. Only set while parsing. */
+    bool                                      parsing = false;
+    mutable std::weak_ptr<litehtml::document> prune_pending;
+    /* Parse-only mode: the finished tree is kept here and the parser is
+       unwound before styling. */
+    bool                             parse_only = false;
+    mutable litehtml::document::ptr  parsed;
+
+    /* Safe point: count a step and, if the budget ran out and the call
+       may unwind, throw. Called before any vtable call, so no Rust frame is
+       ever unwound. */
+    void checkpoint() const
+    {
+        if (budget) budget->step(budget->unwind);
+    }
+
+    /* True once a budget that may not unwind has run out. The rest of the
+       pass runs to completion without calling the vtable, answering each
+       callback with a cheap default, so litehtml's state stays consistent. */
+    bool draining() const
+    {
+        return budget && budget->tripped != LH_ABORT_NONE;
+    }
+
+    /* Count one node against max_nodes; false once it is exceeded. */
+    bool admit_node()
+    {
+        if (!limits.max_nodes) return true;
+        if (nodes < limits.max_nodes) {
+            ++nodes;
+            return true;
+        }
+        limits_hit |= LH_LIMIT_NODES;
+        return false;
+    }
+
+    /* The input the parser may see under max_depth: `html` itself, or a
+       copy in `scratch` with the tags nested past the limit removed, so
+       tree construction never recurses deeper than the limit. */
+    const char* admit_depth(const char* html, std::string& scratch)
+    {
+        if (!limits.max_depth || !nesting::flatten(html, limits.max_depth, scratch))
+            return html;
+        limits_hit |= LH_LIMIT_DEPTH;
+        return scratch.c_str();
+    }
 
     CDocumentContainer(lh_container_vtable_t* vt, void* ud)
         : vtable(vt), user_data(ud) {}
@@ -239,22 +838,56 @@ public:
         litehtml::font_metrics* fm) override
     {
         if (!vtable->create_font) return 0;
+        checkpoint();
+
+        font_key(descr, fonts.scratch);
+        auto cached = fonts.by_key.find(fonts.scratch);
+        if (cached != fonts.by_key.end()) {
+            ++fonts.handles[cached->second.handle].refs;
+            if (fm) *fm = cached->second.metrics;
+            return cached->second.handle;
+        }
+        if (draining()) return 0;
 
         auto* fd = reinterpret_cast<const lh_font_description_t*>(&descr);
         lh_font_metrics_t c_fm = {};
 
         litehtml::uint_ptr result = vtable->create_font(user_data, fd, &c_fm);
 
+        litehtml::font_metrics metrics;
+        from_c(c_fm, metrics);
         if (fm)
-            from_c(c_fm, *fm);
+            *fm = metrics;
 
+        if (result) {
+            fonts.by_key.emplace(fonts.scratch, lh_font_cache::entry{result, metrics});
+            auto& refs = fonts.handles[result];
+            ++refs.refs;
+            ++refs.created;
+        }
         return result;
     }
 
     /* -- delete_font -- */
     void delete_font(litehtml::uint_ptr hFont) override
     {
-        if (vtable->delete_font)
+        /* 0 is "no font", handed out without calling the vtable. */
+        if (!hFont) return;
+        int created = 1;
+        auto it = fonts.handles.find(hFont);
+        if (it != fonts.handles.end()) {
+            if (--it->second.refs > 0) return;
+            created = it->second.created;
+            fonts.handles.erase(it);
+            for (auto k = fonts.by_key.begin(); k != fonts.by_key.end();) {
+                if (k->second.handle == hFont)
+                    k = fonts.by_key.erase(k);
+                else
+                    ++k;
+            }
+        }
+        if (!vtable->delete_font) return;
+        for (int i = 0; i < created; ++i)
             vtable->delete_font(user_data, hFont);
     }
 
@@ -262,6 +895,8 @@ public:
     litehtml::pixel_t text_width(const char* text, litehtml::uint_ptr hFont) override
     {
         if (!vtable->text_width) return 0;
+        checkpoint();
+        if (draining()) return 0;
         return vtable->text_width(user_data, text, hFont);
     }
 
@@ -280,6 +915,8 @@ public:
     litehtml::pixel_t pt_to_px(float pt) const override
     {
         if (!vtable->pt_to_px) return pt;
+        checkpoint();
+        if (draining()) return pt;
         return vtable->pt_to_px(user_data, pt);
     }
 
@@ -319,6 +956,8 @@ public:
                         litehtml::size& sz) override
     {
         if (!vtable->get_image_size) return;
+        checkpoint();
+        if (draining()) return;
         lh_size_t c_sz = to_c(sz);
         vtable->get_image_size(user_data, src, baseurl, &c_sz);
         sz.width  = c_sz.width;
@@ -444,6 +1083,8 @@ public:
                         litehtml::text_transform tt) override
     {
         if (!vtable->transform_text) return;
+        checkpoint();
+        if (draining()) return;
 
         litehtml::string result = text;
         litehtml::string* result_ptr = &result;
@@ -467,6 +1108,8 @@ public:
                     litehtml::string& baseurl) override
     {
         if (!vtable->import_css) return;
+        checkpoint();
+        if (draining()) return;
 
         litehtml::string result;
         litehtml::string* result_ptr = &result;
@@ -521,15 +1164,52 @@ public:
     litehtml::element::ptr create_element(
         const char* /*tag_name*/,
         const litehtml::string_map& /*attributes*/,
-        const std::shared_ptr<litehtml::document>& /*doc*/) override
+        const std::shared_ptr<litehtml::document>& doc) override
     {
+        /* Counted but never thrown from: the parser holds gumbo's output in
+           a raw pointer here, which unwinding would leak. */
+        if (budget) budget->step(false);
+        if (parsing && (limits.max_depth || parse_only)) prune_pending = doc;
+        if (!admit_node()) return std::make_shared<lh_pruned_element>(doc);
         /* Return null so litehtml creates the default element. */
         return nullptr;
     }
 
+    /* -- split_text -- */
+    void split_text(const char* text,
+                    const std::function<void(const char*)>& on_word,
+                    const std::function<void(const char*)>& on_space) override
+    {
+        if (!limits.max_nodes) {
+            document_container::split_text(text, on_word, on_space);
+            return;
+        }
+        /* Each word and space becomes a text node; drop those past the limit. */
+        document_container::split_text(
+            text,
+            [&](const char* word) {
+                if (admit_node()) on_word(word);
+            },
+            [&](const char* space) {
+                if (admit_node()) on_space(space);
+            });
+    }
+
     /* -- get_media_features -- */
     void get_media_features(litehtml::media_features& media) const override
     {
+        /* The parser's first callback once the tree is complete and before
+           styles are applied: the last point where pruning costs nothing. */
+        if (auto doc = prune_pending.lock()) {
+            prune_pending.reset();
+            if (limits.max_depth && doc->root() &&
+                prune_depth(doc->root().get(), limits.max_depth))
+                limits_hit |= LH_LIMIT_DEPTH;
+            if (parse_only) {
+                parsed = std::move(doc);
+                throw lh_parse_only_done{};
+            }
+        }
         if (!vtable->get_media_features) return;
         lh_media_features_t c_mf = to_c(media);
         vtable->get_media_features(user_data, &c_mf);
@@ -564,6 +1244,30 @@ public:
 
 extern "C" {
 
+#ifdef LH_BENCH
+lh_font_description_t* lh_font_description_create(const char* family,
+                                                  float size,
+                                                  int weight,
+                                                  int style)
+{
+    try {
+        auto* d   = new litehtml::font_description;
+        d->family = family ? family : "";
+        d->size   = size;
+        d->weight = weight;
+        d->style  = static_cast<litehtml::font_style>(style);
+        return reinterpret_cast<lh_font_description_t*>(d);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void lh_font_description_destroy(lh_font_description_t* fd)
+{
+    delete reinterpret_cast<litehtml::font_description*>(fd);
+}
+#endif
+
 const char* lh_font_description_family(const lh_font_description_t* fd)
 {
     try {
@@ -1173,142 +1877,595 @@ int lh_conic_gradient_hue_interpolation(const lh_conic_gradient_t* g)
 }
 
 /* --------------------------------------------------------------------------
- * Document lifecycle
+ * Snapshots
  * -------------------------------------------------------------------------- */
 
-lh_document_t* lh_document_create_from_string(
-    const char* html,
-    lh_container_vtable_t* vtable,
-    void* user_data,
-    const char* master_css,
-    const char* user_styles)
+void lh_font_description_snapshot(const lh_font_description_t* fd,
+                                  lh_font_description_snapshot_t* out)
 {
     try {
-        if (!html || !vtable) return nullptr;
-
-        auto* container = new CDocumentContainer(vtable, user_data);
-
-        std::string master = master_css ? master_css : litehtml::master_css;
-        std::string user   = user_styles ? user_styles : "";
-
-        litehtml::document::ptr doc =
-            litehtml::document::createFromString(html, container, master, user);
-
-        if (!doc) {
-            delete container;
-            return nullptr;
+        if (!out) return;
+        *out = {};
+        out->family = "";
+        out->emphasis_style = "";
+        out->decoration_thickness_is_predefined = 1;
+        if (!fd) return;
+        const auto* d = reinterpret_cast<const litehtml::font_description*>(fd);
+        out->family            = d->family.c_str();
+        out->emphasis_style    = d->emphasis_style.c_str();
+        out->size              = d->size;
+        out->style             = static_cast<int>(d->style);
+        out->weight            = d->weight;
+        out->decoration_line   = d->decoration_line;
+        if (d->decoration_thickness.is_predefined()) {
+            out->decoration_thickness_predef = d->decoration_thickness.predef();
+        } else {
+            out->decoration_thickness_is_predefined = 0;
+            out->decoration_thickness_value = d->decoration_thickness.val();
         }
-
-        auto* internal    = new lh_document_internal;
-        internal->doc       = doc;
-        internal->container = container;
-
-        return reinterpret_cast<lh_document_t*>(internal);
+        out->decoration_style  = static_cast<int>(d->decoration_style);
+        out->decoration_color  = to_c(d->decoration_color);
+        out->emphasis_color    = to_c(d->emphasis_color);
+        out->emphasis_position = d->emphasis_position;
     } catch (...) {
-        return nullptr;
     }
 }
 
-void lh_document_destroy(lh_document_t* doc)
+void lh_list_marker_snapshot(const lh_list_marker_t* m,
+                             lh_list_marker_snapshot_t* out)
 {
     try {
-        if (!doc) return;
-        auto* internal = reinterpret_cast<lh_document_internal*>(doc);
-        /* Drop the document (shared_ptr) first -- its destructor calls back into
-           the container (e.g. delete_font), so the container must still be alive. */
-        auto* container = internal->container;
-        delete internal;
-        delete container;
+        if (!out) return;
+        *out = {};
+        out->image = "";
+        out->baseurl = "";
+        if (!m) return;
+        const auto* mk = reinterpret_cast<const litehtml::list_marker*>(m);
+        out->image       = mk->image.c_str();
+        out->baseurl     = mk->baseurl ? mk->baseurl : "";
+        out->font        = mk->font;
+        out->marker_type = static_cast<int>(mk->marker_type);
+        out->color       = to_c(mk->color);
+        out->pos         = to_c(mk->pos);
+        out->index       = mk->index;
     } catch (...) {
     }
 }
 
-float lh_document_render(lh_document_t* doc, float max_width)
+void lh_background_layer_snapshot(const lh_background_layer_t* layer,
+                                  lh_background_layer_snapshot_t* out)
 {
     try {
-        if (!doc) return 0;
-        auto* internal = reinterpret_cast<lh_document_internal*>(doc);
-        return internal->doc->render(max_width);
+        if (!out) return;
+        *out = {};
+        if (!layer) return;
+        const auto* bl = reinterpret_cast<const litehtml::background_layer*>(layer);
+        out->border_box    = to_c(bl->border_box);
+        out->border_radius = to_c(bl->border_radius);
+        out->clip_box      = to_c(bl->clip_box);
+        out->origin_box    = to_c(bl->origin_box);
+        out->attachment    = static_cast<int>(bl->attachment);
+        out->repeat        = static_cast<int>(bl->repeat);
+        out->is_root       = bl->is_root ? 1 : 0;
     } catch (...) {
-        return 0;
     }
 }
 
-void lh_document_draw(lh_document_t* doc,
-                       uintptr_t hdc,
-                       float x, float y,
-                       const lh_position_t* clip)
+void lh_linear_gradient_snapshot(const lh_linear_gradient_t* g,
+                                 lh_linear_gradient_snapshot_t* out,
+                                 lh_color_point_t* points,
+                                 int capacity)
 {
     try {
-        if (!doc) return;
-        auto* internal = reinterpret_cast<lh_document_internal*>(doc);
-
-        if (clip) {
-            litehtml::position cpp_clip = to_cpp(*clip);
-            internal->doc->draw(hdc, x, y, &cpp_clip);
-        } else {
-            internal->doc->draw(hdc, x, y, nullptr);
-        }
+        if (!out) return;
+        *out = {};
+        if (!g) return;
+        const auto* lg = reinterpret_cast<
+            const litehtml::background_layer::linear_gradient*>(g);
+        out->start              = to_c(lg->start);
+        out->end                = to_c(lg->end);
+        out->color_points_count = copy_color_points(*lg, points, capacity);
+        out->color_space        = static_cast<int>(lg->color_space);
+        out->hue_interpolation  = static_cast<int>(lg->hue_interpolation);
     } catch (...) {
     }
 }
 
-float lh_document_width(const lh_document_t* doc)
+void lh_radial_gradient_snapshot(const lh_radial_gradient_t* g,
+                                 lh_radial_gradient_snapshot_t* out,
+                                 lh_color_point_t* points,
+                                 int capacity)
 {
     try {
-        if (!doc) return 0;
-        const auto* internal =
-            reinterpret_cast<const lh_document_internal*>(doc);
-        return internal->doc->width();
+        if (!out) return;
+        *out = {};
+        if (!g) return;
+        const auto* rg = reinterpret_cast<
+            const litehtml::background_layer::radial_gradient*>(g);
+        out->position           = to_c(rg->position);
+        out->radius             = to_c(rg->radius);
+        out->color_points_count = copy_color_points(*rg, points, capacity);
+        out->color_space        = static_cast<int>(rg->color_space);
+        out->hue_interpolation  = static_cast<int>(rg->hue_interpolation);
     } catch (...) {
-        return 0;
     }
 }
 
-float lh_document_height(const lh_document_t* doc)
+void lh_conic_gradient_snapshot(const lh_conic_gradient_t* g,
+                                lh_conic_gradient_snapshot_t* out,
+                                lh_color_point_t* points,
+                                int capacity)
 {
     try {
-        if (!doc) return 0;
-        const auto* internal =
-            reinterpret_cast<const lh_document_internal*>(doc);
-        return internal->doc->height();
+        if (!out) return;
+        *out = {};
+        if (!g) return;
+        const auto* cg = reinterpret_cast<
+            const litehtml::background_layer::conic_gradient*>(g);
+        out->position           = to_c(cg->position);
+        out->angle              = cg->angle;
+        out->radius             = cg->radius;
+        out->color_points_count = copy_color_points(*cg, points, capacity);
+        out->color_space        = static_cast<int>(cg->color_space);
+        out->hue_interpolation  = static_cast<int>(cg->hue_interpolation);
     } catch (...) {
-        return 0;
     }
 }
 
 /* --------------------------------------------------------------------------
- * Document content manipulation
+ * Document lifecycle
  * -------------------------------------------------------------------------- */
 
-void lh_document_add_stylesheet(lh_document_t* doc,
-                                const char* css_text,
-                                const char* baseurl,
-                                const char* media)
-{
-    try {
-        if (!doc || !css_text || !css_text[0]) return;
-        auto* internal = reinterpret_cast<lh_document_internal*>(doc);
-
-        litehtml::css stylesheet;
-        litehtml::media_query_list_list::ptr mq;
-        if (media && media[0]) {
-            auto mq_list = litehtml::parse_media_query_list(media, internal->doc);
-            mq = std::make_shared<litehtml::media_query_list_list>();
-            mq->add(mq_list);
+/* Shared body of the create entry points; budget and limits may be null. */
+static lh_document_t* create_document(
+    const char* html,
+    lh_container_vtable_t* vtable,
+    void* user_data,
+    const char* master_css,
+    const char* user_styles,
+    const lh_budget_t* budget,
+    const lh_limits_t* limits,
+    int* abort_reason)
+{
+    if (abort_reason) *abort_reason = LH_ABORT_NONE;
+    if (!html || !vtable) return nullptr;
+
+    auto* container = new CDocumentContainer(vtable, user_data);
+    if (limits) container->limits = *limits;
+    container->parsing = true;
+    std::string shallow;
+    html = container->admit_depth(html, shallow);
+
+    std::string master = master_css ? master_css : litehtml::master_css;
+    std::string user   = user_styles ? user_styles : "";
+
+    litehtml::document::ptr doc;
+    if (budget) {
+        lh_budget_state state(*budget);
+        container->budget = &state;
+        try {
+            doc = litehtml::document::createFromString(html, container, master, user);
+        } catch (const lh_budget_exceeded&) {
+        } catch (...) {
+            container->budget = nullptr;
+            delete container;
+            throw;
         }
-        stylesheet.parse_css_stylesheet(
-            css_text,
-            baseurl ? baseurl : "",
-            internal->doc,
-            mq);
-        stylesheet.sort_selectors();
-
-        auto root = internal->doc->root();
-        if (root) {
-            root->apply_stylesheet(stylesheet);
-            root->compute_styles();
+        container->budget = nullptr;
+        /* A limit hit inside the parser only unwinds at a later safe point;
+           if none came, drop the finished document here instead. */
+        if (state.tripped != LH_ABORT_NONE) {
+            doc.reset();
+            if (abort_reason) *abort_reason = state.tripped;
         }
+    } else {
+        try {
+            doc = litehtml::document::createFromString(html, container, master, user);
+        } catch (...) {
+            delete container;
+            throw;
+        }
+    }
+
+    container->parsing = false;
+    container->prune_pending.reset();
+
+    if (!doc) {
+        delete container;
+        return nullptr;
+    }
+
+    auto* internal        = new lh_document_internal;
+    internal->doc         = doc;
+    internal->container   = container;
+    internal->master_css  = std::move(master);
+    internal->user_styles = std::move(user);
+    container->owner      = internal;
+
+    return reinterpret_cast<lh_document_t*>(internal);
+}
+
+lh_document_t* lh_document_create_from_string(
+    const char* html,
+    lh_container_vtable_t* vtable,
+    void* user_data,
+    const char* master_css,
+    const char* user_styles)
+{
+    try {
+        return create_document(html, vtable, user_data, master_css, user_styles,
+                               nullptr, nullptr, nullptr);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+lh_document_t* lh_document_create_from_string_limited(
+    const char* html,
+    lh_container_vtable_t* vtable,
+    void* user_data,
+    const char* master_css,
+    const char* user_styles,
+    const lh_budget_t* budget,
+    const lh_limits_t* limits,
+    int* abort_reason)
+{
+    try {
+        return create_document(html, vtable, user_data, master_css, user_styles,
+                               budget, limits, abort_reason);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+lh_document_t* lh_dom_parse(const char* html, const lh_limits_t* limits)
+{
+    try {
+        if (!html) return nullptr;
+        /* Parsing alone never reaches the vtable, which is all null. */
+        static lh_container_vtable_t no_callbacks = {};
+        auto* container = new CDocumentContainer(&no_callbacks, nullptr);
+        if (limits) container->limits = *limits;
+        container->parsing    = true;
+        container->parse_only = true;
+        std::string shallow;
+        html = container->admit_depth(html, shallow);
+
+        litehtml::document::ptr doc;
+        try {
+            /* Empty stylesheets are not parsed at all. */
+            doc = litehtml::document::createFromString(html, container, "", "");
+        } catch (const lh_parse_only_done&) {
+            doc = std::move(container->parsed);
+        } catch (...) {
+            delete container;
+            throw;
+        }
+        container->parsing = false;
+        container->prune_pending.reset();
+        container->parsed.reset();
+
+        if (!doc) {
+            delete container;
+            return nullptr;
+        }
+        auto* internal      = new lh_document_internal;
+        internal->doc       = doc;
+        internal->container = container;
+        container->owner    = internal;
+        return reinterpret_cast<lh_document_t*>(internal);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+uint32_t lh_document_limits_hit(const lh_document_t* doc)
+{
+    try {
+        if (!doc) return 0;
+        auto* internal = reinterpret_cast<const lh_document_internal*>(doc);
+        return internal->container->limits_hit;
+    } catch (...) {
+        return 0;
+    }
+}
+
+int lh_document_reset(lh_document_t* doc, const char* html)
+{
+    return lh_document_reset_budgeted(doc, html, nullptr, nullptr);
+}
+
+int lh_document_reset_budgeted(lh_document_t* doc,
+                               const char* html,
+                               const lh_budget_t* budget,
+                               int* abort_reason)
+{
+    if (abort_reason) *abort_reason = LH_ABORT_NONE;
+    try {
+        if (!doc || !html) return 0;
+        auto* internal = reinterpret_cast<lh_document_internal*>(doc);
+
+        /* Build the new document while the old one still holds its fonts,
+           so matching descriptions are served from the font cache. */
+        auto* container     = internal->container;
+        uint64_t old_nodes  = container->nodes;
+        uint32_t old_hit    = container->limits_hit;
+        container->nodes      = 0;
+        container->limits_hit = 0;
+        container->parsing    = true;
+        std::string shallow;
+        html = container->admit_depth(html, shallow);
+        litehtml::document::ptr fresh;
+        std::optional<lh_budget_state> state;
+        if (budget) {
+            state.emplace(*budget);
+            container->budget = &*state;
+        }
+        try {
+            fresh = litehtml::document::createFromString(
+                html, container, internal->master_css, internal->user_styles);
+        } catch (...) {
+            fresh.reset();
+        }
+        container->budget = nullptr;
+        /* As in create_document: a limit hit inside the
+           parser leaves a finished document behind; it is dropped too. */
+        if (state && state->tripped != LH_ABORT_NONE) {
+            fresh.reset();
+            if (abort_reason) *abort_reason = state->tripped;
+        }
+        container->parsing = false;
+        container->prune_pending.reset();
+        if (!fresh) {
+            container->nodes      = old_nodes;
+            container->limits_hit = old_hit;
+            return 0;
+        }
+
+        internal->doc = std::move(fresh);
+
+        /* clear() keeps the maps' bucket arrays for the next document. */
+        invalidate_indexes(internal);
+        auto& dirty = internal->dirty;
+        dirty.full           = true;
+        dirty.subtrees.clear();
+        dirty.has_old_region = false;
+        dirty.width          = -1;
+        dirty.result         = 0;
+        dirty.has_changed    = false;
+        return 1;
+    } catch (...) {
+        return 0;
+    }
+}
+
+void lh_document_destroy(lh_document_t* doc)
+{
+    try {
+        if (!doc) return;
+        auto* internal = reinterpret_cast<lh_document_internal*>(doc);
+        /* Drop the document (shared_ptr) first -- its destructor calls back into
+           the container (e.g. delete_font), so the container must still be alive. */
+        auto* container = internal->container;
+        delete internal;
+        delete container;
+    } catch (...) {
+    }
+}
+
+/* Lay out the whole document and work out which region moved, from the
+   dirty state accumulated since the previous render. */
+static float render_document(lh_document_internal* internal, float max_width)
+{
+    auto& dirty = internal->dirty;
+    bool full = dirty.full || max_width != dirty.width;
+    float old_height = internal->doc->height();
+
+    layout_changed(internal);
+    float result = internal->doc->render(max_width);
+
+    float width  = internal->doc->width();
+    float height = internal->doc->height();
+    if (full) {
+        dirty.has_changed = true;
+        dirty.changed     = litehtml::position(0, 0, width, height);
+    } else {
+        litehtml::position region = dirty.old_region;
+        bool has = dirty.has_old_region;
+        for (const auto& weak : dirty.subtrees) {
+            if (auto el = weak.lock())
+                grow_region(region, has, placement_of(internal, el.get()));
+        }
+        /* Content below a subtree that grew or shrank moves with it. */
+        if (height != old_height) {
+            float top = has ? region.top() : std::min(old_height, height);
+            region = litehtml::position(0, top, width, std::max(old_height, height) - top);
+            has    = true;
+        }
+        dirty.has_changed = has;
+        dirty.changed     = region;
+    }
+
+    dirty.full           = false;
+    dirty.subtrees.clear();
+    dirty.has_old_region = false;
+    dirty.width          = max_width;
+    dirty.result         = result;
+    return result;
+}
+
+float lh_document_render(lh_document_t* doc, float max_width)
+{
+    try {
+        if (!doc) return 0;
+        auto* internal = reinterpret_cast<lh_document_internal*>(doc);
+        return render_document(internal, max_width);
+    } catch (...) {
+        return 0;
+    }
+}
+
+int lh_document_render_budgeted(lh_document_t* doc,
+                                float max_width,
+                                const lh_budget_t* budget,
+                                float* result)
+{
+    try {
+        if (!doc) return LH_ABORT_NONE;
+        auto* internal = reinterpret_cast<lh_document_internal*>(doc);
+        if (!budget) {
+            float width = render_document(internal, max_width);
+            if (result) *result = width;
+            return LH_ABORT_NONE;
+        }
+
+        /* Layout is never unwound: once the budget runs out the pass drains
+           (see CDocumentContainer::draining) and the render tree stays
+           whole, only laid out against placeholder metrics. */
+        lh_budget_state state(*budget);
+        state.unwind      = false;
+        auto* container   = internal->container;
+        container->budget = &state;
+        try {
+            float width = render_document(internal, max_width);
+            if (result) *result = width;
+        } catch (...) {
+            container->budget = nullptr;
+            throw;
+        }
+        container->budget = nullptr;
+        if (state.tripped != LH_ABORT_NONE) {
+            /* Lay out from scratch next time, and drop positions memoized
+               from the drained pass. */
+            styles_changed(internal);
+        }
+        return state.tripped;
+    } catch (...) {
+        return LH_ABORT_NONE;
+    }
+}
+
+int lh_document_render_incremental(lh_document_t* doc,
+                                   float max_width,
+                                   float* result,
+                                   lh_position_t* changed)
+{
+    try {
+        if (!doc) return 0;
+        auto* internal = reinterpret_cast<lh_document_internal*>(doc);
+        auto& dirty = internal->dirty;
+        bool clean = !dirty.full && dirty.subtrees.empty() && !dirty.has_old_region;
+        if (clean && max_width == dirty.width) {
+            dirty.has_changed = false;
+            if (result) *result = dirty.result;
+            return 0;
+        }
+        float width = render_document(internal, max_width);
+        if (result) *result = width;
+        if (!dirty.has_changed) return 0;
+        if (changed) *changed = to_c(dirty.changed);
+        return 1;
+    } catch (...) {
+        return 0;
+    }
+}
+
+void lh_document_invalidate_layout(lh_document_t* doc)
+{
+    try {
+        if (!doc) return;
+        styles_changed(reinterpret_cast<lh_document_internal*>(doc));
+    } catch (...) {
+    }
+}
+
+int lh_document_is_layout_dirty(const lh_document_t* doc)
+{
+    try {
+        if (!doc) return 0;
+        const auto& dirty = reinterpret_cast<const lh_document_internal*>(doc)->dirty;
+        return (dirty.full || !dirty.subtrees.empty() || dirty.has_old_region) ? 1 : 0;
+    } catch (...) {
+        return 0;
+    }
+}
+
+void lh_document_draw(lh_document_t* doc,
+                       uintptr_t hdc,
+                       float x, float y,
+                       const lh_position_t* clip)
+{
+    try {
+        if (!doc) return;
+        auto* internal = reinterpret_cast<lh_document_internal*>(doc);
+
+        if (clip) {
+            litehtml::position cpp_clip = to_cpp(*clip);
+            internal->doc->draw(hdc, x, y, &cpp_clip);
+        } else {
+            internal->doc->draw(hdc, x, y, nullptr);
+        }
+    } catch (...) {
+    }
+}
+
+float lh_document_width(const lh_document_t* doc)
+{
+    try {
+        if (!doc) return 0;
+        const auto* internal =
+            reinterpret_cast<const lh_document_internal*>(doc);
+        return internal->doc->width();
+    } catch (...) {
+        return 0;
+    }
+}
+
+float lh_document_height(const lh_document_t* doc)
+{
+    try {
+        if (!doc) return 0;
+        const auto* internal =
+            reinterpret_cast<const lh_document_internal*>(doc);
+        return internal->doc->height();
+    } catch (...) {
+        return 0;
+    }
+}
+
+/* --------------------------------------------------------------------------
+ * Document content manipulation
+ * -------------------------------------------------------------------------- */
+
+void lh_document_add_stylesheet(lh_document_t* doc,
+                                const char* css_text,
+                                const char* baseurl,
+                                const char* media)
+{
+    try {
+        if (!doc || !css_text || !css_text[0]) return;
+        auto* internal = reinterpret_cast<lh_document_internal*>(doc);
+
+        litehtml::css stylesheet;
+        litehtml::media_query_list_list::ptr mq;
+        if (media && media[0]) {
+            auto mq_list = litehtml::parse_media_query_list(media, internal->doc);
+            mq = std::make_shared<litehtml::media_query_list_list>();
+            mq->add(mq_list);
+        }
+        stylesheet.parse_css_stylesheet(
+            css_text,
+            baseurl ? baseurl : "",
+            internal->doc,
+            mq);
+        stylesheet.sort_selectors();
+
+        auto root = internal->doc->root();
+        if (root) {
+            root->apply_stylesheet(stylesheet);
+            root->compute_styles();
+        }
+        styles_changed(internal);
     } catch (...) {
     }
 }
@@ -1334,7 +2491,12 @@ void lh_document_append_children_from_string(lh_document_t* doc,
         if (!doc || !parent || !html) return;
         auto* internal = reinterpret_cast<lh_document_internal*>(doc);
         auto* elem = reinterpret_cast<litehtml::element*>(parent);
+        auto& dirty = internal->dirty;
+        if (!dirty.full)
+            grow_region(dirty.old_region, dirty.has_old_region, placement_of(internal, elem));
         internal->doc->append_children_from_string(*elem, html, replace_existing != 0);
+        dirty.subtrees.push_back(elem->shared_from_this());
+        invalidate_indexes(internal);
     } catch (...) {
     }
 }
@@ -1353,6 +2515,7 @@ int lh_document_on_mouse_over(lh_document_t* doc,
         litehtml::position::vector redraw_boxes;
         bool changed = internal->doc->on_mouse_over(x, y, client_x, client_y,
                                                      redraw_boxes);
+        if (changed) styles_changed(internal);
         return changed ? 1 : 0;
     } catch (...) {
         return 0;
@@ -1369,6 +2532,7 @@ int lh_document_on_lbutton_down(lh_document_t* doc,
         litehtml::position::vector redraw_boxes;
         bool changed = internal->doc->on_lbutton_down(x, y, client_x, client_y,
                                                        redraw_boxes);
+        if (changed) styles_changed(internal);
         return changed ? 1 : 0;
     } catch (...) {
         return 0;
@@ -1385,6 +2549,7 @@ int lh_document_on_lbutton_up(lh_document_t* doc,
         litehtml::position::vector redraw_boxes;
         bool changed = internal->doc->on_lbutton_up(x, y, client_x, client_y,
                                                      redraw_boxes);
+        if (changed) styles_changed(internal);
         return changed ? 1 : 0;
     } catch (...) {
         return 0;
@@ -1398,6 +2563,7 @@ int lh_document_on_mouse_leave(lh_document_t* doc)
         auto* internal = reinterpret_cast<lh_document_internal*>(doc);
         litehtml::position::vector redraw_boxes;
         bool changed = internal->doc->on_mouse_leave(redraw_boxes);
+        if (changed) styles_changed(internal);
         return changed ? 1 : 0;
     } catch (...) {
         return 0;
@@ -1409,7 +2575,47 @@ int lh_document_media_changed(lh_document_t* doc)
     try {
         if (!doc) return 0;
         auto* internal = reinterpret_cast<lh_document_internal*>(doc);
-        return internal->doc->media_changed() ? 1 : 0;
+        bool changed = internal->doc->media_changed();
+        if (changed) styles_changed(internal);
+        return changed ? 1 : 0;
+    } catch (...) {
+        return 0;
+    }
+}
+
+static void index_ids(lh_tree_index& tree, litehtml::element* elem)
+{
+    if (const char* id = elem->get_attr("id")) {
+        if (id[0]) tree.ids.emplace(id, elem);
+    }
+    for (const auto& child : elem->children())
+        index_ids(tree, child.get());
+}
+
+lh_element_t* lh_document_element_by_id(lh_document_t* doc, const char* id)
+{
+    try {
+        if (!doc || !id || !id[0]) return nullptr;
+        auto* internal = reinterpret_cast<lh_document_internal*>(doc);
+        auto& tree = internal->tree;
+        if (!tree.ids_built) {
+            tree.ids.clear();
+            if (auto root = internal->doc->root()) index_ids(tree, root.get());
+            tree.ids_built = true;
+        }
+        auto it = tree.ids.find(id);
+        if (it == tree.ids.end()) return nullptr;
+        return reinterpret_cast<lh_element_t*>(it->second);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+uint64_t lh_document_layout_generation(const lh_document_t* doc)
+{
+    try {
+        if (!doc) return 0;
+        return reinterpret_cast<const lh_document_internal*>(doc)->layout_generation;
     } catch (...) {
         return 0;
     }
@@ -1419,6 +2625,61 @@ int lh_document_media_changed(lh_document_t* doc)
  * Element introspection
  * -------------------------------------------------------------------------- */
 
+/* The wrapper that owns elem's document, or null while it is being parsed. */
+static lh_document_internal* owner_of(const litehtml::element* elem)
+{
+    auto doc = elem->get_document();
+    if (!doc) return nullptr;
+    auto* container = dynamic_cast<CDocumentContainer*>(doc->container());
+    return container ? container->owner : nullptr;
+}
+
+static void index_subtree(lh_tree_index& tree,
+                          litehtml::element* elem,
+                          const std::vector<litehtml::element*>* siblings,
+                          int index)
+{
+    auto& node    = tree.nodes[elem];
+    node.siblings = siblings;
+    node.index    = index;
+    node.children.clear();
+    node.children.reserve(elem->children().size());
+    for (const auto& child : elem->children())
+        node.children.push_back(child.get());
+    for (size_t i = 0; i < node.children.size(); ++i)
+        index_subtree(tree, node.children[i], &node.children, static_cast<int>(i));
+}
+
+/* Look elem up in its document's tree index, building the index on first
+   use. Returns null if no index is available (e.g. during parsing). */
+static const lh_tree_index::node* tree_node(const litehtml::element* elem)
+{
+    auto* owner = owner_of(elem);
+    if (!owner) return nullptr;
+    auto& tree = owner->tree;
+    if (!tree.built) {
+        tree.nodes.clear();
+        if (auto root = owner->doc->root())
+            index_subtree(tree, root.get(), nullptr, -1);
+        tree.built = true;
+    }
+    auto it = tree.nodes.find(elem);
+    return it == tree.nodes.end() ? nullptr : &it->second;
+}
+
+/* Linear fallback: position of elem among its parent's children, or -1. */
+static int scan_index_in_parent(const litehtml::element* elem)
+{
+    auto parent = elem->parent();
+    if (!parent) return -1;
+    int i = 0;
+    for (const auto& child : parent->children()) {
+        if (child.get() == elem) return i;
+        ++i;
+    }
+    return -1;
+}
+
 lh_element_t* lh_element_parent(lh_element_t* el)
 {
     try {
@@ -1451,6 +2712,8 @@ lh_element_t* lh_element_child_at(lh_element_t* el, int index)
         const auto& kids = elem->children();
         if (index < 0 || index >= static_cast<int>(kids.size()))
             return nullptr;
+        if (const auto* node = tree_node(elem))
+            return reinterpret_cast<lh_element_t*>(node->children[index]);
         auto it = kids.begin();
         std::advance(it, index);
         return reinterpret_cast<lh_element_t*>(it->get());
@@ -1459,6 +2722,76 @@ lh_element_t* lh_element_child_at(lh_element_t* el, int index)
     }
 }
 
+lh_element_t* lh_element_first_child(lh_element_t* el)
+{
+    try {
+        if (!el) return nullptr;
+        auto* elem = reinterpret_cast<litehtml::element*>(el);
+        const auto& kids = elem->children();
+        if (kids.empty()) return nullptr;
+        return reinterpret_cast<lh_element_t*>(kids.front().get());
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+/* Sibling at offset `step` (+1 or -1) from elem, or null. */
+static lh_element_t* sibling_of(litehtml::element* elem, int step)
+{
+    if (const auto* node = tree_node(elem)) {
+        if (!node->siblings) return nullptr;
+        const auto& siblings = *node->siblings;
+        int i = node->index + step;
+        if (i < 0 || i >= static_cast<int>(siblings.size())) return nullptr;
+        return reinterpret_cast<lh_element_t*>(siblings[i]);
+    }
+    auto parent = elem->parent();
+    if (!parent) return nullptr;
+    const auto& kids = parent->children();
+    for (auto it = kids.begin(); it != kids.end(); ++it) {
+        if (it->get() != elem) continue;
+        if (step < 0) {
+            if (it == kids.begin()) return nullptr;
+            return reinterpret_cast<lh_element_t*>(std::prev(it)->get());
+        }
+        auto next = std::next(it);
+        return next == kids.end() ? nullptr : reinterpret_cast<lh_element_t*>(next->get());
+    }
+    return nullptr;
+}
+
+lh_element_t* lh_element_next_sibling(lh_element_t* el)
+{
+    try {
+        if (!el) return nullptr;
+        return sibling_of(reinterpret_cast<litehtml::element*>(el), 1);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+lh_element_t* lh_element_prev_sibling(lh_element_t* el)
+{
+    try {
+        if (!el) return nullptr;
+        return sibling_of(reinterpret_cast<litehtml::element*>(el), -1);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+int lh_element_index_in_parent(lh_element_t* el)
+{
+    try {
+        if (!el) return -1;
+        auto* elem = reinterpret_cast<litehtml::element*>(el);
+        if (const auto* node = tree_node(elem)) return node->index;
+        return scan_index_in_parent(elem);
+    } catch (...) {
+        return -1;
+    }
+}
+
 int lh_element_is_text(lh_element_t* el)
 {
     try {
@@ -1510,8 +2843,8 @@ void lh_element_get_placement(lh_element_t* el, lh_position_t* pos)
     try {
         if (!el || !pos) return;
         auto* elem = reinterpret_cast<litehtml::element*>(el);
-        litehtml::position p = elem->get_placement();
-        *pos = to_c(p);
+        auto* owner = owner_of(elem);
+        *pos = to_c(owner ? placement_of(owner, elem) : elem->get_placement());
     } catch (...) {
     }
 }
@@ -1530,6 +2863,71 @@ void lh_element_get_text(lh_element_t* el,
     }
 }
 
+/* el_text keeps its source text in a protected member. Naming it through a
+   derived class yields a plain pointer-to-member, which lets us borrow the
+   string without copying it through get_text(). */
+struct el_text_access : litehtml::el_text {
+    static const litehtml::string& text(const litehtml::el_text& el)
+    {
+        return el.*(&el_text_access::m_text);
+    }
+};
+
+static const litehtml::string* borrow_text(litehtml::element* elem)
+{
+    if (!elem->is_text()) return nullptr;
+    auto* text = dynamic_cast<litehtml::el_text*>(elem);
+    if (!text) return nullptr;
+    return &el_text_access::text(*text);
+}
+
+static void walk_text(litehtml::element* elem,
+                      void (*cb)(void* ctx, const char* text, size_t len),
+                      void* ctx,
+                      litehtml::string& scratch)
+{
+    if (const auto* text = borrow_text(elem)) {
+        if (!text->empty()) cb(ctx, text->data(), text->size());
+        return;
+    }
+    const auto& kids = elem->children();
+    if (kids.empty()) {
+        /* Leaves such as comments still contribute through get_text(). */
+        scratch.clear();
+        elem->get_text(scratch);
+        if (!scratch.empty()) cb(ctx, scratch.data(), scratch.size());
+        return;
+    }
+    for (const auto& child : kids)
+        walk_text(child.get(), cb, ctx, scratch);
+}
+
+const char* lh_element_text_ref(lh_element_t* el, size_t* len)
+{
+    try {
+        if (len) *len = 0;
+        if (!el) return nullptr;
+        const auto* text = borrow_text(reinterpret_cast<litehtml::element*>(el));
+        if (!text) return nullptr;
+        if (len) *len = text->size();
+        return text->data();
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void lh_element_text_content(lh_element_t* el,
+                             void (*cb)(void* ctx, const char* text, size_t len),
+                             void* ctx)
+{
+    try {
+        if (!el || !cb) return;
+        litehtml::string scratch;
+        walk_text(reinterpret_cast<litehtml::element*>(el), cb, ctx, scratch);
+    } catch (...) {
+    }
+}
+
 lh_element_t* lh_document_get_element_by_point(lh_document_t* doc,
                                                 float x, float y,
                                                 float client_x, float client_y)
@@ -1556,14 +2954,40 @@ lh_element_t* lh_document_get_element_by_point(lh_document_t* doc,
  * apply it to each box so callers get absolute document coordinates.
  * -------------------------------------------------------------------------- */
 
+/* Absolute origin of ri's m_pos, memoized so that sibling and descendant
+   lookups reuse their ancestors' results instead of re-walking the chain. */
+static lh_layout_cache::origin ri_origin(lh_layout_cache& cache, litehtml::render_item* ri)
+{
+    auto it = cache.origins.find(ri);
+    if (it != cache.origins.end()) return it->second;
+
+    lh_layout_cache::origin o;
+    if (auto parent = ri->parent()) o = ri_origin(cache, parent.get());
+    o.x += ri->pos().x;
+    o.y += ri->pos().y;
+    cache.origins.emplace(ri, o);
+    return o;
+}
+
 /* Compute parent-chain offset: placement.{x,y} - m_pos.{x,y} */
-static void compute_ri_offset(const std::shared_ptr<litehtml::render_item>& ri,
+static void compute_ri_offset(const litehtml::element* elem,
+                               const std::shared_ptr<litehtml::render_item>& ri,
                                float& ox, float& oy)
 {
-    litehtml::position placement = ri->get_placement();
-    litehtml::position pos = ri->pos();
-    ox = placement.x - pos.x;
-    oy = placement.y - pos.y;
+    auto* owner = owner_of(elem);
+    if (!owner) {
+        litehtml::position placement = ri->get_placement();
+        litehtml::position pos = ri->pos();
+        ox = placement.x - pos.x;
+        oy = placement.y - pos.y;
+        return;
+    }
+    ox = oy = 0;
+    if (auto parent = ri->parent()) {
+        auto o = ri_origin(owner->layout, parent.get());
+        ox = o.x;
+        oy = o.y;
+    }
 }
 
 int lh_element_get_inline_boxes_count(lh_element_t* el)
@@ -1595,7 +3019,7 @@ void lh_element_get_inline_box_at(lh_element_t* el, int index, lh_position_t* po
             return;
 
         float ox, oy;
-        compute_ri_offset(ri, ox, oy);
+        compute_ri_offset(elem, ri, ox, oy);
 
         litehtml::position box = boxes[index];
         box.x += ox;
@@ -1618,7 +3042,7 @@ void lh_element_get_inline_boxes(lh_element_t* el, lh_inline_box_callback cb, vo
         if (boxes.empty()) return;
 
         float ox, oy;
-        compute_ri_offset(ri, ox, oy);
+        compute_ri_offset(elem, ri, ox, oy);
 
         for (const auto& box_ : boxes)
         {
@@ -1654,4 +3078,282 @@ float lh_element_get_line_height(lh_element_t* el)
     }
 }
 
+const char* lh_element_get_tag_name(lh_element_t* el)
+{
+    try {
+        if (!el) return "";
+        return reinterpret_cast<litehtml::element*>(el)->get_tagName();
+    } catch (...) {
+        return "";
+    }
+}
+
+const char* lh_element_get_attr(lh_element_t* el, const char* name)
+{
+    try {
+        if (!el || !name) return nullptr;
+        return reinterpret_cast<litehtml::element*>(el)->get_attr(name);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+/* --------------------------------------------------------------------------
+ * Memory accounting
+ * -------------------------------------------------------------------------- */
+
+/* Reads html_tag's attribute map without copying it; see el_text_access. */
+struct html_tag_access : litehtml::html_tag {
+    static const litehtml::string_map& attrs(const litehtml::html_tag& el)
+    {
+        return el.*(&html_tag_access::m_attrs);
+    }
+};
+
+/* A std::list node holding a shared_ptr, plus make_shared's control block. */
+static constexpr uint64_t link_bytes =
+    2 * sizeof(void*) + sizeof(std::shared_ptr<void>) + 2 * sizeof(long);
+
+/* Heap bytes behind a string; short strings live inside the object. */
+static uint64_t heap_bytes(const std::string& s)
+{
+    return s.capacity() >= sizeof(std::string) ? s.capacity() + 1 : 0;
+}
+
+/* Entries plus bucket array of a node-based hash map. */
+template <class Map>
+static uint64_t map_bytes(const Map& m)
+{
+    return m.size() * (sizeof(typename Map::value_type) + 2 * sizeof(void*)) +
+           m.bucket_count() * sizeof(void*);
+}
+
+static void measure_dom(litehtml::element* root, lh_memory_usage_t& usage)
+{
+    std::vector<litehtml::element*> stack{root};
+    while (!stack.empty()) {
+        auto* elem = stack.back();
+        stack.pop_back();
+        usage.style_bytes += sizeof(litehtml::css_properties);
+        if (const auto* text = borrow_text(elem)) {
+            ++usage.text_nodes;
+            usage.dom_bytes += sizeof(litehtml::el_text) + link_bytes;
+            usage.string_bytes += heap_bytes(*text);
+        } else {
+            ++usage.elements;
+            usage.dom_bytes += sizeof(litehtml::html_tag) + link_bytes;
+            if (auto* tag = dynamic_cast<litehtml::html_tag*>(elem)) {
+                for (const auto& attr : html_tag_access::attrs(*tag))
+                    usage.string_bytes += sizeof(attr) + 3 * sizeof(void*) +
+                                          heap_bytes(attr.first) + heap_bytes(attr.second);
+            }
+        }
+        for (const auto& child : elem->children()) stack.push_back(child.get());
+    }
+    /* css_properties is a member of every node; report it separately. */
+    usage.dom_bytes -= usage.style_bytes;
+}
+
+static void measure_render_tree(litehtml::render_item* root, lh_memory_usage_t& usage)
+{
+    std::vector<litehtml::render_item*> stack{root};
+    while (!stack.empty()) {
+        auto* ri = stack.back();
+        stack.pop_back();
+        ++usage.render_items;
+        usage.render_bytes += sizeof(litehtml::render_item) + link_bytes;
+        for (const auto& child : ri->children()) stack.push_back(child.get());
+    }
+}
+
+/* The wrapper's own buffers; these grow lazily between layouts, so they are
+   measured on every call. Sizes only, no walks. */
+static uint64_t wrapper_bytes(const lh_document_internal* internal)
+{
+    const auto& tree = internal->tree;
+    uint64_t bytes = map_bytes(tree.nodes) +
+                     tree.nodes.size() * sizeof(litehtml::element*) + /* children vectors */
+                     map_bytes(tree.ids);
+    for (const auto& id : tree.ids) bytes += heap_bytes(id.first);
+    bytes += map_bytes(internal->layout.origins) + map_bytes(internal->layout.placements);
+
+    const auto& fonts = internal->container->fonts;
+    bytes += map_bytes(fonts.by_key) + map_bytes(fonts.handles) + heap_bytes(fonts.scratch);
+    for (const auto& font : fonts.by_key) bytes += heap_bytes(font.first);
+
+    bytes += heap_bytes(internal->master_css) + heap_bytes(internal->user_styles);
+    bytes += internal->dirty.subtrees.capacity() * sizeof(std::weak_ptr<litehtml::element>);
+    return bytes;
+}
+
+void lh_document_memory_usage(lh_document_t* doc, lh_memory_usage_t* out)
+{
+    try {
+        if (!doc || !out) return;
+        auto* internal = reinterpret_cast<lh_document_internal*>(doc);
+        if (internal->memory_generation != internal->layout_generation) {
+            lh_memory_usage_t usage = {};
+            if (auto root = internal->doc->root()) measure_dom(root.get(), usage);
+            if (auto root_render = internal->doc->root_render())
+                measure_render_tree(root_render.get(), usage);
+            internal->memory            = usage;
+            internal->memory_generation = internal->layout_generation;
+        }
+        *out               = internal->memory;
+        out->wrapper_bytes = wrapper_bytes(internal);
+    } catch (...) {
+    }
+}
+
+/* --------------------------------------------------------------------------
+ * Render cost
+ * -------------------------------------------------------------------------- */
+
+/* Every '{' outside comments and strings, except those opening an at-rule.
+   Mirrors count_css_rules in cost.rs. */
+static uint64_t count_css_rules(const std::string& css)
+{
+    uint64_t rules = 0;
+    size_t prelude = 0;
+    for (size_t i = 0; i < css.size(); ++i) {
+        char c = css[i];
+        if (c == '/' && i + 1 < css.size() && css[i + 1] == '*') {
+            size_t end = css.find("*/", i + 2);
+            if (end == std::string::npos) break;
+            i = end + 1;
+        } else if (c == '"' || c == '\'') {
+            for (++i; i < css.size() && css[i] != c; ++i)
+                if (css[i] == '\\') ++i;
+        } else if (c == '{') {
+            size_t start = css.find_first_not_of(" \t\r\n\f", prelude);
+            if (start >= i || css[start] != '@') ++rules;
+            prelude = i + 1;
+        } else if (c == '}' || c == ';') {
+            prelude = i + 1;
+        }
+    }
+    return rules;
+}
+
+void lh_document_render_cost(lh_document_t* doc, lh_render_cost_t* out)
+{
+    try {
+        if (!doc || !out) return;
+        *out = {};
+        auto* internal = reinterpret_cast<lh_document_internal*>(doc);
+        auto root = internal->doc->root();
+        if (!root) return;
+
+        std::string css;
+        std::vector<std::pair<litehtml::element*, uint64_t>> stack;
+        stack.emplace_back(root.get(), 1);
+        while (!stack.empty()) {
+            auto [elem, depth] = stack.back();
+            stack.pop_back();
+            if (const auto* text = borrow_text(elem)) {
+                out->text_bytes += text->size();
+                continue;
+            }
+            ++out->nodes;
+            out->max_depth = std::max(out->max_depth, depth);
+            if (elem->css().get_display() == litehtml::display_table_cell) ++out->table_cells;
+
+            const char* tag = elem->get_tagName();
+            if (std::strcmp(tag, "img") == 0) {
+                ++out->images;
+            } else if (std::strcmp(tag, "style") == 0) {
+                css.clear();
+                for (const auto& child : elem->children())
+                    if (const auto* text = borrow_text(child.get())) css += *text;
+                out->style_rules += count_css_rules(css);
+                continue;
+            } else if (std::strcmp(tag, "script") == 0) {
+                continue;
+            }
+            for (const auto& child : elem->children()) stack.emplace_back(child.get(), depth + 1);
+        }
+    } catch (...) {
+    }
+}
+
+/* --------------------------------------------------------------------------
+ * Links
+ * -------------------------------------------------------------------------- */
+
+void lh_document_links(lh_document_t* doc, lh_link_callback cb, void* ctx)
+{
+    try {
+        if (!doc || !cb) return;
+        auto* internal = reinterpret_cast<lh_document_internal*>(doc);
+        auto root = internal->doc->root();
+        if (!root) return;
+
+        /* Each entry carries the href of its innermost enclosing link.
+           Children are pushed in reverse so they pop in document order. */
+        std::vector<std::pair<litehtml::element*, const char*>> stack;
+        stack.emplace_back(root.get(), nullptr);
+        while (!stack.empty()) {
+            auto [elem, href] = stack.back();
+            stack.pop_back();
+            if (borrow_text(elem)) {
+                if (href) {
+                    lh_position_t pos = to_c(placement_of(internal, elem));
+                    cb(href, &pos, ctx);
+                }
+                continue;
+            }
+            if (std::strcmp(elem->get_tagName(), "a") == 0) {
+                if (const char* own = elem->get_attr("href")) href = own;
+            }
+            const auto& children = elem->children();
+            for (auto it = children.rbegin(); it != children.rend(); ++it)
+                stack.emplace_back(it->get(), href);
+        }
+    } catch (...) {
+    }
+}
+
+/* --------------------------------------------------------------------------
+ * Text leaves
+ * -------------------------------------------------------------------------- */
+
+void lh_document_text_leaves(lh_document_t* doc, lh_text_leaf_callback cb, void* ctx)
+{
+    try {
+        if (!doc || !cb) return;
+        auto* internal = reinterpret_cast<lh_document_internal*>(doc);
+        auto root = internal->doc->root();
+        if (!root) return;
+
+        litehtml::string scratch;
+        std::vector<litehtml::element*> stack;
+        stack.push_back(root.get());
+        while (!stack.empty()) {
+            auto* elem = stack.back();
+            stack.pop_back();
+            if (elem->is_text()) {
+                const auto* text = borrow_text(elem);
+                if (!text) {
+                    scratch.clear();
+                    elem->get_text(scratch);
+                    text = &scratch;
+                }
+                auto parent = elem->parent();
+                auto box = placement_of(internal, elem);
+                if (box.width <= 0 && parent) box = placement_of(internal, parent.get());
+                auto font = elem->css().get_font();
+                if (!font && parent) font = parent->css().get_font();
+                lh_position_t pos = to_c(box);
+                cb(reinterpret_cast<lh_element_t*>(elem), text->data(), text->size(),
+                   &pos, font, ctx);
+                continue;
+            }
+            const auto& children = elem->children();
+            for (auto it = children.rbegin(); it != children.rend(); ++it)
+                stack.push_back(it->get());
+        }
+    } catch (...) {
+    }
+}
+
 } /* extern "C" */
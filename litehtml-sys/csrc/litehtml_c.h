@@ -124,6 +124,17 @@ const char* lh_font_description_emphasis_style(const lh_font_description_t* fd);
 lh_web_color_t lh_font_description_emphasis_color(const lh_font_description_t* fd);
 int   lh_font_description_emphasis_position(const lh_font_description_t* fd);
 
+#ifdef LH_BENCH
+/* A standalone font_description, for calling create_font outside layout
+   (benches/callbacks.rs). Other fields keep their defaults. Free it with
+   lh_font_description_destroy. Only built with the `bench` feature. */
+lh_font_description_t* lh_font_description_create(const char* family,
+                                                  float size,
+                                                  int weight,
+                                                  int style);
+void lh_font_description_destroy(lh_font_description_t* fd);
+#endif
+
 /* list_marker getters */
 const char*    lh_list_marker_image(const lh_list_marker_t* m);
 const char*    lh_list_marker_baseurl(const lh_list_marker_t* m);
@@ -170,6 +181,103 @@ lh_web_color_t lh_conic_gradient_color_point_color(const lh_conic_gradient_t* g,
 int            lh_conic_gradient_color_space(const lh_conic_gradient_t* g);
 int            lh_conic_gradient_hue_interpolation(const lh_conic_gradient_t* g);
 
+/* --------------------------------------------------------------------------
+ * Snapshots -- every field of an opaque type filled in a single call
+ *
+ * String pointers borrow from the C++ object and stay valid only as long
+ * as the opaque pointer they were read from (i.e. for the duration of the
+ * callback that received it).
+ * -------------------------------------------------------------------------- */
+
+typedef struct lh_color_point {
+    float          offset;
+    lh_web_color_t color;
+} lh_color_point_t;
+
+typedef struct lh_font_description_snapshot {
+    const char*    family;
+    const char*    emphasis_style;
+    float          size;
+    int            style;
+    int            weight;
+    int            decoration_line;
+    int            decoration_thickness_is_predefined;
+    int            decoration_thickness_predef;
+    float          decoration_thickness_value;
+    int            decoration_style;
+    lh_web_color_t decoration_color;
+    lh_web_color_t emphasis_color;
+    int            emphasis_position;
+} lh_font_description_snapshot_t;
+
+typedef struct lh_list_marker_snapshot {
+    const char*    image;
+    const char*    baseurl;
+    uintptr_t      font;
+    int            marker_type;
+    lh_web_color_t color;
+    lh_position_t  pos;
+    int            index;
+} lh_list_marker_snapshot_t;
+
+typedef struct lh_background_layer_snapshot {
+    lh_position_t        border_box;
+    lh_border_radiuses_t border_radius;
+    lh_position_t        clip_box;
+    lh_position_t        origin_box;
+    int                  attachment;
+    int                  repeat;
+    int                  is_root;
+} lh_background_layer_snapshot_t;
+
+/* color_points_count is the total number of stops in the gradient. At most
+   `capacity` of them are written to the caller's `points` buffer; if the
+   total is larger, call again with a buffer of at least that size. */
+
+typedef struct lh_linear_gradient_snapshot {
+    lh_point_t start;
+    lh_point_t end;
+    int        color_points_count;
+    int        color_space;
+    int        hue_interpolation;
+} lh_linear_gradient_snapshot_t;
+
+typedef struct lh_radial_gradient_snapshot {
+    lh_point_t position;
+    lh_point_t radius;
+    int        color_points_count;
+    int        color_space;
+    int        hue_interpolation;
+} lh_radial_gradient_snapshot_t;
+
+typedef struct lh_conic_gradient_snapshot {
+    lh_point_t position;
+    float      angle;
+    float      radius;
+    int        color_points_count;
+    int        color_space;
+    int        hue_interpolation;
+} lh_conic_gradient_snapshot_t;
+
+void lh_font_description_snapshot(const lh_font_description_t* fd,
+                                  lh_font_description_snapshot_t* out);
+void lh_list_marker_snapshot(const lh_list_marker_t* m,
+                             lh_list_marker_snapshot_t* out);
+void lh_background_layer_snapshot(const lh_background_layer_t* layer,
+                                  lh_background_layer_snapshot_t* out);
+void lh_linear_gradient_snapshot(const lh_linear_gradient_t* g,
+                                 lh_linear_gradient_snapshot_t* out,
+                                 lh_color_point_t* points,
+                                 int capacity);
+void lh_radial_gradient_snapshot(const lh_radial_gradient_t* g,
+                                 lh_radial_gradient_snapshot_t* out,
+                                 lh_color_point_t* points,
+                                 int capacity);
+void lh_conic_gradient_snapshot(const lh_conic_gradient_t* g,
+                                lh_conic_gradient_snapshot_t* out,
+                                lh_color_point_t* points,
+                                int capacity);
+
 /* --------------------------------------------------------------------------
  * Container callback vtable
  *
@@ -304,6 +412,48 @@ typedef struct lh_container_vtable {
 /* Element handle -- borrowed pointer, valid while the parent document is alive */
 typedef struct lh_element lh_element_t;
 
+/* --------------------------------------------------------------------------
+ * Work budgets
+ *
+ * A budget bounds the work done by one create or render call. It is checked
+ * at safe points: container callbacks made during style and layout
+ * (create_font, text_width, pt_to_px, get_image_size, import_css,
+ * transform_text), each of which counts as one step, plus one step per
+ * element created while parsing. Once a limit is hit the call unwinds at
+ * the next safe point outside the HTML parser and reports why.
+ * -------------------------------------------------------------------------- */
+
+#define LH_ABORT_NONE      0
+#define LH_ABORT_CANCELLED 1
+#define LH_ABORT_STEPS     2
+#define LH_ABORT_TIME      3
+
+typedef struct lh_budget {
+    /* Aborts once the byte is non-zero. Read atomically, so another thread
+       may set it while the call runs. May be NULL. */
+    const uint8_t* cancel_flag;
+    uint64_t       max_steps;  /* 0 = unlimited */
+    uint64_t       max_micros; /* wall-clock limit for the call, 0 = unlimited */
+} lh_budget_t;
+
+/* --------------------------------------------------------------------------
+ * Resource limits
+ *
+ * Limits on the size of the DOM built from the HTML. Unlike a budget they
+ * never fail the call: nodes past max_nodes (elements and text words, in
+ * document order) are dropped while parsing, and elements nested deeper
+ * than max_depth lose their children before styles are applied. The node
+ * count carries over to content appended later.
+ * -------------------------------------------------------------------------- */
+
+#define LH_LIMIT_NODES 0x1
+#define LH_LIMIT_DEPTH 0x2
+
+typedef struct lh_limits {
+    uint64_t max_nodes; /* 0 = unlimited */
+    uint32_t max_depth; /* 0 = unlimited; the root element is at depth 1 */
+} lh_limits_t;
+
 /* --------------------------------------------------------------------------
  * Document lifecycle
  * -------------------------------------------------------------------------- */
@@ -316,8 +466,85 @@ lh_document_t* lh_document_create_from_string(
     const char* user_styles);
 
 void  lh_document_destroy(lh_document_t* doc);
+
+/* Replace the document's content with freshly parsed html, keeping the
+   container, the stylesheets it was created with and the wrapper's internal
+   buffers. Fonts whose descriptions match one used by the old content keep
+   their handles; create_font/delete_font are only called for the rest.
+   Returns non-zero on success; on failure the old content is kept. */
+int   lh_document_reset(lh_document_t* doc, const char* html);
 float lh_document_render(lh_document_t* doc, float max_width);
 
+/* lh_document_create_from_string under a budget and resource limits;
+   budget and limits may each be NULL. Returns NULL with *abort_reason set
+   to one of LH_ABORT_* if the budget ran out, or to LH_ABORT_NONE on
+   success and on other failures. */
+lh_document_t* lh_document_create_from_string_limited(
+    const char* html,
+    lh_container_vtable_t* vtable,
+    void* user_data,
+    const char* master_css,
+    const char* user_styles,
+    const lh_budget_t* budget,
+    const lh_limits_t* limits,
+    int* abort_reason);
+
+/* lh_document_reset under a budget. Returns non-zero on success; if the
+   budget runs out, writes the reason to *abort_reason and keeps the old
+   content, as on any other failure. budget may be NULL. */
+int lh_document_reset_budgeted(lh_document_t* doc,
+                               const char* html,
+                               const lh_budget_t* budget,
+                               int* abort_reason);
+
+/* LH_LIMIT_* flags for the limits that truncated the document's DOM.
+   Cleared by lh_document_reset. */
+uint32_t lh_document_limits_hit(const lh_document_t* doc);
+
+/* Build the element tree of html without styling it: no stylesheet is
+   parsed or applied, no font is created and no render tree is built, and
+   no container callback is ever made. Elements carry their tag names,
+   attributes and text, so tree traversal, lh_element_get_attr,
+   lh_document_element_by_id and the text functions work; anything that
+   reads computed styles or layout reports defaults. The result must not be
+   rendered, drawn or reset. Free it with lh_document_destroy. limits may
+   be NULL. */
+lh_document_t* lh_dom_parse(const char* html, const lh_limits_t* limits);
+
+/* lh_document_render under a budget. Writes the render result to *result
+   and returns LH_ABORT_NONE, or returns the abort reason. Once the budget
+   runs out the pass finishes without calling the container (text measures
+   zero wide, images keep their size), so the layout it leaves is
+   meaningless but the document stays usable: the next render lays out from
+   scratch and matches a fresh document's. */
+int lh_document_render_budgeted(lh_document_t* doc,
+                                float max_width,
+                                const lh_budget_t* budget,
+                                float* result);
+
+/* Render only if something changed since the last render (a DOM or style
+   change, an element state change, lh_document_invalidate_layout, or a
+   different max_width); otherwise keep the current layout.
+   Writes the render result to *result. Returns non-zero and writes the
+   region that must be repainted to *changed when the layout may differ;
+   after a DOM change this is the mutated parents' old and new boxes,
+   extended to the bottom of the document if its height changed. Only the
+   decision to render and the reported region are incremental: a render
+   that does run lays out the whole tree, like lh_document_render. */
+int lh_document_render_incremental(lh_document_t* doc,
+                                   float max_width,
+                                   float* result,
+                                   lh_position_t* changed);
+
+/* Force the next lh_document_render_incremental to run layout and report
+   the whole document as changed, e.g. after the container learned new
+   image sizes. */
+void lh_document_invalidate_layout(lh_document_t* doc);
+
+/* Non-zero if lh_document_render_incremental would re-run layout at the
+   last max_width. */
+int lh_document_is_layout_dirty(const lh_document_t* doc);
+
 void  lh_document_draw(lh_document_t* doc,
                         uintptr_t hdc,
                         float x,
@@ -337,6 +564,11 @@ void lh_document_add_stylesheet(lh_document_t* doc,
 /* Get the root element of the document. Returns NULL if doc is NULL. */
 lh_element_t* lh_document_root(lh_document_t* doc);
 
+/* Find the first element (in document order) whose id attribute equals id.
+   Backed by an id map built on first use and rebuilt after
+   lh_document_append_children_from_string. Returns NULL if not found. */
+lh_element_t* lh_document_element_by_id(lh_document_t* doc, const char* id);
+
 /* --------------------------------------------------------------------------
  * Element introspection
  * -------------------------------------------------------------------------- */
@@ -347,9 +579,23 @@ lh_element_t* lh_element_parent(lh_element_t* el);
 /* Number of child elements. Returns 0 if el is NULL. */
 int lh_element_children_count(lh_element_t* el);
 
-/* Get the child at the given index. Returns NULL if out of bounds. */
+/* Get the child at the given index. Returns NULL if out of bounds.
+   O(1) once the document's tree index has been built. */
 lh_element_t* lh_element_child_at(lh_element_t* el, int index);
 
+/* First child, or NULL if el has no children. */
+lh_element_t* lh_element_first_child(lh_element_t* el);
+
+/* Next / previous sibling, or NULL at either end or for the root. */
+lh_element_t* lh_element_next_sibling(lh_element_t* el);
+lh_element_t* lh_element_prev_sibling(lh_element_t* el);
+
+/* Position of el among its parent's children; -1 for the root or NULL.
+
+   Sibling and index queries use a per-document tree index built in one pass
+   on first use and rebuilt after lh_document_append_children_from_string. */
+int lh_element_index_in_parent(lh_element_t* el);
+
 /* Returns non-zero if the element is a text node. */
 int lh_element_is_text(lh_element_t* el);
 
@@ -359,7 +605,8 @@ uintptr_t lh_element_get_font(lh_element_t* el);
 /* Get the font size from the element's computed CSS. Returns 0.0 on error. */
 float lh_element_get_font_size(lh_element_t* el);
 
-/* Get the element's absolute pixel bounding box after layout. */
+/* Get the element's absolute pixel bounding box after layout. Memoized per
+   layout generation, so repeated lookups are O(1) until the next render. */
 void lh_element_get_placement(lh_element_t* el, lh_position_t* pos);
 
 /* Get the element's recursive text content via callback. */
@@ -367,6 +614,17 @@ void lh_element_get_text(lh_element_t* el,
                          void (*cb)(void* ctx, const char* text),
                          void* ctx);
 
+/* Borrow the text of a text node. Returns a pointer into litehtml's own
+   storage, valid while the parent document is alive, and writes its byte
+   length to *len. Returns NULL (and *len = 0) for non-text elements. */
+const char* lh_element_text_ref(lh_element_t* el, size_t* len);
+
+/* Walk el's subtree in document order and call cb once per text node with
+   a borrowed, non-null-terminated slice of its text. */
+void lh_element_text_content(lh_element_t* el,
+                             void (*cb)(void* ctx, const char* text, size_t len),
+                             void* ctx);
+
 /* Hit testing: find the deepest element at document coordinates (x, y). */
 lh_element_t* lh_document_get_element_by_point(lh_document_t* doc,
                                                 float x, float y,
@@ -393,6 +651,14 @@ int lh_element_get_text_align(lh_element_t* el);
 /* Get the computed line-height in pixels. */
 float lh_element_get_line_height(lh_element_t* el);
 
+/* Lower-case tag name of an element; "" for text nodes. Valid while the
+   element is alive. */
+const char* lh_element_get_tag_name(lh_element_t* el);
+
+/* Value of attribute name as written in the source, or NULL if absent.
+   Valid until the attribute changes or the element is destroyed. */
+const char* lh_element_get_attr(lh_element_t* el, const char* name);
+
 /* Parse an HTML fragment and append the resulting elements as children of parent.
    If replace_existing is non-zero, existing children are removed first.
    Requires a subsequent render() to update layout. */
@@ -420,6 +686,65 @@ int lh_document_on_lbutton_up(lh_document_t* doc,
 int lh_document_on_mouse_leave(lh_document_t* doc);
 int lh_document_media_changed(lh_document_t* doc);
 
+/* Counter bumped by every call that may move boxes: render, stylesheet and
+   DOM changes, and mouse events or media changes that alter element state.
+   Cached positions derived from an older generation are stale. */
+uint64_t lh_document_layout_generation(const lh_document_t* doc);
+
+/* --------------------------------------------------------------------------
+ * Memory accounting
+ *
+ * Estimates from object sizes and string capacities; allocator overhead and
+ * the parsed stylesheets are not included. The DOM and render tree are
+ * walked once per layout generation, so repeated calls are cheap.
+ * -------------------------------------------------------------------------- */
+
+typedef struct lh_memory_usage {
+    uint64_t elements;      /* element nodes */
+    uint64_t text_nodes;    /* text and whitespace nodes */
+    uint64_t render_items;
+    uint64_t dom_bytes;     /* node objects and child links, excluding styles */
+    uint64_t style_bytes;   /* computed styles, one per node */
+    uint64_t render_bytes;  /* render items and their child links */
+    uint64_t string_bytes;  /* text content and attribute names and values */
+    uint64_t wrapper_bytes; /* tree index, layout cache, font cache, stylesheets */
+} lh_memory_usage_t;
+
+void lh_document_memory_usage(lh_document_t* doc, lh_memory_usage_t* out);
+
+/* --------------------------------------------------------------------------
+ * Render cost
+ * -------------------------------------------------------------------------- */
+
+typedef struct lh_render_cost {
+    uint64_t nodes;       /* element nodes */
+    uint64_t max_depth;   /* root element at depth 1 */
+    uint64_t table_cells; /* elements computed as display: table-cell */
+    uint64_t text_bytes;  /* text outside <style> and <script> */
+    uint64_t images;      /* <img> elements */
+    uint64_t style_rules; /* rule blocks in <style> elements, at-rules excluded */
+} lh_render_cost_t;
+
+/* Measure the features that drive style and layout cost on the parsed
+   document. Walks the whole DOM. */
+void lh_document_render_cost(lh_document_t* doc, lh_render_cost_t* out);
+
+/* --------------------------------------------------------------------------
+ * Links
+ * -------------------------------------------------------------------------- */
+
+/* Report every text leaf inside an <a href> element, in document order,
+   with the href of its innermost link and its absolute box. */
+typedef void (*lh_link_callback)(const char* href, const lh_position_t* pos, void* ctx);
+void lh_document_links(lh_document_t* doc, lh_link_callback cb, void* ctx);
+
+/* Report every text leaf in document order with its text, absolute box and
+   font. A leaf with a zero-width box or no font reports its parent's, as
+   litehtml does not place every text node itself. */
+typedef void (*lh_text_leaf_callback)(lh_element_t* el, const char* text, size_t len,
+                                      const lh_position_t* pos, uintptr_t font, void* ctx);
+void lh_document_text_leaves(lh_document_t* doc, lh_text_leaf_callback cb, void* ctx);
+
 #ifdef __cplusplus
 }
 #endif
@@ -307,6 +307,19 @@ unsafe extern "C" {
         fd: *const lh_font_description_t,
     ) -> ::std::os::raw::c_int;
 }
+#[cfg(feature = "bench")]
+unsafe extern "C" {
+    pub fn lh_font_description_create(
+        family: *const ::std::os::raw::c_char,
+        size: f32,
+        weight: ::std::os::raw::c_int,
+        style: ::std::os::raw::c_int,
+    ) -> *mut lh_font_description_t;
+}
+#[cfg(feature = "bench")]
+unsafe extern "C" {
+    pub fn lh_font_description_destroy(fd: *mut lh_font_description_t);
+}
 unsafe extern "C" {
     pub fn lh_list_marker_image(m: *const lh_list_marker_t) -> *const ::std::os::raw::c_char;
 }
@@ -452,6 +465,279 @@ unsafe extern "C" {
         g: *const lh_conic_gradient_t,
     ) -> ::std::os::raw::c_int;
 }
+#[repr(C)]
+#[derive(Debug, Default, Copy, Clone)]
+pub struct lh_color_point {
+    pub offset: f32,
+    pub color: lh_web_color_t,
+}
+#[allow(clippy::unnecessary_operation, clippy::identity_op)]
+const _: () = {
+    ["Size of lh_color_point"][::std::mem::size_of::<lh_color_point>() - 12usize];
+    ["Alignment of lh_color_point"][::std::mem::align_of::<lh_color_point>() - 4usize];
+    ["Offset of field: lh_color_point::offset"]
+        [::std::mem::offset_of!(lh_color_point, offset) - 0usize];
+    ["Offset of field: lh_color_point::color"]
+        [::std::mem::offset_of!(lh_color_point, color) - 4usize];
+};
+pub type lh_color_point_t = lh_color_point;
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct lh_font_description_snapshot {
+    pub family: *const ::std::os::raw::c_char,
+    pub emphasis_style: *const ::std::os::raw::c_char,
+    pub size: f32,
+    pub style: ::std::os::raw::c_int,
+    pub weight: ::std::os::raw::c_int,
+    pub decoration_line: ::std::os::raw::c_int,
+    pub decoration_thickness_is_predefined: ::std::os::raw::c_int,
+    pub decoration_thickness_predef: ::std::os::raw::c_int,
+    pub decoration_thickness_value: f32,
+    pub decoration_style: ::std::os::raw::c_int,
+    pub decoration_color: lh_web_color_t,
+    pub emphasis_color: lh_web_color_t,
+    pub emphasis_position: ::std::os::raw::c_int,
+}
+#[allow(clippy::unnecessary_operation, clippy::identity_op)]
+const _: () = {
+    ["Size of lh_font_description_snapshot"]
+        [::std::mem::size_of::<lh_font_description_snapshot>() - 72usize];
+    ["Alignment of lh_font_description_snapshot"]
+        [::std::mem::align_of::<lh_font_description_snapshot>() - 8usize];
+    ["Offset of field: lh_font_description_snapshot::family"]
+        [::std::mem::offset_of!(lh_font_description_snapshot, family) - 0usize];
+    ["Offset of field: lh_font_description_snapshot::emphasis_style"]
+        [::std::mem::offset_of!(lh_font_description_snapshot, emphasis_style) - 8usize];
+    ["Offset of field: lh_font_description_snapshot::size"]
+        [::std::mem::offset_of!(lh_font_description_snapshot, size) - 16usize];
+    ["Offset of field: lh_font_description_snapshot::style"]
+        [::std::mem::offset_of!(lh_font_description_snapshot, style) - 20usize];
+    ["Offset of field: lh_font_description_snapshot::weight"]
+        [::std::mem::offset_of!(lh_font_description_snapshot, weight) - 24usize];
+    ["Offset of field: lh_font_description_snapshot::decoration_line"]
+        [::std::mem::offset_of!(lh_font_description_snapshot, decoration_line) - 28usize];
+    ["Offset of field: lh_font_description_snapshot::decoration_thickness_is_predefined"]
+        [::std::mem::offset_of!(lh_font_description_snapshot, decoration_thickness_is_predefined) - 32usize];
+    ["Offset of field: lh_font_description_snapshot::decoration_thickness_predef"]
+        [::std::mem::offset_of!(lh_font_description_snapshot, decoration_thickness_predef) - 36usize];
+    ["Offset of field: lh_font_description_snapshot::decoration_thickness_value"]
+        [::std::mem::offset_of!(lh_font_description_snapshot, decoration_thickness_value) - 40usize];
+    ["Offset of field: lh_font_description_snapshot::decoration_style"]
+        [::std::mem::offset_of!(lh_font_description_snapshot, decoration_style) - 44usize];
+    ["Offset of field: lh_font_description_snapshot::decoration_color"]
+        [::std::mem::offset_of!(lh_font_description_snapshot, decoration_color) - 48usize];
+    ["Offset of field: lh_font_description_snapshot::emphasis_color"]
+        [::std::mem::offset_of!(lh_font_description_snapshot, emphasis_color) - 56usize];
+    ["Offset of field: lh_font_description_snapshot::emphasis_position"]
+        [::std::mem::offset_of!(lh_font_description_snapshot, emphasis_position) - 64usize];
+};
+impl Default for lh_font_description_snapshot {
+    fn default() -> Self {
+        let mut s = ::std::mem::MaybeUninit::<Self>::uninit();
+        unsafe {
+            ::std::ptr::write_bytes(s.as_mut_ptr(), 0, 1);
+            s.assume_init()
+        }
+    }
+}
+pub type lh_font_description_snapshot_t = lh_font_description_snapshot;
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct lh_list_marker_snapshot {
+    pub image: *const ::std::os::raw::c_char,
+    pub baseurl: *const ::std::os::raw::c_char,
+    pub font: usize,
+    pub marker_type: ::std::os::raw::c_int,
+    pub color: lh_web_color_t,
+    pub pos: lh_position_t,
+    pub index: ::std::os::raw::c_int,
+}
+#[allow(clippy::unnecessary_operation, clippy::identity_op)]
+const _: () = {
+    ["Size of lh_list_marker_snapshot"][::std::mem::size_of::<lh_list_marker_snapshot>() - 56usize];
+    ["Alignment of lh_list_marker_snapshot"]
+        [::std::mem::align_of::<lh_list_marker_snapshot>() - 8usize];
+    ["Offset of field: lh_list_marker_snapshot::image"]
+        [::std::mem::offset_of!(lh_list_marker_snapshot, image) - 0usize];
+    ["Offset of field: lh_list_marker_snapshot::baseurl"]
+        [::std::mem::offset_of!(lh_list_marker_snapshot, baseurl) - 8usize];
+    ["Offset of field: lh_list_marker_snapshot::font"]
+        [::std::mem::offset_of!(lh_list_marker_snapshot, font) - 16usize];
+    ["Offset of field: lh_list_marker_snapshot::marker_type"]
+        [::std::mem::offset_of!(lh_list_marker_snapshot, marker_type) - 24usize];
+    ["Offset of field: lh_list_marker_snapshot::color"]
+        [::std::mem::offset_of!(lh_list_marker_snapshot, color) - 28usize];
+    ["Offset of field: lh_list_marker_snapshot::pos"]
+        [::std::mem::offset_of!(lh_list_marker_snapshot, pos) - 36usize];
+    ["Offset of field: lh_list_marker_snapshot::index"]
+        [::std::mem::offset_of!(lh_list_marker_snapshot, index) - 52usize];
+};
+impl Default for lh_list_marker_snapshot {
+    fn default() -> Self {
+        let mut s = ::std::mem::MaybeUninit::<Self>::uninit();
+        unsafe {
+            ::std::ptr::write_bytes(s.as_mut_ptr(), 0, 1);
+            s.assume_init()
+        }
+    }
+}
+pub type lh_list_marker_snapshot_t = lh_list_marker_snapshot;
+#[repr(C)]
+#[derive(Debug, Default, Copy, Clone)]
+pub struct lh_background_layer_snapshot {
+    pub border_box: lh_position_t,
+    pub border_radius: lh_border_radiuses_t,
+    pub clip_box: lh_position_t,
+    pub origin_box: lh_position_t,
+    pub attachment: ::std::os::raw::c_int,
+    pub repeat: ::std::os::raw::c_int,
+    pub is_root: ::std::os::raw::c_int,
+}
+#[allow(clippy::unnecessary_operation, clippy::identity_op)]
+const _: () = {
+    ["Size of lh_background_layer_snapshot"]
+        [::std::mem::size_of::<lh_background_layer_snapshot>() - 92usize];
+    ["Alignment of lh_background_layer_snapshot"]
+        [::std::mem::align_of::<lh_background_layer_snapshot>() - 4usize];
+    ["Offset of field: lh_background_layer_snapshot::border_box"]
+        [::std::mem::offset_of!(lh_background_layer_snapshot, border_box) - 0usize];
+    ["Offset of field: lh_background_layer_snapshot::border_radius"]
+        [::std::mem::offset_of!(lh_background_layer_snapshot, border_radius) - 16usize];
+    ["Offset of field: lh_background_layer_snapshot::clip_box"]
+        [::std::mem::offset_of!(lh_background_layer_snapshot, clip_box) - 48usize];
+    ["Offset of field: lh_background_layer_snapshot::origin_box"]
+        [::std::mem::offset_of!(lh_background_layer_snapshot, origin_box) - 64usize];
+    ["Offset of field: lh_background_layer_snapshot::attachment"]
+        [::std::mem::offset_of!(lh_background_layer_snapshot, attachment) - 80usize];
+    ["Offset of field: lh_background_layer_snapshot::repeat"]
+        [::std::mem::offset_of!(lh_background_layer_snapshot, repeat) - 84usize];
+    ["Offset of field: lh_background_layer_snapshot::is_root"]
+        [::std::mem::offset_of!(lh_background_layer_snapshot, is_root) - 88usize];
+};
+pub type lh_background_layer_snapshot_t = lh_background_layer_snapshot;
+#[repr(C)]
+#[derive(Debug, Default, Copy, Clone)]
+pub struct lh_linear_gradient_snapshot {
+    pub start: lh_point_t,
+    pub end: lh_point_t,
+    pub color_points_count: ::std::os::raw::c_int,
+    pub color_space: ::std::os::raw::c_int,
+    pub hue_interpolation: ::std::os::raw::c_int,
+}
+#[allow(clippy::unnecessary_operation, clippy::identity_op)]
+const _: () = {
+    ["Size of lh_linear_gradient_snapshot"]
+        [::std::mem::size_of::<lh_linear_gradient_snapshot>() - 28usize];
+    ["Alignment of lh_linear_gradient_snapshot"]
+        [::std::mem::align_of::<lh_linear_gradient_snapshot>() - 4usize];
+    ["Offset of field: lh_linear_gradient_snapshot::start"]
+        [::std::mem::offset_of!(lh_linear_gradient_snapshot, start) - 0usize];
+    ["Offset of field: lh_linear_gradient_snapshot::end"]
+        [::std::mem::offset_of!(lh_linear_gradient_snapshot, end) - 8usize];
+    ["Offset of field: lh_linear_gradient_snapshot::color_points_count"]
+        [::std::mem::offset_of!(lh_linear_gradient_snapshot, color_points_count) - 16usize];
+    ["Offset of field: lh_linear_gradient_snapshot::color_space"]
+        [::std::mem::offset_of!(lh_linear_gradient_snapshot, color_space) - 20usize];
+    ["Offset of field: lh_linear_gradient_snapshot::hue_interpolation"]
+        [::std::mem::offset_of!(lh_linear_gradient_snapshot, hue_interpolation) - 24usize];
+};
+pub type lh_linear_gradient_snapshot_t = lh_linear_gradient_snapshot;
+#[repr(C)]
+#[derive(Debug, Default, Copy, Clone)]
+pub struct lh_radial_gradient_snapshot {
+    pub position: lh_point_t,
+    pub radius: lh_point_t,
+    pub color_points_count: ::std::os::raw::c_int,
+    pub color_space: ::std::os::raw::c_int,
+    pub hue_interpolation: ::std::os::raw::c_int,
+}
+#[allow(clippy::unnecessary_operation, clippy::identity_op)]
+const _: () = {
+    ["Size of lh_radial_gradient_snapshot"]
+        [::std::mem::size_of::<lh_radial_gradient_snapshot>() - 28usize];
+    ["Alignment of lh_radial_gradient_snapshot"]
+        [::std::mem::align_of::<lh_radial_gradient_snapshot>() - 4usize];
+    ["Offset of field: lh_radial_gradient_snapshot::position"]
+        [::std::mem::offset_of!(lh_radial_gradient_snapshot, position) - 0usize];
+    ["Offset of field: lh_radial_gradient_snapshot::radius"]
+        [::std::mem::offset_of!(lh_radial_gradient_snapshot, radius) - 8usize];
+    ["Offset of field: lh_radial_gradient_snapshot::color_points_count"]
+        [::std::mem::offset_of!(lh_radial_gradient_snapshot, color_points_count) - 16usize];
+    ["Offset of field: lh_radial_gradient_snapshot::color_space"]
+        [::std::mem::offset_of!(lh_radial_gradient_snapshot, color_space) - 20usize];
+    ["Offset of field: lh_radial_gradient_snapshot::hue_interpolation"]
+        [::std::mem::offset_of!(lh_radial_gradient_snapshot, hue_interpolation) - 24usize];
+};
+pub type lh_radial_gradient_snapshot_t = lh_radial_gradient_snapshot;
+#[repr(C)]
+#[derive(Debug, Default, Copy, Clone)]
+pub struct lh_conic_gradient_snapshot {
+    pub position: lh_point_t,
+    pub angle: f32,
+    pub radius: f32,
+    pub color_points_count: ::std::os::raw::c_int,
+    pub color_space: ::std::os::raw::c_int,
+    pub hue_interpolation: ::std::os::raw::c_int,
+}
+#[allow(clippy::unnecessary_operation, clippy::identity_op)]
+const _: () = {
+    ["Size of lh_conic_gradient_snapshot"]
+        [::std::mem::size_of::<lh_conic_gradient_snapshot>() - 28usize];
+    ["Alignment of lh_conic_gradient_snapshot"]
+        [::std::mem::align_of::<lh_conic_gradient_snapshot>() - 4usize];
+    ["Offset of field: lh_conic_gradient_snapshot::position"]
+        [::std::mem::offset_of!(lh_conic_gradient_snapshot, position) - 0usize];
+    ["Offset of field: lh_conic_gradient_snapshot::angle"]
+        [::std::mem::offset_of!(lh_conic_gradient_snapshot, angle) - 8usize];
+    ["Offset of field: lh_conic_gradient_snapshot::radius"]
+        [::std::mem::offset_of!(lh_conic_gradient_snapshot, radius) - 12usize];
+    ["Offset of field: lh_conic_gradient_snapshot::color_points_count"]
+        [::std::mem::offset_of!(lh_conic_gradient_snapshot, color_points_count) - 16usize];
+    ["Offset of field: lh_conic_gradient_snapshot::color_space"]
+        [::std::mem::offset_of!(lh_conic_gradient_snapshot, color_space) - 20usize];
+    ["Offset of field: lh_conic_gradient_snapshot::hue_interpolation"]
+        [::std::mem::offset_of!(lh_conic_gradient_snapshot, hue_interpolation) - 24usize];
+};
+pub type lh_conic_gradient_snapshot_t = lh_conic_gradient_snapshot;
+unsafe extern "C" {
+    pub fn lh_font_description_snapshot(
+        fd: *const lh_font_description_t,
+        out: *mut lh_font_description_snapshot_t,
+    );
+}
+unsafe extern "C" {
+    pub fn lh_list_marker_snapshot(m: *const lh_list_marker_t, out: *mut lh_list_marker_snapshot_t);
+}
+unsafe extern "C" {
+    pub fn lh_background_layer_snapshot(
+        layer: *const lh_background_layer_t,
+        out: *mut lh_background_layer_snapshot_t,
+    );
+}
+unsafe extern "C" {
+    pub fn lh_linear_gradient_snapshot(
+        g: *const lh_linear_gradient_t,
+        out: *mut lh_linear_gradient_snapshot_t,
+        points: *mut lh_color_point_t,
+        capacity: ::std::os::raw::c_int,
+    );
+}
+unsafe extern "C" {
+    pub fn lh_radial_gradient_snapshot(
+        g: *const lh_radial_gradient_t,
+        out: *mut lh_radial_gradient_snapshot_t,
+        points: *mut lh_color_point_t,
+        capacity: ::std::os::raw::c_int,
+    );
+}
+unsafe extern "C" {
+    pub fn lh_conic_gradient_snapshot(
+        g: *const lh_conic_gradient_t,
+        out: *mut lh_conic_gradient_snapshot_t,
+        points: *mut lh_color_point_t,
+        capacity: ::std::os::raw::c_int,
+    );
+}
 pub type lh_set_string_fn = ::std::option::Option<
     unsafe extern "C" fn(ctx: *mut ::std::os::raw::c_void, text: *const ::std::os::raw::c_char),
 >;
@@ -719,6 +1005,42 @@ pub struct lh_element {
     _unused: [u8; 0],
 }
 pub type lh_element_t = lh_element;
+pub const LH_ABORT_NONE: u32 = 0;
+pub const LH_ABORT_CANCELLED: u32 = 1;
+pub const LH_ABORT_STEPS: u32 = 2;
+pub const LH_ABORT_TIME: u32 = 3;
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct lh_budget {
+    pub cancel_flag: *const u8,
+    pub max_steps: u64,
+    pub max_micros: u64,
+}
+#[allow(clippy::unnecessary_operation, clippy::identity_op)]
+const _: () = {
+    ["Size of lh_budget"][::std::mem::size_of::<lh_budget>() - 24usize];
+    ["Alignment of lh_budget"][::std::mem::align_of::<lh_budget>() - 8usize];
+    ["Offset of field: lh_budget::cancel_flag"][::std::mem::offset_of!(lh_budget, cancel_flag) - 0usize];
+    ["Offset of field: lh_budget::max_steps"][::std::mem::offset_of!(lh_budget, max_steps) - 8usize];
+    ["Offset of field: lh_budget::max_micros"][::std::mem::offset_of!(lh_budget, max_micros) - 16usize];
+};
+pub type lh_budget_t = lh_budget;
+pub const LH_LIMIT_NODES: u32 = 1;
+pub const LH_LIMIT_DEPTH: u32 = 2;
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct lh_limits {
+    pub max_nodes: u64,
+    pub max_depth: u32,
+}
+#[allow(clippy::unnecessary_operation, clippy::identity_op)]
+const _: () = {
+    ["Size of lh_limits"][::std::mem::size_of::<lh_limits>() - 16usize];
+    ["Alignment of lh_limits"][::std::mem::align_of::<lh_limits>() - 8usize];
+    ["Offset of field: lh_limits::max_nodes"][::std::mem::offset_of!(lh_limits, max_nodes) - 0usize];
+    ["Offset of field: lh_limits::max_depth"][::std::mem::offset_of!(lh_limits, max_depth) - 8usize];
+};
+pub type lh_limits_t = lh_limits;
 unsafe extern "C" {
     pub fn lh_document_create_from_string(
         html: *const ::std::os::raw::c_char,
@@ -731,9 +1053,66 @@ unsafe extern "C" {
 unsafe extern "C" {
     pub fn lh_document_destroy(doc: *mut lh_document_t);
 }
+unsafe extern "C" {
+    pub fn lh_document_reset(
+        doc: *mut lh_document_t,
+        html: *const ::std::os::raw::c_char,
+    ) -> ::std::os::raw::c_int;
+}
 unsafe extern "C" {
     pub fn lh_document_render(doc: *mut lh_document_t, max_width: f32) -> f32;
 }
+unsafe extern "C" {
+    pub fn lh_document_create_from_string_limited(
+        html: *const ::std::os::raw::c_char,
+        vtable: *mut lh_container_vtable_t,
+        user_data: *mut ::std::os::raw::c_void,
+        master_css: *const ::std::os::raw::c_char,
+        user_styles: *const ::std::os::raw::c_char,
+        budget: *const lh_budget_t,
+        limits: *const lh_limits_t,
+        abort_reason: *mut ::std::os::raw::c_int,
+    ) -> *mut lh_document_t;
+}
+unsafe extern "C" {
+    pub fn lh_document_reset_budgeted(
+        doc: *mut lh_document_t,
+        html: *const ::std::os::raw::c_char,
+        budget: *const lh_budget_t,
+        abort_reason: *mut ::std::os::raw::c_int,
+    ) -> ::std::os::raw::c_int;
+}
+unsafe extern "C" {
+    pub fn lh_document_limits_hit(doc: *const lh_document_t) -> u32;
+}
+unsafe extern "C" {
+    pub fn lh_dom_parse(
+        html: *const ::std::os::raw::c_char,
+        limits: *const lh_limits_t,
+    ) -> *mut lh_document_t;
+}
+unsafe extern "C" {
+    pub fn lh_document_render_budgeted(
+        doc: *mut lh_document_t,
+        max_width: f32,
+        budget: *const lh_budget_t,
+        result: *mut f32,
+    ) -> ::std::os::raw::c_int;
+}
+unsafe extern "C" {
+    pub fn lh_document_render_incremental(
+        doc: *mut lh_document_t,
+        max_width: f32,
+        result: *mut f32,
+        changed: *mut lh_position_t,
+    ) -> ::std::os::raw::c_int;
+}
+unsafe extern "C" {
+    pub fn lh_document_invalidate_layout(doc: *mut lh_document_t);
+}
+unsafe extern "C" {
+    pub fn lh_document_is_layout_dirty(doc: *const lh_document_t) -> ::std::os::raw::c_int;
+}
 unsafe extern "C" {
     pub fn lh_document_draw(
         doc: *mut lh_document_t,
@@ -760,6 +1139,12 @@ unsafe extern "C" {
 unsafe extern "C" {
     pub fn lh_document_root(doc: *mut lh_document_t) -> *mut lh_element_t;
 }
+unsafe extern "C" {
+    pub fn lh_document_element_by_id(
+        doc: *mut lh_document_t,
+        id: *const ::std::os::raw::c_char,
+    ) -> *mut lh_element_t;
+}
 unsafe extern "C" {
     pub fn lh_element_parent(el: *mut lh_element_t) -> *mut lh_element_t;
 }
@@ -772,6 +1157,18 @@ unsafe extern "C" {
         index: ::std::os::raw::c_int,
     ) -> *mut lh_element_t;
 }
+unsafe extern "C" {
+    pub fn lh_element_first_child(el: *mut lh_element_t) -> *mut lh_element_t;
+}
+unsafe extern "C" {
+    pub fn lh_element_next_sibling(el: *mut lh_element_t) -> *mut lh_element_t;
+}
+unsafe extern "C" {
+    pub fn lh_element_prev_sibling(el: *mut lh_element_t) -> *mut lh_element_t;
+}
+unsafe extern "C" {
+    pub fn lh_element_index_in_parent(el: *mut lh_element_t) -> ::std::os::raw::c_int;
+}
 unsafe extern "C" {
     pub fn lh_element_is_text(el: *mut lh_element_t) -> ::std::os::raw::c_int;
 }
@@ -796,6 +1193,25 @@ unsafe extern "C" {
         ctx: *mut ::std::os::raw::c_void,
     );
 }
+unsafe extern "C" {
+    pub fn lh_element_text_ref(
+        el: *mut lh_element_t,
+        len: *mut usize,
+    ) -> *const ::std::os::raw::c_char;
+}
+unsafe extern "C" {
+    pub fn lh_element_text_content(
+        el: *mut lh_element_t,
+        cb: ::std::option::Option<
+            unsafe extern "C" fn(
+                ctx: *mut ::std::os::raw::c_void,
+                text: *const ::std::os::raw::c_char,
+                len: usize,
+            ),
+        >,
+        ctx: *mut ::std::os::raw::c_void,
+    );
+}
 unsafe extern "C" {
     pub fn lh_document_get_element_by_point(
         doc: *mut lh_document_t,
@@ -837,6 +1253,15 @@ unsafe extern "C" {
 unsafe extern "C" {
     pub fn lh_element_get_line_height(el: *mut lh_element_t) -> f32;
 }
+unsafe extern "C" {
+    pub fn lh_element_get_tag_name(el: *mut lh_element_t) -> *const ::std::os::raw::c_char;
+}
+unsafe extern "C" {
+    pub fn lh_element_get_attr(
+        el: *mut lh_element_t,
+        name: *const ::std::os::raw::c_char,
+    ) -> *const ::std::os::raw::c_char;
+}
 unsafe extern "C" {
     pub fn lh_document_append_children_from_string(
         doc: *mut lh_document_t,
@@ -878,3 +1303,91 @@ unsafe extern "C" {
 unsafe extern "C" {
     pub fn lh_document_media_changed(doc: *mut lh_document_t) -> ::std::os::raw::c_int;
 }
+unsafe extern "C" {
+    pub fn lh_document_layout_generation(doc: *const lh_document_t) -> u64;
+}
+#[repr(C)]
+#[derive(Debug, Default, Copy, Clone)]
+pub struct lh_memory_usage {
+    pub elements: u64,
+    pub text_nodes: u64,
+    pub render_items: u64,
+    pub dom_bytes: u64,
+    pub style_bytes: u64,
+    pub render_bytes: u64,
+    pub string_bytes: u64,
+    pub wrapper_bytes: u64,
+}
+#[allow(clippy::unnecessary_operation, clippy::identity_op)]
+const _: () = {
+    ["Size of lh_memory_usage"][::std::mem::size_of::<lh_memory_usage>() - 64usize];
+    ["Alignment of lh_memory_usage"][::std::mem::align_of::<lh_memory_usage>() - 8usize];
+    ["Offset of field: lh_memory_usage::elements"][::std::mem::offset_of!(lh_memory_usage, elements) - 0usize];
+    ["Offset of field: lh_memory_usage::text_nodes"][::std::mem::offset_of!(lh_memory_usage, text_nodes) - 8usize];
+    ["Offset of field: lh_memory_usage::render_items"][::std::mem::offset_of!(lh_memory_usage, render_items) - 16usize];
+    ["Offset of field: lh_memory_usage::dom_bytes"][::std::mem::offset_of!(lh_memory_usage, dom_bytes) - 24usize];
+    ["Offset of field: lh_memory_usage::style_bytes"][::std::mem::offset_of!(lh_memory_usage, style_bytes) - 32usize];
+    ["Offset of field: lh_memory_usage::render_bytes"][::std::mem::offset_of!(lh_memory_usage, render_bytes) - 40usize];
+    ["Offset of field: lh_memory_usage::string_bytes"][::std::mem::offset_of!(lh_memory_usage, string_bytes) - 48usize];
+    ["Offset of field: lh_memory_usage::wrapper_bytes"][::std::mem::offset_of!(lh_memory_usage, wrapper_bytes) - 56usize];
+};
+pub type lh_memory_usage_t = lh_memory_usage;
+unsafe extern "C" {
+    pub fn lh_document_memory_usage(doc: *mut lh_document_t, out: *mut lh_memory_usage_t);
+}
+#[repr(C)]
+#[derive(Debug, Default, Copy, Clone)]
+pub struct lh_render_cost {
+    pub nodes: u64,
+    pub max_depth: u64,
+    pub table_cells: u64,
+    pub text_bytes: u64,
+    pub images: u64,
+    pub style_rules: u64,
+}
+#[allow(clippy::unnecessary_operation, clippy::identity_op)]
+const _: () = {
+    ["Size of lh_render_cost"][::std::mem::size_of::<lh_render_cost>() - 48usize];
+    ["Alignment of lh_render_cost"][::std::mem::align_of::<lh_render_cost>() - 8usize];
+    ["Offset of field: lh_render_cost::nodes"][::std::mem::offset_of!(lh_render_cost, nodes) - 0usize];
+    ["Offset of field: lh_render_cost::max_depth"][::std::mem::offset_of!(lh_render_cost, max_depth) - 8usize];
+    ["Offset of field: lh_render_cost::table_cells"][::std::mem::offset_of!(lh_render_cost, table_cells) - 16usize];
+    ["Offset of field: lh_render_cost::text_bytes"][::std::mem::offset_of!(lh_render_cost, text_bytes) - 24usize];
+    ["Offset of field: lh_render_cost::images"][::std::mem::offset_of!(lh_render_cost, images) - 32usize];
+    ["Offset of field: lh_render_cost::style_rules"][::std::mem::offset_of!(lh_render_cost, style_rules) - 40usize];
+};
+pub type lh_render_cost_t = lh_render_cost;
+unsafe extern "C" {
+    pub fn lh_document_render_cost(doc: *mut lh_document_t, out: *mut lh_render_cost_t);
+}
+pub type lh_link_callback = ::std::option::Option<
+    unsafe extern "C" fn(
+        href: *const ::std::os::raw::c_char,
+        pos: *const lh_position_t,
+        ctx: *mut ::std::os::raw::c_void,
+    ),
+>;
+unsafe extern "C" {
+    pub fn lh_document_links(
+        doc: *mut lh_document_t,
+        cb: lh_link_callback,
+        ctx: *mut ::std::os::raw::c_void,
+    );
+}
+pub type lh_text_leaf_callback = ::std::option::Option<
+    unsafe extern "C" fn(
+        el: *mut lh_element_t,
+        text: *const ::std::os::raw::c_char,
+        len: usize,
+        pos: *const lh_position_t,
+        font: usize,
+        ctx: *mut ::std::os::raw::c_void,
+    ),
+>;
+unsafe extern "C" {
+    pub fn lh_document_text_leaves(
+        doc: *mut lh_document_t,
+        cb: lh_text_leaf_callback,
+        ctx: *mut ::std::os::raw::c_void,
+    );
+}
@@ -28,4 +28,18 @@ mod tests {
             assert_eq!(lh_document_height(std::ptr::null()), 0.0);
         }
     }
+
+    #[test]
+    fn test_null_snapshots() {
+        unsafe {
+            let mut font = lh_font_description_snapshot_t::default();
+            lh_font_description_snapshot(std::ptr::null(), &mut font);
+            assert_eq!(font.decoration_thickness_is_predefined, 1);
+
+            let mut gradient = lh_linear_gradient_snapshot_t::default();
+            let mut points = [lh_color_point_t::default(); 4];
+            lh_linear_gradient_snapshot(std::ptr::null(), &mut gradient, points.as_mut_ptr(), 4);
+            assert_eq!(gradient.color_points_count, 0);
+        }
+    }
 }
@@ -0,0 +1,141 @@
+//! Per-callback overhead of the container bridge.
+//!
+//! Calls `text_width` and `create_font` directly through the bridge's
+//! `extern "C"` entry points, the way the C wrapper does during layout, and
+//! reports the average cost per call for:
+//!
+//! - `dyn`: a `dyn DocumentContainer`, a virtual call per callback (the
+//!   only path before `Document` became generic)
+//! - `generic`: the monomorphized vtable for the concrete container
+//!
+//! The C++ side of each call (the virtual call into the wrapper and its
+//! font cache) is the same for both and is not included.
+//!
+//! ```text
+//! cargo bench -p litehtml --features bench --bench callbacks
+//! ```
+
+use std::cell::Cell;
+use std::ffi::CStr;
+use std::hint::black_box;
+use std::time::Instant;
+
+use litehtml::{
+    CallbackBench, Color, DocumentContainer, DrawContext, FontDescription, FontHandle, FontMetrics,
+    MediaFeatures, MediaType, Position,
+};
+
+const CALLS: u32 = 1_000_000;
+const ROUNDS: usize = 7;
+const WORDS: [&CStr; 4] = [c"word", c"callback", c"a", c"monomorphized"];
+
+struct CountingContainer {
+    calls: Cell<u64>,
+}
+
+impl DocumentContainer for CountingContainer {
+    fn create_font(&mut self, descr: &FontDescription) -> (FontHandle, FontMetrics) {
+        self.calls.set(self.calls.get() + 1);
+        let size = descr.size();
+        let metrics = FontMetrics {
+            font_size: size,
+            height: size * 1.2,
+            ascent: size * 0.8,
+            descent: size * 0.2,
+            x_height: size * 0.5,
+            ch_width: size * 0.5,
+            draw_spaces: false,
+            sub_shift: 0.0,
+            super_shift: 0.0,
+        };
+        (FontHandle(1), metrics)
+    }
+
+    fn delete_font(&mut self, _font: FontHandle) {}
+
+    fn text_width(&self, text: &str, _font: FontHandle) -> f32 {
+        self.calls.set(self.calls.get() + 1);
+        text.len() as f32 * 7.5
+    }
+
+    fn draw_text(
+        &mut self,
+        _hdc: DrawContext,
+        _text: &str,
+        _font: FontHandle,
+        _color: Color,
+        _pos: Position,
+    ) {
+    }
+
+    fn get_viewport(&self) -> Position {
+        Position {
+            x: 0.0,
+            y: 0.0,
+            width: 600.0,
+            height: 800.0,
+        }
+    }
+
+    fn get_media_features(&self) -> MediaFeatures {
+        MediaFeatures {
+            media_type: MediaType::Screen,
+            width: 600.0,
+            height: 800.0,
+            device_width: 600.0,
+            device_height: 800.0,
+            color: 8,
+            color_index: 0,
+            monochrome: 0,
+            resolution: 96.0,
+        }
+    }
+}
+
+/// Time `CALLS` calls of `call` in each of `ROUNDS` rounds, after a
+/// warm-up, and print the fastest round in ns per call.
+fn bench<C: DocumentContainer + ?Sized>(
+    label: &str,
+    callbacks: &mut CallbackBench<'_, C>,
+    mut call: impl FnMut(&mut CallbackBench<'_, C>, u32),
+) {
+    for i in 0..CALLS / 10 {
+        call(callbacks, i);
+    }
+    let best = (0..ROUNDS)
+        .map(|_| {
+            let start = Instant::now();
+            for i in 0..CALLS {
+                call(callbacks, i);
+            }
+            start.elapsed()
+        })
+        .min()
+        .unwrap();
+    println!(
+        "{label:<30} {:>6.2} ns/call",
+        best.as_nanos() as f64 / f64::from(CALLS)
+    );
+}
+
+fn run<C: DocumentContainer + ?Sized>(label: &str, container: &mut C) {
+    let mut callbacks = CallbackBench::new(container, "serif", 16.0);
+    bench(&format!("text_width  {label}"), &mut callbacks, |cb, i| {
+        black_box(cb.text_width(WORDS[i as usize % WORDS.len()], FontHandle(1)));
+    });
+    bench(&format!("create_font {label}"), &mut callbacks, |cb, _| {
+        black_box(cb.create_font());
+    });
+}
+
+fn main() {
+    let mut container = CountingContainer {
+        calls: Cell::new(0),
+    };
+
+    run::<dyn DocumentContainer>("dyn", &mut container);
+    run("generic", &mut container);
+
+    // Keep the container's work observable.
+    black_box(container.calls.get());
+}
@@ -0,0 +1,447 @@
+/// Render a directory or manifest of HTML files to PNG without a window,
+/// on a pool of workers, and report per-file timings as JSON.
+///
+/// Usage: cargo run --release --example batch --features pixbuf,email -p litehtml -- \
+///            <dir|manifest.txt> [--out DIR] [--width 600,800] [--scale 1,2] \
+///            [--threads N] [--email] [--max-height N] [--viewport-height N] \
+///            [--json FILE]
+///
+/// A manifest lists one HTML file per line, relative to the manifest;
+/// blank lines and lines starting with `#` are skipped. Every file is
+/// rendered at every width/scale combination. `--email` runs inputs through
+/// the email preprocessing pipeline and stylesheet. `--viewport-height` is
+/// the window height layout resolves `vh` units and media queries against.
+/// Outputs are named after the input file plus a short hash of its path, so
+/// inputs with the same name in different directories do not collide.
+/// Without `--out` nothing is written except the metrics, which go to
+/// stdout unless `--json` is set. A job that panics is reported as failed.
+use std::any::Any;
+use std::fmt::Write as _;
+use std::fs;
+use std::io::{BufWriter, Write as _};
+use std::panic::{self, AssertUnwindSafe};
+use std::path::{Path, PathBuf};
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::time::{Duration, Instant};
+use std::{env, process};
+
+use image::ImageEncoder;
+
+use litehtml::email::{prepare_email_html, EMAIL_MASTER_CSS};
+use litehtml::pipeline::LayoutRequest;
+use litehtml::pixbuf::{PixbufContainer, DEFAULT_VIEWPORT_HEIGHT};
+use litehtml::ResourceLimits;
+
+struct Config {
+    out_dir: Option<PathBuf>,
+    widths: Vec<u32>,
+    scales: Vec<f32>,
+    threads: usize,
+    email: bool,
+    max_height: u32,
+    viewport_height: u32,
+    json: Option<PathBuf>,
+}
+
+/// One file at one width and scale.
+struct Job {
+    path: PathBuf,
+    width: u32,
+    scale: f32,
+}
+
+#[derive(Default)]
+struct Timings {
+    parse: Duration,
+    layout: Duration,
+    draw: Duration,
+    encode: Duration,
+}
+
+struct Rendered {
+    output: Option<PathBuf>,
+    phys_width: u32,
+    phys_height: u32,
+    timings: Timings,
+    document_bytes: usize,
+    container_bytes: usize,
+    height_clamped: bool,
+}
+
+struct Outcome {
+    job: usize,
+    total: Duration,
+    result: Result<Rendered, String>,
+}
+
+fn main() {
+    let args: Vec<String> = env::args().collect();
+    if args.len() < 2 {
+        eprintln!(
+            "Usage: {} <dir|manifest.txt> [--out DIR] [--width 600,800] [--scale 1,2] \
+             [--threads N] [--email] [--max-height N] [--viewport-height N] [--json FILE]",
+            args[0]
+        );
+        process::exit(1);
+    }
+
+    let flag = |name: &str| {
+        args.iter()
+            .position(|a| a == name)
+            .and_then(|i| args.get(i + 1))
+    };
+    let list = |name: &str, default: &str| -> Vec<String> {
+        flag(name)
+            .map_or(default, |s| s.as_str())
+            .split(',')
+            .map(str::to_owned)
+            .collect()
+    };
+    let config = Config {
+        out_dir: flag("--out").map(PathBuf::from),
+        widths: list("--width", "800")
+            .iter()
+            .filter_map(|s| s.parse().ok())
+            .collect(),
+        scales: list("--scale", "1")
+            .iter()
+            .filter_map(|s| s.parse().ok())
+            .collect(),
+        threads: flag("--threads")
+            .and_then(|s| s.parse().ok())
+            .unwrap_or_else(|| std::thread::available_parallelism().map_or(1, |n| n.get())),
+        email: args.iter().any(|a| a == "--email"),
+        max_height: flag("--max-height")
+            .and_then(|s| s.parse().ok())
+            .unwrap_or(30_000),
+        viewport_height: flag("--viewport-height")
+            .and_then(|s| s.parse().ok())
+            .unwrap_or(DEFAULT_VIEWPORT_HEIGHT),
+        json: flag("--json").map(PathBuf::from),
+    };
+    if config.widths.is_empty() || config.scales.is_empty() {
+        eprintln!("--width and --scale need at least one number each");
+        process::exit(1);
+    }
+
+    let files = collect_inputs(Path::new(&args[1])).unwrap_or_else(|e| {
+        eprintln!("Cannot read {}: {}", args[1], e);
+        process::exit(1);
+    });
+    if let Some(dir) = &config.out_dir {
+        if let Err(e) = fs::create_dir_all(dir) {
+            eprintln!("Cannot create {}: {}", dir.display(), e);
+            process::exit(1);
+        }
+    }
+
+    let mut jobs = Vec::new();
+    for path in &files {
+        for &width in &config.widths {
+            for &scale in &config.scales {
+                jobs.push(Job {
+                    path: path.clone(),
+                    width,
+                    scale,
+                });
+            }
+        }
+    }
+
+    let started = Instant::now();
+    let outcomes = run_pool(&jobs, &config);
+    let wall = started.elapsed();
+
+    let json = report(&jobs, &outcomes, &config, wall);
+    match &config.json {
+        Some(path) => {
+            if let Err(e) = fs::write(path, json) {
+                eprintln!("Cannot write {}: {}", path.display(), e);
+                process::exit(1);
+            }
+        }
+        None => println!("{json}"),
+    }
+
+    let failed = outcomes.iter().filter(|o| o.result.is_err()).count();
+    eprintln!(
+        "{} jobs, {} failed, {:.1} s on {} threads",
+        jobs.len(),
+        failed,
+        wall.as_secs_f64(),
+        config.threads.min(jobs.len()).max(1)
+    );
+    if failed > 0 {
+        process::exit(2);
+    }
+}
+
+/// HTML files in a directory (sorted), or the files listed in a manifest.
+fn collect_inputs(input: &Path) -> std::io::Result<Vec<PathBuf>> {
+    if input.is_dir() {
+        let mut files: Vec<PathBuf> = fs::read_dir(input)?
+            .filter_map(|e| e.ok().map(|e| e.path()))
+            .filter(|p| {
+                p.extension().and_then(|e| e.to_str()).is_some_and(|e| {
+                    e.eq_ignore_ascii_case("html") || e.eq_ignore_ascii_case("htm")
+                })
+            })
+            .collect();
+        files.sort();
+        return Ok(files);
+    }
+    let base = input.parent().unwrap_or(Path::new("."));
+    Ok(fs::read_to_string(input)?
+        .lines()
+        .map(str::trim)
+        .filter(|l| !l.is_empty() && !l.starts_with('#'))
+        .map(|l| base.join(l))
+        .collect())
+}
+
+/// Run every job on `config.threads` workers. Each worker keeps one
+/// container for its lifetime, so fonts are discovered and glyphs cached
+/// once per worker rather than once per file.
+fn run_pool(jobs: &[Job], config: &Config) -> Vec<Outcome> {
+    let next = AtomicUsize::new(0);
+    let threads = config.threads.clamp(1, jobs.len().max(1));
+    let mut outcomes: Vec<Outcome> = std::thread::scope(|scope| {
+        let workers: Vec<_> = (0..threads)
+            .map(|_| {
+                let next = &next;
+                scope.spawn(move || {
+                    let new_container = || {
+                        let mut container = PixbufContainer::new(1, 1);
+                        container
+                            .set_limits(&ResourceLimits::new().with_max_height(config.max_height));
+                        container
+                    };
+                    let mut container = new_container();
+                    let mut done = Vec::new();
+                    loop {
+                        let i = next.fetch_add(1, Ordering::Relaxed);
+                        let Some(job) = jobs.get(i) else {
+                            break;
+                        };
+                        let started = Instant::now();
+                        let result = panic::catch_unwind(AssertUnwindSafe(|| {
+                            render_job(&mut container, job, config)
+                        }))
+                        .unwrap_or_else(|payload| {
+                            // The container may be mid-draw; start the next
+                            // job on a fresh one.
+                            container = new_container();
+                            Err(format!("panicked: {}", panic_message(&*payload)))
+                        });
+                        done.push(Outcome {
+                            job: i,
+                            total: started.elapsed(),
+                            result,
+                        });
+                    }
+                    done
+                })
+            })
+            .collect();
+        workers
+            .into_iter()
+            .flat_map(|w| w.join().expect("worker panicked"))
+            .collect()
+    });
+    outcomes.sort_unstable_by_key(|o| o.job);
+    outcomes
+}
+
+fn render_job(
+    container: &mut PixbufContainer,
+    job: &Job,
+    config: &Config,
+) -> Result<Rendered, String> {
+    let raw = fs::read(&job.path).map_err(|e| e.to_string())?;
+    let mut timings = Timings::default();
+
+    container.clear_images();
+    container.reset_limits_hit();
+
+    // Parse, including email preprocessing
+    let started = Instant::now();
+    let (html, master_css) = if config.email {
+        let prepared = prepare_email_html(&raw, None, None);
+        for (url, bytes) in &prepared.images {
+            container.load_image_data(url, bytes);
+        }
+        (prepared.html, Some(EMAIL_MASTER_CSS))
+    } else {
+        (String::from_utf8_lossy(&raw).into_owned(), None)
+    };
+    let prepare = started.elapsed();
+
+    // Lay out and record the draw pass, so the pixmap is sized to the
+    // content before anything is rasterized.
+    let mut request = LayoutRequest::new(&html, job.width as f32);
+    request.options.master_css = master_css;
+    request.measure_memory = true;
+    let laid = container
+        .render_page(&request, config.viewport_height, job.scale)
+        .map_err(|e| e.to_string())?;
+    timings.parse = prepare + laid.timings.parse;
+    timings.layout = laid.timings.layout;
+    timings.draw = laid.timings.record + laid.timings.raster;
+    let document_bytes = laid.memory.map_or(0, |m| m.total_bytes());
+
+    let (phys_width, phys_height) = (container.width(), container.height());
+    let started = Instant::now();
+    let output = match &config.out_dir {
+        Some(dir) => {
+            let stem = job
+                .path
+                .file_stem()
+                .map_or("out".into(), |s| s.to_string_lossy());
+            let path = dir.join(format!(
+                "{stem}-{:08x}-w{}@{}x.png",
+                path_hash(&job.path),
+                job.width,
+                job.scale
+            ));
+            write_png(&path, container.pixels(), phys_width, phys_height)?;
+            Some(path)
+        }
+        None => None,
+    };
+    timings.encode = started.elapsed();
+
+    Ok(Rendered {
+        output,
+        phys_width,
+        phys_height,
+        timings,
+        document_bytes,
+        container_bytes: container.memory_usage().total_bytes(),
+        height_clamped: container.limits_hit().height,
+    })
+}
+
+/// Short stable hash of an input path (32-bit FNV-1a), telling apart
+/// outputs of files that share a name.
+fn path_hash(path: &Path) -> u32 {
+    path.to_string_lossy()
+        .bytes()
+        .fold(0x811c_9dc5, |h, b| (h ^ b as u32).wrapping_mul(0x0100_0193))
+}
+
+/// The message a panic was raised with, if it is a string.
+fn panic_message(payload: &(dyn Any + Send)) -> &str {
+    payload
+        .downcast_ref::<&str>()
+        .copied()
+        .or_else(|| payload.downcast_ref::<String>().map(String::as_str))
+        .unwrap_or("unknown panic")
+}
+
+/// Composite premultiplied RGBA over white and write it as an RGB PNG.
+fn write_png(path: &Path, pixels: &[u8], width: u32, height: u32) -> Result<(), String> {
+    let rgb: Vec<u8> = pixels
+        .chunks_exact(4)
+        .flat_map(|px| {
+            let a = px[3] as u32;
+            let over_white = |c: u8| (c as u32 + (255 * (255 - a) + 127) / 255).min(255) as u8;
+            [over_white(px[0]), over_white(px[1]), over_white(px[2])]
+        })
+        .collect();
+    let file = fs::File::create(path).map_err(|e| e.to_string())?;
+    let mut out = BufWriter::new(file);
+    image::codecs::png::PngEncoder::new(&mut out)
+        .write_image(&rgb, width, height, image::ExtendedColorType::Rgb8)
+        .map_err(|e| e.to_string())?;
+    out.flush().map_err(|e| e.to_string())
+}
+
+/// Peak resident set size of this process, where the OS reports it.
+fn peak_rss_bytes() -> Option<u64> {
+    let status = fs::read_to_string("/proc/self/status").ok()?;
+    let line = status.lines().find(|l| l.starts_with("VmHWM:"))?;
+    let kib: u64 = line.split_whitespace().nth(1)?.parse().ok()?;
+    Some(kib * 1024)
+}
+
+fn report(jobs: &[Job], outcomes: &[Outcome], config: &Config, wall: Duration) -> String {
+    let ms = |d: Duration| d.as_secs_f64() * 1000.0;
+    let mut json = String::from("{\n  \"files\": [");
+    let mut pixels = 0u64;
+    for (n, outcome) in outcomes.iter().enumerate() {
+        let job = &jobs[outcome.job];
+        json.push_str(if n == 0 { "\n    {" } else { ",\n    {" });
+        let _ = write!(
+            json,
+            "\"path\": {}, \"width\": {}, \"scale\": {}, \"total_ms\": {:.3}, ",
+            json_string(&job.path.to_string_lossy()),
+            job.width,
+            job.scale,
+            ms(outcome.total)
+        );
+        match &outcome.result {
+            Ok(r) => {
+                pixels += r.phys_width as u64 * r.phys_height as u64;
+                let t = &r.timings;
+                let _ = write!(
+                    json,
+                    "\"ok\": true, \"output\": {}, \"pixels\": [{}, {}], \
+                     \"parse_ms\": {:.3}, \"layout_ms\": {:.3}, \"draw_ms\": {:.3}, \
+                     \"encode_ms\": {:.3}, \"document_bytes\": {}, \"container_bytes\": {}, \
+                     \"height_clamped\": {}}}",
+                    r.output
+                        .as_ref()
+                        .map_or("null".into(), |p| json_string(&p.to_string_lossy())),
+                    r.phys_width,
+                    r.phys_height,
+                    ms(t.parse),
+                    ms(t.layout),
+                    ms(t.draw),
+                    ms(t.encode),
+                    r.document_bytes,
+                    r.container_bytes,
+                    r.height_clamped
+                );
+            }
+            Err(e) => {
+                let _ = write!(json, "\"ok\": false, \"error\": {}}}", json_string(e));
+            }
+        }
+    }
+    let failed = outcomes.iter().filter(|o| o.result.is_err()).count();
+    let secs = wall.as_secs_f64().max(1e-9);
+    let _ = write!(
+        json,
+        "\n  ],\n  \"summary\": {{\"jobs\": {}, \"failed\": {}, \"threads\": {}, \
+         \"wall_ms\": {:.3}, \"jobs_per_sec\": {:.2}, \"megapixels_per_sec\": {:.2}, \
+         \"peak_rss_bytes\": {}}}\n}}",
+        jobs.len(),
+        failed,
+        config.threads.clamp(1, jobs.len().max(1)),
+        ms(wall),
+        jobs.len() as f64 / secs,
+        pixels as f64 / 1e6 / secs,
+        peak_rss_bytes().map_or("null".into(), |b| b.to_string())
+    );
+    json
+}
+
+fn json_string(s: &str) -> String {
+    let mut out = String::with_capacity(s.len() + 2);
+    out.push('"');
+    for c in s.chars() {
+        match c {
+            '"' => out.push_str("\\\""),
+            '\\' => out.push_str("\\\\"),
+            '\n' => out.push_str("\\n"),
+            '\r' => out.push_str("\\r"),
+            '\t' => out.push_str("\\t"),
+            c if (c as u32) < 0x20 => {
+                let _ = write!(out, "\\u{:04x}", c as u32);
+            }
+            c => out.push(c),
+        }
+    }
+    out.push('"');
+    out
+}
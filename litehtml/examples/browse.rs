@@ -417,7 +417,7 @@ fn main() {
     let base_framebuffer = premul_to_rgb(container.inner.pixels());
 
     // Create document for interactive selection (layout only, no draw)
-    let measure = container.inner.text_measure_fn();
+    let measure = container.inner.text_measure();
     let doc = match litehtml::Document::from_html(&html, &mut container, None, None) {
         Ok(mut d) => {
             let _ = d.render(width as f32);
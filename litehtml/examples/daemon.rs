@@ -0,0 +1,491 @@
+/// Long-running render daemon on a Unix socket, keeping warm containers.
+///
+/// Usage: cargo run --release --example daemon --features pixbuf -p litehtml -- \
+///            <socket> [--threads N] [--connections N] [--max-height N]
+///        cargo run --release --example daemon --features pixbuf -p litehtml -- \
+///            --request <socket> <input.html> <output.png> [width] [--scale N]
+///
+/// Every worker thread owns one `PixbufContainer` for the life of the
+/// process, so system fonts are discovered and glyphs rasterized once per
+/// worker instead of once per request. Requests run on a `RenderQueue`;
+/// small documents are queued as interactive work ahead of large ones.
+/// At most `--connections` clients are served at once; further clients wait
+/// in the listen backlog until a slot frees up.
+///
+/// Protocol: every message in either direction is a little-endian `u32`
+/// byte length followed by that many bytes.
+///
+/// Requests start with an opcode byte:
+///   1 render  `u32 width, f32 scale, u8 format, u32 timeout_ms, html...`
+///             format 0 returns premultiplied RGBA, 1 returns PNG;
+///             timeout_ms 0 means no deadline; width is at most 8192 and
+///             the page height is capped so width·scale × height·scale
+///             stays under 64M pixels
+///   2 health  no body
+///   3 stats   no body
+///
+/// Responses start with a status byte, 0 for success and 1 for an error
+/// (followed by a UTF-8 message). A successful render continues with
+/// `u32 width, u32 height` in physical pixels and then the pixel data or
+/// PNG. Health and stats reply with UTF-8 text (stats as JSON).
+use std::cell::RefCell;
+use std::io::{self, BufReader, BufWriter, Read, Write};
+use std::os::unix::net::{UnixListener, UnixStream};
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::Arc;
+use std::time::{Duration, Instant};
+use std::{env, fs, process};
+
+use image::ImageEncoder;
+
+use litehtml::pipeline::LayoutRequest;
+use litehtml::pixbuf::{PixbufContainer, DEFAULT_VIEWPORT_HEIGHT};
+use litehtml::render_queue::{JobError, Priority, RenderQueue};
+use litehtml::{Budget, ResourceLimits};
+
+const OP_RENDER: u8 = 1;
+const OP_HEALTH: u8 = 2;
+const OP_STATS: u8 = 3;
+
+const STATUS_OK: u8 = 0;
+const STATUS_ERROR: u8 = 1;
+
+const FORMAT_RGBA: u8 = 0;
+const FORMAT_PNG: u8 = 1;
+
+/// Largest message accepted from a client.
+const MAX_FRAME: usize = 64 << 20;
+
+/// Documents up to this size are queued as interactive work.
+const INTERACTIVE_BYTES: usize = 64 << 10;
+
+/// Widest layout accepted, in CSS pixels.
+const MAX_WIDTH: u32 = 8192;
+
+/// Most physical pixels one render may allocate (256 MiB of RGBA).
+const MAX_PIXELS: u64 = 64 << 20;
+
+/// Default number of clients served concurrently.
+const DEFAULT_CONNECTIONS: usize = 64;
+
+/// A connection idle this long is closed so its slot can be reused.
+const IDLE_TIMEOUT: Duration = Duration::from_secs(60);
+
+thread_local! {
+    /// The worker's warm container, created on its first request.
+    static CONTAINER: RefCell<Option<PixbufContainer>> = const { RefCell::new(None) };
+}
+
+struct RenderRequest {
+    width: u32,
+    scale: f32,
+    format: u8,
+    timeout: Option<Duration>,
+    html: String,
+}
+
+struct Rendered {
+    width: u32,
+    height: u32,
+    data: Vec<u8>,
+}
+
+#[derive(Default)]
+struct Stats {
+    requests: AtomicU64,
+    renders: AtomicU64,
+    errors: AtomicU64,
+    bytes_in: AtomicU64,
+    bytes_out: AtomicU64,
+    render_micros: AtomicU64,
+    max_render_micros: AtomicU64,
+}
+
+struct Daemon {
+    queue: RenderQueue,
+    stats: Stats,
+    limits: ResourceLimits,
+    started: Instant,
+    threads: usize,
+}
+
+fn main() {
+    let args: Vec<String> = env::args().collect();
+    if args.len() < 2 {
+        eprintln!(
+            "Usage: {0} <socket> [--threads N] [--connections N] [--max-height N]\n       \
+             {0} --request <socket> <input.html> <output.png> [width] [--scale N]",
+            args[0]
+        );
+        process::exit(1);
+    }
+    let flag = |name: &str| {
+        args.iter()
+            .position(|a| a == name)
+            .and_then(|i| args.get(i + 1))
+            .and_then(|s| s.parse::<f64>().ok())
+    };
+
+    if args[1] == "--request" {
+        if args.len() < 5 {
+            eprintln!("--request needs <socket> <input.html> <output.png>");
+            process::exit(1);
+        }
+        let width = args.get(5).and_then(|s| s.parse().ok()).unwrap_or(800);
+        let scale = flag("--scale").unwrap_or(1.0) as f32;
+        if let Err(e) = request(&args[2], &args[3], &args[4], width, scale) {
+            eprintln!("Request failed: {e}");
+            process::exit(1);
+        }
+        return;
+    }
+
+    let socket = &args[1];
+    let threads = flag("--threads").map_or(0, |n| n as usize);
+    let threads = match threads {
+        0 => std::thread::available_parallelism().map_or(1, |n| n.get()),
+        n => n,
+    };
+    let connections = match flag("--connections").map_or(0, |n| n as usize) {
+        0 => DEFAULT_CONNECTIONS,
+        n => n,
+    };
+    let max_height = flag("--max-height").map_or(20_000, |n| n as u32);
+
+    // A stale socket from a previous run would make bind fail.
+    let _ = fs::remove_file(socket);
+    let listener = UnixListener::bind(socket).unwrap_or_else(|e| {
+        eprintln!("Cannot bind {socket}: {e}");
+        process::exit(1);
+    });
+
+    let daemon = Arc::new(Daemon {
+        queue: RenderQueue::new(threads),
+        stats: Stats::default(),
+        limits: ResourceLimits::new()
+            .with_max_nodes(500_000)
+            .with_max_depth(512)
+            .with_max_image_pixels(40_000_000)
+            .with_max_height(max_height),
+        started: Instant::now(),
+        threads,
+    });
+    warm_up(&daemon);
+    eprintln!("Listening on {socket} with {threads} workers and {connections} connections");
+
+    // A fixed pool of acceptors, each serving one client at a time, bounds
+    // the number of connection threads no matter how many clients connect.
+    let listener = Arc::new(listener);
+    let acceptors: Vec<_> = (0..connections)
+        .map(|_| {
+            let daemon = Arc::clone(&daemon);
+            let listener = Arc::clone(&listener);
+            std::thread::spawn(move || accept_loop(&daemon, &listener))
+        })
+        .collect();
+    for acceptor in acceptors {
+        let _ = acceptor.join();
+    }
+}
+
+/// Accept and serve clients one after another, forever.
+fn accept_loop(daemon: &Daemon, listener: &UnixListener) {
+    for stream in listener.incoming() {
+        let stream = match stream {
+            Ok(stream) => stream,
+            Err(e) => {
+                eprintln!("Accept failed: {e}");
+                continue;
+            }
+        };
+        if let Err(e) = stream
+            .set_read_timeout(Some(IDLE_TIMEOUT))
+            .and_then(|()| serve(daemon, stream))
+        {
+            match e.kind() {
+                io::ErrorKind::UnexpectedEof
+                | io::ErrorKind::WouldBlock
+                | io::ErrorKind::TimedOut => {}
+                _ => eprintln!("Connection error: {e}"),
+            }
+        }
+    }
+}
+
+/// Render a tiny document once per worker so fonts are loaded before the
+/// first real request arrives.
+fn warm_up(daemon: &Daemon) {
+    let handles: Vec<_> = (0..daemon.threads)
+        .map(|_| {
+            let limits = daemon.limits;
+            daemon.queue.submit_fn(Priority::Background, None, move || {
+                let request = RenderRequest {
+                    width: 64,
+                    scale: 1.0,
+                    format: FORMAT_RGBA,
+                    timeout: None,
+                    html: "<p>warm</p>".into(),
+                };
+                let _ = render(&request, &limits);
+                // Hold the worker briefly so the others pick up the rest.
+                std::thread::sleep(Duration::from_millis(20));
+            })
+        })
+        .collect();
+    for handle in handles {
+        let _ = handle.wait();
+    }
+}
+
+/// Answer requests on one connection until the client hangs up.
+fn serve(daemon: &Daemon, stream: UnixStream) -> io::Result<()> {
+    let mut reader = BufReader::new(stream.try_clone()?);
+    let mut writer = BufWriter::new(stream);
+    loop {
+        let frame = read_frame(&mut reader)?;
+        daemon.stats.requests.fetch_add(1, Ordering::Relaxed);
+        daemon
+            .stats
+            .bytes_in
+            .fetch_add(frame.len() as u64 + 4, Ordering::Relaxed);
+
+        let reply = match frame.split_first() {
+            Some((&OP_RENDER, body)) => handle_render(daemon, body),
+            Some((&OP_HEALTH, _)) => Ok(format!(
+                "ok uptime={}s pending={}",
+                daemon.started.elapsed().as_secs(),
+                daemon.queue.pending()
+            )
+            .into_bytes()),
+            Some((&OP_STATS, _)) => Ok(stats_json(daemon).into_bytes()),
+            _ => Err("unknown opcode".to_string()),
+        };
+
+        let mut out = Vec::new();
+        match reply {
+            Ok(body) => {
+                out.push(STATUS_OK);
+                out.extend_from_slice(&body);
+            }
+            Err(message) => {
+                daemon.stats.errors.fetch_add(1, Ordering::Relaxed);
+                out.push(STATUS_ERROR);
+                out.extend_from_slice(message.as_bytes());
+            }
+        }
+        write_frame(&mut writer, &out)?;
+        writer.flush()?;
+        daemon
+            .stats
+            .bytes_out
+            .fetch_add(out.len() as u64 + 4, Ordering::Relaxed);
+    }
+}
+
+fn handle_render(daemon: &Daemon, body: &[u8]) -> Result<Vec<u8>, String> {
+    let request = parse_render(body).ok_or("malformed render request")?;
+    let started = Instant::now();
+    let priority = if request.html.len() <= INTERACTIVE_BYTES {
+        Priority::Interactive
+    } else {
+        Priority::Normal
+    };
+    let deadline = request.timeout.map(|t| started + t);
+    let limits = page_limits(&daemon.limits, &request).ok_or("page too large")?;
+    let result = daemon
+        .queue
+        .submit_fn(priority, deadline, move || render(&request, &limits))
+        .wait();
+
+    let micros = started.elapsed().as_micros() as u64;
+    daemon.stats.renders.fetch_add(1, Ordering::Relaxed);
+    daemon
+        .stats
+        .render_micros
+        .fetch_add(micros, Ordering::Relaxed);
+    daemon
+        .stats
+        .max_render_micros
+        .fetch_max(micros, Ordering::Relaxed);
+
+    let rendered = match result {
+        Ok(r) => r?,
+        Err(JobError::DeadlineExceeded) => return Err("deadline exceeded".into()),
+        Err(e) => return Err(e.to_string()),
+    };
+    let mut out = Vec::with_capacity(8 + rendered.data.len());
+    out.extend_from_slice(&rendered.width.to_le_bytes());
+    out.extend_from_slice(&rendered.height.to_le_bytes());
+    out.extend_from_slice(&rendered.data);
+    Ok(out)
+}
+
+fn parse_render(body: &[u8]) -> Option<RenderRequest> {
+    let u32_at = |at: usize| Some(u32::from_le_bytes(body.get(at..at + 4)?.try_into().ok()?));
+    let width = u32_at(0)?;
+    let scale = f32::from_bits(u32_at(4)?);
+    let format = *body.get(8)?;
+    let timeout_ms = u32_at(9)?;
+    let html = String::from_utf8_lossy(body.get(13..)?).into_owned();
+    if width == 0 || width > MAX_WIDTH || !(scale > 0.0 && scale <= 8.0) || format > FORMAT_PNG {
+        return None;
+    }
+    Some(RenderRequest {
+        width,
+        scale,
+        format,
+        timeout: (timeout_ms > 0).then(|| Duration::from_millis(timeout_ms.into())),
+        html,
+    })
+}
+
+/// The daemon's limits with the height limit lowered so the page pixmap
+/// stays within [`MAX_PIXELS`] at the request's width and scale, or `None`
+/// if not even one row fits.
+fn page_limits(limits: &ResourceLimits, request: &RenderRequest) -> Option<ResourceLimits> {
+    let scale = f64::from(request.scale);
+    let row = (f64::from(request.width) * scale).ceil();
+    // `row` is already physical; one more `scale` turns physical rows into
+    // the CSS pixel height litehtml is limited by.
+    let max_height = (MAX_PIXELS as f64 / row / scale).floor() as u32;
+    if max_height == 0 {
+        return None;
+    }
+    let max_height = limits
+        .max_height()
+        .map_or(max_height, |h| h.min(max_height));
+    Some(limits.with_max_height(max_height))
+}
+
+/// Lay out and rasterize one request on the calling worker's warm container.
+/// The request timeout also bounds parsing and layout, so one pathological
+/// document cannot hold the worker past its deadline.
+fn render(request: &RenderRequest, limits: &ResourceLimits) -> Result<Rendered, String> {
+    CONTAINER.with(|cell| {
+        let mut slot = cell.borrow_mut();
+        let container = slot.get_or_insert_with(|| PixbufContainer::new(1, 1));
+        container.set_limits(limits);
+        container.clear_images();
+        container.reset_limits_hit();
+
+        let mut layout = LayoutRequest::new(&request.html, request.width as f32);
+        layout.options.limits = Some(limits);
+        let budget = request.timeout.map(|t| Budget::new().with_time_limit(t));
+        layout.options.budget = budget.as_ref();
+        container
+            .render_page(&layout, DEFAULT_VIEWPORT_HEIGHT, request.scale)
+            .map_err(|e| e.to_string())?;
+
+        let (width, height) = (container.width(), container.height());
+        let data = match request.format {
+            FORMAT_PNG => {
+                let mut png = Vec::new();
+                image::codecs::png::PngEncoder::new(&mut png)
+                    .write_image(
+                        &unpremultiply(container.pixels()),
+                        width,
+                        height,
+                        image::ExtendedColorType::Rgba8,
+                    )
+                    .map_err(|e| e.to_string())?;
+                png
+            }
+            _ => container.pixels().to_vec(),
+        };
+        Ok(Rendered {
+            width,
+            height,
+            data,
+        })
+    })
+}
+
+/// Premultiplied RGBA to straight RGBA, as PNG expects.
+fn unpremultiply(pixels: &[u8]) -> Vec<u8> {
+    pixels
+        .chunks_exact(4)
+        .flat_map(|px| {
+            let a = px[3] as u32;
+            let straight = |c: u8| match a {
+                0 => 0,
+                a => ((c as u32 * 255 + a / 2) / a).min(255) as u8,
+            };
+            [straight(px[0]), straight(px[1]), straight(px[2]), px[3]]
+        })
+        .collect()
+}
+
+fn stats_json(daemon: &Daemon) -> String {
+    let s = &daemon.stats;
+    let load = |v: &AtomicU64| v.load(Ordering::Relaxed);
+    let renders = load(&s.renders);
+    format!(
+        "{{\"uptime_secs\": {}, \"threads\": {}, \"pending\": {}, \"requests\": {}, \
+         \"renders\": {}, \"errors\": {}, \"bytes_in\": {}, \"bytes_out\": {}, \
+         \"mean_render_ms\": {:.3}, \"max_render_ms\": {:.3}}}",
+        daemon.started.elapsed().as_secs(),
+        daemon.threads,
+        daemon.queue.pending(),
+        load(&s.requests),
+        renders,
+        load(&s.errors),
+        load(&s.bytes_in),
+        load(&s.bytes_out),
+        load(&s.render_micros) as f64 / renders.max(1) as f64 / 1000.0,
+        load(&s.max_render_micros) as f64 / 1000.0
+    )
+}
+
+fn read_frame(reader: &mut impl Read) -> io::Result<Vec<u8>> {
+    let mut len = [0u8; 4];
+    reader.read_exact(&mut len)?;
+    let len = u32::from_le_bytes(len) as usize;
+    if len > MAX_FRAME {
+        return Err(io::Error::new(
+            io::ErrorKind::InvalidData,
+            format!("frame of {len} bytes exceeds the limit"),
+        ));
+    }
+    let mut frame = vec![0u8; len];
+    reader.read_exact(&mut frame)?;
+    Ok(frame)
+}
+
+fn write_frame(writer: &mut impl Write, body: &[u8]) -> io::Result<()> {
+    let len = u32::try_from(body.len())
+        .map_err(|_| io::Error::new(io::ErrorKind::InvalidData, "response too large"))?;
+    writer.write_all(&len.to_le_bytes())?;
+    writer.write_all(body)
+}
+
+/// Client side: render `input` to a PNG at `output` through the daemon.
+fn request(socket: &str, input: &str, output: &str, width: u32, scale: f32) -> io::Result<()> {
+    let html = fs::read(input)?;
+    let mut stream = UnixStream::connect(socket)?;
+
+    let mut frame = vec![OP_RENDER];
+    frame.extend_from_slice(&width.to_le_bytes());
+    frame.extend_from_slice(&scale.to_bits().to_le_bytes());
+    frame.push(FORMAT_PNG);
+    frame.extend_from_slice(&0u32.to_le_bytes());
+    frame.extend_from_slice(&html);
+
+    let started = Instant::now();
+    write_frame(&mut stream, &frame)?;
+    let reply = read_frame(&mut stream)?;
+    let elapsed = started.elapsed();
+
+    match reply.split_first() {
+        Some((&STATUS_OK, body)) if body.len() >= 8 => {
+            let w = u32::from_le_bytes(body[0..4].try_into().unwrap());
+            let h = u32::from_le_bytes(body[4..8].try_into().unwrap());
+            fs::write(output, &body[8..])?;
+            eprintln!("{w}x{h} in {:.2} ms", elapsed.as_secs_f64() * 1000.0);
+            Ok(())
+        }
+        Some((_, message)) => Err(io::Error::other(
+            String::from_utf8_lossy(message).into_owned(),
+        )),
+        None => Err(io::Error::new(io::ErrorKind::InvalidData, "empty reply")),
+    }
+}
@@ -81,7 +81,7 @@ fn main() {
     let base_framebuffer = premul_to_rgb(container.pixels());
 
     // Third pass: create document for interactive selection (layout only, no draw)
-    let measure = container.text_measure_fn();
+    let measure = container.text_measure();
     let doc = match Document::from_html(&html, &mut container, None, None) {
         Ok(mut d) => {
             let _ = d.render(width as f32);
@@ -0,0 +1,564 @@
+//! Asynchronous resource loading for document construction.
+//!
+//! litehtml parses synchronously and asks the container for `@import`ed
+//! stylesheets from inside the CSS parser, so a plain [`DocumentContainer`]
+//! has to block until the stylesheet is available. [`AsyncDocumentContainer`]
+//! instead returns futures, and [`Document::from_html_async`] drives parsing
+//! as a small state machine:
+//!
+//! 1. Parse with every stylesheet resolved so far. Unresolved `@import`s are
+//!    recorded and answered with an empty stylesheet; image requests are
+//!    recorded as well.
+//! 2. If anything new was recorded, drop that pass, await all outstanding
+//!    fetches concurrently, and parse again.
+//! 3. Once a pass completes without new requests, that document is returned.
+//!
+//! Each round resolves one level of `@import` nesting, so a document without
+//! external resources is parsed exactly once. The C++ parser itself cannot be
+//! suspended mid-parse; restarting a cheap parse is what lets the expensive
+//! part (network and disk I/O) run without blocking the thread. Because the
+//! returned future only borrows its own container, many documents can be
+//! loaded concurrently on a single executor.
+
+use std::collections::{HashMap, HashSet};
+use std::future::Future;
+use std::pin::Pin;
+use std::task::{Context, Poll};
+
+use crate::{CreateError, Document, DocumentContainer, DocumentOptions};
+
+/// Boxed future returned by [`AsyncDocumentContainer`] resource methods.
+pub type ResourceFuture<'a, T> = Pin<Box<dyn Future<Output = T> + 'a>>;
+
+/// Upper bound on parse passes in [`Document::from_html_async`]. Each pass
+/// resolves one level of `@import` nesting (plus the images discovered so
+/// far), so this also bounds import chains and breaks import cycles.
+const MAX_FETCH_ROUNDS: usize = 16;
+
+/// A [`DocumentContainer`] whose resource callbacks complete asynchronously.
+///
+/// Drawing, measuring and every other callback stay synchronous; only the
+/// methods that typically hit the network or disk return futures.
+pub trait AsyncDocumentContainer: DocumentContainer {
+    /// Fetch the stylesheet at `url`, relative to `baseurl`.
+    ///
+    /// Resolves to the CSS text and, optionally, the URL the stylesheet was
+    /// loaded from (used to resolve relative references inside it), exactly
+    /// like [`DocumentContainer::import_css`]. Resolve to an empty string
+    /// on failure.
+    fn fetch_css(&self, url: &str, baseurl: &str) -> ResourceFuture<'_, (String, Option<String>)>;
+
+    /// Fetch the raw bytes of the image at `src`, relative to `baseurl`.
+    ///
+    /// Resolves to `None` if the image is unavailable. The default fetches
+    /// nothing.
+    fn fetch_image(&self, _src: &str, _baseurl: &str) -> ResourceFuture<'_, Option<Vec<u8>>> {
+        Box::pin(std::future::ready(None))
+    }
+
+    /// Receive image bytes resolved by [`fetch_image`](Self::fetch_image),
+    /// before the document that requested them is returned. Containers
+    /// typically decode and store the image here so `get_image_size` and
+    /// `draw_image` can use it.
+    fn image_fetched(&mut self, _src: &str, _baseurl: &str, _data: Vec<u8>) {}
+}
+
+// ---------------------------------------------------------------------------
+// Prefetch state shared with the bridge callbacks
+// ---------------------------------------------------------------------------
+
+/// Resources resolved so far, plus the requests recorded during the current
+/// parse pass. Lives in `BridgeData` for documents built by
+/// [`Document::from_html_async`].
+#[derive(Default)]
+pub(crate) struct Prefetch {
+    css: HashMap<(String, String), (String, Option<String>)>,
+    css_misses: Vec<(String, String)>,
+    images: Vec<(String, String)>,
+    /// While recording, unresolved imports are noted and answered with an
+    /// empty stylesheet. Once the document is handed out, misses fall back
+    /// to the synchronous `import_css` instead.
+    recording: bool,
+}
+
+impl Prefetch {
+    /// Look up a prefetched stylesheet. Returns `None` when the caller should
+    /// fall back to the container's synchronous `import_css`.
+    pub(crate) fn import_css(
+        &mut self,
+        url: &str,
+        baseurl: &str,
+    ) -> Option<(String, Option<String>)> {
+        let key = (url.to_string(), baseurl.to_string());
+        if let Some(found) = self.css.get(&key) {
+            return Some(found.clone());
+        }
+        if !self.recording {
+            return None;
+        }
+        if !self.css_misses.contains(&key) {
+            self.css_misses.push(key);
+        }
+        Some((String::new(), None))
+    }
+
+    /// Note an image request made during the current pass.
+    pub(crate) fn record_image(&mut self, src: &str, baseurl: &str) {
+        if !self.recording || src.is_empty() {
+            return;
+        }
+        let key = (src.to_string(), baseurl.to_string());
+        if !self.images.contains(&key) {
+            self.images.push(key);
+        }
+    }
+}
+
+/// Outcome of a single resource fetch within one round.
+enum Fetched {
+    Css((String, String), (String, Option<String>)),
+    Image((String, String), Option<Vec<u8>>),
+}
+
+// ---------------------------------------------------------------------------
+// Document construction
+// ---------------------------------------------------------------------------
+
+impl<'a, C: AsyncDocumentContainer + ?Sized + 'a> Document<'a, C> {
+    /// Parse HTML into a document, fetching `@import`ed stylesheets and
+    /// images through `container`'s asynchronous resource methods.
+    ///
+    /// Takes the same arguments as [`from_html`](Self::from_html). The
+    /// returned document behaves exactly like a synchronously created one;
+    /// stylesheets imported later (e.g. by
+    /// [`add_stylesheet`](Self::add_stylesheet)) go through the synchronous
+    /// [`DocumentContainer::import_css`].
+    pub async fn from_html_async(
+        html: &str,
+        container: &'a mut C,
+        master_css: Option<&str>,
+        user_styles: Option<&str>,
+    ) -> Result<Self, CreateError> {
+        let options = DocumentOptions {
+            master_css,
+            user_styles,
+            ..DocumentOptions::default()
+        };
+        let container: *mut C = container;
+        let mut prefetch = Prefetch {
+            recording: true,
+            ..Prefetch::default()
+        };
+        let mut images_done: HashSet<(String, String)> = HashSet::new();
+
+        for round in 0..MAX_FETCH_ROUNDS {
+            // SAFETY: `container` comes from a `&'a mut C`. Every document
+            // created in an earlier round has been dropped before this
+            // reborrow, and no fetch future outlives its round, so this is
+            // the only live borrow derived from the pointer.
+            let mut doc = Self::create(html, unsafe { &mut *container }, &options, Some(prefetch))?;
+
+            let state = doc.prefetch_mut();
+            let css_misses = std::mem::take(&mut state.css_misses);
+            let images: Vec<(String, String)> = std::mem::take(&mut state.images)
+                .into_iter()
+                .filter(|key| !images_done.contains(key))
+                .collect();
+
+            if (css_misses.is_empty() && images.is_empty()) || round + 1 == MAX_FETCH_ROUNDS {
+                state.recording = false;
+                return Ok(doc);
+            }
+
+            prefetch = doc.take_prefetch();
+            drop(doc);
+
+            let results = {
+                // SAFETY: no document is alive at this point; the shared
+                // borrow ends with this block, before `image_fetched` below.
+                let container = unsafe { &*container };
+                let mut fetches: Vec<ResourceFuture<'_, Fetched>> =
+                    Vec::with_capacity(css_misses.len() + images.len());
+                for key in css_misses {
+                    let fut = container.fetch_css(&key.0, &key.1);
+                    fetches.push(Box::pin(async move { Fetched::Css(key, fut.await) }));
+                }
+                for key in images {
+                    let fut = container.fetch_image(&key.0, &key.1);
+                    fetches.push(Box::pin(async move { Fetched::Image(key, fut.await) }));
+                }
+                join_all(fetches).await
+            };
+
+            for fetched in results {
+                match fetched {
+                    Fetched::Css(key, css) => {
+                        prefetch.css.insert(key, css);
+                    }
+                    Fetched::Image(key, data) => {
+                        if let Some(data) = data {
+                            // SAFETY: see above; no other borrow is live.
+                            unsafe { &mut *container }.image_fetched(&key.0, &key.1, data);
+                        }
+                        images_done.insert(key);
+                    }
+                }
+            }
+        }
+        unreachable!("the final round always returns")
+    }
+
+    /// Prefetch state of a document under construction.
+    fn prefetch_mut(&mut self) -> &mut Prefetch {
+        // SAFETY: the bridge is owned by this document and no callback is
+        // running while we hold `&mut self`.
+        let bridge = unsafe { &mut *self.bridge };
+        bridge
+            .prefetch
+            .as_mut()
+            .expect("document was created with prefetch state")
+    }
+
+    /// Move the prefetch state out so it can seed the next parse pass.
+    fn take_prefetch(&mut self) -> Prefetch {
+        // SAFETY: see `prefetch_mut`.
+        let bridge = unsafe { &mut *self.bridge };
+        bridge.prefetch.take().unwrap_or_default()
+    }
+}
+
+// ---------------------------------------------------------------------------
+// join_all
+// ---------------------------------------------------------------------------
+
+/// Poll every future in `futures` until all have completed, returning their
+/// outputs in the original order.
+pub fn join_all<'a, T>(futures: Vec<ResourceFuture<'a, T>>) -> JoinAll<'a, T> {
+    let results = futures.iter().map(|_| None).collect();
+    JoinAll {
+        futures: futures.into_iter().map(Some).collect(),
+        results,
+    }
+}
+
+/// Future returned by [`join_all`].
+pub struct JoinAll<'a, T> {
+    futures: Vec<Option<ResourceFuture<'a, T>>>,
+    results: Vec<Option<T>>,
+}
+
+// Outputs are stored by value and never pinned; the futures themselves are
+// already boxed.
+impl<T> Unpin for JoinAll<'_, T> {}
+
+impl<T> Future for JoinAll<'_, T> {
+    type Output = Vec<T>;
+
+    fn poll(self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<Vec<T>> {
+        let this = self.get_mut();
+        let mut pending = false;
+        for (slot, out) in this.futures.iter_mut().zip(this.results.iter_mut()) {
+            if let Some(fut) = slot {
+                match fut.as_mut().poll(cx) {
+                    Poll::Ready(value) => {
+                        *out = Some(value);
+                        *slot = None;
+                    }
+                    Poll::Pending => pending = true,
+                }
+            }
+        }
+        if pending {
+            return Poll::Pending;
+        }
+        Poll::Ready(
+            this.results
+                .iter_mut()
+                .map(|r| r.take().expect("join_all polled after completion"))
+                .collect(),
+        )
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Tests
+// ---------------------------------------------------------------------------
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::{
+        Color, DrawContext, FontDescription, FontHandle, FontMetrics, MediaFeatures, MediaType,
+        Position, Size,
+    };
+    use std::cell::{Cell, RefCell};
+    use std::rc::Rc;
+    use std::sync::Arc;
+    use std::task::{Wake, Waker};
+
+    /// Minimal single-threaded executor: parks the thread until woken.
+    fn block_on<F: Future>(fut: F) -> F::Output {
+        struct ThreadWaker(std::thread::Thread);
+        impl Wake for ThreadWaker {
+            fn wake(self: Arc<Self>) {
+                self.0.unpark();
+            }
+        }
+
+        let mut fut = std::pin::pin!(fut);
+        let waker = Waker::from(Arc::new(ThreadWaker(std::thread::current())));
+        let mut cx = Context::from_waker(&waker);
+        loop {
+            if let Poll::Ready(out) = fut.as_mut().poll(&mut cx) {
+                return out;
+            }
+            std::thread::park();
+        }
+    }
+
+    /// Future that returns `Pending` once before completing, so every fetch
+    /// actually suspends the caller.
+    struct Delayed<T>(Option<T>, bool);
+
+    impl<T: Unpin> Future for Delayed<T> {
+        type Output = T;
+        fn poll(mut self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<T> {
+            if !self.1 {
+                self.1 = true;
+                cx.waker().wake_by_ref();
+                return Poll::Pending;
+            }
+            Poll::Ready(self.0.take().expect("polled after completion"))
+        }
+    }
+
+    /// In-process stand-in for an HTTP server: serves fixed resources and
+    /// logs every request.
+    #[derive(Default)]
+    struct StandInServer {
+        css: HashMap<String, String>,
+        images: HashMap<String, Vec<u8>>,
+        log: RefCell<Vec<String>>,
+    }
+
+    impl StandInServer {
+        fn get(&self, path: &str) -> Delayed<Option<Vec<u8>>> {
+            self.log.borrow_mut().push(path.to_string());
+            let body = self
+                .css
+                .get(path)
+                .map(|s| s.as_bytes().to_vec())
+                .or_else(|| self.images.get(path).cloned());
+            Delayed(Some(body), false)
+        }
+    }
+
+    struct AsyncTestContainer {
+        server: Rc<StandInServer>,
+        images: HashMap<String, Size>,
+        sync_imports: Cell<usize>,
+        next_font_id: usize,
+    }
+
+    impl AsyncTestContainer {
+        fn new(server: Rc<StandInServer>) -> Self {
+            Self {
+                server,
+                images: HashMap::new(),
+                sync_imports: Cell::new(0),
+                next_font_id: 1,
+            }
+        }
+    }
+
+    impl DocumentContainer for AsyncTestContainer {
+        fn create_font(&mut self, descr: &FontDescription) -> (FontHandle, FontMetrics) {
+            let id = self.next_font_id;
+            self.next_font_id += 1;
+            let size = descr.size();
+            let metrics = FontMetrics {
+                font_size: size,
+                height: size * 1.25,
+                ascent: size,
+                descent: size * 0.25,
+                x_height: size * 0.5,
+                ch_width: size * 0.5,
+                draw_spaces: false,
+                sub_shift: 0.0,
+                super_shift: 0.0,
+            };
+            (FontHandle(id), metrics)
+        }
+
+        fn delete_font(&mut self, _font: FontHandle) {}
+
+        fn text_width(&self, text: &str, _font: FontHandle) -> f32 {
+            text.len() as f32 * 8.0
+        }
+
+        fn draw_text(
+            &mut self,
+            _hdc: DrawContext,
+            _text: &str,
+            _font: FontHandle,
+            _color: Color,
+            _pos: Position,
+        ) {
+        }
+
+        fn get_image_size(&self, src: &str, _baseurl: &str) -> Size {
+            self.images.get(src).copied().unwrap_or_default()
+        }
+
+        fn import_css(&self, _url: &str, _baseurl: &str) -> (String, Option<String>) {
+            self.sync_imports.set(self.sync_imports.get() + 1);
+            (String::new(), None)
+        }
+
+        fn get_viewport(&self) -> Position {
+            Position {
+                x: 0.0,
+                y: 0.0,
+                width: 800.0,
+                height: 600.0,
+            }
+        }
+
+        fn get_media_features(&self) -> MediaFeatures {
+            MediaFeatures {
+                media_type: MediaType::Screen,
+                width: 800.0,
+                height: 600.0,
+                device_width: 800.0,
+                device_height: 600.0,
+                color: 8,
+                color_index: 0,
+                monochrome: 0,
+                resolution: 96.0,
+            }
+        }
+    }
+
+    impl AsyncDocumentContainer for AsyncTestContainer {
+        fn fetch_css(
+            &self,
+            url: &str,
+            _baseurl: &str,
+        ) -> ResourceFuture<'_, (String, Option<String>)> {
+            let response = self.server.get(url);
+            let url = url.to_string();
+            Box::pin(async move {
+                let body = response.await.unwrap_or_default();
+                (String::from_utf8(body).unwrap_or_default(), Some(url))
+            })
+        }
+
+        fn fetch_image(&self, src: &str, _baseurl: &str) -> ResourceFuture<'_, Option<Vec<u8>>> {
+            Box::pin(self.server.get(src))
+        }
+
+        fn image_fetched(&mut self, src: &str, _baseurl: &str, data: Vec<u8>) {
+            // The stand-in "image format" is two bytes: width and height.
+            let size = Size {
+                width: data[0] as f32,
+                height: data[1] as f32,
+            };
+            self.images.insert(src.to_string(), size);
+        }
+    }
+
+    fn server() -> Rc<StandInServer> {
+        let mut server = StandInServer::default();
+        server
+            .css
+            .insert("a.css".into(), "@import url(b.css); p { margin: 0 }".into());
+        server
+            .css
+            .insert("b.css".into(), ".big { font-size: 30px }".into());
+        server.images.insert("dot.png".into(), vec![40, 20]);
+        Rc::new(server)
+    }
+
+    #[test]
+    fn test_async_resolves_nested_imports() {
+        let server = server();
+        let mut container = AsyncTestContainer::new(server.clone());
+        let html = r#"<style>@import url(a.css);</style><p class="big">hi</p>"#;
+        let doc = block_on(Document::from_html_async(html, &mut container, None, None))
+            .expect("document");
+        let p = doc.root().and_then(|r| r.select_one(".big")).expect("p");
+        assert_eq!(p.font_size(), 30.0);
+        assert_eq!(*server.log.borrow(), vec!["a.css", "b.css"]);
+        drop(doc);
+        assert_eq!(container.sync_imports.get(), 0);
+    }
+
+    #[test]
+    fn test_async_delivers_images_before_layout() {
+        let server = server();
+        let mut container = AsyncTestContainer::new(server.clone());
+        let html = r#"<img id="i" src="dot.png">"#;
+        let mut doc = block_on(Document::from_html_async(html, &mut container, None, None))
+            .expect("document");
+        let _ = doc.render(800.0);
+        let img = doc.root().and_then(|r| r.select_one("#i")).expect("img");
+        assert_eq!(img.placement().width, 40.0);
+        assert_eq!(img.placement().height, 20.0);
+        assert_eq!(*server.log.borrow(), vec!["dot.png"]);
+    }
+
+    #[test]
+    fn test_async_without_resources_fetches_nothing() {
+        let server = server();
+        let mut container = AsyncTestContainer::new(server.clone());
+        let doc = block_on(Document::from_html_async(
+            "<p>plain</p>",
+            &mut container,
+            None,
+            None,
+        ));
+        assert!(doc.is_ok());
+        assert!(server.log.borrow().is_empty());
+    }
+
+    #[test]
+    fn test_async_many_documents_on_one_executor() {
+        let server = server();
+        let mut a = AsyncTestContainer::new(server.clone());
+        let mut b = AsyncTestContainer::new(server.clone());
+        let html = r#"<style>@import url(a.css);</style><p class="big">x</p>"#;
+        let loads: Vec<ResourceFuture<'_, _>> = vec![
+            Box::pin(Document::from_html_async(html, &mut a, None, None)),
+            Box::pin(Document::from_html_async(html, &mut b, None, None)),
+        ];
+        let docs = block_on(join_all(loads));
+        assert_eq!(docs.len(), 2);
+        for doc in &docs {
+            let doc = doc.as_ref().expect("document");
+            let p = doc.root().and_then(|r| r.select_one(".big")).expect("p");
+            assert_eq!(p.font_size(), 30.0);
+        }
+        // Both loads progressed in lock-step: each level of imports was
+        // requested by both documents before either moved on.
+        assert_eq!(
+            *server.log.borrow(),
+            vec!["a.css", "a.css", "b.css", "b.css"]
+        );
+    }
+
+    #[test]
+    fn test_prefetch_falls_back_to_sync_after_construction() {
+        let mut prefetch = Prefetch {
+            recording: true,
+            ..Prefetch::default()
+        };
+        assert_eq!(
+            prefetch.import_css("x.css", ""),
+            Some((String::new(), None))
+        );
+        assert_eq!(prefetch.css_misses.len(), 1);
+        prefetch.recording = false;
+        assert_eq!(prefetch.import_css("y.css", ""), None);
+        assert_eq!(prefetch.css_misses.len(), 1);
+    }
+}
@@ -0,0 +1,303 @@
+//! Render-cost estimation for admission control.
+//!
+//! A [`RenderCost`] summarizes the features of a document that drive parse,
+//! style and layout time: element count, nesting depth, table cells, text
+//! volume, images and stylesheet rules. It comes from one of two places:
+//!
+//! - `html::estimate_render_cost` scans the markup without parsing it. It is
+//!   cheap enough to run on every request before deciding whether to accept
+//!   it, but approximate (implied end tags are only partly modelled).
+//! - [`Document::render_cost`](crate::Document::render_cost) measures a
+//!   parsed document exactly.
+//!
+//! A [`CostModel`] turns the features into a single score. The default
+//! weights are rough; [`CostModel::calibrate`] fits them to render times
+//! measured on the actual workload.
+//!
+//! ```ignore
+//! let model = CostModel::calibrate(&samples);
+//! let cost = html::estimate_render_cost(&html);
+//! match model.score(&cost) {
+//!     s if s > REJECT => return Err(TooExpensive),
+//!     s if s > HEAVY => heavy_pool.submit(job),
+//!     _ => pool.submit(job),
+//! }
+//! ```
+
+/// Features of a document that determine how expensive it is to render.
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct RenderCost {
+    /// Element nodes; text is counted in `text_bytes`.
+    pub nodes: usize,
+    /// Deepest element nesting; the root element is at depth 1.
+    pub max_depth: usize,
+    /// Table cells (`<td>`, `<th>`, or `display: table-cell` once parsed).
+    pub table_cells: usize,
+    /// Bytes of text content, excluding markup, scripts and stylesheets.
+    pub text_bytes: usize,
+    /// `<img>` elements.
+    pub images: usize,
+    /// Rule blocks in `<style>` elements. Rules nested in `@media` and
+    /// similar blocks count; the at-rule block itself does not.
+    pub style_rules: usize,
+}
+
+impl RenderCost {
+    /// Score under the default [`CostModel`].
+    pub fn score(&self) -> f64 {
+        CostModel::default().score(self)
+    }
+
+    /// Model inputs: each feature, then style rules times nodes, which
+    /// approximates the selector-matching work.
+    fn features(&self) -> [f64; FEATURES] {
+        [
+            1.0,
+            self.nodes as f64,
+            self.max_depth as f64,
+            self.table_cells as f64,
+            self.text_bytes as f64,
+            self.images as f64,
+            self.style_rules as f64,
+            self.style_rules as f64 * self.nodes as f64,
+        ]
+    }
+}
+
+/// Intercept plus the seven weighted inputs of [`RenderCost::features`].
+const FEATURES: usize = 8;
+
+/// Linear model from [`RenderCost`] to an estimated render time.
+///
+/// The default weights approximate microseconds for a full parse and layout
+/// on one core; any consistent unit works once calibrated.
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct CostModel {
+    /// Fixed cost of any document.
+    pub base: f64,
+    pub per_node: f64,
+    pub per_depth: f64,
+    pub per_table_cell: f64,
+    pub per_text_byte: f64,
+    pub per_image: f64,
+    pub per_style_rule: f64,
+    /// Cost of matching one style rule against one element.
+    pub per_rule_node: f64,
+}
+
+impl Default for CostModel {
+    fn default() -> Self {
+        Self {
+            base: 200.0,
+            per_node: 2.0,
+            per_depth: 5.0,
+            per_table_cell: 4.0,
+            per_text_byte: 0.05,
+            per_image: 20.0,
+            per_style_rule: 3.0,
+            per_rule_node: 0.01,
+        }
+    }
+}
+
+impl CostModel {
+    /// Estimated cost of rendering a document with these features.
+    pub fn score(&self, cost: &RenderCost) -> f64 {
+        self.weights()
+            .iter()
+            .zip(cost.features())
+            .map(|(w, x)| w * x)
+            .sum()
+    }
+
+    /// Fit the weights to `(features, measured cost)` samples by least
+    /// squares.
+    ///
+    /// The fit is pulled towards the default weights, so features the
+    /// samples do not exercise (say, no sample has images) keep their
+    /// default instead of dropping to zero. Negative weights are clamped to
+    /// zero. With no samples this returns the default model.
+    pub fn calibrate(samples: &[(RenderCost, f64)]) -> Self {
+        let prior = Self::default().weights();
+        if samples.is_empty() {
+            return Self::from_weights(prior);
+        }
+
+        // Scale every feature to at most 1 so the normal equations stay well
+        // conditioned; text bytes and rules x nodes dwarf the rest otherwise.
+        let rows: Vec<[f64; FEATURES]> = samples.iter().map(|(c, _)| c.features()).collect();
+        let mut scale = [1.0f64; FEATURES];
+        for (j, s) in scale.iter_mut().enumerate() {
+            let max = rows.iter().map(|r| r[j].abs()).fold(0.0, f64::max);
+            if max > 0.0 {
+                *s = max;
+            }
+        }
+
+        // (XᵀX + λI) w = Xᵀy + λ w₀, in scaled units.
+        const RIDGE: f64 = 1e-3;
+        let mut a = [[0.0f64; FEATURES]; FEATURES];
+        let mut b = [0.0f64; FEATURES];
+        for (row, (_, y)) in rows.iter().zip(samples) {
+            for i in 0..FEATURES {
+                let xi = row[i] / scale[i];
+                b[i] += xi * y;
+                for j in 0..FEATURES {
+                    a[i][j] += xi * row[j] / scale[j];
+                }
+            }
+        }
+        for i in 0..FEATURES {
+            a[i][i] += RIDGE;
+            b[i] += RIDGE * prior[i] * scale[i];
+        }
+
+        let Some(w) = solve(a, b) else {
+            return Self::from_weights(prior);
+        };
+        let mut weights = [0.0; FEATURES];
+        for i in 0..FEATURES {
+            weights[i] = (w[i] / scale[i]).max(0.0);
+        }
+        Self::from_weights(weights)
+    }
+
+    fn weights(&self) -> [f64; FEATURES] {
+        [
+            self.base,
+            self.per_node,
+            self.per_depth,
+            self.per_table_cell,
+            self.per_text_byte,
+            self.per_image,
+            self.per_style_rule,
+            self.per_rule_node,
+        ]
+    }
+
+    fn from_weights(w: [f64; FEATURES]) -> Self {
+        Self {
+            base: w[0],
+            per_node: w[1],
+            per_depth: w[2],
+            per_table_cell: w[3],
+            per_text_byte: w[4],
+            per_image: w[5],
+            per_style_rule: w[6],
+            per_rule_node: w[7],
+        }
+    }
+}
+
+/// Gaussian elimination with partial pivoting. `None` if `a` is singular.
+fn solve(mut a: [[f64; FEATURES]; FEATURES], mut b: [f64; FEATURES]) -> Option<[f64; FEATURES]> {
+    for col in 0..FEATURES {
+        let pivot = (col..FEATURES).max_by(|&i, &j| a[i][col].abs().total_cmp(&a[j][col].abs()))?;
+        if a[pivot][col].abs() < 1e-12 {
+            return None;
+        }
+        a.swap(col, pivot);
+        b.swap(col, pivot);
+        for row in col + 1..FEATURES {
+            let f = a[row][col] / a[col][col];
+            for k in col..FEATURES {
+                a[row][k] -= f * a[col][k];
+            }
+            b[row] -= f * b[col];
+        }
+    }
+    let mut x = [0.0; FEATURES];
+    for row in (0..FEATURES).rev() {
+        let tail: f64 = (row + 1..FEATURES).map(|k| a[row][k] * x[k]).sum();
+        x[row] = (b[row] - tail) / a[row][row];
+    }
+    Some(x)
+}
+
+/// Count rule blocks in a stylesheet: every `{` outside comments and
+/// strings, except those opening an at-rule (`@media`, `@font-face`, ...).
+#[cfg_attr(not(feature = "html"), allow(dead_code))]
+pub(crate) fn count_css_rules(css: &str) -> usize {
+    let bytes = css.as_bytes();
+    let mut rules = 0;
+    let mut prelude_start = 0;
+    let mut i = 0;
+    while i < bytes.len() {
+        match bytes[i] {
+            b'/' if bytes.get(i + 1) == Some(&b'*') => {
+                i = css[i + 2..]
+                    .find("*/")
+                    .map_or(bytes.len(), |e| i + 2 + e + 2);
+                continue;
+            }
+            q @ (b'"' | b'\'') => {
+                i += 1;
+                while i < bytes.len() && bytes[i] != q {
+                    i += if bytes[i] == b'\\' { 2 } else { 1 };
+                }
+            }
+            b'{' => {
+                if !css[prelude_start..i].trim_start().starts_with('@') {
+                    rules += 1;
+                }
+                prelude_start = i + 1;
+            }
+            b'}' | b';' => prelude_start = i + 1,
+            _ => {}
+        }
+        i += 1;
+    }
+    rules
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_count_css_rules() {
+        let css = r#"
+            /* a { } */
+            p { color: red }
+            @media print { h1, h2 { margin: 0 } .x { content: "{" } }
+            @font-face { font-family: X; }
+        "#;
+        assert_eq!(count_css_rules(css), 3);
+    }
+
+    #[test]
+    fn test_calibrate_recovers_weights() {
+        let truth = CostModel {
+            base: 50.0,
+            per_node: 3.0,
+            per_depth: 1.0,
+            per_table_cell: 10.0,
+            per_text_byte: 0.1,
+            per_image: 0.0,
+            per_style_rule: 2.0,
+            per_rule_node: 0.02,
+        };
+        let samples: Vec<_> = (1..40)
+            .map(|i| {
+                let cost = RenderCost {
+                    nodes: i * 37 % 500 + i,
+                    max_depth: i % 13 + 3,
+                    table_cells: i * 11 % 90,
+                    text_bytes: i * 997 % 20_000,
+                    images: 0,
+                    style_rules: i * 7 % 60,
+                };
+                (cost, truth.score(&cost))
+            })
+            .collect();
+
+        let fitted = CostModel::calibrate(&samples);
+        for (cost, measured) in &samples {
+            let err = (fitted.score(cost) - measured).abs() / measured;
+            assert!(err < 0.01, "relative error {err}");
+        }
+        // No sample has images: the default weight is kept.
+        assert!((fitted.per_image - CostModel::default().per_image).abs() < 1.0);
+        assert_eq!(CostModel::calibrate(&[]), CostModel::default());
+    }
+}
@@ -0,0 +1,753 @@
+//! Retained display lists with spatial culling.
+//!
+//! [`RecordingContainer`] sits between a [`Document`] and a real container.
+//! Layout callbacks go through to the real container unchanged, while draw
+//! callbacks are kept as [`DrawOp`]s with fonts and images resolved to
+//! [`FontId`] and [`ImageId`]. The resulting [`DisplayList`] is owned and
+//! `Send`, and carries a uniform grid index over the bounds of each
+//! operation. Replaying a viewport only visits the operations that intersect
+//! it. Scrolling, thumbnails and output at several scales can therefore
+//! share one recording instead of walking litehtml's render tree each time.
+//!
+//! ```ignore
+//! let list = DisplayList::record(&html, &mut measure, 800.0, &Default::default())?;
+//!
+//! // Draw the part of the page currently scrolled into view.
+//! let viewport = Position { x: 0.0, y: 0.0, width: 800.0, height: 600.0 };
+//! list.replay(&mut pixbuf, DrawContext::default(), 0.0, -scroll_y, Some(viewport));
+//! ```
+
+use std::collections::HashMap;
+use std::marker::PhantomData;
+
+use crate::snapshot::{
+    intersects, DrawOp, FontDescriptor, FontId, GradientStops, ImageId, ImageRef, LayoutSnapshot,
+    ReplaySession,
+};
+use crate::{
+    BackgroundLayer, BorderRadiuses, Borders, Color, ConicGradient, CreateError, Document,
+    DocumentContainer, DocumentOptions, DrawContext, FontDescription, FontHandle, FontMetrics,
+    LinearGradient, ListMarker, MediaFeatures, MouseEvent, Position, RadialGradient, Size,
+    TextTransform,
+};
+
+/// Side length of one grid cell, in CSS pixels.
+const CELL_SIZE: f32 = 256.0;
+
+/// Upper bound on cells per axis, so a stray huge box cannot blow up the
+/// index.
+const MAX_CELLS: usize = 1024;
+
+fn owned_layer(layer: &BackgroundLayer<'_>) -> BackgroundLayer<'static> {
+    BackgroundLayer {
+        border_box: layer.border_box,
+        border_radius: layer.border_radius,
+        clip_box: layer.clip_box,
+        origin_box: layer.origin_box,
+        attachment: layer.attachment,
+        repeat: layer.repeat,
+        is_root: layer.is_root,
+        _phantom: PhantomData,
+    }
+}
+
+// ---------------------------------------------------------------------------
+// RecordingContainer
+// ---------------------------------------------------------------------------
+
+/// Container adapter that forwards layout callbacks to `inner` and turns
+/// draw callbacks into [`DrawOp`]s instead of painting.
+///
+/// Create a [`Document`] over the recorder, render and draw it once, drop
+/// the document, then call [`finish`](Self::finish) to take the recording.
+///
+/// The recorder hands litehtml its own font handles, never reused, so a
+/// handle the inner container recycles after `delete_font` cannot make a
+/// later op point at the wrong font.
+pub struct RecordingContainer<'c, C: ?Sized> {
+    inner: &'c mut C,
+    fonts: Vec<FontDescriptor>,
+    /// Recorder handle to the inner container's handle and the recorded font.
+    handles: HashMap<FontHandle, (FontHandle, FontId)>,
+    next_font: usize,
+    /// Stands in for draws with a handle `create_font` never returned.
+    default_font: Option<FontId>,
+    images: Vec<ImageRef>,
+    image_ids: HashMap<ImageRef, ImageId>,
+    ops: Vec<DrawOp>,
+}
+
+impl<'c, C: DocumentContainer + ?Sized> RecordingContainer<'c, C> {
+    /// Record draw calls, forwarding everything else to `inner`.
+    pub fn new(inner: &'c mut C) -> Self {
+        Self {
+            inner,
+            fonts: Vec::new(),
+            handles: HashMap::new(),
+            next_font: 0,
+            default_font: None,
+            images: Vec::new(),
+            image_ids: HashMap::new(),
+            ops: Vec::new(),
+        }
+    }
+
+    fn image_id(&mut self, url: &str, base_url: &str) -> ImageId {
+        let key = ImageRef {
+            url: url.to_string(),
+            base_url: base_url.to_string(),
+        };
+        if let Some(id) = self.image_ids.get(&key) {
+            return *id;
+        }
+        let id = ImageId(self.images.len() as u32);
+        self.images.push(key.clone());
+        self.image_ids.insert(key, id);
+        id
+    }
+
+    fn inner_font(&self, font: FontHandle) -> FontHandle {
+        self.handles.get(&font).map_or(font, |&(inner, _)| inner)
+    }
+
+    /// The recorded font for `font`. litehtml draws with handle 0 when no
+    /// font could be created; that is recorded, on first use, as the
+    /// container's default font, so the op still replays.
+    fn font_id(&mut self, font: FontHandle) -> FontId {
+        if let Some(&(_, id)) = self.handles.get(&font) {
+            return id;
+        }
+        *self.default_font.get_or_insert_with(|| {
+            self.fonts.push(FontDescriptor {
+                family: self.inner.default_font_name().to_string(),
+                size: self.inner.default_font_size(),
+                style: Default::default(),
+                weight: 400,
+                decoration_line: Default::default(),
+                decoration_thickness: Default::default(),
+                decoration_style: Default::default(),
+                decoration_color: Default::default(),
+                emphasis_style: String::new(),
+                emphasis_color: Default::default(),
+                emphasis_position: Default::default(),
+            });
+            FontId(self.fonts.len() as u32 - 1)
+        })
+    }
+
+    /// Take the recorded operations as an indexed display list.
+    pub fn finish(self) -> DisplayList {
+        DisplayList::from_parts(self.fonts, self.images, self.ops)
+    }
+}
+
+impl<C: DocumentContainer + ?Sized> DocumentContainer for RecordingContainer<'_, C> {
+    fn create_font(&mut self, descr: &FontDescription) -> (FontHandle, FontMetrics) {
+        let (inner, metrics) = self.inner.create_font(descr);
+        let id = FontId(self.fonts.len() as u32);
+        self.fonts.push(FontDescriptor::from_description(descr));
+        self.next_font += 1;
+        let handle = FontHandle(self.next_font);
+        self.handles.insert(handle, (inner, id));
+        (handle, metrics)
+    }
+
+    fn delete_font(&mut self, font: FontHandle) {
+        // The descriptor stays: recorded ops still refer to its FontId.
+        if let Some((inner, _)) = self.handles.remove(&font) {
+            self.inner.delete_font(inner);
+        }
+    }
+
+    fn text_width(&self, text: &str, font: FontHandle) -> f32 {
+        self.inner.text_width(text, self.inner_font(font))
+    }
+
+    fn draw_text(
+        &mut self,
+        _hdc: DrawContext,
+        text: &str,
+        font: FontHandle,
+        color: Color,
+        pos: Position,
+    ) {
+        let font = self.font_id(font);
+        self.ops.push(DrawOp::Text {
+            text: text.to_string(),
+            font,
+            color,
+            pos,
+        });
+    }
+
+    fn pt_to_px(&self, pt: f32) -> f32 {
+        self.inner.pt_to_px(pt)
+    }
+
+    fn default_font_size(&self) -> f32 {
+        self.inner.default_font_size()
+    }
+
+    fn default_font_name(&self) -> &str {
+        self.inner.default_font_name()
+    }
+
+    fn draw_list_marker(&mut self, _hdc: DrawContext, marker: &ListMarker) {
+        let font = self.font_id(marker.font);
+        let image = (!marker.image.is_empty()).then(|| self.image_id(marker.image, marker.baseurl));
+        self.ops.push(DrawOp::ListMarker {
+            image,
+            marker_type: marker.marker_type,
+            color: marker.color,
+            pos: marker.pos,
+            index: marker.index,
+            font,
+        });
+    }
+
+    fn load_image(&mut self, src: &str, baseurl: &str, redraw_on_ready: bool) {
+        self.inner.load_image(src, baseurl, redraw_on_ready);
+    }
+
+    fn get_image_size(&self, src: &str, baseurl: &str) -> Size {
+        self.inner.get_image_size(src, baseurl)
+    }
+
+    fn draw_image(
+        &mut self,
+        _hdc: DrawContext,
+        layer: &BackgroundLayer,
+        url: &str,
+        base_url: &str,
+    ) {
+        let image = self.image_id(url, base_url);
+        self.ops.push(DrawOp::Image {
+            layer: owned_layer(layer),
+            image,
+        });
+    }
+
+    fn draw_solid_fill(&mut self, _hdc: DrawContext, layer: &BackgroundLayer, color: Color) {
+        self.ops.push(DrawOp::SolidFill {
+            layer: owned_layer(layer),
+            color,
+        });
+    }
+
+    fn draw_linear_gradient(
+        &mut self,
+        _hdc: DrawContext,
+        layer: &BackgroundLayer,
+        gradient: &LinearGradient,
+    ) {
+        self.ops.push(DrawOp::LinearGradient {
+            layer: owned_layer(layer),
+            start: gradient.start,
+            end: gradient.end,
+            stops: GradientStops {
+                points: gradient.color_points.to_vec(),
+                color_space: gradient.color_space,
+                hue_interpolation: gradient.hue_interpolation,
+            },
+        });
+    }
+
+    fn draw_radial_gradient(
+        &mut self,
+        _hdc: DrawContext,
+        layer: &BackgroundLayer,
+        gradient: &RadialGradient,
+    ) {
+        self.ops.push(DrawOp::RadialGradient {
+            layer: owned_layer(layer),
+            position: gradient.position,
+            radius: gradient.radius,
+            stops: GradientStops {
+                points: gradient.color_points.to_vec(),
+                color_space: gradient.color_space,
+                hue_interpolation: gradient.hue_interpolation,
+            },
+        });
+    }
+
+    fn draw_conic_gradient(
+        &mut self,
+        _hdc: DrawContext,
+        layer: &BackgroundLayer,
+        gradient: &ConicGradient,
+    ) {
+        self.ops.push(DrawOp::ConicGradient {
+            layer: owned_layer(layer),
+            position: gradient.position,
+            angle: gradient.angle,
+            radius: gradient.radius,
+            stops: GradientStops {
+                points: gradient.color_points.to_vec(),
+                color_space: gradient.color_space,
+                hue_interpolation: gradient.hue_interpolation,
+            },
+        });
+    }
+
+    fn draw_borders(
+        &mut self,
+        _hdc: DrawContext,
+        borders: &Borders,
+        draw_pos: Position,
+        root: bool,
+    ) {
+        self.ops.push(DrawOp::Borders {
+            borders: *borders,
+            draw_pos,
+            root,
+        });
+    }
+
+    fn set_caption(&mut self, caption: &str) {
+        self.inner.set_caption(caption);
+    }
+
+    fn set_base_url(&mut self, base_url: &str) {
+        self.inner.set_base_url(base_url);
+    }
+
+    fn link(&mut self) {
+        self.inner.link();
+    }
+
+    fn on_anchor_click(&mut self, url: &str) {
+        self.inner.on_anchor_click(url);
+    }
+
+    fn on_mouse_event(&mut self, event: MouseEvent) {
+        self.inner.on_mouse_event(event);
+    }
+
+    fn set_cursor(&mut self, cursor: &str) {
+        self.inner.set_cursor(cursor);
+    }
+
+    fn transform_text(&self, text: &str, tt: TextTransform) -> String {
+        self.inner.transform_text(text, tt)
+    }
+
+    fn import_css(&self, url: &str, baseurl: &str) -> (String, Option<String>) {
+        self.inner.import_css(url, baseurl)
+    }
+
+    fn set_clip(&mut self, pos: Position, radius: BorderRadiuses) {
+        self.ops.push(DrawOp::SetClip { pos, radius });
+    }
+
+    fn del_clip(&mut self) {
+        self.ops.push(DrawOp::DelClip);
+    }
+
+    fn get_viewport(&self) -> Position {
+        self.inner.get_viewport()
+    }
+
+    fn get_media_features(&self) -> MediaFeatures {
+        self.inner.get_media_features()
+    }
+
+    fn get_language(&self) -> (String, String) {
+        self.inner.get_language()
+    }
+}
+
+// ---------------------------------------------------------------------------
+// DisplayList
+// ---------------------------------------------------------------------------
+
+/// Owned, spatially indexed draw operations for one laid-out document.
+#[derive(Debug, Clone)]
+pub struct DisplayList {
+    fonts: Vec<FontDescriptor>,
+    images: Vec<ImageRef>,
+    ops: Vec<DrawOp>,
+    bounds: Vec<Option<Position>>,
+    extent: Position,
+    grid: GridIndex,
+}
+
+impl DisplayList {
+    /// Parse `html`, lay it out at `width` and record one full draw pass.
+    ///
+    /// `container` answers layout callbacks; none of its draw methods are
+    /// called.
+    pub fn record<C: DocumentContainer + ?Sized>(
+        html: &str,
+        container: &mut C,
+        width: f32,
+        options: &DocumentOptions<'_>,
+    ) -> Result<Self, CreateError> {
+        let mut recorder = RecordingContainer::new(container);
+        {
+            let mut doc = Document::from_html_with_options(html, &mut recorder, options)?;
+            let _ = doc.render(width);
+            doc.draw(DrawContext::default(), 0.0, 0.0, None);
+        }
+        Ok(recorder.finish())
+    }
+
+    pub(crate) fn from_parts(
+        fonts: Vec<FontDescriptor>,
+        images: Vec<ImageRef>,
+        ops: Vec<DrawOp>,
+    ) -> Self {
+        let bounds: Vec<Option<Position>> = ops.iter().map(DrawOp::bounds).collect();
+        let extent = bounds
+            .iter()
+            .flatten()
+            .fold(None, |acc: Option<Position>, b| {
+                Some(match acc {
+                    Some(a) => union(&a, b),
+                    None => *b,
+                })
+            });
+        let extent = extent.unwrap_or_default();
+        let grid = GridIndex::build(&extent, &bounds);
+        Self {
+            fonts,
+            images,
+            ops,
+            bounds,
+            extent,
+            grid,
+        }
+    }
+
+    pub(crate) fn into_parts(self) -> (Vec<FontDescriptor>, Vec<ImageRef>, Vec<DrawOp>) {
+        (self.fonts, self.images, self.ops)
+    }
+
+    /// Number of recorded operations.
+    pub fn len(&self) -> usize {
+        self.ops.len()
+    }
+
+    /// Returns `true` if nothing was drawn.
+    pub fn is_empty(&self) -> bool {
+        self.ops.is_empty()
+    }
+
+    /// Recorded operations in draw order.
+    pub fn ops(&self) -> &[DrawOp] {
+        &self.ops
+    }
+
+    /// Fonts referenced by [`FontId`].
+    pub fn fonts(&self) -> &[FontDescriptor] {
+        &self.fonts
+    }
+
+    /// Images referenced by [`ImageId`].
+    pub fn images(&self) -> &[ImageRef] {
+        &self.images
+    }
+
+    /// Union of the bounds of every painting operation, in document
+    /// coordinates.
+    pub fn extent(&self) -> Position {
+        self.extent
+    }
+
+    /// Indices of the operations needed to paint `rect` (document
+    /// coordinates), in draw order. Clip operations are always included so
+    /// the clip stack stays balanced.
+    pub fn query(&self, rect: Position) -> Vec<usize> {
+        let mut hits = self.grid.candidates(&rect);
+        hits.retain(|&i| {
+            self.bounds[i as usize]
+                .as_ref()
+                .is_some_and(|b| intersects(b, &rect))
+        });
+        let mut out = Vec::with_capacity(hits.len() + self.grid.clips.len());
+        let (mut a, mut b) = (hits.iter().peekable(), self.grid.clips.iter().peekable());
+        loop {
+            let next = match (a.peek(), b.peek()) {
+                (Some(&&x), Some(&&y)) if x < y => a.next(),
+                (Some(_), Some(_)) | (None, Some(_)) => b.next(),
+                (Some(_), None) => a.next(),
+                (None, None) => break,
+            };
+            out.push(*next.unwrap() as usize);
+        }
+        out
+    }
+
+    /// Replay into `container`, offset by `(x, y)`.
+    ///
+    /// If `viewport` is `Some`, it is given in the target's coordinates and
+    /// only operations intersecting it are issued, found through the grid
+    /// index rather than a scan of the whole list.
+    pub fn replay<C: DocumentContainer + ?Sized>(
+        &self,
+        container: &mut C,
+        hdc: DrawContext,
+        x: f32,
+        y: f32,
+        viewport: Option<Position>,
+    ) {
+        let mut session = ReplaySession::new(&self.fonts, &self.images);
+        match viewport {
+            Some(viewport) => {
+                let rect = Position {
+                    x: viewport.x - x,
+                    y: viewport.y - y,
+                    ..viewport
+                };
+                for i in self.query(rect) {
+                    session.draw(container, hdc, &self.ops[i], x, y);
+                }
+            }
+            None => {
+                for op in &self.ops {
+                    session.draw(container, hdc, op, x, y);
+                }
+            }
+        }
+        session.finish(container);
+    }
+}
+
+impl From<LayoutSnapshot> for DisplayList {
+    fn from(snapshot: LayoutSnapshot) -> Self {
+        let (fonts, images, ops) = snapshot.into_parts();
+        Self::from_parts(fonts, images, ops)
+    }
+}
+
+fn union(a: &Position, b: &Position) -> Position {
+    let x = a.x.min(b.x);
+    let y = a.y.min(b.y);
+    Position {
+        x,
+        y,
+        width: (a.x + a.width).max(b.x + b.width) - x,
+        height: (a.y + a.height).max(b.y + b.height) - y,
+    }
+}
+
+/// Uniform grid over the list extent. Each cell holds the indices of the
+/// operations whose bounds touch it, in ascending order.
+#[derive(Debug, Clone, Default)]
+struct GridIndex {
+    origin_x: f32,
+    origin_y: f32,
+    cell_w: f32,
+    cell_h: f32,
+    cols: usize,
+    rows: usize,
+    cells: Vec<Vec<u32>>,
+    /// Operations without bounds (clip push/pop), in ascending order.
+    clips: Vec<u32>,
+}
+
+impl GridIndex {
+    fn build(extent: &Position, bounds: &[Option<Position>]) -> Self {
+        let cols = ((extent.width / CELL_SIZE).ceil() as usize).clamp(1, MAX_CELLS);
+        let rows = ((extent.height / CELL_SIZE).ceil() as usize).clamp(1, MAX_CELLS);
+        let mut grid = Self {
+            origin_x: extent.x,
+            origin_y: extent.y,
+            cell_w: (extent.width / cols as f32).max(1.0),
+            cell_h: (extent.height / rows as f32).max(1.0),
+            cols,
+            rows,
+            cells: vec![Vec::new(); cols * rows],
+            clips: Vec::new(),
+        };
+        for (i, b) in bounds.iter().enumerate() {
+            match b {
+                Some(b) => {
+                    let (c0, c1, r0, r1) = grid.cell_range(b);
+                    for r in r0..=r1 {
+                        for c in c0..=c1 {
+                            grid.cells[r * cols + c].push(i as u32);
+                        }
+                    }
+                }
+                None => grid.clips.push(i as u32),
+            }
+        }
+        grid
+    }
+
+    /// Inclusive column and row range covered by `rect`, clamped to the grid.
+    fn cell_range(&self, rect: &Position) -> (usize, usize, usize, usize) {
+        let col = |x: f32| {
+            (((x - self.origin_x) / self.cell_w).floor().max(0.0) as usize).min(self.cols - 1)
+        };
+        let row = |y: f32| {
+            (((y - self.origin_y) / self.cell_h).floor().max(0.0) as usize).min(self.rows - 1)
+        };
+        (
+            col(rect.x),
+            col(rect.x + rect.width),
+            row(rect.y),
+            row(rect.y + rect.height),
+        )
+    }
+
+    /// Sorted, deduplicated indices of operations in cells touched by `rect`.
+    fn candidates(&self, rect: &Position) -> Vec<u32> {
+        let (c0, c1, r0, r1) = self.cell_range(rect);
+        let mut out = Vec::new();
+        for r in r0..=r1 {
+            for c in c0..=c1 {
+                out.extend_from_slice(&self.cells[r * self.cols + c]);
+            }
+        }
+        out.sort_unstable();
+        out.dedup();
+        out
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::test_util::Canvas;
+
+    fn long_page() -> String {
+        let mut html = String::from("<body>");
+        for i in 0..200 {
+            html.push_str(&format!("<p>paragraph {i}</p>"));
+        }
+        html.push_str("</body>");
+        html
+    }
+
+    #[test]
+    fn test_display_list_is_send() {
+        fn assert_send<T: Send + Sync>() {}
+        assert_send::<DisplayList>();
+    }
+
+    #[test]
+    fn test_viewport_replay_matches_scan() {
+        let mut measure = Canvas::default();
+        let list = DisplayList::record(&long_page(), &mut measure, 600.0, &Default::default())
+            .expect("record");
+        assert!(measure.texts.is_empty(), "recording must not draw");
+        assert!(list.extent().height > 2000.0);
+
+        let viewport = Position {
+            x: 0.0,
+            y: 0.0,
+            width: 600.0,
+            height: 400.0,
+        };
+        let scroll_y = 1000.0;
+
+        let mut culled = Canvas::default();
+        list.replay(
+            &mut culled,
+            DrawContext::default(),
+            0.0,
+            -scroll_y,
+            Some(viewport),
+        );
+        assert_eq!(culled.clips, 0);
+        assert!(!culled.texts.is_empty());
+
+        let expected: Vec<_> = list
+            .ops()
+            .iter()
+            .filter_map(|op| match op {
+                DrawOp::Text { text, pos, .. } => Some((text.clone(), *pos, op.bounds()?)),
+                _ => None,
+            })
+            .filter(|(_, _, b)| b.y + b.height > scroll_y && b.y < scroll_y + 400.0)
+            .map(|(text, pos, _)| {
+                (
+                    text,
+                    Position {
+                        y: pos.y - scroll_y,
+                        ..pos
+                    },
+                )
+            })
+            .collect();
+        assert_eq!(culled.texts, expected);
+    }
+
+    #[test]
+    fn test_recorder_keeps_ops_across_font_handle_reuse() {
+        let font = |family: &str| FontDescriptor {
+            family: family.to_string(),
+            size: 16.0,
+            style: Default::default(),
+            weight: 400,
+            decoration_line: Default::default(),
+            decoration_thickness: Default::default(),
+            decoration_style: Default::default(),
+            decoration_color: Default::default(),
+            emphasis_style: String::new(),
+            emphasis_color: Default::default(),
+            emphasis_position: Default::default(),
+        };
+        // Not the default family, so a stale descriptor would show up.
+        let (cursive, mono) = (font("cursive"), font("monospace"));
+        let pos = Position {
+            x: 0.0,
+            y: 0.0,
+            width: 40.0,
+            height: 20.0,
+        };
+
+        let mut canvas = Canvas::default();
+        let mut recorder = RecordingContainer::new(&mut canvas);
+        let (a, _) = recorder.create_font(&cursive.as_description());
+        recorder.delete_font(a);
+        // The inner container hands out its freed handle again.
+        recorder.inner.next_font = 0;
+        let (b, _) = recorder.create_font(&mono.as_description());
+        assert_ne!(a, b);
+        let hdc = DrawContext::default();
+        recorder.draw_text(hdc, "mono", b, Color::default(), pos);
+        // Unknown handles fall back to the default font ("serif").
+        recorder.draw_text(hdc, "none", FontHandle(0), Color::default(), pos);
+
+        let list = recorder.finish();
+        let families: Vec<_> = list
+            .ops()
+            .iter()
+            .filter_map(|op| match op {
+                DrawOp::Text { text, font, .. } => {
+                    Some((text.as_str(), list.fonts()[font.0 as usize].family.as_str()))
+                }
+                _ => None,
+            })
+            .collect();
+        assert_eq!(families, [("mono", "monospace"), ("none", "serif")]);
+    }
+
+    #[test]
+    fn test_query_returns_draw_order() {
+        let mut measure = Canvas::default();
+        let list =
+            DisplayList::record(&long_page(), &mut measure, 600.0, &Default::default()).unwrap();
+        let hits = list.query(list.extent());
+        assert!(hits.windows(2).all(|w| w[0] < w[1]));
+        for (i, op) in list.ops().iter().enumerate() {
+            if matches!(
+                op,
+                DrawOp::Text { .. } | DrawOp::SetClip { .. } | DrawOp::DelClip
+            ) {
+                assert!(hits.contains(&i));
+            }
+        }
+        assert!(list
+            .query(Position {
+                x: 0.0,
+                y: -500.0,
+                width: 10.0,
+                height: 10.0,
+            })
+            .iter()
+            .all(|&i| list.ops()[i].bounds().is_none()));
+    }
+}
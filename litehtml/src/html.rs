@@ -742,6 +742,140 @@ fn preprocess_cellpadding(html: &str) -> String {
     result
 }
 
+// ---------------------------------------------------------------------------
+// Render cost estimation
+// ---------------------------------------------------------------------------
+
+/// Elements that never have content.
+const VOID_ELEMENTS: &[&str] = &[
+    "area", "base", "br", "col", "embed", "hr", "img", "input", "link", "meta", "source", "track",
+    "wbr",
+];
+
+/// Elements whose content is raw text, not markup.
+const RAW_TEXT_ELEMENTS: &[&str] = &["script", "style", "textarea", "title", "xmp"];
+
+/// Elements implicitly closed by a following sibling of the same kind; each
+/// entry lists the open elements a new one closes.
+const SELF_CLOSING_SIBLINGS: &[(&str, &[&str])] = &[
+    ("p", &["p"]),
+    ("li", &["li"]),
+    ("dt", &["dt", "dd"]),
+    ("dd", &["dt", "dd"]),
+    ("option", &["option"]),
+    ("tr", &["tr", "td", "th"]),
+    ("td", &["td", "th"]),
+    ("th", &["td", "th"]),
+];
+
+/// Estimate the cost of rendering `html` by scanning its tags, without
+/// parsing it.
+///
+/// Runs in one linear pass over the input and builds no tree, so it can gate
+/// admission before any parsing work is spent. Depth is
+/// approximate: void elements and the common implied end tags (`p`, `li`,
+/// `tr`, `td`, ...) are handled, the rest of the HTML tree-building rules are
+/// not. [`Document::render_cost`](crate::Document::render_cost) gives exact
+/// figures for a parsed document.
+pub fn estimate_render_cost(html: &str) -> crate::cost::RenderCost {
+    let mut cost = crate::cost::RenderCost::default();
+    let mut open: Vec<String> = Vec::new();
+    // Open elements per name, so a close tag with nothing to match (say,
+    // thousands of stray `</x>` under a deep stack) costs no stack scan.
+    let mut open_names: std::collections::HashMap<String, usize> = std::collections::HashMap::new();
+    let bytes = html.as_bytes();
+    let mut text_start = 0;
+    let mut i = 0;
+
+    while i < bytes.len() {
+        if bytes[i] != b'<' {
+            i += 1;
+            continue;
+        }
+        let rest = &html[i..];
+        // Comments, doctype and processing instructions
+        if let Some(comment) = rest.strip_prefix("<!--") {
+            cost.text_bytes += i - text_start;
+            i = comment.find("-->").map_or(bytes.len(), |e| i + 4 + e + 3);
+            text_start = i;
+            continue;
+        }
+        let next = bytes.get(i + 1).copied().unwrap_or(b' ');
+        if !(next.is_ascii_alphabetic() || next == b'/' || next == b'!' || next == b'?') {
+            // A lone '<' is text
+            i += 1;
+            continue;
+        }
+        let Some(tag_end) = find_tag_end(html, i) else {
+            break;
+        };
+        cost.text_bytes += i - text_start;
+        let tag_content = &html[i + 1..tag_end];
+        i = tag_end + 1;
+        text_start = i;
+        if next == b'!' || next == b'?' {
+            continue;
+        }
+
+        let name = extract_tag_name(tag_content).to_ascii_lowercase();
+        if tag_content.starts_with('/') {
+            if open_names.get(&name).is_some_and(|&n| n > 0) {
+                if let Some(pos) = open.iter().rposition(|t| *t == name) {
+                    for popped in open.drain(pos..) {
+                        *open_names.entry(popped).or_default() -= 1;
+                    }
+                }
+            }
+            continue;
+        }
+
+        cost.nodes += 1;
+        match name.as_str() {
+            "td" | "th" => cost.table_cells += 1,
+            "img" => cost.images += 1,
+            _ => {}
+        }
+        if let Some((_, closes)) = SELF_CLOSING_SIBLINGS.iter().find(|(t, _)| *t == name) {
+            while open.last().is_some_and(|t| closes.contains(&t.as_str())) {
+                if let Some(popped) = open.pop() {
+                    *open_names.entry(popped).or_default() -= 1;
+                }
+            }
+        }
+        cost.max_depth = cost.max_depth.max(open.len() + 1);
+        if VOID_ELEMENTS.contains(&name.as_str()) || tag_content.ends_with('/') {
+            continue;
+        }
+
+        if RAW_TEXT_ELEMENTS.contains(&name.as_str()) {
+            let close = format!("</{name}");
+            let body_end =
+                find_ascii_case_insensitive(&html[i..], &close).map_or(bytes.len(), |e| i + e);
+            let body = &html[i..body_end];
+            match name.as_str() {
+                "style" => cost.style_rules += crate::cost::count_css_rules(body),
+                "script" => {}
+                _ => cost.text_bytes += body.len(),
+            }
+            i = find_tag_end(html, body_end).map_or(bytes.len(), |e| e + 1);
+            text_start = i;
+            continue;
+        }
+        *open_names.entry(name.clone()).or_default() += 1;
+        open.push(name);
+    }
+    cost.text_bytes += bytes.len() - text_start;
+    cost
+}
+
+/// Byte offset of the first ASCII case-insensitive match of `needle`.
+fn find_ascii_case_insensitive(haystack: &str, needle: &str) -> Option<usize> {
+    haystack
+        .as_bytes()
+        .windows(needle.len())
+        .position(|w| w.eq_ignore_ascii_case(needle.as_bytes()))
+}
+
 // ---------------------------------------------------------------------------
 // HTML preprocessing pipeline
 // ---------------------------------------------------------------------------
@@ -1135,4 +1269,34 @@ mod tests {
         assert!(prepared.html.contains('\u{201c}'));
         assert!(prepared.html.contains('\u{201d}'));
     }
+
+    // -- Render cost estimation --
+
+    #[test]
+    fn estimate_render_cost_counts_features() {
+        let html = r#"<!DOCTYPE html><html><head><style>p { color: red } @media print { a { x: y } }</style></head>
+<body><!-- <img> --><table><tr><td>a<td>b<tr><td>c</table><p>one<p>two<img src="x.png"><br>
+<ul><li>x<li>y</ul><script>if (a < b) { document.write("<td>") }</script></body></html>"#;
+        let cost = estimate_render_cost(html);
+        assert_eq!(cost.nodes, 18);
+        assert_eq!(cost.table_cells, 3);
+        assert_eq!(cost.images, 1);
+        assert_eq!(cost.style_rules, 2);
+        // html > body > table > tr > td
+        assert_eq!(cost.max_depth, 5);
+        assert!(cost.text_bytes >= "abconetwoxy".len());
+    }
+
+    #[test]
+    fn estimate_render_cost_stray_close_tags() {
+        let html = format!(
+            "{}{}<p>x</p>{}",
+            "<div>".repeat(5_000),
+            "</x>".repeat(100_000),
+            "</div>".repeat(5_000)
+        );
+        let cost = estimate_render_cost(&html);
+        assert_eq!(cost.nodes, 5_001);
+        assert_eq!(cost.max_depth, 5_001);
+    }
 }
@@ -25,6 +25,8 @@ pub enum CreateError {
     InvalidString(std::ffi::NulError),
     /// The litehtml C++ engine returned a null document pointer.
     CreateFailed,
+    /// The [`Budget`] ran out before the document was built.
+    Aborted(AbortReason),
 }
 
 impl std::fmt::Display for CreateError {
@@ -32,6 +34,7 @@ impl std::fmt::Display for CreateError {
         match self {
             Self::InvalidString(e) => write!(f, "string contains interior null byte: {e}"),
             Self::CreateFailed => write!(f, "litehtml failed to create document"),
+            Self::Aborted(reason) => write!(f, "document creation aborted: {reason}"),
         }
     }
 }
@@ -40,7 +43,7 @@ impl std::error::Error for CreateError {
     fn source(&self) -> Option<&(dyn std::error::Error + 'static)> {
         match self {
             Self::InvalidString(e) => Some(e),
-            Self::CreateFailed => None,
+            Self::CreateFailed | Self::Aborted(_) => None,
         }
     }
 }
@@ -51,6 +54,40 @@ impl From<std::ffi::NulError> for CreateError {
     }
 }
 
+/// Why a budgeted create or render call stopped early.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash)]
+pub enum AbortReason {
+    /// The [`CancellationToken`] was cancelled.
+    Cancelled,
+    /// The step limit was reached.
+    StepLimit,
+    /// The time limit was reached.
+    TimeLimit,
+}
+
+impl AbortReason {
+    fn from_c_int(v: c_int) -> Option<Self> {
+        match v as u32 {
+            sys::LH_ABORT_CANCELLED => Some(Self::Cancelled),
+            sys::LH_ABORT_STEPS => Some(Self::StepLimit),
+            sys::LH_ABORT_TIME => Some(Self::TimeLimit),
+            _ => None,
+        }
+    }
+}
+
+impl std::fmt::Display for AbortReason {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        match self {
+            Self::Cancelled => write!(f, "cancelled"),
+            Self::StepLimit => write!(f, "step limit reached"),
+            Self::TimeLimit => write!(f, "time limit reached"),
+        }
+    }
+}
+
+impl std::error::Error for AbortReason {}
+
 // ---------------------------------------------------------------------------
 // Safe Rust value types
 // ---------------------------------------------------------------------------
@@ -779,13 +816,41 @@ pub enum DecorationThickness {
 }
 
 // ---------------------------------------------------------------------------
-// Opaque pointer wrappers (borrowed, read-only)
+// Callback argument snapshots (borrowed strings, read-only)
 // ---------------------------------------------------------------------------
 
-/// Borrowed reference to a font description from litehtml.
+/// Borrow a C string from a snapshot field as `&str`, returning `""` for
+/// null or non-UTF-8 input.
+///
+/// # Safety
+///
+/// If non-null, `ptr` must point to a valid, null-terminated C string that
+/// lives at least as long as `'a`.
+unsafe fn snapshot_str<'a>(ptr: *const c_char) -> &'a str {
+    if ptr.is_null() {
+        ""
+    } else {
+        CStr::from_ptr(ptr).to_str().unwrap_or("")
+    }
+}
+
+/// Font description passed to [`DocumentContainer::create_font`].
+///
+/// All fields are read from litehtml in a single FFI call; the string fields
+/// borrow from litehtml for the duration of the callback.
+#[derive(Debug, Clone, Copy, PartialEq)]
 pub struct FontDescription<'a> {
-    ptr: *const sys::lh_font_description_t,
-    _phantom: PhantomData<&'a ()>,
+    family: &'a str,
+    size: f32,
+    style: FontStyle,
+    weight: i32,
+    decoration_line: TextDecorationLine,
+    decoration_thickness: DecorationThickness,
+    decoration_style: TextDecorationStyle,
+    decoration_color: Color,
+    emphasis_style: &'a str,
+    emphasis_color: Color,
+    emphasis_position: TextEmphasisPosition,
 }
 
 impl<'a> FontDescription<'a> {
@@ -794,107 +859,86 @@ impl<'a> FontDescription<'a> {
     /// `ptr` must be a valid, non-null pointer to a `lh_font_description_t`
     /// that lives at least as long as `'a`.
     unsafe fn from_ptr(ptr: *const sys::lh_font_description_t) -> Self {
+        let mut s = sys::lh_font_description_snapshot_t::default();
+        sys::lh_font_description_snapshot(ptr, &mut s);
+        let decoration_thickness = if s.decoration_thickness_is_predefined != 0 {
+            match s.decoration_thickness_predef {
+                1 => DecorationThickness::FromFont,
+                _ => DecorationThickness::Auto,
+            }
+        } else {
+            DecorationThickness::Length(s.decoration_thickness_value)
+        };
         Self {
-            ptr,
-            _phantom: PhantomData,
+            family: snapshot_str(s.family),
+            size: s.size,
+            style: FontStyle::from_c_int(s.style),
+            weight: s.weight,
+            decoration_line: TextDecorationLine(s.decoration_line),
+            decoration_thickness,
+            decoration_style: TextDecorationStyle::from_c_int(s.decoration_style),
+            decoration_color: Color::from(s.decoration_color),
+            emphasis_style: snapshot_str(s.emphasis_style),
+            emphasis_color: Color::from(s.emphasis_color),
+            emphasis_position: TextEmphasisPosition(s.emphasis_position),
         }
     }
 
     pub fn family(&self) -> &'a str {
-        unsafe {
-            let ptr = sys::lh_font_description_family(self.ptr);
-            if ptr.is_null() {
-                ""
-            } else {
-                CStr::from_ptr(ptr).to_str().unwrap_or("")
-            }
-        }
+        self.family
     }
 
     pub fn size(&self) -> f32 {
-        unsafe { sys::lh_font_description_size(self.ptr) }
+        self.size
     }
 
     pub fn style(&self) -> FontStyle {
-        FontStyle::from_c_int(unsafe { sys::lh_font_description_style(self.ptr) })
+        self.style
     }
 
     pub fn weight(&self) -> i32 {
-        unsafe { sys::lh_font_description_weight(self.ptr) }
+        self.weight
     }
 
     pub fn decoration_line(&self) -> TextDecorationLine {
-        TextDecorationLine(unsafe { sys::lh_font_description_decoration_line(self.ptr) })
+        self.decoration_line
     }
 
     pub fn decoration_thickness(&self) -> DecorationThickness {
-        let is_predef =
-            unsafe { sys::lh_font_description_decoration_thickness_is_predefined(self.ptr) };
-        if is_predef != 0 {
-            let predef = unsafe { sys::lh_font_description_decoration_thickness_predef(self.ptr) };
-            match predef {
-                1 => DecorationThickness::FromFont,
-                _ => DecorationThickness::Auto,
-            }
-        } else {
-            DecorationThickness::Length(unsafe {
-                sys::lh_font_description_decoration_thickness_value(self.ptr)
-            })
-        }
+        self.decoration_thickness
     }
 
     pub fn decoration_style(&self) -> TextDecorationStyle {
-        TextDecorationStyle::from_c_int(unsafe {
-            sys::lh_font_description_decoration_style(self.ptr)
-        })
+        self.decoration_style
     }
 
     pub fn decoration_color(&self) -> Color {
-        Color::from(unsafe { sys::lh_font_description_decoration_color(self.ptr) })
+        self.decoration_color
     }
 
     pub fn emphasis_style(&self) -> &'a str {
-        unsafe {
-            let ptr = sys::lh_font_description_emphasis_style(self.ptr);
-            if ptr.is_null() {
-                ""
-            } else {
-                CStr::from_ptr(ptr).to_str().unwrap_or("")
-            }
-        }
+        self.emphasis_style
     }
 
     pub fn emphasis_color(&self) -> Color {
-        Color::from(unsafe { sys::lh_font_description_emphasis_color(self.ptr) })
+        self.emphasis_color
     }
 
     pub fn emphasis_position(&self) -> TextEmphasisPosition {
-        TextEmphasisPosition(unsafe { sys::lh_font_description_emphasis_position(self.ptr) })
+        self.emphasis_position
     }
 }
 
-impl std::fmt::Debug for FontDescription<'_> {
-    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
-        f.debug_struct("FontDescription")
-            .field("family", &self.family())
-            .field("size", &self.size())
-            .field("style", &self.style())
-            .field("weight", &self.weight())
-            .field("decoration_line", &self.decoration_line())
-            .field("decoration_thickness", &self.decoration_thickness())
-            .field("decoration_style", &self.decoration_style())
-            .field("decoration_color", &self.decoration_color())
-            .field("emphasis_style", &self.emphasis_style())
-            .field("emphasis_color", &self.emphasis_color())
-            .field("emphasis_position", &self.emphasis_position())
-            .finish()
-    }
-}
-
-/// Borrowed reference to a list marker from litehtml.
+/// List marker passed to [`DocumentContainer::draw_list_marker`].
+#[derive(Debug, Clone, Copy, PartialEq)]
 pub struct ListMarker<'a> {
-    ptr: *const sys::lh_list_marker_t,
-    _phantom: PhantomData<&'a ()>,
+    image: &'a str,
+    baseurl: &'a str,
+    marker_type: ListStyleType,
+    color: Color,
+    pos: Position,
+    index: i32,
+    font: FontHandle,
 }
 
 impl<'a> ListMarker<'a> {
@@ -902,314 +946,330 @@ impl<'a> ListMarker<'a> {
     ///
     /// `ptr` must be a valid, non-null pointer that lives at least as long as `'a`.
     unsafe fn from_ptr(ptr: *const sys::lh_list_marker_t) -> Self {
+        let mut s = sys::lh_list_marker_snapshot_t::default();
+        sys::lh_list_marker_snapshot(ptr, &mut s);
         Self {
-            ptr,
-            _phantom: PhantomData,
+            image: snapshot_str(s.image),
+            baseurl: snapshot_str(s.baseurl),
+            marker_type: ListStyleType::from_c_int(s.marker_type),
+            color: Color::from(s.color),
+            pos: Position::from(s.pos),
+            index: s.index,
+            font: FontHandle(s.font),
         }
     }
 
     pub fn image(&self) -> &'a str {
-        unsafe {
-            let ptr = sys::lh_list_marker_image(self.ptr);
-            if ptr.is_null() {
-                ""
-            } else {
-                CStr::from_ptr(ptr).to_str().unwrap_or("")
-            }
-        }
+        self.image
     }
 
     pub fn baseurl(&self) -> &'a str {
-        unsafe {
-            let ptr = sys::lh_list_marker_baseurl(self.ptr);
-            if ptr.is_null() {
-                ""
-            } else {
-                CStr::from_ptr(ptr).to_str().unwrap_or("")
-            }
-        }
+        self.baseurl
     }
 
     pub fn marker_type(&self) -> ListStyleType {
-        ListStyleType::from_c_int(unsafe { sys::lh_list_marker_type(self.ptr) })
+        self.marker_type
     }
 
     pub fn color(&self) -> Color {
-        Color::from(unsafe { sys::lh_list_marker_color(self.ptr) })
+        self.color
     }
 
     pub fn pos(&self) -> Position {
-        Position::from(unsafe { sys::lh_list_marker_pos(self.ptr) })
+        self.pos
     }
 
     pub fn index(&self) -> i32 {
-        unsafe { sys::lh_list_marker_index(self.ptr) }
+        self.index
     }
 
     pub fn font(&self) -> FontHandle {
-        FontHandle(unsafe { sys::lh_list_marker_font(self.ptr) })
-    }
-}
-
-impl std::fmt::Debug for ListMarker<'_> {
-    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
-        f.debug_struct("ListMarker")
-            .field("image", &self.image())
-            .field("baseurl", &self.baseurl())
-            .field("marker_type", &self.marker_type())
-            .field("color", &self.color())
-            .field("pos", &self.pos())
-            .field("index", &self.index())
-            .field("font", &self.font())
-            .finish()
+        self.font
     }
 }
 
-/// Borrowed reference to a background layer from litehtml.
+/// Background layer passed to the `draw_image`, `draw_solid_fill` and
+/// `draw_*_gradient` callbacks.
+#[derive(Debug, Clone, Copy, PartialEq)]
 pub struct BackgroundLayer<'a> {
-    ptr: *const sys::lh_background_layer_t,
+    border_box: Position,
+    border_radius: BorderRadiuses,
+    clip_box: Position,
+    origin_box: Position,
+    attachment: BackgroundAttachment,
+    repeat: BackgroundRepeat,
+    is_root: bool,
     _phantom: PhantomData<&'a ()>,
 }
 
-impl<'a> BackgroundLayer<'a> {
+impl BackgroundLayer<'_> {
     /// # Safety
     ///
-    /// `ptr` must be a valid, non-null pointer that lives at least as long as `'a`.
+    /// `ptr` must be a valid, non-null pointer to a `lh_background_layer_t`.
     unsafe fn from_ptr(ptr: *const sys::lh_background_layer_t) -> Self {
+        let mut s = sys::lh_background_layer_snapshot_t::default();
+        sys::lh_background_layer_snapshot(ptr, &mut s);
         Self {
-            ptr,
+            border_box: Position::from(s.border_box),
+            border_radius: BorderRadiuses::from(s.border_radius),
+            clip_box: Position::from(s.clip_box),
+            origin_box: Position::from(s.origin_box),
+            attachment: BackgroundAttachment::from_c_int(s.attachment),
+            repeat: BackgroundRepeat::from_c_int(s.repeat),
+            is_root: s.is_root != 0,
             _phantom: PhantomData,
         }
     }
 
     pub fn border_box(&self) -> Position {
-        Position::from(unsafe { sys::lh_background_layer_border_box(self.ptr) })
+        self.border_box
     }
 
     pub fn border_radius(&self) -> BorderRadiuses {
-        BorderRadiuses::from(unsafe { sys::lh_background_layer_border_radius(self.ptr) })
+        self.border_radius
     }
 
     pub fn clip_box(&self) -> Position {
-        Position::from(unsafe { sys::lh_background_layer_clip_box(self.ptr) })
+        self.clip_box
     }
 
     pub fn origin_box(&self) -> Position {
-        Position::from(unsafe { sys::lh_background_layer_origin_box(self.ptr) })
+        self.origin_box
     }
 
     pub fn attachment(&self) -> BackgroundAttachment {
-        BackgroundAttachment::from_c_int(unsafe { sys::lh_background_layer_attachment(self.ptr) })
+        self.attachment
     }
 
     pub fn repeat(&self) -> BackgroundRepeat {
-        BackgroundRepeat::from_c_int(unsafe { sys::lh_background_layer_repeat(self.ptr) })
+        self.repeat
     }
 
     pub fn is_root(&self) -> bool {
-        unsafe { sys::lh_background_layer_is_root(self.ptr) != 0 }
+        self.is_root
     }
 }
 
-impl std::fmt::Debug for BackgroundLayer<'_> {
-    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
-        f.debug_struct("BackgroundLayer")
-            .field("border_box", &self.border_box())
-            .field("clip_box", &self.clip_box())
-            .field("origin_box", &self.origin_box())
-            .field("is_root", &self.is_root())
-            .finish()
+/// Number of gradient stops that fit in [`ColorStops`] without allocating.
+/// Gradients with more stops fall back to a heap buffer.
+const INLINE_COLOR_STOPS: usize = 16;
+
+/// Callback-local storage for gradient color stops. The C wrapper writes the
+/// stops straight into this buffer; the gradient types borrow from it.
+struct ColorStops {
+    inline: [ColorPoint; INLINE_COLOR_STOPS],
+    heap: Vec<ColorPoint>,
+}
+
+impl ColorStops {
+    fn new() -> Self {
+        Self {
+            inline: [ColorPoint {
+                offset: 0.0,
+                color: Color::default(),
+            }; INLINE_COLOR_STOPS],
+            heap: Vec::new(),
+        }
+    }
+
+    /// Fill the buffer via `snapshot(points, capacity) -> total` and return
+    /// the stops. `snapshot` is called a second time only when the gradient
+    /// has more than [`INLINE_COLOR_STOPS`] stops.
+    fn fill(
+        &mut self,
+        mut snapshot: impl FnMut(*mut sys::lh_color_point_t, c_int) -> c_int,
+    ) -> &[ColorPoint] {
+        let mut raw = [sys::lh_color_point_t::default(); INLINE_COLOR_STOPS];
+        let total = snapshot(raw.as_mut_ptr(), INLINE_COLOR_STOPS as c_int).max(0) as usize;
+        if total <= INLINE_COLOR_STOPS {
+            for (dst, src) in self.inline.iter_mut().zip(&raw[..total]) {
+                *dst = ColorPoint::from(*src);
+            }
+            return &self.inline[..total];
+        }
+        let mut raw = vec![sys::lh_color_point_t::default(); total];
+        let written = snapshot(raw.as_mut_ptr(), total as c_int).clamp(0, total as c_int);
+        self.heap.clear();
+        self.heap
+            .extend(raw[..written as usize].iter().map(|p| ColorPoint::from(*p)));
+        &self.heap
     }
 }
 
-/// Borrowed reference to a linear gradient from litehtml.
+impl From<sys::lh_color_point_t> for ColorPoint {
+    fn from(p: sys::lh_color_point_t) -> Self {
+        Self {
+            offset: p.offset,
+            color: Color::from(p.color),
+        }
+    }
+}
+
+/// Linear gradient passed to [`DocumentContainer::draw_linear_gradient`].
+#[derive(Debug, Clone, Copy, PartialEq)]
 pub struct LinearGradient<'a> {
-    ptr: *const sys::lh_linear_gradient_t,
-    _phantom: PhantomData<&'a ()>,
+    start: Point,
+    end: Point,
+    color_points: &'a [ColorPoint],
+    color_space: ColorSpace,
+    hue_interpolation: HueInterpolation,
 }
 
 impl<'a> LinearGradient<'a> {
     /// # Safety
     ///
-    /// `ptr` must be a valid, non-null pointer that lives at least as long as `'a`.
-    unsafe fn from_ptr(ptr: *const sys::lh_linear_gradient_t) -> Self {
+    /// `ptr` must be a valid, non-null pointer to a `lh_linear_gradient_t`.
+    unsafe fn from_ptr(ptr: *const sys::lh_linear_gradient_t, stops: &'a mut ColorStops) -> Self {
+        let mut s = sys::lh_linear_gradient_snapshot_t::default();
+        let color_points = stops.fill(|points, capacity| {
+            sys::lh_linear_gradient_snapshot(ptr, &mut s, points, capacity);
+            s.color_points_count
+        });
         Self {
-            ptr,
-            _phantom: PhantomData,
+            start: Point::from(s.start),
+            end: Point::from(s.end),
+            color_points,
+            color_space: ColorSpace::from_c_int(s.color_space),
+            hue_interpolation: HueInterpolation::from_c_int(s.hue_interpolation),
         }
     }
 
     pub fn start(&self) -> Point {
-        Point::from(unsafe { sys::lh_linear_gradient_start(self.ptr) })
+        self.start
     }
 
     pub fn end(&self) -> Point {
-        Point::from(unsafe { sys::lh_linear_gradient_end(self.ptr) })
+        self.end
     }
 
     pub fn color_points_count(&self) -> i32 {
-        unsafe { sys::lh_linear_gradient_color_points_count(self.ptr) }
+        self.color_points.len() as i32
     }
 
-    pub fn color_points(&self) -> Vec<ColorPoint> {
-        let count = self.color_points_count();
-        (0..count)
-            .map(|i| ColorPoint {
-                offset: unsafe { sys::lh_linear_gradient_color_point_offset(self.ptr, i) },
-                color: Color::from(unsafe {
-                    sys::lh_linear_gradient_color_point_color(self.ptr, i)
-                }),
-            })
-            .collect()
+    pub fn color_points(&self) -> &'a [ColorPoint] {
+        self.color_points
     }
 
     pub fn color_space(&self) -> ColorSpace {
-        ColorSpace::from_c_int(unsafe { sys::lh_linear_gradient_color_space(self.ptr) })
+        self.color_space
     }
 
     pub fn hue_interpolation(&self) -> HueInterpolation {
-        HueInterpolation::from_c_int(unsafe { sys::lh_linear_gradient_hue_interpolation(self.ptr) })
-    }
-}
-
-impl std::fmt::Debug for LinearGradient<'_> {
-    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
-        f.debug_struct("LinearGradient")
-            .field("start", &self.start())
-            .field("end", &self.end())
-            .field("color_points", &self.color_points())
-            .field("color_space", &self.color_space())
-            .field("hue_interpolation", &self.hue_interpolation())
-            .finish()
+        self.hue_interpolation
     }
 }
 
-/// Borrowed reference to a radial gradient from litehtml.
+/// Radial gradient passed to [`DocumentContainer::draw_radial_gradient`].
+#[derive(Debug, Clone, Copy, PartialEq)]
 pub struct RadialGradient<'a> {
-    ptr: *const sys::lh_radial_gradient_t,
-    _phantom: PhantomData<&'a ()>,
+    position: Point,
+    radius: Point,
+    color_points: &'a [ColorPoint],
+    color_space: ColorSpace,
+    hue_interpolation: HueInterpolation,
 }
 
 impl<'a> RadialGradient<'a> {
     /// # Safety
     ///
-    /// `ptr` must be a valid, non-null pointer that lives at least as long as `'a`.
-    unsafe fn from_ptr(ptr: *const sys::lh_radial_gradient_t) -> Self {
+    /// `ptr` must be a valid, non-null pointer to a `lh_radial_gradient_t`.
+    unsafe fn from_ptr(ptr: *const sys::lh_radial_gradient_t, stops: &'a mut ColorStops) -> Self {
+        let mut s = sys::lh_radial_gradient_snapshot_t::default();
+        let color_points = stops.fill(|points, capacity| {
+            sys::lh_radial_gradient_snapshot(ptr, &mut s, points, capacity);
+            s.color_points_count
+        });
         Self {
-            ptr,
-            _phantom: PhantomData,
+            position: Point::from(s.position),
+            radius: Point::from(s.radius),
+            color_points,
+            color_space: ColorSpace::from_c_int(s.color_space),
+            hue_interpolation: HueInterpolation::from_c_int(s.hue_interpolation),
         }
     }
 
     pub fn position(&self) -> Point {
-        Point::from(unsafe { sys::lh_radial_gradient_position(self.ptr) })
+        self.position
     }
 
     pub fn radius(&self) -> Point {
-        Point::from(unsafe { sys::lh_radial_gradient_radius(self.ptr) })
+        self.radius
     }
 
     pub fn color_points_count(&self) -> i32 {
-        unsafe { sys::lh_radial_gradient_color_points_count(self.ptr) }
+        self.color_points.len() as i32
     }
 
-    pub fn color_points(&self) -> Vec<ColorPoint> {
-        let count = self.color_points_count();
-        (0..count)
-            .map(|i| ColorPoint {
-                offset: unsafe { sys::lh_radial_gradient_color_point_offset(self.ptr, i) },
-                color: Color::from(unsafe {
-                    sys::lh_radial_gradient_color_point_color(self.ptr, i)
-                }),
-            })
-            .collect()
+    pub fn color_points(&self) -> &'a [ColorPoint] {
+        self.color_points
     }
 
     pub fn color_space(&self) -> ColorSpace {
-        ColorSpace::from_c_int(unsafe { sys::lh_radial_gradient_color_space(self.ptr) })
+        self.color_space
     }
 
     pub fn hue_interpolation(&self) -> HueInterpolation {
-        HueInterpolation::from_c_int(unsafe { sys::lh_radial_gradient_hue_interpolation(self.ptr) })
-    }
-}
-
-impl std::fmt::Debug for RadialGradient<'_> {
-    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
-        f.debug_struct("RadialGradient")
-            .field("position", &self.position())
-            .field("radius", &self.radius())
-            .field("color_points", &self.color_points())
-            .field("color_space", &self.color_space())
-            .field("hue_interpolation", &self.hue_interpolation())
-            .finish()
+        self.hue_interpolation
     }
 }
 
-/// Borrowed reference to a conic gradient from litehtml.
+/// Conic gradient passed to [`DocumentContainer::draw_conic_gradient`].
+#[derive(Debug, Clone, Copy, PartialEq)]
 pub struct ConicGradient<'a> {
-    ptr: *const sys::lh_conic_gradient_t,
-    _phantom: PhantomData<&'a ()>,
+    position: Point,
+    angle: f32,
+    radius: f32,
+    color_points: &'a [ColorPoint],
+    color_space: ColorSpace,
+    hue_interpolation: HueInterpolation,
 }
 
 impl<'a> ConicGradient<'a> {
     /// # Safety
     ///
-    /// `ptr` must be a valid, non-null pointer that lives at least as long as `'a`.
-    unsafe fn from_ptr(ptr: *const sys::lh_conic_gradient_t) -> Self {
+    /// `ptr` must be a valid, non-null pointer to a `lh_conic_gradient_t`.
+    unsafe fn from_ptr(ptr: *const sys::lh_conic_gradient_t, stops: &'a mut ColorStops) -> Self {
+        let mut s = sys::lh_conic_gradient_snapshot_t::default();
+        let color_points = stops.fill(|points, capacity| {
+            sys::lh_conic_gradient_snapshot(ptr, &mut s, points, capacity);
+            s.color_points_count
+        });
         Self {
-            ptr,
-            _phantom: PhantomData,
+            position: Point::from(s.position),
+            angle: s.angle,
+            radius: s.radius,
+            color_points,
+            color_space: ColorSpace::from_c_int(s.color_space),
+            hue_interpolation: HueInterpolation::from_c_int(s.hue_interpolation),
         }
     }
 
     pub fn position(&self) -> Point {
-        Point::from(unsafe { sys::lh_conic_gradient_position(self.ptr) })
+        self.position
     }
 
     pub fn angle(&self) -> f32 {
-        unsafe { sys::lh_conic_gradient_angle(self.ptr) }
+        self.angle
     }
 
     pub fn radius(&self) -> f32 {
-        unsafe { sys::lh_conic_gradient_radius(self.ptr) }
+        self.radius
     }
 
     pub fn color_points_count(&self) -> i32 {
-        unsafe { sys::lh_conic_gradient_color_points_count(self.ptr) }
+        self.color_points.len() as i32
     }
 
-    pub fn color_points(&self) -> Vec<ColorPoint> {
-        let count = self.color_points_count();
-        (0..count)
-            .map(|i| ColorPoint {
-                offset: unsafe { sys::lh_conic_gradient_color_point_offset(self.ptr, i) },
-                color: Color::from(unsafe {
-                    sys::lh_conic_gradient_color_point_color(self.ptr, i)
-                }),
-            })
-            .collect()
+    pub fn color_points(&self) -> &'a [ColorPoint] {
+        self.color_points
     }
 
     pub fn color_space(&self) -> ColorSpace {
-        ColorSpace::from_c_int(unsafe { sys::lh_conic_gradient_color_space(self.ptr) })
+        self.color_space
     }
 
     pub fn hue_interpolation(&self) -> HueInterpolation {
-        HueInterpolation::from_c_int(unsafe { sys::lh_conic_gradient_hue_interpolation(self.ptr) })
-    }
-}
-
-impl std::fmt::Debug for ConicGradient<'_> {
-    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
-        f.debug_struct("ConicGradient")
-            .field("position", &self.position())
-            .field("angle", &self.angle())
-            .field("radius", &self.radius())
-            .field("color_points", &self.color_points())
-            .field("color_space", &self.color_space())
-            .field("hue_interpolation", &self.hue_interpolation())
-            .finish()
+        self.hue_interpolation
     }
 }
 
@@ -1419,11 +1479,14 @@ unsafe fn c_str_to_str<'a>(ptr: *const c_char) -> &'a str {
 /// Each callback recovers `&mut BridgeData` via [`bridge_from_user_data`].
 /// This is sound only because litehtml never calls container methods
 /// re-entrantly — at most one callback is active at any time.
-struct BridgeData<'a> {
-    container: &'a mut dyn DocumentContainer,
+struct BridgeData<'a, C: ?Sized> {
+    container: &'a mut C,
     /// Cached null-terminated default font name, kept alive so the pointer
     /// returned by `get_default_font_name` remains valid.
     default_font_name: CString,
+    /// Resources resolved ahead of time by [`Document::from_html_async`].
+    /// `None` for documents created through the synchronous constructors.
+    prefetch: Option<async_container::Prefetch>,
 }
 
 /// Recover a `&mut BridgeData` from the raw `user_data` pointer passed by
@@ -1442,11 +1505,13 @@ struct BridgeData<'a> {
 ///   simultaneous `&mut` references is immediate undefined behavior.
 ///
 ///   This invariant is currently upheld by Rust's borrow checker: `Document`
-///   holds `&'a mut dyn DocumentContainer` for its entire lifetime, so the
+///   holds `&'a mut C` for its entire lifetime, so the
 ///   container cannot simultaneously access the document. litehtml's C++ engine
 ///   also dispatches container callbacks sequentially, never re-entrantly.
-unsafe fn bridge_from_user_data<'a>(user_data: *mut c_void) -> &'a mut BridgeData<'a> {
-    &mut *(user_data as *mut BridgeData<'a>)
+unsafe fn bridge_from_user_data<'a, C: ?Sized>(
+    user_data: *mut c_void,
+) -> &'a mut BridgeData<'a, C> {
+    &mut *(user_data as *mut BridgeData<'a, C>)
 }
 
 // Each `extern "C"` function below matches a field of `lh_container_vtable_t`.
@@ -1458,21 +1523,26 @@ unsafe fn bridge_from_user_data<'a>(user_data: *mut c_void) -> &'a mut BridgeDat
 //   5. The entire body is wrapped in catch_unwind to prevent panics from
 //      unwinding across the FFI boundary (which is UB).
 //
+// Callbacks are generic over the container type, so each `Document<'a, C>`
+// gets its own monomorphized copies and the trait calls can be inlined.
+// `Document<'a>` (i.e. `C = dyn DocumentContainer`) still dispatches
+// dynamically.
+//
 // Re-entrancy constraint: each callback creates a temporary `&mut BridgeData`
-// (and thus `&mut dyn DocumentContainer`) from the raw pointer. This is sound
+// (and thus `&mut C`) from the raw pointer. This is sound
 // only because litehtml dispatches callbacks sequentially — it never calls a
 // second container method while a previous one is still executing. If that
 // invariant were violated, two `&mut` references to the same data would exist
 // simultaneously, which is UB. The `DocumentContainer` trait methods must not
 // call back into the `Document` for the same reason.
 
-unsafe extern "C" fn cb_create_font(
+unsafe extern "C" fn cb_create_font<C: DocumentContainer + ?Sized>(
     user_data: *mut c_void,
     descr: *const sys::lh_font_description_t,
     fm: *mut sys::lh_font_metrics_t,
 ) -> usize {
     catch_unwind(AssertUnwindSafe(|| {
-        let bridge = bridge_from_user_data(user_data);
+        let bridge = bridge_from_user_data::<C>(user_data);
         let font_descr = FontDescription::from_ptr(descr);
         let (handle, metrics) = bridge.container.create_font(&font_descr);
         if !fm.is_null() {
@@ -1483,27 +1553,30 @@ unsafe extern "C" fn cb_create_font(
     .unwrap_or(0)
 }
 
-unsafe extern "C" fn cb_delete_font(user_data: *mut c_void, h_font: usize) {
+unsafe extern "C" fn cb_delete_font<C: DocumentContainer + ?Sized>(
+    user_data: *mut c_void,
+    h_font: usize,
+) {
     let _ = catch_unwind(AssertUnwindSafe(|| {
-        let bridge = bridge_from_user_data(user_data);
+        let bridge = bridge_from_user_data::<C>(user_data);
         bridge.container.delete_font(FontHandle(h_font));
     }));
 }
 
-unsafe extern "C" fn cb_text_width(
+unsafe extern "C" fn cb_text_width<C: DocumentContainer + ?Sized>(
     user_data: *mut c_void,
     text: *const c_char,
     h_font: usize,
 ) -> f32 {
     catch_unwind(AssertUnwindSafe(|| {
-        let bridge = bridge_from_user_data(user_data);
+        let bridge = bridge_from_user_data::<C>(user_data);
         let text = c_str_to_str(text);
         bridge.container.text_width(text, FontHandle(h_font))
     }))
     .unwrap_or(0.0)
 }
 
-unsafe extern "C" fn cb_draw_text(
+unsafe extern "C" fn cb_draw_text<C: DocumentContainer + ?Sized>(
     user_data: *mut c_void,
     hdc: usize,
     text: *const c_char,
@@ -1512,7 +1585,7 @@ unsafe extern "C" fn cb_draw_text(
     pos: sys::lh_position_t,
 ) {
     let _ = catch_unwind(AssertUnwindSafe(|| {
-        let bridge = bridge_from_user_data(user_data);
+        let bridge = bridge_from_user_data::<C>(user_data);
         let text = c_str_to_str(text);
         bridge.container.draw_text(
             DrawContext(hdc),
@@ -1524,66 +1597,76 @@ unsafe extern "C" fn cb_draw_text(
     }));
 }
 
-unsafe extern "C" fn cb_pt_to_px(user_data: *mut c_void, pt: f32) -> f32 {
+unsafe extern "C" fn cb_pt_to_px<C: DocumentContainer + ?Sized>(
+    user_data: *mut c_void,
+    pt: f32,
+) -> f32 {
     catch_unwind(AssertUnwindSafe(|| {
-        let bridge = bridge_from_user_data(user_data);
+        let bridge = bridge_from_user_data::<C>(user_data);
         bridge.container.pt_to_px(pt)
     }))
     .unwrap_or(0.0)
 }
 
-unsafe extern "C" fn cb_get_default_font_size(user_data: *mut c_void) -> f32 {
+unsafe extern "C" fn cb_get_default_font_size<C: DocumentContainer + ?Sized>(
+    user_data: *mut c_void,
+) -> f32 {
     catch_unwind(AssertUnwindSafe(|| {
-        let bridge = bridge_from_user_data(user_data);
+        let bridge = bridge_from_user_data::<C>(user_data);
         bridge.container.default_font_size()
     }))
     .unwrap_or(16.0)
 }
 
-unsafe extern "C" fn cb_get_default_font_name(user_data: *mut c_void) -> *const c_char {
+unsafe extern "C" fn cb_get_default_font_name<C: DocumentContainer + ?Sized>(
+    user_data: *mut c_void,
+) -> *const c_char {
     catch_unwind(AssertUnwindSafe(|| {
-        let bridge = bridge_from_user_data(user_data);
+        let bridge = bridge_from_user_data::<C>(user_data);
         bridge.default_font_name.as_ptr()
     }))
     .unwrap_or(c"serif".as_ptr())
 }
 
-unsafe extern "C" fn cb_draw_list_marker(
+unsafe extern "C" fn cb_draw_list_marker<C: DocumentContainer + ?Sized>(
     user_data: *mut c_void,
     hdc: usize,
     marker: *const sys::lh_list_marker_t,
 ) {
     let _ = catch_unwind(AssertUnwindSafe(|| {
-        let bridge = bridge_from_user_data(user_data);
+        let bridge = bridge_from_user_data::<C>(user_data);
         let marker = ListMarker::from_ptr(marker);
         bridge.container.draw_list_marker(DrawContext(hdc), &marker);
     }));
 }
 
-unsafe extern "C" fn cb_load_image(
+unsafe extern "C" fn cb_load_image<C: DocumentContainer + ?Sized>(
     user_data: *mut c_void,
     src: *const c_char,
     baseurl: *const c_char,
     redraw_on_ready: c_int,
 ) {
     let _ = catch_unwind(AssertUnwindSafe(|| {
-        let bridge = bridge_from_user_data(user_data);
+        let bridge = bridge_from_user_data::<C>(user_data);
         let src = c_str_to_str(src);
         let baseurl = c_str_to_str(baseurl);
+        if let Some(prefetch) = bridge.prefetch.as_mut() {
+            prefetch.record_image(src, baseurl);
+        }
         bridge
             .container
             .load_image(src, baseurl, redraw_on_ready != 0);
     }));
 }
 
-unsafe extern "C" fn cb_get_image_size(
+unsafe extern "C" fn cb_get_image_size<C: DocumentContainer + ?Sized>(
     user_data: *mut c_void,
     src: *const c_char,
     baseurl: *const c_char,
     sz: *mut sys::lh_size_t,
 ) {
     let _ = catch_unwind(AssertUnwindSafe(|| {
-        let bridge = bridge_from_user_data(user_data);
+        let bridge = bridge_from_user_data::<C>(user_data);
         let src = c_str_to_str(src);
         let baseurl = c_str_to_str(baseurl);
         let size = bridge.container.get_image_size(src, baseurl);
@@ -1593,7 +1676,7 @@ unsafe extern "C" fn cb_get_image_size(
     }));
 }
 
-unsafe extern "C" fn cb_draw_image(
+unsafe extern "C" fn cb_draw_image<C: DocumentContainer + ?Sized>(
     user_data: *mut c_void,
     hdc: usize,
     layer: *const sys::lh_background_layer_t,
@@ -1601,7 +1684,7 @@ unsafe extern "C" fn cb_draw_image(
     base_url: *const c_char,
 ) {
     let _ = catch_unwind(AssertUnwindSafe(|| {
-        let bridge = bridge_from_user_data(user_data);
+        let bridge = bridge_from_user_data::<C>(user_data);
         let layer = BackgroundLayer::from_ptr(layer);
         let url = c_str_to_str(url);
         let base_url = c_str_to_str(base_url);
@@ -1611,14 +1694,14 @@ unsafe extern "C" fn cb_draw_image(
     }));
 }
 
-unsafe extern "C" fn cb_draw_solid_fill(
+unsafe extern "C" fn cb_draw_solid_fill<C: DocumentContainer + ?Sized>(
     user_data: *mut c_void,
     hdc: usize,
     layer: *const sys::lh_background_layer_t,
     color: sys::lh_web_color_t,
 ) {
     let _ = catch_unwind(AssertUnwindSafe(|| {
-        let bridge = bridge_from_user_data(user_data);
+        let bridge = bridge_from_user_data::<C>(user_data);
         let layer = BackgroundLayer::from_ptr(layer);
         bridge
             .container
@@ -1626,55 +1709,58 @@ unsafe extern "C" fn cb_draw_solid_fill(
     }));
 }
 
-unsafe extern "C" fn cb_draw_linear_gradient(
+unsafe extern "C" fn cb_draw_linear_gradient<C: DocumentContainer + ?Sized>(
     user_data: *mut c_void,
     hdc: usize,
     layer: *const sys::lh_background_layer_t,
     gradient: *const sys::lh_linear_gradient_t,
 ) {
     let _ = catch_unwind(AssertUnwindSafe(|| {
-        let bridge = bridge_from_user_data(user_data);
+        let bridge = bridge_from_user_data::<C>(user_data);
         let layer = BackgroundLayer::from_ptr(layer);
-        let gradient = LinearGradient::from_ptr(gradient);
+        let mut stops = ColorStops::new();
+        let gradient = LinearGradient::from_ptr(gradient, &mut stops);
         bridge
             .container
             .draw_linear_gradient(DrawContext(hdc), &layer, &gradient);
     }));
 }
 
-unsafe extern "C" fn cb_draw_radial_gradient(
+unsafe extern "C" fn cb_draw_radial_gradient<C: DocumentContainer + ?Sized>(
     user_data: *mut c_void,
     hdc: usize,
     layer: *const sys::lh_background_layer_t,
     gradient: *const sys::lh_radial_gradient_t,
 ) {
     let _ = catch_unwind(AssertUnwindSafe(|| {
-        let bridge = bridge_from_user_data(user_data);
+        let bridge = bridge_from_user_data::<C>(user_data);
         let layer = BackgroundLayer::from_ptr(layer);
-        let gradient = RadialGradient::from_ptr(gradient);
+        let mut stops = ColorStops::new();
+        let gradient = RadialGradient::from_ptr(gradient, &mut stops);
         bridge
             .container
             .draw_radial_gradient(DrawContext(hdc), &layer, &gradient);
     }));
 }
 
-unsafe extern "C" fn cb_draw_conic_gradient(
+unsafe extern "C" fn cb_draw_conic_gradient<C: DocumentContainer + ?Sized>(
     user_data: *mut c_void,
     hdc: usize,
     layer: *const sys::lh_background_layer_t,
     gradient: *const sys::lh_conic_gradient_t,
 ) {
     let _ = catch_unwind(AssertUnwindSafe(|| {
-        let bridge = bridge_from_user_data(user_data);
+        let bridge = bridge_from_user_data::<C>(user_data);
         let layer = BackgroundLayer::from_ptr(layer);
-        let gradient = ConicGradient::from_ptr(gradient);
+        let mut stops = ColorStops::new();
+        let gradient = ConicGradient::from_ptr(gradient, &mut stops);
         bridge
             .container
             .draw_conic_gradient(DrawContext(hdc), &layer, &gradient);
     }));
 }
 
-unsafe extern "C" fn cb_draw_borders(
+unsafe extern "C" fn cb_draw_borders<C: DocumentContainer + ?Sized>(
     user_data: *mut c_void,
     hdc: usize,
     borders: sys::lh_borders_t,
@@ -1682,7 +1768,7 @@ unsafe extern "C" fn cb_draw_borders(
     root: c_int,
 ) {
     let _ = catch_unwind(AssertUnwindSafe(|| {
-        let bridge = bridge_from_user_data(user_data);
+        let bridge = bridge_from_user_data::<C>(user_data);
         let borders = Borders::from(borders);
         bridge.container.draw_borders(
             DrawContext(hdc),
@@ -1693,55 +1779,70 @@ unsafe extern "C" fn cb_draw_borders(
     }));
 }
 
-unsafe extern "C" fn cb_set_caption(user_data: *mut c_void, caption: *const c_char) {
+unsafe extern "C" fn cb_set_caption<C: DocumentContainer + ?Sized>(
+    user_data: *mut c_void,
+    caption: *const c_char,
+) {
     let _ = catch_unwind(AssertUnwindSafe(|| {
-        let bridge = bridge_from_user_data(user_data);
+        let bridge = bridge_from_user_data::<C>(user_data);
         let caption = c_str_to_str(caption);
         bridge.container.set_caption(caption);
     }));
 }
 
-unsafe extern "C" fn cb_set_base_url(user_data: *mut c_void, base_url: *const c_char) {
+unsafe extern "C" fn cb_set_base_url<C: DocumentContainer + ?Sized>(
+    user_data: *mut c_void,
+    base_url: *const c_char,
+) {
     let _ = catch_unwind(AssertUnwindSafe(|| {
-        let bridge = bridge_from_user_data(user_data);
+        let bridge = bridge_from_user_data::<C>(user_data);
         let base_url = c_str_to_str(base_url);
         bridge.container.set_base_url(base_url);
     }));
 }
 
-unsafe extern "C" fn cb_link(user_data: *mut c_void) {
+unsafe extern "C" fn cb_link<C: DocumentContainer + ?Sized>(user_data: *mut c_void) {
     let _ = catch_unwind(AssertUnwindSafe(|| {
-        let bridge = bridge_from_user_data(user_data);
+        let bridge = bridge_from_user_data::<C>(user_data);
         bridge.container.link();
     }));
 }
 
-unsafe extern "C" fn cb_on_anchor_click(user_data: *mut c_void, url: *const c_char) {
+unsafe extern "C" fn cb_on_anchor_click<C: DocumentContainer + ?Sized>(
+    user_data: *mut c_void,
+    url: *const c_char,
+) {
     let _ = catch_unwind(AssertUnwindSafe(|| {
-        let bridge = bridge_from_user_data(user_data);
+        let bridge = bridge_from_user_data::<C>(user_data);
         let url = c_str_to_str(url);
         bridge.container.on_anchor_click(url);
     }));
 }
 
-unsafe extern "C" fn cb_on_mouse_event(user_data: *mut c_void, event: c_int) {
+unsafe extern "C" fn cb_on_mouse_event<C: DocumentContainer + ?Sized>(
+    user_data: *mut c_void,
+    event: c_int,
+) {
     let _ = catch_unwind(AssertUnwindSafe(|| {
-        let bridge = bridge_from_user_data(user_data);
+        let bridge = bridge_from_user_data::<C>(user_data);
         bridge
             .container
             .on_mouse_event(MouseEvent::from_c_int(event));
     }));
 }
 
-unsafe extern "C" fn cb_set_cursor(user_data: *mut c_void, cursor: *const c_char) {
+unsafe extern "C" fn cb_set_cursor<C: DocumentContainer + ?Sized>(
+    user_data: *mut c_void,
+    cursor: *const c_char,
+) {
     let _ = catch_unwind(AssertUnwindSafe(|| {
-        let bridge = bridge_from_user_data(user_data);
+        let bridge = bridge_from_user_data::<C>(user_data);
         let cursor = c_str_to_str(cursor);
         bridge.container.set_cursor(cursor);
     }));
 }
 
-unsafe extern "C" fn cb_transform_text(
+unsafe extern "C" fn cb_transform_text<C: DocumentContainer + ?Sized>(
     user_data: *mut c_void,
     text: *const c_char,
     tt: c_int,
@@ -1749,7 +1850,7 @@ unsafe extern "C" fn cb_transform_text(
     ctx: *mut c_void,
 ) {
     let _ = catch_unwind(AssertUnwindSafe(|| {
-        let bridge = bridge_from_user_data(user_data);
+        let bridge = bridge_from_user_data::<C>(user_data);
         let text = c_str_to_str(text);
         let transform = TextTransform::from_c_int(tt);
         let result = bridge.container.transform_text(text, transform);
@@ -1763,7 +1864,7 @@ unsafe extern "C" fn cb_transform_text(
     }));
 }
 
-unsafe extern "C" fn cb_import_css(
+unsafe extern "C" fn cb_import_css<C: DocumentContainer + ?Sized>(
     user_data: *mut c_void,
     url: *const c_char,
     baseurl: *const c_char,
@@ -1773,10 +1874,17 @@ unsafe extern "C" fn cb_import_css(
     baseurl_ctx: *mut c_void,
 ) {
     let _ = catch_unwind(AssertUnwindSafe(|| {
-        let bridge = bridge_from_user_data(user_data);
+        let bridge = bridge_from_user_data::<C>(user_data);
         let url = c_str_to_str(url);
         let baseurl = c_str_to_str(baseurl);
-        let (css_text, new_baseurl) = bridge.container.import_css(url, baseurl);
+        let prefetched = bridge
+            .prefetch
+            .as_mut()
+            .and_then(|p| p.import_css(url, baseurl));
+        let (css_text, new_baseurl) = match prefetched {
+            Some(result) => result,
+            None => bridge.container.import_css(url, baseurl),
+        };
         if let Some(set_fn) = set_result {
             let c_result = CString::new(css_text).unwrap_or_else(|_| {
                 warn!("import_css result contained interior null byte, using empty string");
@@ -1793,29 +1901,32 @@ unsafe extern "C" fn cb_import_css(
     }));
 }
 
-unsafe extern "C" fn cb_set_clip(
+unsafe extern "C" fn cb_set_clip<C: DocumentContainer + ?Sized>(
     user_data: *mut c_void,
     pos: sys::lh_position_t,
     bdr_radius: sys::lh_border_radiuses_t,
 ) {
     let _ = catch_unwind(AssertUnwindSafe(|| {
-        let bridge = bridge_from_user_data(user_data);
+        let bridge = bridge_from_user_data::<C>(user_data);
         bridge
             .container
             .set_clip(Position::from(pos), BorderRadiuses::from(bdr_radius));
     }));
 }
 
-unsafe extern "C" fn cb_del_clip(user_data: *mut c_void) {
+unsafe extern "C" fn cb_del_clip<C: DocumentContainer + ?Sized>(user_data: *mut c_void) {
     let _ = catch_unwind(AssertUnwindSafe(|| {
-        let bridge = bridge_from_user_data(user_data);
+        let bridge = bridge_from_user_data::<C>(user_data);
         bridge.container.del_clip();
     }));
 }
 
-unsafe extern "C" fn cb_get_viewport(user_data: *mut c_void, viewport: *mut sys::lh_position_t) {
+unsafe extern "C" fn cb_get_viewport<C: DocumentContainer + ?Sized>(
+    user_data: *mut c_void,
+    viewport: *mut sys::lh_position_t,
+) {
     let _ = catch_unwind(AssertUnwindSafe(|| {
-        let bridge = bridge_from_user_data(user_data);
+        let bridge = bridge_from_user_data::<C>(user_data);
         let vp = bridge.container.get_viewport();
         if !viewport.is_null() {
             *viewport = vp.into();
@@ -1823,12 +1934,12 @@ unsafe extern "C" fn cb_get_viewport(user_data: *mut c_void, viewport: *mut sys:
     }));
 }
 
-unsafe extern "C" fn cb_get_media_features(
+unsafe extern "C" fn cb_get_media_features<C: DocumentContainer + ?Sized>(
     user_data: *mut c_void,
     media: *mut sys::lh_media_features_t,
 ) {
     let _ = catch_unwind(AssertUnwindSafe(|| {
-        let bridge = bridge_from_user_data(user_data);
+        let bridge = bridge_from_user_data::<C>(user_data);
         let features = bridge.container.get_media_features();
         if !media.is_null() {
             *media = features.into();
@@ -1836,13 +1947,13 @@ unsafe extern "C" fn cb_get_media_features(
     }));
 }
 
-unsafe extern "C" fn cb_get_language(
+unsafe extern "C" fn cb_get_language<C: DocumentContainer + ?Sized>(
     user_data: *mut c_void,
     set_result: sys::lh_set_language_fn,
     ctx: *mut c_void,
 ) {
     let _ = catch_unwind(AssertUnwindSafe(|| {
-        let bridge = bridge_from_user_data(user_data);
+        let bridge = bridge_from_user_data::<C>(user_data);
         let (lang, culture) = bridge.container.get_language();
         if let Some(set_fn) = set_result {
             let c_lang = CString::new(lang).unwrap_or_default();
@@ -1852,40 +1963,101 @@ unsafe extern "C" fn cb_get_language(
     }));
 }
 
-/// Single shared vtable for all Document instances. Every field is a
-/// compile-time-constant function pointer; per-document state is carried
-/// through `user_data`, not the vtable.
-static CONTAINER_VTABLE: sys::lh_container_vtable_t = sys::lh_container_vtable_t {
-    create_font: Some(cb_create_font),
-    delete_font: Some(cb_delete_font),
-    text_width: Some(cb_text_width),
-    draw_text: Some(cb_draw_text),
-    pt_to_px: Some(cb_pt_to_px),
-    get_default_font_size: Some(cb_get_default_font_size),
-    get_default_font_name: Some(cb_get_default_font_name),
-    draw_list_marker: Some(cb_draw_list_marker),
-    load_image: Some(cb_load_image),
-    get_image_size: Some(cb_get_image_size),
-    draw_image: Some(cb_draw_image),
-    draw_solid_fill: Some(cb_draw_solid_fill),
-    draw_linear_gradient: Some(cb_draw_linear_gradient),
-    draw_radial_gradient: Some(cb_draw_radial_gradient),
-    draw_conic_gradient: Some(cb_draw_conic_gradient),
-    draw_borders: Some(cb_draw_borders),
-    set_caption: Some(cb_set_caption),
-    set_base_url: Some(cb_set_base_url),
-    link: Some(cb_link),
-    on_anchor_click: Some(cb_on_anchor_click),
-    on_mouse_event: Some(cb_on_mouse_event),
-    set_cursor: Some(cb_set_cursor),
-    transform_text: Some(cb_transform_text),
-    import_css: Some(cb_import_css),
-    set_clip: Some(cb_set_clip),
-    del_clip: Some(cb_del_clip),
-    get_viewport: Some(cb_get_viewport),
-    get_media_features: Some(cb_get_media_features),
-    get_language: Some(cb_get_language),
-};
+/// Per-container-type vtable. Every field is a compile-time-constant function
+/// pointer; per-document state is carried through `user_data`, not the
+/// vtable.
+struct VTable<C: ?Sized>(PhantomData<*const C>);
+
+impl<C: DocumentContainer + ?Sized> VTable<C> {
+    const VTABLE: &'static sys::lh_container_vtable_t = &sys::lh_container_vtable_t {
+        create_font: Some(cb_create_font::<C>),
+        delete_font: Some(cb_delete_font::<C>),
+        text_width: Some(cb_text_width::<C>),
+        draw_text: Some(cb_draw_text::<C>),
+        pt_to_px: Some(cb_pt_to_px::<C>),
+        get_default_font_size: Some(cb_get_default_font_size::<C>),
+        get_default_font_name: Some(cb_get_default_font_name::<C>),
+        draw_list_marker: Some(cb_draw_list_marker::<C>),
+        load_image: Some(cb_load_image::<C>),
+        get_image_size: Some(cb_get_image_size::<C>),
+        draw_image: Some(cb_draw_image::<C>),
+        draw_solid_fill: Some(cb_draw_solid_fill::<C>),
+        draw_linear_gradient: Some(cb_draw_linear_gradient::<C>),
+        draw_radial_gradient: Some(cb_draw_radial_gradient::<C>),
+        draw_conic_gradient: Some(cb_draw_conic_gradient::<C>),
+        draw_borders: Some(cb_draw_borders::<C>),
+        set_caption: Some(cb_set_caption::<C>),
+        set_base_url: Some(cb_set_base_url::<C>),
+        link: Some(cb_link::<C>),
+        on_anchor_click: Some(cb_on_anchor_click::<C>),
+        on_mouse_event: Some(cb_on_mouse_event::<C>),
+        set_cursor: Some(cb_set_cursor::<C>),
+        transform_text: Some(cb_transform_text::<C>),
+        import_css: Some(cb_import_css::<C>),
+        set_clip: Some(cb_set_clip::<C>),
+        del_clip: Some(cb_del_clip::<C>),
+        get_viewport: Some(cb_get_viewport::<C>),
+        get_media_features: Some(cb_get_media_features::<C>),
+        get_language: Some(cb_get_language::<C>),
+    };
+}
+
+/// Calls container callbacks through the same `extern "C"` entry points and
+/// vtable the C wrapper uses, with no document or layout around them.
+///
+/// Exists for `benches/callbacks.rs` and is only built with the `bench`
+/// feature; not part of the stable API.
+#[cfg(feature = "bench")]
+#[doc(hidden)]
+pub struct CallbackBench<'a, C: DocumentContainer + ?Sized> {
+    bridge: *mut BridgeData<'a, C>,
+    vtable: &'static sys::lh_container_vtable_t,
+    descr: *mut sys::lh_font_description_t,
+}
+
+#[cfg(feature = "bench")]
+impl<'a, C: DocumentContainer + ?Sized> CallbackBench<'a, C> {
+    /// `create_font` is called with a description of `family` at `size`
+    /// px, weight 400, normal style.
+    pub fn new(container: &'a mut C, family: &str, size: f32) -> Self {
+        let c_family = CString::new(family).unwrap_or_default();
+        let bridge = Box::into_raw(Box::new(BridgeData {
+            container,
+            default_font_name: CString::default(),
+            prefetch: None,
+        }));
+        Self {
+            bridge,
+            vtable: VTable::<C>::VTABLE,
+            descr: unsafe { sys::lh_font_description_create(c_family.as_ptr(), size, 400, 0) },
+        }
+    }
+
+    // The C++ caller reaches callbacks through an opaque function pointer;
+    // black_box keeps the optimizer from inlining through the const vtable
+    // here, which no real caller could do.
+
+    pub fn text_width(&mut self, text: &CStr, font: FontHandle) -> f32 {
+        let text_width = std::hint::black_box(self.vtable.text_width).unwrap();
+        unsafe { text_width(self.bridge.cast(), text.as_ptr(), font.0) }
+    }
+
+    pub fn create_font(&mut self) -> FontHandle {
+        let create_font = std::hint::black_box(self.vtable.create_font).unwrap();
+        let mut fm = sys::lh_font_metrics_t::default();
+        FontHandle(unsafe { create_font(self.bridge.cast(), self.descr, &mut fm) })
+    }
+}
+
+#[cfg(feature = "bench")]
+impl<C: DocumentContainer + ?Sized> Drop for CallbackBench<'_, C> {
+    fn drop(&mut self) {
+        unsafe {
+            sys::lh_font_description_destroy(self.descr);
+            drop(Box::from_raw(self.bridge));
+        }
+    }
+}
 
 // ---------------------------------------------------------------------------
 // Document
@@ -1976,6 +2148,50 @@ impl<'a> Element<'a> {
         }
     }
 
+    /// First child, or `None` if this element has no children.
+    pub fn first_child(&self) -> Option<Element<'a>> {
+        Self::from_raw(unsafe { sys::lh_element_first_child(self.ptr) })
+    }
+
+    /// Next sibling in document order, or `None` for the last child.
+    pub fn next_sibling(&self) -> Option<Element<'a>> {
+        Self::from_raw(unsafe { sys::lh_element_next_sibling(self.ptr) })
+    }
+
+    /// Previous sibling in document order, or `None` for the first child.
+    pub fn prev_sibling(&self) -> Option<Element<'a>> {
+        Self::from_raw(unsafe { sys::lh_element_prev_sibling(self.ptr) })
+    }
+
+    /// Position of this element among its parent's children. Returns `None`
+    /// for the root element.
+    pub fn index_in_parent(&self) -> Option<usize> {
+        let index = unsafe { sys::lh_element_index_in_parent(self.ptr) };
+        usize::try_from(index).ok()
+    }
+
+    /// Iterate over the direct children of this element in document order.
+    ///
+    /// Sibling steps, [`child_at`](Self::child_at) and
+    /// [`index_in_parent`](Self::index_in_parent) are O(1) after the first
+    /// call builds the document's tree index.
+    pub fn children(&self) -> Children<'a> {
+        Children {
+            next: self.first_child(),
+        }
+    }
+
+    fn from_raw(ptr: *mut sys::lh_element_t) -> Option<Element<'a>> {
+        if ptr.is_null() {
+            None
+        } else {
+            Some(Element {
+                ptr,
+                _phantom: PhantomData,
+            })
+        }
+    }
+
     /// Returns `true` if this element is a text node.
     pub fn is_text(&self) -> bool {
         unsafe { sys::lh_element_is_text(self.ptr) != 0 }
@@ -2009,6 +2225,9 @@ impl<'a> Element<'a> {
     }
 
     /// Absolute pixel bounding box after layout.
+    ///
+    /// Memoized per layout: repeated lookups are O(1) until the document is
+    /// rendered again (see [`Document::layout_generation`]).
     pub fn placement(&self) -> Position {
         let mut pos = sys::lh_position_t {
             x: 0.0,
@@ -2045,6 +2264,46 @@ impl<'a> Element<'a> {
         result
     }
 
+    /// Borrow the text of a text node directly from litehtml's storage.
+    ///
+    /// Returns `None` for non-text elements (or text that is not valid
+    /// UTF-8). Unlike [`get_text`](Self::get_text) this neither allocates
+    /// nor copies.
+    pub fn text_ref(&self) -> Option<&'a str> {
+        let mut len = 0usize;
+        let ptr = unsafe { sys::lh_element_text_ref(self.ptr, &mut len) };
+        if ptr.is_null() {
+            return None;
+        }
+        // SAFETY: the C side points into the element's own string, which
+        // lives as long as the document this element borrows from.
+        let bytes = unsafe { std::slice::from_raw_parts(ptr as *const u8, len) };
+        std::str::from_utf8(bytes).ok()
+    }
+
+    /// Append the text content of this element's subtree to `out` in
+    /// document order, in a single pass over the tree.
+    pub fn text_content_into(&self, out: &mut String) {
+        unsafe extern "C" fn append_text(ctx: *mut c_void, text: *const c_char, len: usize) {
+            if text.is_null() || ctx.is_null() {
+                return;
+            }
+            let out = &mut *(ctx as *mut String);
+            let bytes = std::slice::from_raw_parts(text as *const u8, len);
+            if let Ok(s) = std::str::from_utf8(bytes) {
+                out.push_str(s);
+            }
+        }
+
+        unsafe {
+            sys::lh_element_text_content(
+                self.ptr,
+                Some(append_text),
+                out as *mut String as *mut c_void,
+            );
+        }
+    }
+
     /// Number of per-line inline boxes (0 if not an inline element).
     pub fn inline_boxes_count(&self) -> usize {
         unsafe { sys::lh_element_get_inline_boxes_count(self.ptr) as usize }
@@ -2105,6 +2364,22 @@ impl<'a> Element<'a> {
         unsafe { sys::lh_element_get_line_height(self.ptr) }
     }
 
+    /// Lower-case tag name; empty for text nodes.
+    pub fn tag_name(&self) -> &'a str {
+        unsafe { c_str_to_str(sys::lh_element_get_tag_name(self.ptr)) }
+    }
+
+    /// Value of attribute `name` as written in the source.
+    pub fn attr(&self, name: &str) -> Option<&'a str> {
+        let c_name = CString::new(name).ok()?;
+        let value = unsafe { sys::lh_element_get_attr(self.ptr, c_name.as_ptr()) };
+        if value.is_null() {
+            None
+        } else {
+            Some(unsafe { c_str_to_str(value) })
+        }
+    }
+
     /// Raw pointer to the underlying C element. Valid while the parent
     /// `Document` is alive.
     pub(crate) fn as_ptr(&self) -> *mut sys::lh_element_t {
@@ -2112,57 +2387,355 @@ impl<'a> Element<'a> {
     }
 }
 
-/// A parsed HTML document. Wraps the C++ `litehtml::document` and ties its
-/// lifetime to the [`DocumentContainer`] that provides rendering callbacks.
-///
-/// `Document` is intentionally `!Send` and `!Sync` because the underlying
-/// C++ engine is single-threaded.
-///
-/// ```compile_fail
-/// fn assert_send<T: Send>() {}
-/// assert_send::<litehtml::Document<'static>>();
-/// ```
-///
-/// ```compile_fail
-/// fn assert_sync<T: Sync>() {}
-/// assert_sync::<litehtml::Document<'static>>();
-/// ```
-pub struct Document<'a> {
-    raw: *mut sys::lh_document_t,
-    /// Kept alive so the user_data pointer inside litehtml remains valid.
-    bridge: *mut BridgeData<'a>,
+/// Iterator over an element's direct children, created by
+/// [`Element::children`].
+pub struct Children<'a> {
+    next: Option<Element<'a>>,
 }
 
-impl<'a> Document<'a> {
-    /// Parse HTML into a document, using `container` for all rendering
-    /// callbacks.
-    ///
-    /// Returns an error if the input strings contain interior null bytes
-    /// or if litehtml fails to create the document.
-    ///
-    /// `master_css` is the user-agent stylesheet applied before any document
-    /// styles. `user_styles` are additional CSS rules applied after the
-    /// document styles.
-    #[must_use = "document must be stored for rendering"]
-    pub fn from_html(
-        html: &str,
-        container: &'a mut dyn DocumentContainer,
-        master_css: Option<&str>,
-        user_styles: Option<&str>,
-    ) -> Result<Self, CreateError> {
-        let c_html = CString::new(html)?;
+impl<'a> Iterator for Children<'a> {
+    type Item = Element<'a>;
 
-        let c_master_css = master_css.map(CString::new).transpose()?;
-        let c_user_styles = user_styles.map(CString::new).transpose()?;
+    fn next(&mut self) -> Option<Element<'a>> {
+        let current = self.next.take()?;
+        self.next = current.next_sibling();
+        Some(current)
+    }
+}
 
-        let master_css_ptr = c_master_css
-            .as_ref()
-            .map_or(std::ptr::null(), |s| s.as_ptr());
-        let user_styles_ptr = c_user_styles
-            .as_ref()
-            .map_or(std::ptr::null(), |s| s.as_ptr());
+/// Result of [`Document::render_incremental`].
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct RenderUpdate {
+    /// Content width after layout, as returned by [`Document::render`].
+    pub width: f32,
+    /// Region that must be repainted, or `None` if the layout is unchanged.
+    pub changed: Option<Position>,
+}
 
-        // Cache the default font name as a CString so get_default_font_name
+/// Approximate memory held by a [`Document`], from
+/// [`Document::memory_usage`].
+///
+/// Byte counts are estimates from object sizes and string capacities; they
+/// leave out allocator overhead and the parsed stylesheets.
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct DocumentMemory {
+    /// Element nodes in the DOM.
+    pub elements: usize,
+    /// Text and whitespace nodes in the DOM.
+    pub text_nodes: usize,
+    /// Render items from the last layout.
+    pub render_items: usize,
+    /// Node objects and child links, excluding computed styles.
+    pub dom_bytes: usize,
+    /// Computed styles, one per node.
+    pub style_bytes: usize,
+    /// Render items and their child links.
+    pub render_bytes: usize,
+    /// Text content and attribute names and values.
+    pub string_bytes: usize,
+    /// The C wrapper's tree index, layout cache, font cache and stylesheet
+    /// sources.
+    pub wrapper_bytes: usize,
+}
+
+impl DocumentMemory {
+    pub fn total_bytes(&self) -> usize {
+        self.dom_bytes
+            + self.style_bytes
+            + self.render_bytes
+            + self.string_bytes
+            + self.wrapper_bytes
+    }
+}
+
+/// One `<a href>` of a laid-out document, from [`Document::links`].
+#[derive(Debug, Clone, Default, PartialEq)]
+pub struct LinkBoxes {
+    /// The `href` attribute, unresolved.
+    pub href: String,
+    /// Absolute box of each text leaf (word or space) inside the link, in
+    /// document order.
+    pub boxes: Vec<Position>,
+}
+
+/// Options for [`Document::from_html_with_options`].
+#[derive(Debug, Clone, Copy, Default)]
+pub struct DocumentOptions<'o> {
+    /// User-agent stylesheet applied before any document styles.
+    pub master_css: Option<&'o str>,
+    /// Additional CSS rules applied after the document styles.
+    pub user_styles: Option<&'o str>,
+    /// Limits on parsing and styling; creation fails with
+    /// [`CreateError::Aborted`] once exhausted.
+    pub budget: Option<&'o Budget>,
+    /// Limits on the size of the DOM; the document is truncated to fit, see
+    /// [`Document::limits_hit`].
+    pub limits: Option<&'o ResourceLimits>,
+}
+
+/// Cooperative cancellation flag shared between threads.
+///
+/// Clones share the flag. Cancelling makes any budgeted create or render
+/// call using it stop at its next safe point.
+#[derive(Debug, Clone, Default)]
+pub struct CancellationToken(std::sync::Arc<std::sync::atomic::AtomicBool>);
+
+impl CancellationToken {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Request cancellation. Safe to call from any thread.
+    pub fn cancel(&self) {
+        self.0.store(true, std::sync::atomic::Ordering::Relaxed);
+    }
+
+    pub fn is_cancelled(&self) -> bool {
+        self.0.load(std::sync::atomic::Ordering::Relaxed)
+    }
+}
+
+/// Limits on the work done by one create or render call.
+///
+/// The C wrapper checks the budget at safe points: container callbacks made
+/// during style and layout (`create_font`, `text_width`, `pt_to_px`,
+/// `get_image_size`, `import_css`, `transform_text`) each count as one step,
+/// as does every element created while parsing. Work inside the HTML parser
+/// itself is not interrupted; a limit hit there takes effect at the next
+/// safe point after it. The time limit applies to each call separately.
+#[derive(Debug, Clone, Default)]
+pub struct Budget {
+    cancel: Option<CancellationToken>,
+    max_steps: u64,
+    max_time: Option<std::time::Duration>,
+}
+
+impl Budget {
+    /// A budget with no limits.
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Stop once `token` is cancelled.
+    pub fn with_cancellation(mut self, token: CancellationToken) -> Self {
+        self.cancel = Some(token);
+        self
+    }
+
+    /// Stop after `steps` safe points.
+    pub fn with_max_steps(mut self, steps: u64) -> Self {
+        self.max_steps = steps;
+        self
+    }
+
+    /// Stop once a call has run for `limit`.
+    pub fn with_time_limit(mut self, limit: std::time::Duration) -> Self {
+        self.max_time = Some(limit);
+        self
+    }
+
+    fn to_c(&self) -> sys::lh_budget_t {
+        sys::lh_budget_t {
+            cancel_flag: self
+                .cancel
+                .as_ref()
+                .map_or(std::ptr::null(), |t| t.0.as_ptr() as *const u8),
+            max_steps: self.max_steps,
+            max_micros: self.max_time.map_or(0, |d| {
+                u64::try_from(d.as_micros()).unwrap_or(u64::MAX).max(1)
+            }),
+        }
+    }
+}
+
+/// Hard limits on the resources one document may use.
+///
+/// Unlike a [`Budget`], hitting a limit never fails the call; the input is
+/// cut down to fit and the limits that were hit are reported through
+/// [`LimitsHit`]. The node and depth limits apply when the document is
+/// parsed (pass them in [`DocumentOptions::limits`]): nodes past
+/// `max_nodes`, counting elements and text words in document order, are
+/// dropped, and elements nested deeper than `max_depth` lose their
+/// children. The image and height limits apply to containers that
+/// rasterize, such as `PixbufContainer::set_limits`.
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct ResourceLimits {
+    max_nodes: u64,
+    max_depth: u32,
+    max_image_pixels: u64,
+    max_height: u32,
+}
+
+impl ResourceLimits {
+    /// Limits that allow everything.
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Keep at most `nodes` DOM nodes.
+    pub fn with_max_nodes(mut self, nodes: u64) -> Self {
+        self.max_nodes = nodes;
+        self
+    }
+
+    /// Drop the children of elements nested `depth` levels deep; the root
+    /// element is at depth 1.
+    pub fn with_max_depth(mut self, depth: u32) -> Self {
+        self.max_depth = depth;
+        self
+    }
+
+    /// Refuse to decode images with more than `pixels` pixels.
+    pub fn with_max_image_pixels(mut self, pixels: u64) -> Self {
+        self.max_image_pixels = pixels;
+        self
+    }
+
+    /// Rasterize at most `height` logical pixels of a document.
+    pub fn with_max_height(mut self, height: u32) -> Self {
+        self.max_height = height;
+        self
+    }
+
+    pub fn max_nodes(&self) -> Option<u64> {
+        (self.max_nodes > 0).then_some(self.max_nodes)
+    }
+
+    pub fn max_depth(&self) -> Option<u32> {
+        (self.max_depth > 0).then_some(self.max_depth)
+    }
+
+    pub fn max_image_pixels(&self) -> Option<u64> {
+        (self.max_image_pixels > 0).then_some(self.max_image_pixels)
+    }
+
+    pub fn max_height(&self) -> Option<u32> {
+        (self.max_height > 0).then_some(self.max_height)
+    }
+
+    fn to_c(self) -> sys::lh_limits_t {
+        sys::lh_limits_t {
+            max_nodes: self.max_nodes,
+            max_depth: self.max_depth,
+        }
+    }
+}
+
+/// Which [`ResourceLimits`] cut something off.
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct LimitsHit {
+    /// Nodes past the node limit were dropped.
+    pub nodes: bool,
+    /// Elements past the depth limit lost their children.
+    pub depth: bool,
+    /// Number of images that were not decoded because they were too large.
+    pub images: usize,
+    /// The rasterized height was clamped.
+    pub height: bool,
+}
+
+impl LimitsHit {
+    /// Whether any limit was hit.
+    pub fn any(&self) -> bool {
+        self.nodes || self.depth || self.images > 0 || self.height
+    }
+}
+
+impl std::ops::BitOr for LimitsHit {
+    type Output = Self;
+
+    fn bitor(self, rhs: Self) -> Self {
+        Self {
+            nodes: self.nodes || rhs.nodes,
+            depth: self.depth || rhs.depth,
+            images: self.images + rhs.images,
+            height: self.height || rhs.height,
+        }
+    }
+}
+
+/// A parsed HTML document. Wraps the C++ `litehtml::document` and ties its
+/// lifetime to the [`DocumentContainer`] that provides rendering callbacks.
+///
+/// The container type `C` is normally inferred from the argument to
+/// [`from_html`](Self::from_html), so callbacks are dispatched statically.
+/// `Document<'a>` is shorthand for `Document<'a, dyn DocumentContainer>`,
+/// for code that needs to pick the container at runtime.
+///
+/// `Document` is intentionally `!Send` and `!Sync` because the underlying
+/// C++ engine is single-threaded.
+///
+/// ```compile_fail
+/// fn assert_send<T: Send>() {}
+/// assert_send::<litehtml::Document<'static>>();
+/// ```
+///
+/// ```compile_fail
+/// fn assert_sync<T: Sync>() {}
+/// assert_sync::<litehtml::Document<'static>>();
+/// ```
+pub struct Document<'a, C: ?Sized + 'a = dyn DocumentContainer + 'a> {
+    raw: *mut sys::lh_document_t,
+    /// Kept alive so the user_data pointer inside litehtml remains valid.
+    bridge: *mut BridgeData<'a, C>,
+}
+
+impl<'a, C: DocumentContainer + ?Sized + 'a> Document<'a, C> {
+    /// Parse HTML into a document, using `container` for all rendering
+    /// callbacks.
+    ///
+    /// Returns an error if the input strings contain interior null bytes
+    /// or if litehtml fails to create the document.
+    ///
+    /// `master_css` is the user-agent stylesheet applied before any document
+    /// styles. `user_styles` are additional CSS rules applied after the
+    /// document styles.
+    #[must_use = "document must be stored for rendering"]
+    pub fn from_html(
+        html: &str,
+        container: &'a mut C,
+        master_css: Option<&str>,
+        user_styles: Option<&str>,
+    ) -> Result<Self, CreateError> {
+        let options = DocumentOptions {
+            master_css,
+            user_styles,
+            ..DocumentOptions::default()
+        };
+        Self::create(html, container, &options, None)
+    }
+
+    /// Parse HTML into a document with explicit [`DocumentOptions`].
+    #[must_use = "document must be stored for rendering"]
+    pub fn from_html_with_options(
+        html: &str,
+        container: &'a mut C,
+        options: &DocumentOptions<'_>,
+    ) -> Result<Self, CreateError> {
+        Self::create(html, container, options, None)
+    }
+
+    /// Shared constructor behind [`from_html`](Self::from_html) and
+    /// [`from_html_async`](Self::from_html_async).
+    fn create(
+        html: &str,
+        container: &'a mut C,
+        options: &DocumentOptions<'_>,
+        prefetch: Option<async_container::Prefetch>,
+    ) -> Result<Self, CreateError> {
+        let c_html = CString::new(html)?;
+
+        let c_master_css = options.master_css.map(CString::new).transpose()?;
+        let c_user_styles = options.user_styles.map(CString::new).transpose()?;
+
+        let master_css_ptr = c_master_css
+            .as_ref()
+            .map_or(std::ptr::null(), |s| s.as_ptr());
+        let user_styles_ptr = c_user_styles
+            .as_ref()
+            .map_or(std::ptr::null(), |s| s.as_ptr());
+
+        // Cache the default font name as a CString so get_default_font_name
         // can return a pointer that lives as long as the document.
         let font_name = container.default_font_name();
         let default_font_name =
@@ -2171,28 +2744,49 @@ impl<'a> Document<'a> {
         let bridge_data = BridgeData {
             container,
             default_font_name,
+            prefetch,
         };
         let bridge_ptr = Box::into_raw(Box::new(bridge_data));
 
         // SAFETY: the C++ side only reads through this pointer (never writes).
         // See CDocumentContainer in litehtml_c.cpp — all vtable access is read-only.
-        let vtable_ptr = std::ptr::addr_of!(CONTAINER_VTABLE) as *mut sys::lh_container_vtable_t;
+        let vtable = VTable::<C>::VTABLE;
+        let vtable_ptr = vtable as *const sys::lh_container_vtable_t as *mut _;
 
-        let raw = unsafe {
-            sys::lh_document_create_from_string(
-                c_html.as_ptr(),
-                vtable_ptr,
-                bridge_ptr as *mut c_void,
-                master_css_ptr,
-                user_styles_ptr,
-            )
+        let mut abort_reason: c_int = 0;
+        let c_budget = options.budget.map(Budget::to_c);
+        let c_limits = options.limits.map(|l| l.to_c());
+        let raw = if c_budget.is_none() && c_limits.is_none() {
+            unsafe {
+                sys::lh_document_create_from_string(
+                    c_html.as_ptr(),
+                    vtable_ptr,
+                    bridge_ptr as *mut c_void,
+                    master_css_ptr,
+                    user_styles_ptr,
+                )
+            }
+        } else {
+            unsafe {
+                sys::lh_document_create_from_string_limited(
+                    c_html.as_ptr(),
+                    vtable_ptr,
+                    bridge_ptr as *mut c_void,
+                    master_css_ptr,
+                    user_styles_ptr,
+                    c_budget.as_ref().map_or(std::ptr::null(), |b| b),
+                    c_limits.as_ref().map_or(std::ptr::null(), |l| l),
+                    &mut abort_reason,
+                )
+            }
         };
 
         if raw.is_null() {
             unsafe {
                 drop(Box::from_raw(bridge_ptr));
             }
-            return Err(CreateError::CreateFailed);
+            return Err(AbortReason::from_c_int(abort_reason)
+                .map_or(CreateError::CreateFailed, CreateError::Aborted));
         }
 
         Ok(Self {
@@ -2200,7 +2794,9 @@ impl<'a> Document<'a> {
             bridge: bridge_ptr,
         })
     }
+}
 
+impl<'a, C: ?Sized + 'a> Document<'a, C> {
     /// Lay out the document within `max_width` pixels. Returns the actual
     /// content width after layout.
     #[must_use = "returns the content width after layout"]
@@ -2208,6 +2804,235 @@ impl<'a> Document<'a> {
         unsafe { sys::lh_document_render(self.raw, max_width) }
     }
 
+    /// [`render`](Self::render) under a [`Budget`].
+    ///
+    /// If the budget runs out, the reason is returned. The rest of the pass
+    /// runs without calling the container (text measures zero wide), so the
+    /// layout it leaves is meaningless, but the document stays usable: the
+    /// next render lays out from scratch and matches a fresh document's.
+    pub fn render_with_budget(
+        &mut self,
+        max_width: f32,
+        budget: &Budget,
+    ) -> Result<f32, AbortReason> {
+        let c_budget = budget.to_c();
+        let mut width = 0.0;
+        let reason =
+            unsafe { sys::lh_document_render_budgeted(self.raw, max_width, &c_budget, &mut width) };
+        match AbortReason::from_c_int(reason) {
+            Some(reason) => Err(reason),
+            None => Ok(width),
+        }
+    }
+
+    /// Estimate the memory this document holds.
+    ///
+    /// The DOM and render tree are walked once per
+    /// [`layout_generation`](Self::layout_generation) and the result is
+    /// cached, so sampling between changes costs only a few map size reads.
+    pub fn memory_usage(&self) -> DocumentMemory {
+        let mut usage = sys::lh_memory_usage_t::default();
+        unsafe { sys::lh_document_memory_usage(self.raw, &mut usage) };
+        let n = |v: u64| usize::try_from(v).unwrap_or(usize::MAX);
+        DocumentMemory {
+            elements: n(usage.elements),
+            text_nodes: n(usage.text_nodes),
+            render_items: n(usage.render_items),
+            dom_bytes: n(usage.dom_bytes),
+            style_bytes: n(usage.style_bytes),
+            render_bytes: n(usage.render_bytes),
+            string_bytes: n(usage.string_bytes),
+            wrapper_bytes: n(usage.wrapper_bytes),
+        }
+    }
+
+    /// Measure the features that drive this document's style and layout
+    /// cost. Exact counterpart of `html::estimate_render_cost`; walks the
+    /// whole DOM.
+    pub fn render_cost(&self) -> cost::RenderCost {
+        let mut c = sys::lh_render_cost_t::default();
+        unsafe { sys::lh_document_render_cost(self.raw, &mut c) };
+        let n = |v: u64| usize::try_from(v).unwrap_or(usize::MAX);
+        cost::RenderCost {
+            nodes: n(c.nodes),
+            max_depth: n(c.max_depth),
+            table_cells: n(c.table_cells),
+            text_bytes: n(c.text_bytes),
+            images: n(c.images),
+            style_rules: n(c.style_rules),
+        }
+    }
+
+    /// Every link in the document with the boxes of its text, in document
+    /// order. Text inside nested links belongs to the innermost one, and
+    /// adjacent links with the same `href` are merged. Call after
+    /// [`render`](Self::render); one walk of the DOM.
+    pub fn links(&self) -> Vec<LinkBoxes> {
+        unsafe extern "C" fn collect_link(
+            href: *const c_char,
+            pos: *const sys::lh_position_t,
+            ctx: *mut std::ffi::c_void,
+        ) {
+            if href.is_null() || pos.is_null() || ctx.is_null() {
+                return;
+            }
+            let out = &mut *(ctx as *mut Vec<LinkBoxes>);
+            let href = c_str_to_str(href);
+            // Consecutive leaves of one link arrive together.
+            match out.last_mut() {
+                Some(last) if last.href == href => last.boxes.push(Position::from(*pos)),
+                _ => out.push(LinkBoxes {
+                    href: href.to_string(),
+                    boxes: vec![Position::from(*pos)],
+                }),
+            }
+        }
+
+        let mut links: Vec<LinkBoxes> = Vec::new();
+        unsafe {
+            sys::lh_document_links(
+                self.raw,
+                Some(collect_link),
+                &mut links as *mut Vec<LinkBoxes> as *mut std::ffi::c_void,
+            );
+        }
+        links
+    }
+
+    /// Call `f` with every text leaf in document order: the element, its
+    /// text, its absolute box and its font, in one walk of the DOM. Leaves
+    /// that litehtml did not place or give a font report their parent's.
+    pub(crate) fn for_each_text_leaf(
+        &self,
+        mut f: impl FnMut(*mut sys::lh_element_t, &str, Position, FontHandle),
+    ) {
+        type Visit<'f> = &'f mut dyn FnMut(*mut sys::lh_element_t, &str, Position, FontHandle);
+
+        unsafe extern "C" fn visit_leaf(
+            el: *mut sys::lh_element_t,
+            text: *const c_char,
+            len: usize,
+            pos: *const sys::lh_position_t,
+            font: usize,
+            ctx: *mut c_void,
+        ) {
+            if el.is_null() || pos.is_null() || ctx.is_null() {
+                return;
+            }
+            let visit = &mut *(ctx as *mut Visit<'_>);
+            let text = if text.is_null() || len == 0 {
+                ""
+            } else {
+                std::str::from_utf8(std::slice::from_raw_parts(text as *const u8, len))
+                    .unwrap_or("")
+            };
+            visit(el, text, Position::from(*pos), FontHandle(font));
+        }
+
+        let mut visit: Visit<'_> = &mut f;
+        unsafe {
+            sys::lh_document_text_leaves(
+                self.raw,
+                Some(visit_leaf),
+                &mut visit as *mut Visit<'_> as *mut c_void,
+            );
+        }
+    }
+
+    /// Which DOM limits from [`DocumentOptions::limits`] truncated this
+    /// document. Only [`LimitsHit::nodes`] and [`LimitsHit::depth`] are
+    /// reported here; the node limit also covers content appended later.
+    pub fn limits_hit(&self) -> LimitsHit {
+        let flags = unsafe { sys::lh_document_limits_hit(self.raw) };
+        LimitsHit {
+            nodes: flags & sys::LH_LIMIT_NODES != 0,
+            depth: flags & sys::LH_LIMIT_DEPTH != 0,
+            ..LimitsHit::default()
+        }
+    }
+
+    /// Replace the document's content with `html`, reusing the document
+    /// shell instead of creating a new [`Document`].
+    ///
+    /// The container, the master and user stylesheets passed at creation and
+    /// the wrapper's internal buffers are kept. Fonts whose descriptions
+    /// match one used by the previous content keep their handles, so
+    /// [`DocumentContainer::create_font`] and
+    /// [`DocumentContainer::delete_font`] are only called for fonts that
+    /// actually changed. Call [`render`](Self::render) afterwards.
+    ///
+    /// On error the previous content is left in place.
+    pub fn reset_with_html(&mut self, html: &str) -> Result<(), CreateError> {
+        let c_html = CString::new(html)?;
+        if unsafe { sys::lh_document_reset(self.raw, c_html.as_ptr()) } == 0 {
+            return Err(CreateError::CreateFailed);
+        }
+        Ok(())
+    }
+
+    /// [`reset_with_html`](Self::reset_with_html) under a [`Budget`].
+    ///
+    /// If the budget runs out, [`CreateError::Aborted`] is returned and the
+    /// previous content is left in place.
+    pub fn reset_with_html_budgeted(
+        &mut self,
+        html: &str,
+        budget: &Budget,
+    ) -> Result<(), CreateError> {
+        let c_html = CString::new(html)?;
+        let c_budget = budget.to_c();
+        let mut abort_reason = 0;
+        let ok = unsafe {
+            sys::lh_document_reset_budgeted(self.raw, c_html.as_ptr(), &c_budget, &mut abort_reason)
+        };
+        if ok == 0 {
+            return Err(AbortReason::from_c_int(abort_reason)
+                .map_or(CreateError::CreateFailed, CreateError::Aborted));
+        }
+        Ok(())
+    }
+
+    /// Lay out the document only if something changed since the last
+    /// render, and report the region that has to be repainted.
+    ///
+    /// Layout runs after DOM changes ([`append_children_from_string`]),
+    /// stylesheet or media changes, mouse events that changed element
+    /// state, [`invalidate_layout`](Self::invalidate_layout), or a different
+    /// `max_width`. Otherwise the current layout is kept and `changed` is
+    /// `None`. After DOM changes alone, `changed` covers the mutated
+    /// parents' old and new boxes, extended to the bottom of the document
+    /// if its height changed; in all other cases it is the whole document.
+    ///
+    /// Only the decision to lay out and the reported region are
+    /// incremental: when layout runs, it covers the whole tree, as
+    /// [`render`](Self::render) does.
+    ///
+    /// [`append_children_from_string`]: Self::append_children_from_string
+    pub fn render_incremental(&mut self, max_width: f32) -> RenderUpdate {
+        let mut width = 0.0;
+        let mut changed = sys::lh_position_t::default();
+        let updated = unsafe {
+            sys::lh_document_render_incremental(self.raw, max_width, &mut width, &mut changed)
+        };
+        RenderUpdate {
+            width,
+            changed: (updated != 0).then(|| Position::from(changed)),
+        }
+    }
+
+    /// Force the next [`render_incremental`](Self::render_incremental) to
+    /// run layout and report the whole document as changed, e.g. after the
+    /// container learned the size of an image.
+    pub fn invalidate_layout(&mut self) {
+        unsafe { sys::lh_document_invalidate_layout(self.raw) }
+    }
+
+    /// Returns `true` if [`render_incremental`](Self::render_incremental)
+    /// at the last width would run layout.
+    pub fn is_layout_dirty(&self) -> bool {
+        unsafe { sys::lh_document_is_layout_dirty(self.raw) != 0 }
+    }
+
     /// Draw the document into the rendering context identified by `hdc`,
     /// at offset `(x, y)`. If `clip` is `Some`, only the intersection with
     /// the clip rectangle is drawn.
@@ -2260,6 +3085,16 @@ impl<'a> Document<'a> {
         unsafe { sys::lh_document_media_changed(self.raw) != 0 }
     }
 
+    /// Counter that changes whenever boxes may have moved: on every
+    /// [`render`](Self::render), stylesheet or DOM change, and on mouse or
+    /// media events that changed element state.
+    ///
+    /// Positions cached outside the document are stale once this differs
+    /// from the value they were computed at.
+    pub fn layout_generation(&self) -> u64 {
+        unsafe { sys::lh_document_layout_generation(self.raw) }
+    }
+
     /// Add a CSS stylesheet to the document and apply it immediately.
     ///
     /// This parses the CSS, applies matching rules to all elements, and
@@ -2295,6 +3130,34 @@ impl<'a> Document<'a> {
         }
     }
 
+    /// Find the first element whose `id` attribute is exactly `id`.
+    ///
+    /// Unlike `select_one("#id")` this needs no CSS escaping and, after the
+    /// first call builds the document's id map, is a hash lookup rather than
+    /// a tree walk. The map is rebuilt after
+    /// [`append_children_from_string`](Self::append_children_from_string).
+    pub fn element_by_id(&self, id: &str) -> Option<Element<'_>> {
+        let c_id = CString::new(id).ok()?;
+        let ptr = unsafe { sys::lh_document_element_by_id(self.raw, c_id.as_ptr()) };
+        if ptr.is_null() {
+            None
+        } else {
+            Some(Element {
+                ptr,
+                _phantom: PhantomData,
+            })
+        }
+    }
+
+    /// Append all text in the document to `out` in document order.
+    ///
+    /// Text is copied once, straight from litehtml's storage into `out`.
+    pub fn text_content_into(&self, out: &mut String) {
+        if let Some(root) = self.root() {
+            root.text_content_into(out);
+        }
+    }
+
     /// Find the deepest element at document coordinates `(x, y)`.
     pub fn get_element_by_point(
         &self,
@@ -2331,7 +3194,7 @@ impl<'a> Document<'a> {
     /// between document operations (e.g., between `render` and `draw`).
     pub unsafe fn with_container_mut<F, R>(&mut self, f: F) -> R
     where
-        F: FnOnce(&mut dyn DocumentContainer) -> R,
+        F: FnOnce(&mut C) -> R,
     {
         let bridge = &mut *self.bridge;
         f(bridge.container)
@@ -2341,8 +3204,10 @@ impl<'a> Document<'a> {
     /// of `parent`.
     ///
     /// If `replace_existing` is true, all existing children of `parent` are
-    /// removed first. A subsequent [`render`](Self::render) call is needed
-    /// to update the layout.
+    /// removed first. Only the inserted elements are styled. A subsequent
+    /// [`render`](Self::render) or
+    /// [`render_incremental`](Self::render_incremental) call is needed to
+    /// update the layout.
     pub fn append_children_from_string(
         &mut self,
         parent: &Element<'_>,
@@ -2360,9 +3225,32 @@ impl<'a> Document<'a> {
         }
         Ok(())
     }
+
+    /// [`append_children_from_string`](Self::append_children_from_string)
+    /// on the first element matching the CSS `selector`.
+    ///
+    /// An [`Element`] borrows the document, so it cannot be passed to
+    /// `append_children_from_string` on the same document; this looks the
+    /// parent up itself. Returns `Ok(false)` if nothing matches.
+    pub fn append_children_to(
+        &mut self,
+        selector: &str,
+        html: &str,
+        replace_existing: bool,
+    ) -> Result<bool, CreateError> {
+        let Some(parent) = self.root().and_then(|root| root.select_one(selector)) else {
+            return Ok(false);
+        };
+        let parent = Element {
+            ptr: parent.ptr,
+            _phantom: PhantomData,
+        };
+        self.append_children_from_string(&parent, html, replace_existing)?;
+        Ok(true)
+    }
 }
 
-impl Drop for Document<'_> {
+impl<'a, C: ?Sized + 'a> Drop for Document<'a, C> {
     fn drop(&mut self) {
         unsafe {
             // Destroy the document first (it may call callbacks during teardown),
@@ -2373,12 +3261,118 @@ impl Drop for Document<'_> {
     }
 }
 
+// ---------------------------------------------------------------------------
+// Dom
+// ---------------------------------------------------------------------------
+
+/// Element tree of an HTML document, parsed without styling or layout.
+///
+/// No stylesheet is parsed or applied, no font is created and no render
+/// tree is built, so parsing costs a fraction of [`Document::from_html`].
+/// Traversal, [`Element::tag_name`], [`Element::attr`] and the text
+/// functions work as on a [`Document`]; anything that reads computed style
+/// or layout (fonts, placements, inline boxes) returns defaults. Suited to
+/// link and text extraction and sanitization checks.
+pub struct Dom {
+    raw: *mut sys::lh_document_t,
+}
+
+impl Dom {
+    /// Parse `html`, truncating the tree to the node and depth limits of
+    /// `limits` if given. The image and height limits do not apply.
+    pub fn parse(html: &str, limits: Option<&ResourceLimits>) -> Result<Self, CreateError> {
+        let c_html = CString::new(html)?;
+        let c_limits = limits.map(|l| l.to_c());
+        let raw = unsafe {
+            sys::lh_dom_parse(
+                c_html.as_ptr(),
+                c_limits.as_ref().map_or(std::ptr::null(), |l| l),
+            )
+        };
+        if raw.is_null() {
+            return Err(CreateError::CreateFailed);
+        }
+        Ok(Self { raw })
+    }
+
+    /// The root element.
+    pub fn root(&self) -> Option<Element<'_>> {
+        let ptr = unsafe { sys::lh_document_root(self.raw) };
+        if ptr.is_null() {
+            None
+        } else {
+            Some(Element {
+                ptr,
+                _phantom: PhantomData,
+            })
+        }
+    }
+
+    /// Find the first element whose `id` attribute is exactly `id`. See
+    /// [`Document::element_by_id`].
+    pub fn element_by_id(&self, id: &str) -> Option<Element<'_>> {
+        let c_id = CString::new(id).ok()?;
+        let ptr = unsafe { sys::lh_document_element_by_id(self.raw, c_id.as_ptr()) };
+        if ptr.is_null() {
+            None
+        } else {
+            Some(Element {
+                ptr,
+                _phantom: PhantomData,
+            })
+        }
+    }
+
+    /// Append all text in the document to `out` in document order.
+    pub fn text_content_into(&self, out: &mut String) {
+        if let Some(root) = self.root() {
+            root.text_content_into(out);
+        }
+    }
+
+    /// Which DOM limits truncated the tree. See [`Document::limits_hit`].
+    pub fn limits_hit(&self) -> LimitsHit {
+        let flags = unsafe { sys::lh_document_limits_hit(self.raw) };
+        LimitsHit {
+            nodes: flags & sys::LH_LIMIT_NODES != 0,
+            depth: flags & sys::LH_LIMIT_DEPTH != 0,
+            ..LimitsHit::default()
+        }
+    }
+}
+
+impl Drop for Dom {
+    fn drop(&mut self) {
+        unsafe { sys::lh_document_destroy(self.raw) };
+    }
+}
+
 // ---------------------------------------------------------------------------
 // Optional pixbuf rendering backend
 // ---------------------------------------------------------------------------
 
 pub mod selection;
 
+pub mod async_container;
+
+pub mod cost;
+
+pub mod display_list;
+
+pub mod pipeline;
+
+#[cfg(feature = "render-cache")]
+pub mod render_cache;
+
+pub mod render_queue;
+
+pub mod snapshot;
+
+pub mod text_layout;
+
+#[cfg(test)]
+mod test_util;
+
 #[cfg(feature = "pixbuf")]
 pub mod pixbuf;
 
@@ -2676,6 +3670,224 @@ mod tests {
         assert!(find_text_node(&root), "should find at least one text node");
     }
 
+    #[test]
+    fn test_text_ref_and_text_content() {
+        let mut container = TestContainer::new();
+        let doc = Document::from_html("<p>Hello <b>bold</b> world</p>", &mut container, None, None)
+            .unwrap();
+        let root = doc.root().unwrap();
+
+        assert!(root.text_ref().is_none(), "root is not a text node");
+
+        fn collect_refs<'a>(el: &Element<'a>, out: &mut String) {
+            if let Some(text) = el.text_ref() {
+                out.push_str(text);
+            }
+            for i in 0..el.children_count() {
+                if let Some(child) = el.child_at(i) {
+                    collect_refs(&child, out);
+                }
+            }
+        }
+        let mut borrowed = String::new();
+        collect_refs(&root, &mut borrowed);
+
+        let mut content = String::new();
+        doc.text_content_into(&mut content);
+
+        assert!(content.contains("bold"));
+        assert_eq!(content, root.get_text());
+        assert_eq!(borrowed, content);
+    }
+
+    #[test]
+    fn test_sibling_navigation_matches_child_at() {
+        let mut container = TestContainer::new();
+        let mut doc = Document::from_html(
+            "<ul><li>a</li><li>b</li><li>c</li></ul>",
+            &mut container,
+            None,
+            None,
+        )
+        .unwrap();
+        let root = doc.root().unwrap();
+        assert_eq!(root.index_in_parent(), None);
+        assert!(root.next_sibling().is_none());
+
+        fn check(el: &Element<'_>) {
+            let children: Vec<Element<'_>> = el.children().collect();
+            assert_eq!(children.len(), el.children_count());
+            for (i, child) in children.iter().enumerate() {
+                assert_eq!(child.as_ptr(), el.child_at(i).unwrap().as_ptr());
+                assert_eq!(child.index_in_parent(), Some(i));
+                assert_eq!(
+                    child.prev_sibling().map(|e| e.as_ptr()),
+                    i.checked_sub(1).map(|j| children[j].as_ptr())
+                );
+                assert_eq!(
+                    child.next_sibling().map(|e| e.as_ptr()),
+                    children.get(i + 1).map(|e| e.as_ptr())
+                );
+                check(child);
+            }
+        }
+        check(&root);
+
+        // The index is rebuilt after a DOM change.
+        assert!(doc.append_children_to("ul", "<li>d</li>", false).unwrap());
+        let ul = doc.root().unwrap().select_one("ul").unwrap();
+        let last = ul.child_at(ul.children_count() - 1).unwrap();
+        assert_eq!(last.index_in_parent(), Some(ul.children_count() - 1));
+        assert!(last.next_sibling().is_none());
+        check(&doc.root().unwrap());
+    }
+
+    #[test]
+    fn test_placement_memoized_per_layout() {
+        let mut container = TestContainer::new();
+        let mut doc = Document::from_html(
+            "<div style=\"margin-left: 30px\"><p>one</p><p>two</p></div>",
+            &mut container,
+            None,
+            None,
+        )
+        .unwrap();
+        let g0 = doc.layout_generation();
+        let _ = doc.render(800.0);
+        let g1 = doc.layout_generation();
+        assert_ne!(g0, g1);
+
+        let second = doc.root().unwrap().select_one("p + p").unwrap();
+        let first = second.placement();
+        assert_eq!(first, second.placement());
+        assert!(first.x >= 30.0);
+
+        let _ = doc.render(400.0);
+        assert_ne!(doc.layout_generation(), g1);
+        let second = doc.root().unwrap().select_one("p + p").unwrap();
+        assert_eq!(second.placement().x, first.x);
+        assert!(second.placement().width <= 400.0);
+    }
+
+    #[test]
+    fn test_element_by_id() {
+        let mut container = TestContainer::new();
+        let mut doc = Document::from_html(
+            "<h1 id=\"top\">Top</h1><p id=\"a.b\">dotted</p><p id=\"top\">dup</p>",
+            &mut container,
+            None,
+            None,
+        )
+        .unwrap();
+        let root = doc.root().unwrap();
+
+        let top = doc.element_by_id("top").unwrap();
+        assert_eq!(top.as_ptr(), root.select_one("h1").unwrap().as_ptr());
+        let dotted = doc.element_by_id("a.b").unwrap();
+        assert_eq!(
+            dotted.as_ptr(),
+            root.select_one(&format!("#{}", css_escape_ident("a.b")))
+                .unwrap()
+                .as_ptr()
+        );
+        assert!(doc.element_by_id("missing").is_none());
+        assert!(doc.element_by_id("").is_none());
+
+        assert!(doc
+            .append_children_to("body", "<div id=\"late\">new</div>", false)
+            .unwrap());
+        assert!(doc.element_by_id("late").is_some());
+    }
+
+    #[test]
+    fn test_render_incremental() {
+        let mut container = TestContainer::new();
+        let mut doc = Document::from_html(
+            "<div id=\"log\"><p>one</p></div><p>footer</p>",
+            &mut container,
+            None,
+            None,
+        )
+        .unwrap();
+        assert!(doc.is_layout_dirty());
+
+        let first = doc.render_incremental(800.0);
+        assert!(first.changed.is_some(), "first render lays out everything");
+        assert!(!doc.is_layout_dirty());
+
+        let again = doc.render_incremental(800.0);
+        assert_eq!(again.changed, None);
+        assert_eq!(again.width, first.width);
+
+        let old_box = doc.element_by_id("log").unwrap().placement();
+        assert!(doc.append_children_to("#log", "<p>two</p>", false).unwrap());
+        assert!(!doc
+            .append_children_to("#missing", "<p>x</p>", false)
+            .unwrap());
+        assert!(doc.is_layout_dirty());
+
+        let update = doc.render_incremental(800.0);
+        let changed = update.changed.expect("append changes the layout");
+        assert!(changed.y <= old_box.y + old_box.height);
+        assert!(changed.y + changed.height >= doc.height() - 0.5);
+
+        doc.invalidate_layout();
+        assert!(doc.render_incremental(800.0).changed.is_some());
+        assert!(doc.render_incremental(600.0).changed.is_some());
+    }
+
+    #[test]
+    fn test_reset_with_html_reuses_fonts() {
+        #[derive(Default)]
+        struct Counting {
+            inner: Option<TestContainer>,
+            created: usize,
+            deleted: usize,
+        }
+
+        impl DocumentContainer for Counting {
+            fn create_font(&mut self, descr: &FontDescription) -> (FontHandle, FontMetrics) {
+                self.created += 1;
+                self.inner
+                    .get_or_insert_with(TestContainer::new)
+                    .create_font(descr)
+            }
+            fn delete_font(&mut self, _font: FontHandle) {
+                self.deleted += 1;
+            }
+            fn text_width(&self, text: &str, _font: FontHandle) -> f32 {
+                text.len() as f32 * 8.0
+            }
+            fn draw_text(&mut self, _: DrawContext, _: &str, _: FontHandle, _: Color, _: Position) {
+            }
+            fn get_viewport(&self) -> Position {
+                TestContainer::new().get_viewport()
+            }
+            fn get_media_features(&self) -> MediaFeatures {
+                TestContainer::new().get_media_features()
+            }
+        }
+
+        let mut container = Counting::default();
+        {
+            let mut doc =
+                Document::from_html("<p>first message</p>", &mut container, None, None).unwrap();
+            let _ = doc.render(800.0);
+            let before = unsafe { doc.with_container_mut(|c| (c.created, c.deleted)) };
+            assert!(before.0 > 0);
+
+            doc.reset_with_html("<p>second message</p>").unwrap();
+            let _ = doc.render(800.0);
+            let mut text = String::new();
+            doc.text_content_into(&mut text);
+            assert!(text.contains("second"));
+            assert!(!text.contains("first"));
+            let after = unsafe { doc.with_container_mut(|c| (c.created, c.deleted)) };
+            assert_eq!(after, before, "same fonts are reused");
+        }
+        assert_eq!(container.created, container.deleted);
+    }
+
     #[test]
     fn test_element_parent() {
         let mut container = TestContainer::new();
@@ -2705,6 +3917,59 @@ mod tests {
         assert!(el.is_some(), "should find an element at (10, 10)");
     }
 
+    #[test]
+    fn test_color_stops_spill_to_heap() {
+        let fake = |count: usize| {
+            move |points: *mut sys::lh_color_point_t, capacity: c_int| {
+                for i in 0..count.min(capacity as usize) {
+                    unsafe {
+                        *points.add(i) = sys::lh_color_point_t {
+                            offset: i as f32,
+                            color: sys::lh_web_color_t::default(),
+                        };
+                    }
+                }
+                count as c_int
+            }
+        };
+
+        let mut stops = ColorStops::new();
+        let small = stops.fill(fake(3));
+        assert_eq!(small.len(), 3);
+        assert_eq!(small[2].offset, 2.0);
+
+        let large = stops.fill(fake(INLINE_COLOR_STOPS + 5));
+        assert_eq!(large.len(), INLINE_COLOR_STOPS + 5);
+        assert_eq!(
+            large.last().unwrap().offset,
+            (INLINE_COLOR_STOPS + 4) as f32
+        );
+    }
+
+    #[test]
+    fn test_dyn_and_generic_documents_agree() {
+        let html = "<p>Some words that wrap across lines</p>";
+
+        let mut generic_container = TestContainer::new();
+        let mut generic = Document::from_html(html, &mut generic_container, None, None).unwrap();
+        let _ = generic.render(100.0);
+
+        let mut dyn_container = TestContainer::new();
+        let container: &mut dyn DocumentContainer = &mut dyn_container;
+        let mut dynamic: Document<'_> = Document::from_html(html, container, None, None).unwrap();
+        let _ = dynamic.render(100.0);
+
+        assert_eq!(generic.height(), dynamic.height());
+    }
+
+    #[test]
+    fn test_with_container_mut_is_typed() {
+        let mut container = TestContainer::new();
+        let mut doc = Document::from_html("<p>Hi</p>", &mut container, None, None).unwrap();
+        let next = unsafe { doc.with_container_mut(|c| c.next_font_id) };
+        assert!(next > 1);
+    }
+
     // test_not_send_sync is now a compile_fail doc test on the Document struct.
 
     #[cfg(feature = "pixbuf")]
@@ -2729,6 +3994,174 @@ mod tests {
             assert_eq!(c.height(), 150);
         }
 
+        #[cfg(feature = "render-cache")]
+        #[test]
+        fn test_render_to_rgba_cached() {
+            use crate::render_cache::RenderCache;
+
+            let dir =
+                std::env::temp_dir().join(format!("litehtml-rgba-cached-{}", std::process::id()));
+            let _ = std::fs::remove_dir_all(&dir);
+            let cache = RenderCache::open(&dir, 1 << 24).unwrap();
+            let html = r#"<p style="border: 1px solid red">Hello cache</p>"#;
+
+            let (w, h, miss) = crate::pixbuf::render_to_rgba_cached(&cache, html, 120, 2.0);
+            assert_eq!(w, 240);
+            assert!(h > 0);
+            assert_eq!(miss.len(), w as usize * h as usize * 4);
+            let hit = crate::pixbuf::render_to_rgba_cached(&cache, html, 120, 2.0);
+            assert_eq!(hit, (w, h, miss));
+
+            let stats = cache.stats();
+            assert_eq!((stats.insertions, stats.hits, stats.misses), (1, 1, 1));
+            let _ = std::fs::remove_dir_all(&dir);
+        }
+
+        #[test]
+        fn test_tiled_matches_single_pass() {
+            use crate::pipeline::LayoutRequest;
+            use crate::pixbuf::{PixbufContainer, DEFAULT_VIEWPORT_HEIGHT};
+
+            // Fixed block heights keep the document height integral, so both
+            // paths size the page identically at every scale.
+            let mut html = String::from(r#"<body style="margin: 0; background: white">"#);
+            for i in 0..12 {
+                html.push_str(&format!(
+                    r#"<div style="height: 37px; border: {}px {} rgb(200, {}, 40); border-radius: 6px;
+                        font-style: italic; overflow: hidden">Line {i} of gjpqy text</div>"#,
+                    1 + i % 4,
+                    ["solid", "dashed", "dotted"][i % 3],
+                    i * 20
+                ));
+            }
+            html.push_str("</body>");
+
+            for scale in [1.0, 2.0] {
+                let mut container = PixbufContainer::new_with_scale(300, 1, scale);
+                container
+                    .render_page(
+                        &LayoutRequest::new(&html, 300.0),
+                        DEFAULT_VIEWPORT_HEIGHT,
+                        scale,
+                    )
+                    .unwrap();
+                let single = (
+                    container.width(),
+                    container.height(),
+                    container.pixels().to_vec(),
+                );
+                // Divisors and non-divisors of the page height, a single row
+                // and one tile covering the whole page.
+                for tile_height in [1, 7, 37, 50, 64, single.1] {
+                    for threads in [1, 4] {
+                        let tiled = crate::pixbuf::render_to_rgba_tiled(
+                            &html,
+                            300,
+                            scale,
+                            tile_height,
+                            threads,
+                        );
+                        assert!(
+                            tiled == single,
+                            "tiles of {tile_height} rows on {threads} threads at {scale}x differ"
+                        );
+                    }
+                }
+            }
+        }
+
+        #[test]
+        fn test_pixbuf_image_and_height_limits() {
+            use crate::pixbuf::PixbufContainer;
+
+            let png = |w: u32, h: u32| {
+                let mut out = std::io::Cursor::new(Vec::new());
+                image::RgbaImage::new(w, h)
+                    .write_to(&mut out, image::ImageFormat::Png)
+                    .unwrap();
+                out.into_inner()
+            };
+            let limits = crate::ResourceLimits::new()
+                .with_max_image_pixels(50 * 50)
+                .with_max_height(100);
+            let mut c = PixbufContainer::new(200, 100);
+            c.set_limits(&limits);
+
+            c.load_image_data("small.png", &png(50, 50));
+            c.load_image_data("large.png", &png(51, 50));
+            // Unreadable headers are dropped without counting as a hit.
+            c.load_image_data("garbage.png", b"not an image at all");
+            assert_eq!(c.memory_usage().images, 1);
+            assert_eq!(c.limits_hit().images, 1);
+            assert!(!c.limits_hit().height);
+
+            let tall = r#"<div style="height: 1000px; background: red"></div>"#;
+            let request = crate::pipeline::LayoutRequest::new(tall, 200.0);
+            let laid = c
+                .render_page(&request, crate::pixbuf::DEFAULT_VIEWPORT_HEIGHT, 2.0)
+                .unwrap();
+            assert!(laid.height >= 1000.0);
+            assert_eq!((c.width(), c.height()), (400, 200));
+            assert!(c.limits_hit().height);
+        }
+
+        #[test]
+        fn test_lay_out_page_keeps_pixmap_scale() {
+            use crate::DocumentContainer;
+
+            let mut c = crate::pixbuf::PixbufContainer::new_with_scale(100, 50, 1.0);
+            let request = crate::pipeline::LayoutRequest::new("<p>Hello</p>", 300.0);
+            c.lay_out_page(&request, crate::pixbuf::DEFAULT_VIEWPORT_HEIGHT, 2.0)
+                .unwrap();
+            assert_eq!(c.scale_factor(), 1.0);
+            assert_eq!((c.width(), c.height()), (100, 50));
+            let viewport = c.get_viewport();
+            assert_eq!((viewport.width, viewport.height), (100.0, 50.0));
+        }
+
+        #[test]
+        fn test_pixbuf_char_offsets() {
+            use crate::selection::TextMeasure;
+            use crate::DocumentContainer;
+
+            let mut container = crate::pixbuf::PixbufContainer::new(400, 100);
+            let descr = crate::FontDescription {
+                family: "serif",
+                size: 16.0,
+                style: crate::FontStyle::Normal,
+                weight: 400,
+                decoration_line: Default::default(),
+                decoration_thickness: Default::default(),
+                decoration_style: Default::default(),
+                decoration_color: Default::default(),
+                emphasis_style: "",
+                emphasis_color: Default::default(),
+                emphasis_position: Default::default(),
+            };
+            let (font, _) = container.create_font(&descr);
+            let measure = container.text_measure();
+
+            let mut offsets = Vec::new();
+            for text in [
+                // fi/ffi ligatures, where the font has them: one glyph, several chars
+                "office affine",
+                // combining acute accent: a two-char cluster
+                "cafe\u{301} ole\u{301}",
+                // spans lines: measured by prefixes
+                "first line\nsecond",
+            ] {
+                measure.char_offsets(text, font, &mut offsets);
+                assert_eq!(offsets.len(), text.chars().count(), "{text:?}");
+                assert!(
+                    offsets.windows(2).all(|w| w[0] <= w[1]),
+                    "{text:?}: {offsets:?}"
+                );
+                let width = measure.text_width(text, font);
+                let last = *offsets.last().unwrap();
+                assert!((last - width).abs() < 0.01, "{text:?}: {last} != {width}");
+            }
+        }
+
         #[test]
         fn test_pixbuf_render_with_borders() {
             let html = r#"<div style="border: 2px solid red; width: 50px; height: 50px; background: blue;"></div>"#;
@@ -2998,4 +4431,222 @@ mod tests {
             );
         }
     }
+
+    #[test]
+    fn test_budget_aborts_creation_and_render() {
+        let mut html = String::from("<table>");
+        for i in 0..200 {
+            html.push_str(&format!(
+                "<tr><td>row {i}</td><td>some words here</td></tr>"
+            ));
+        }
+        html.push_str("</table>");
+
+        let mut container = TestContainer::new();
+        let budget = Budget::new().with_max_steps(10);
+        let options = DocumentOptions {
+            budget: Some(&budget),
+            ..DocumentOptions::default()
+        };
+        let err = Document::from_html_with_options(&html, &mut container, &options)
+            .err()
+            .expect("step limit must abort creation");
+        assert!(matches!(err, CreateError::Aborted(AbortReason::StepLimit)));
+
+        let token = CancellationToken::new();
+        token.cancel();
+        let budget = Budget::new().with_cancellation(token);
+        let options = DocumentOptions {
+            budget: Some(&budget),
+            ..DocumentOptions::default()
+        };
+        let err = Document::from_html_with_options(&html, &mut container, &options)
+            .err()
+            .expect("cancelled token must abort creation");
+        assert!(matches!(err, CreateError::Aborted(AbortReason::Cancelled)));
+
+        let unlimited = Budget::new();
+        let options = DocumentOptions {
+            budget: Some(&unlimited),
+            ..DocumentOptions::default()
+        };
+        let mut doc = Document::from_html_with_options(&html, &mut container, &options).unwrap();
+        assert_eq!(
+            doc.render_with_budget(800.0, &Budget::new().with_max_steps(5)),
+            Err(AbortReason::StepLimit)
+        );
+        assert!(doc.is_layout_dirty());
+        let width = doc.render_with_budget(800.0, &unlimited).unwrap();
+        assert!(width > 0.0);
+        assert!(doc.height() > 0.0);
+    }
+
+    #[test]
+    fn test_budget_abort_leaves_document_usable() {
+        fn placements(el: &Element<'_>, out: &mut Vec<Position>) {
+            out.push(el.placement());
+            for child in el.children() {
+                placements(&child, out);
+            }
+        }
+        let layout = |doc: &mut Document<'_, TestContainer>| {
+            let width = doc.render(600.0);
+            let mut boxes = Vec::new();
+            placements(&doc.root().unwrap(), &mut boxes);
+            (width, doc.height(), boxes)
+        };
+
+        let mut html = String::from("<table>");
+        for i in 0..100 {
+            html.push_str(&format!(
+                "<tr><td>row {i}</td><td>some words here</td></tr>"
+            ));
+        }
+        html.push_str("</table><p>trailing paragraph</p>");
+
+        let mut container = TestContainer::new();
+        let fresh = {
+            let mut doc = Document::from_html(&html, &mut container, None, None).unwrap();
+            layout(&mut doc)
+        };
+
+        let mut doc = Document::from_html(&html, &mut container, None, None).unwrap();
+        for steps in [1, 5, 50] {
+            assert_eq!(
+                doc.render_with_budget(600.0, &Budget::new().with_max_steps(steps)),
+                Err(AbortReason::StepLimit)
+            );
+            assert_eq!(layout(&mut doc), fresh);
+        }
+
+        // An aborted reset keeps the old content; an unlimited one replaces it.
+        let err = doc
+            .reset_with_html_budgeted("<p>other</p>", &Budget::new().with_max_steps(1))
+            .unwrap_err();
+        assert!(matches!(err, CreateError::Aborted(AbortReason::StepLimit)));
+        assert_eq!(layout(&mut doc), fresh);
+        doc.reset_with_html_budgeted("<p>other</p>", &Budget::new())
+            .unwrap();
+        assert!(layout(&mut doc).1 < fresh.1);
+    }
+
+    #[test]
+    fn test_resource_limits_truncate_dom() {
+        let wide: String = (0..300).map(|i| format!("<p>paragraph {i}</p>")).collect();
+        let deep = format!("{}deep text{}", "<div>".repeat(200), "</div>".repeat(200));
+
+        let mut container = TestContainer::new();
+        let height_of =
+            |html: &str, container: &mut TestContainer, limits: Option<&ResourceLimits>| {
+                let options = DocumentOptions {
+                    limits,
+                    ..DocumentOptions::default()
+                };
+                let mut doc = Document::from_html_with_options(html, container, &options).unwrap();
+                let _ = doc.render(800.0);
+                (doc.height(), doc.limits_hit())
+            };
+
+        let (full, hit) = height_of(&wide, &mut container, None);
+        assert!(!hit.any());
+        let limits = ResourceLimits::new().with_max_nodes(50);
+        let (truncated, hit) = height_of(&wide, &mut container, Some(&limits));
+        assert!(hit.nodes && !hit.depth);
+        assert!(truncated > 0.0 && truncated < full);
+
+        let (full, _) = height_of(&deep, &mut container, None);
+        let limits = ResourceLimits::new().with_max_depth(20);
+        let (pruned, hit) = height_of(&deep, &mut container, Some(&limits));
+        assert!(hit.depth && !hit.nodes);
+        assert!(pruned < full);
+
+        // Nesting this deep would overflow the stack while the tree is
+        // built; the limit flattens it before the parser recurses.
+        let abyss = format!("{}x{}", "<div>".repeat(200_000), "</div>".repeat(200_000));
+        let limits = ResourceLimits::new().with_max_depth(64);
+        let (_, hit) = height_of(&abyss, &mut container, Some(&limits));
+        assert!(hit.depth);
+
+        let roomy = ResourceLimits::new()
+            .with_max_nodes(100_000)
+            .with_max_depth(1000);
+        let (_, hit) = height_of(&wide, &mut container, Some(&roomy));
+        assert_eq!(hit, LimitsHit::default());
+    }
+
+    #[test]
+    fn test_memory_usage() {
+        let mut container = TestContainer::new();
+        let small = "<p class=\"a\">one</p>";
+        let large: String = (0..100)
+            .map(|i| format!("<p class=\"row\" id=\"p{i}\">paragraph number {i}</p>"))
+            .collect();
+
+        let mut doc = Document::from_html(small, &mut container, None, None).unwrap();
+        let parsed = doc.memory_usage();
+        assert!(parsed.elements > 0 && parsed.text_nodes > 0);
+        let _ = doc.render(800.0);
+        let rendered = doc.memory_usage();
+        assert!(rendered.render_items > 0 && rendered.render_bytes > 0);
+        assert_eq!(rendered.elements, parsed.elements);
+        assert_eq!(doc.memory_usage(), rendered);
+        drop(doc);
+
+        let mut doc = Document::from_html(&large, &mut container, None, None).unwrap();
+        let _ = doc.render(800.0);
+        let big = doc.memory_usage();
+        assert!(big.elements > rendered.elements);
+        assert!(big.string_bytes > rendered.string_bytes);
+        assert!(big.total_bytes() > rendered.total_bytes());
+    }
+
+    #[test]
+    fn test_render_cost() {
+        let html = "<html><head><style>td { padding: 1px } @media print { p { color: red } }</style></head>\
+                    <body><table><tr><td>a</td><td>b</td></tr><tr><td>c</td><td><img src=\"x.png\"></td></tr></table>\
+                    <p>hello</p><script>var x = '<td>';</script></body></html>";
+        let mut container = TestContainer::new();
+        let doc = Document::from_html(html, &mut container, None, None).unwrap();
+        let cost = doc.render_cost();
+        assert_eq!(cost.table_cells, 4);
+        assert_eq!(cost.images, 1);
+        assert_eq!(cost.style_rules, 2);
+        // html > body > table > tbody > tr > td > img
+        assert_eq!(cost.max_depth, 7);
+        assert!(cost.text_bytes >= "abchello".len());
+        assert!(cost.score() > cost::CostModel::default().base);
+    }
+
+    #[test]
+    fn test_dom_parse() {
+        let html = r#"<html><head><style>p { color: red }</style></head><body>
+            <p id="intro">Read the <a href="/a" class="x">first</a> and
+            <a href="/b">second</a> post.</p></body></html>"#;
+        let dom = Dom::parse(html, None).unwrap();
+
+        let mut links = Vec::new();
+        let mut stack = vec![dom.root().unwrap()];
+        while let Some(el) = stack.pop() {
+            if el.tag_name() == "a" {
+                links.push(el.attr("href").unwrap().to_string());
+            }
+            stack.extend(el.children().collect::<Vec<_>>().into_iter().rev());
+        }
+        assert_eq!(links, ["/a", "/b"]);
+
+        let intro = dom.element_by_id("intro").unwrap();
+        assert_eq!(intro.tag_name(), "p");
+        assert_eq!(intro.attr("missing"), None);
+
+        let mut container = TestContainer::new();
+        let doc = Document::from_html(html, &mut container, None, None).unwrap();
+        let (mut parsed, mut styled) = (String::new(), String::new());
+        dom.text_content_into(&mut parsed);
+        doc.text_content_into(&mut styled);
+        assert_eq!(parsed, styled);
+
+        let limits = ResourceLimits::new().with_max_depth(3);
+        let shallow = Dom::parse(html, Some(&limits)).unwrap();
+        assert!(shallow.limits_hit().depth);
+    }
 }
@@ -0,0 +1,524 @@
+//! Staged batch rendering.
+//!
+//! Running parse, layout and raster back to back on every worker makes all
+//! CPU-bound phases compete for the same caches at once. A [`Pipeline`]
+//! splits the work into two stages joined by bounded queues:
+//!
+//! 1. **Layout** parses, styles and lays out each document against a
+//!    measuring container, then records its draw pass into a
+//!    [`DisplayList`].
+//! 2. **Raster** turns each display list into the final output, for example
+//!    by replaying it into a `PixbufContainer`.
+//!
+//! Each stage runs on its own pool of threads, so document N can be
+//! rasterized while document N+1 is being laid out. A full queue blocks the
+//! stage feeding it, which bounds memory. [`Pipeline::stats`] reports queue
+//! depth, wait time and busy time for each stage.
+//!
+//! Parse and layout stay in one stage because a [`Document`] borrows its
+//! container and cannot move between threads mid-flight; the display list is
+//! the first point at which a document's state is owned and `Send`.
+//!
+//! ```ignore
+//! let pipeline = Pipeline::spawn(
+//!     &PipelineConfig::default(),
+//!     || PixbufContainer::new(800, 600),
+//!     || |job: &PipelineJob, laid: LaidOut| {
+//!         let mut pixbuf = PixbufContainer::new(800, laid.height.ceil() as u32);
+//!         laid.list.replay(&mut pixbuf, DrawContext::default(), 0.0, 0.0, None);
+//!         pixbuf.pixels().to_vec()
+//!     },
+//! );
+//! for (id, html) in documents.enumerate() {
+//!     pipeline.submit(PipelineJob { id: id as u64, html, width: 800.0 })?;
+//! }
+//! pipeline.close();
+//! while let Some(output) = pipeline.recv() { /* ... */ }
+//! ```
+
+use std::sync::atomic::{AtomicU64, AtomicUsize, Ordering};
+use std::sync::mpsc::{self, Receiver, Sender, SyncSender};
+use std::sync::{Arc, Mutex};
+use std::thread::JoinHandle;
+use std::time::{Duration, Instant};
+
+use crate::display_list::{DisplayList, RecordingContainer};
+use crate::{
+    CreateError, Document, DocumentContainer, DocumentMemory, DocumentOptions, DrawContext,
+};
+
+/// Thread and queue sizing for a [`Pipeline`].
+#[derive(Debug, Clone, Copy)]
+pub struct PipelineConfig {
+    /// Threads in the layout stage.
+    pub layout_workers: usize,
+    /// Threads in the raster stage.
+    pub raster_workers: usize,
+    /// Capacity of each inter-stage queue. Submitting into a full queue
+    /// blocks until a worker takes an item.
+    pub queue_capacity: usize,
+}
+
+impl Default for PipelineConfig {
+    fn default() -> Self {
+        let cores = std::thread::available_parallelism().map_or(2, |n| n.get());
+        Self {
+            layout_workers: cores.div_ceil(2),
+            raster_workers: (cores / 2).max(1),
+            queue_capacity: 16,
+        }
+    }
+}
+
+/// A document submitted to a [`Pipeline`].
+#[derive(Debug, Clone)]
+pub struct PipelineJob {
+    /// Caller-chosen identifier, echoed in [`PipelineOutput::id`].
+    pub id: u64,
+    pub html: String,
+    /// Layout width in CSS pixels.
+    pub width: f32,
+}
+
+/// A document to lay out with [`lay_out`].
+#[derive(Debug, Clone, Copy)]
+pub struct LayoutRequest<'a> {
+    pub html: &'a str,
+    /// Layout width in CSS pixels.
+    pub width: f32,
+    /// Options for creating the document. A budget set here bounds layout
+    /// as well as parsing.
+    pub options: DocumentOptions<'a>,
+    /// Fill in [`LaidOut::memory`]. The document is measured after its draw
+    /// pass is recorded, outside the timings.
+    pub measure_memory: bool,
+}
+
+impl<'a> LayoutRequest<'a> {
+    /// Lay out `html` at `width` with default options.
+    pub fn new(html: &'a str, width: f32) -> Self {
+        Self {
+            html,
+            width,
+            options: DocumentOptions::default(),
+            measure_memory: false,
+        }
+    }
+}
+
+/// Time spent in each phase of a render.
+#[derive(Debug, Clone, Copy, Default, PartialEq)]
+pub struct RenderTimings {
+    pub parse: Duration,
+    pub layout: Duration,
+    /// Recording the draw pass into the display list.
+    pub record: Duration,
+    /// Replaying the display list into the output. Zero until a raster
+    /// stage fills it in.
+    pub raster: Duration,
+}
+
+/// Result of the layout stage, handed to the raster stage.
+#[derive(Debug)]
+pub struct LaidOut {
+    pub list: DisplayList,
+    /// Document width after layout.
+    pub width: f32,
+    /// Document height after layout.
+    pub height: f32,
+    pub timings: RenderTimings,
+    /// Memory held by the document, if the request asked for it.
+    pub memory: Option<DocumentMemory>,
+}
+
+/// A finished job. Outputs arrive in completion order, not submission order.
+#[derive(Debug)]
+pub struct PipelineOutput<T> {
+    pub id: u64,
+    pub result: Result<T, CreateError>,
+}
+
+/// Error returned by [`Pipeline::submit`] after [`Pipeline::close`] or once
+/// every layout worker has exited.
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct PipelineClosed;
+
+impl std::fmt::Display for PipelineClosed {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        write!(f, "pipeline is closed")
+    }
+}
+
+impl std::error::Error for PipelineClosed {}
+
+/// Counters for one stage, as reported by [`Pipeline::stats`].
+#[derive(Debug, Clone, Copy, Default, PartialEq)]
+pub struct StageStats {
+    /// Items waiting in the stage's input queue.
+    pub queue_depth: usize,
+    /// Items the stage has finished.
+    pub completed: u64,
+    /// Total time finished items spent waiting in the input queue.
+    pub waiting: Duration,
+    /// Total time workers spent processing finished items.
+    pub busy: Duration,
+}
+
+impl StageStats {
+    /// Mean queue wait plus processing time per item.
+    pub fn mean_latency(&self) -> Option<Duration> {
+        let n = u32::try_from(self.completed).ok().filter(|&n| n > 0)?;
+        Some((self.waiting + self.busy) / n)
+    }
+}
+
+/// Per-stage counters for a [`Pipeline`].
+#[derive(Debug, Clone, Copy, Default, PartialEq)]
+pub struct PipelineStats {
+    pub layout: StageStats,
+    pub raster: StageStats,
+}
+
+#[derive(Default)]
+struct StageCounters {
+    depth: AtomicUsize,
+    completed: AtomicU64,
+    waiting_ns: AtomicU64,
+    busy_ns: AtomicU64,
+}
+
+impl StageCounters {
+    fn record(&self, queued: Instant, started: Instant) {
+        let now = Instant::now();
+        self.completed.fetch_add(1, Ordering::Relaxed);
+        self.waiting_ns
+            .fetch_add(nanos(started - queued), Ordering::Relaxed);
+        self.busy_ns
+            .fetch_add(nanos(now - started), Ordering::Relaxed);
+    }
+
+    fn snapshot(&self) -> StageStats {
+        StageStats {
+            queue_depth: self.depth.load(Ordering::Relaxed),
+            completed: self.completed.load(Ordering::Relaxed),
+            waiting: Duration::from_nanos(self.waiting_ns.load(Ordering::Relaxed)),
+            busy: Duration::from_nanos(self.busy_ns.load(Ordering::Relaxed)),
+        }
+    }
+}
+
+fn nanos(d: Duration) -> u64 {
+    u64::try_from(d.as_nanos()).unwrap_or(u64::MAX)
+}
+
+/// An item in an inter-stage queue, stamped with its enqueue time.
+struct Queued<T> {
+    item: T,
+    at: Instant,
+}
+
+/// Multi-consumer end of a bounded queue.
+type SharedReceiver<T> = Arc<Mutex<Receiver<Queued<T>>>>;
+
+fn take<T>(queue: &Mutex<Receiver<Queued<T>>>, counters: &StageCounters) -> Option<Queued<T>> {
+    let item = queue.lock().ok()?.recv().ok()?;
+    counters.depth.fetch_sub(1, Ordering::Relaxed);
+    Some(item)
+}
+
+/// Two-stage layout → raster pipeline. See the [module docs](self).
+pub struct Pipeline<T> {
+    input: Option<SyncSender<Queued<PipelineJob>>>,
+    output: Receiver<PipelineOutput<T>>,
+    layout: Arc<StageCounters>,
+    raster: Arc<StageCounters>,
+    workers: Vec<JoinHandle<()>>,
+}
+
+impl<T: Send + 'static> Pipeline<T> {
+    /// Start the stage workers.
+    ///
+    /// Each layout worker calls `measure` once to create the container that
+    /// answers layout callbacks for every document it handles. Each raster
+    /// worker calls `raster` once to create its rasterizer, which is then
+    /// called for every laid-out document. Neither the container nor the
+    /// rasterizer needs to be `Send`; they live on their worker thread.
+    pub fn spawn<C, M, R, F>(config: &PipelineConfig, measure: M, raster: F) -> Self
+    where
+        C: DocumentContainer,
+        M: Fn() -> C + Send + Sync + 'static,
+        R: FnMut(&PipelineJob, LaidOut) -> T,
+        F: Fn() -> R + Send + Sync + 'static,
+    {
+        let capacity = config.queue_capacity.max(1);
+        let (input, jobs) = mpsc::sync_channel::<Queued<PipelineJob>>(capacity);
+        let (laid_tx, laid) = mpsc::sync_channel::<Queued<(PipelineJob, LaidOut)>>(capacity);
+        let (out_tx, output) = mpsc::channel();
+        let jobs: SharedReceiver<PipelineJob> = Arc::new(Mutex::new(jobs));
+        let laid: SharedReceiver<(PipelineJob, LaidOut)> = Arc::new(Mutex::new(laid));
+        let layout = Arc::new(StageCounters::default());
+        let raster_counters = Arc::new(StageCounters::default());
+        let measure = Arc::new(measure);
+        let raster = Arc::new(raster);
+        let mut workers = Vec::new();
+
+        for _ in 0..config.layout_workers.max(1) {
+            let jobs = Arc::clone(&jobs);
+            let laid_tx = laid_tx.clone();
+            let out_tx: Sender<PipelineOutput<T>> = out_tx.clone();
+            let counters = Arc::clone(&layout);
+            let next = Arc::clone(&raster_counters);
+            let measure = Arc::clone(&measure);
+            workers.push(std::thread::spawn(move || {
+                let mut container = measure();
+                while let Some(Queued { item: job, at }) = take(&jobs, &counters) {
+                    let started = Instant::now();
+                    let result = lay_out(&LayoutRequest::new(&job.html, job.width), &mut container);
+                    counters.record(at, started);
+                    match result {
+                        Ok(laid) => {
+                            next.depth.fetch_add(1, Ordering::Relaxed);
+                            let queued = Queued {
+                                item: (job, laid),
+                                at: Instant::now(),
+                            };
+                            if laid_tx.send(queued).is_err() {
+                                next.depth.fetch_sub(1, Ordering::Relaxed);
+                                break;
+                            }
+                        }
+                        Err(e) => {
+                            let _ = out_tx.send(PipelineOutput {
+                                id: job.id,
+                                result: Err(e),
+                            });
+                        }
+                    }
+                }
+            }));
+        }
+        drop(laid_tx);
+
+        for _ in 0..config.raster_workers.max(1) {
+            let laid = Arc::clone(&laid);
+            let out_tx = out_tx.clone();
+            let counters = Arc::clone(&raster_counters);
+            let raster = Arc::clone(&raster);
+            workers.push(std::thread::spawn(move || {
+                let mut rasterize = raster();
+                while let Some(Queued {
+                    item: (job, laid),
+                    at,
+                }) = take(&laid, &counters)
+                {
+                    let started = Instant::now();
+                    let value = rasterize(&job, laid);
+                    counters.record(at, started);
+                    let output = PipelineOutput {
+                        id: job.id,
+                        result: Ok(value),
+                    };
+                    if out_tx.send(output).is_err() {
+                        break;
+                    }
+                }
+            }));
+        }
+
+        Self {
+            input: Some(input),
+            output,
+            layout,
+            raster: raster_counters,
+            workers,
+        }
+    }
+
+    /// Queue a document for layout, blocking while the layout queue is full.
+    pub fn submit(&self, job: PipelineJob) -> Result<(), PipelineClosed> {
+        let input = self.input.as_ref().ok_or(PipelineClosed)?;
+        self.layout.depth.fetch_add(1, Ordering::Relaxed);
+        let queued = Queued {
+            item: job,
+            at: Instant::now(),
+        };
+        input.send(queued).map_err(|_| {
+            self.layout.depth.fetch_sub(1, Ordering::Relaxed);
+            PipelineClosed
+        })
+    }
+
+    /// Stop accepting jobs. Workers finish everything already queued, after
+    /// which [`recv`](Self::recv) returns `None`.
+    pub fn close(&mut self) {
+        self.input = None;
+    }
+
+    /// Wait for the next finished job. Returns `None` once the pipeline is
+    /// closed and drained.
+    pub fn recv(&self) -> Option<PipelineOutput<T>> {
+        self.output.recv().ok()
+    }
+
+    /// Return a finished job if one is ready, without blocking.
+    pub fn try_recv(&self) -> Option<PipelineOutput<T>> {
+        self.output.try_recv().ok()
+    }
+
+    /// Current per-stage counters.
+    pub fn stats(&self) -> PipelineStats {
+        PipelineStats {
+            layout: self.layout.snapshot(),
+            raster: self.raster.snapshot(),
+        }
+    }
+}
+
+impl<T> Drop for Pipeline<T> {
+    fn drop(&mut self) {
+        self.input = None;
+        for worker in self.workers.drain(..) {
+            let _ = worker.join();
+        }
+    }
+}
+
+/// Parse, lay out and record one document.
+///
+/// This is the one place documents are laid out for deferred drawing: the
+/// pipeline, [`RenderQueue`](crate::render_queue::RenderQueue) jobs and
+/// `PixbufContainer::render_page` all go through it.
+pub fn lay_out<C: DocumentContainer + ?Sized>(
+    request: &LayoutRequest<'_>,
+    container: &mut C,
+) -> Result<LaidOut, CreateError> {
+    let mut timings = RenderTimings::default();
+    let mut recorder = RecordingContainer::new(container);
+    let (width, height, memory) = {
+        let started = Instant::now();
+        let mut doc =
+            Document::from_html_with_options(request.html, &mut recorder, &request.options)?;
+        timings.parse = started.elapsed();
+
+        let started = Instant::now();
+        match request.options.budget {
+            Some(budget) => {
+                doc.render_with_budget(request.width, budget)
+                    .map_err(CreateError::Aborted)?;
+            }
+            None => {
+                let _ = doc.render(request.width);
+            }
+        }
+        timings.layout = started.elapsed();
+
+        let started = Instant::now();
+        doc.draw(DrawContext::default(), 0.0, 0.0, None);
+        timings.record = started.elapsed();
+
+        let memory = request.measure_memory.then(|| doc.memory_usage());
+        (doc.width(), doc.height(), memory)
+    };
+    Ok(LaidOut {
+        list: recorder.finish(),
+        width,
+        height,
+        timings,
+        memory,
+    })
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::{Color, FontDescription, FontHandle, FontMetrics, MediaFeatures, Position};
+
+    struct Measure;
+
+    impl DocumentContainer for Measure {
+        fn create_font(&mut self, _descr: &FontDescription) -> (FontHandle, FontMetrics) {
+            let metrics = FontMetrics {
+                font_size: 16.0,
+                height: 20.0,
+                ascent: 16.0,
+                descent: 4.0,
+                ..Default::default()
+            };
+            (FontHandle(1), metrics)
+        }
+
+        fn delete_font(&mut self, _font: FontHandle) {}
+
+        fn text_width(&self, text: &str, _font: FontHandle) -> f32 {
+            text.len() as f32 * 8.0
+        }
+
+        fn draw_text(&mut self, _: DrawContext, _: &str, _: FontHandle, _: Color, _: Position) {
+            panic!("layout stage must not draw");
+        }
+
+        fn get_viewport(&self) -> Position {
+            Position {
+                x: 0.0,
+                y: 0.0,
+                width: 800.0,
+                height: 600.0,
+            }
+        }
+
+        fn get_media_features(&self) -> MediaFeatures {
+            MediaFeatures {
+                media_type: crate::MediaType::Screen,
+                width: 800.0,
+                height: 600.0,
+                ..Default::default()
+            }
+        }
+    }
+
+    #[test]
+    fn test_pipeline_processes_every_job() {
+        let config = PipelineConfig {
+            layout_workers: 2,
+            raster_workers: 2,
+            queue_capacity: 2,
+        };
+        let mut pipeline = Pipeline::spawn(
+            &config,
+            || Measure,
+            || |_: &PipelineJob, laid: LaidOut| laid.list.len(),
+        );
+        for id in 0..20 {
+            let job = PipelineJob {
+                id,
+                html: format!("<p>document {id}</p>"),
+                width: 400.0,
+            };
+            pipeline.submit(job).unwrap();
+        }
+        pipeline.close();
+        assert_eq!(
+            pipeline.submit(PipelineJob {
+                id: 99,
+                html: String::new(),
+                width: 400.0,
+            }),
+            Err(PipelineClosed)
+        );
+
+        let mut ids = Vec::new();
+        while let Some(output) = pipeline.recv() {
+            assert!(output.result.unwrap() > 0);
+            ids.push(output.id);
+        }
+        ids.sort_unstable();
+        assert_eq!(ids, (0..20).collect::<Vec<_>>());
+
+        let stats = pipeline.stats();
+        assert_eq!(stats.layout.completed, 20);
+        assert_eq!(stats.raster.completed, 20);
+        assert_eq!(stats.layout.queue_depth, 0);
+        assert_eq!(stats.raster.queue_depth, 0);
+        assert!(stats.raster.mean_latency().is_some());
+    }
+}
@@ -6,6 +6,9 @@
 use std::cell::RefCell;
 use std::collections::HashMap;
 use std::rc::Rc;
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::sync::Arc;
+use std::time::Instant;
 
 use cosmic_text::{Attrs, Family, Metrics, Shaping, Style, Weight};
 use tiny_skia::{
@@ -13,13 +16,22 @@ use tiny_skia::{
     Transform,
 };
 
+use crate::display_list::DisplayList;
+use crate::pipeline::{lay_out, LaidOut, LayoutRequest};
+#[cfg(feature = "render-cache")]
+use crate::render_cache::{RenderCache, RenderKey};
+use crate::selection::{prefix_offsets, TextMeasure};
 use crate::{
     BackgroundLayer, BorderRadiuses, BorderStyle, Borders, Color, ColorPoint, ConicGradient,
-    DocumentContainer, DrawContext, FontDescription, FontHandle, FontMetrics, FontStyle,
-    LinearGradient, ListMarker, ListStyleType, MediaFeatures, MediaType, Position, RadialGradient,
-    Size, TextTransform,
+    CreateError, DocumentContainer, DrawContext, FontDescription, FontHandle, FontMetrics,
+    FontStyle, LinearGradient, ListMarker, ListStyleType, MediaFeatures, MediaType, Position,
+    RadialGradient, Size, TextTransform,
 };
 
+/// Viewport height, in logical pixels, that whole-page renders lay out
+/// against when the caller has no window to take it from.
+pub const DEFAULT_VIEWPORT_HEIGHT: u32 = 900;
+
 /// Internal font data associated with a font handle.
 struct FontData {
     family: String,
@@ -44,7 +56,8 @@ pub struct PixbufContainer {
     clip_stack: Vec<(Position, BorderRadiuses)>,
     cached_clip_mask: Option<tiny_skia::Mask>,
     clip_mask_dirty: bool,
-    images: HashMap<String, tiny_skia::Pixmap>,
+    // Arc so tile workers can share decoded images without copying them
+    images: Arc<HashMap<String, tiny_skia::Pixmap>>,
     pending_images: Vec<(String, bool)>,
     /// URLs that have already been handed off for fetching. Prevents the same
     /// URL from being re-added to `pending_images` across document rebuilds.
@@ -56,6 +69,8 @@ pub struct PixbufContainer {
     ignore_overflow_clips: bool,
     last_anchor_click: Option<String>,
     current_cursor: String,
+    limits: crate::ResourceLimits,
+    limits_hit: crate::LimitsHit,
 }
 
 impl PixbufContainer {
@@ -73,20 +88,29 @@ impl PixbufContainer {
     /// (`width * scale_factor`, `height * scale_factor`), while the viewport
     /// stores the logical size. At scale 1.0 this behaves identically to `new()`.
     pub fn new_with_scale(width: u32, height: u32, scale_factor: f32) -> Self {
+        Self::with_font_system(width, height, scale_factor, cosmic_text::FontSystem::new())
+    }
+
+    fn with_font_system(
+        width: u32,
+        height: u32,
+        scale_factor: f32,
+        font_system: cosmic_text::FontSystem,
+    ) -> Self {
         let phys_w = ((width as f32) * scale_factor).ceil() as u32;
         let phys_h = ((height as f32) * scale_factor).ceil() as u32;
         let pixmap =
             tiny_skia::Pixmap::new(phys_w.max(1), phys_h.max(1)).expect("failed to create pixmap");
         Self {
             pixmap,
-            font_system: Rc::new(RefCell::new(cosmic_text::FontSystem::new())),
+            font_system: Rc::new(RefCell::new(font_system)),
             swash_cache: RefCell::new(cosmic_text::SwashCache::new()),
             fonts: Rc::new(RefCell::new(HashMap::new())),
             next_font_id: 1,
             clip_stack: Vec::new(),
             cached_clip_mask: None,
             clip_mask_dirty: false,
-            images: HashMap::new(),
+            images: Arc::new(HashMap::new()),
             pending_images: Vec::new(),
             requested_images: std::collections::HashSet::new(),
             viewport: Position {
@@ -101,6 +125,8 @@ impl PixbufContainer {
             ignore_overflow_clips: false,
             last_anchor_click: None,
             current_cursor: String::new(),
+            limits: crate::ResourceLimits::default(),
+            limits_hit: crate::LimitsHit::default(),
         }
     }
 
@@ -122,10 +148,48 @@ impl PixbufContainer {
     /// Load an image from raw bytes, decoded with the `image` crate.
     ///
     /// The decoded pixels are stored internally and referenced by `url` during
-    /// subsequent draw calls.
+    /// subsequent draw calls. Images larger than the
+    /// [`max_image_pixels`](crate::ResourceLimits::with_max_image_pixels)
+    /// limit are not decoded and behave as if they had failed to load; under
+    /// that limit, so do images whose size cannot be read from the header.
     pub fn load_image_data(&mut self, url: &str, data: &[u8]) {
-        let Ok(img) = image::load_from_memory(data) else {
-            return;
+        let reader = || {
+            image::ImageReader::new(std::io::Cursor::new(data))
+                .with_guessed_format()
+                .ok()
+        };
+        let decoded = match self.limits.max_image_pixels() {
+            None => image::load_from_memory(data),
+            Some(max) => {
+                // Only the header is read here, so nothing large is allocated.
+                let Some((w, h)) = reader().and_then(|r| r.into_dimensions().ok()) else {
+                    return;
+                };
+                if u64::from(w) * u64::from(h) > max {
+                    self.limits_hit.images += 1;
+                    return;
+                }
+                // The decoder may allocate more than the header suggests
+                // (animation frames, progressive passes), so bound it too:
+                // twice the RGBA output plus room for decoder state.
+                let Some(mut reader) = reader() else {
+                    return;
+                };
+                let mut limits = image::Limits::default();
+                limits.max_image_width = Some(w);
+                limits.max_image_height = Some(h);
+                limits.max_alloc = Some(max.saturating_mul(8).saturating_add(1 << 20));
+                reader.limits(limits);
+                reader.decode()
+            }
+        };
+        let img = match decoded {
+            Ok(img) => img,
+            Err(image::ImageError::Limits(_)) => {
+                self.limits_hit.images += 1;
+                return;
+            }
+            Err(_) => return,
         };
         let rgba = img.to_rgba8();
         let (w, h) = (rgba.width(), rgba.height());
@@ -143,7 +207,7 @@ impl PixbufContainer {
             premul,
             tiny_skia::IntSize::from_wh(w, h).expect("invalid image size"),
         ) {
-            self.images.insert(url.to_string(), pm);
+            Arc::make_mut(&mut self.images).insert(url.to_string(), pm);
         }
     }
 
@@ -167,6 +231,76 @@ impl PixbufContainer {
         }
     }
 
+    /// Apply the image and height limits of `limits`; its DOM limits belong
+    /// in [`DocumentOptions`](crate::DocumentOptions). Images loaded before
+    /// this call are kept.
+    pub fn set_limits(&mut self, limits: &crate::ResourceLimits) {
+        self.limits = *limits;
+    }
+
+    /// Image and height limits hit since the container was created or
+    /// [`reset_limits_hit`](Self::reset_limits_hit) was last called.
+    pub fn limits_hit(&self) -> crate::LimitsHit {
+        self.limits_hit
+    }
+
+    pub fn reset_limits_hit(&mut self) {
+        self.limits_hit = crate::LimitsHit::default();
+    }
+
+    /// Clamp a logical height to the height limit, recording a hit.
+    fn clamp_height(&mut self, height: f32) -> f32 {
+        match self.limits.max_height() {
+            Some(max) if height > max as f32 => {
+                self.limits_hit.height = true;
+                max as f32
+            }
+            _ => height,
+        }
+    }
+
+    /// Estimate the memory this container holds. Cost is proportional to
+    /// the number of decoded images, fonts and cached glyphs, not to their
+    /// size.
+    pub fn memory_usage(&self) -> PixbufMemory {
+        let string_bytes = |s: &String| s.capacity();
+        let font_bytes = self
+            .fonts
+            .borrow()
+            .values()
+            .map(|f| std::mem::size_of::<(usize, FontData)>() + string_bytes(&f.family))
+            .sum();
+        let glyph_cache_bytes = self
+            .swash_cache
+            .borrow()
+            .image_cache
+            .values()
+            .map(|img| {
+                std::mem::size_of::<(cosmic_text::CacheKey, Option<cosmic_text::SwashImage>)>()
+                    + img.as_ref().map_or(0, |img| img.data.capacity())
+            })
+            .sum();
+        let url_bytes = self
+            .pending_images
+            .iter()
+            .map(|(url, _)| url)
+            .chain(&self.requested_images)
+            .chain(self.images.keys())
+            .map(string_bytes)
+            .sum();
+        PixbufMemory {
+            pixmap_bytes: self.pixmap.data().len(),
+            clip_mask_bytes: self.cached_clip_mask.as_ref().map_or(0, |m| m.data().len()),
+            images: self.images.len(),
+            image_bytes: self.images.values().map(|pm| pm.data().len()).sum(),
+            fonts: self.fonts.borrow().len(),
+            font_bytes,
+            font_faces: self.font_system.borrow().db().len(),
+            glyph_cache_bytes,
+            url_bytes,
+        }
+    }
+
     /// Get the current display scale factor.
     pub fn scale_factor(&self) -> f32 {
         self.scale_factor
@@ -201,6 +335,14 @@ impl PixbufContainer {
         self.requested_images.clear();
     }
 
+    /// Drop all decoded images, along with the pending/requested tracking.
+    /// Call between unrelated documents when reusing a container, so images
+    /// do not accumulate.
+    pub fn clear_images(&mut self) {
+        self.images = Arc::new(HashMap::new());
+        self.clear_pending_images();
+    }
+
     /// Get the current CSS cursor value set by litehtml (e.g. `"pointer"`, `"default"`).
     pub fn cursor(&self) -> &str {
         &self.current_cursor
@@ -212,7 +354,12 @@ impl PixbufContainer {
     }
 
     /// Resize the pixmap with a new scale factor, clearing all existing content.
+    ///
+    /// `height` is clamped to the
+    /// [`max_height`](crate::ResourceLimits::with_max_height) limit, so the
+    /// pixmap and clip masks never outgrow it.
     pub fn resize_with_scale(&mut self, width: u32, height: u32, scale_factor: f32) {
+        let height = self.clamp_height(height as f32) as u32;
         self.scale_factor = scale_factor;
         let phys_w = ((width as f32) * scale_factor).ceil() as u32;
         let phys_h = ((height as f32) * scale_factor).ceil() as u32;
@@ -224,6 +371,56 @@ impl PixbufContainer {
         self.clip_mask_dirty = !self.clip_stack.is_empty();
     }
 
+    /// Lay out a whole document for deferred drawing, without touching the
+    /// pixmap.
+    ///
+    /// Layout sees a viewport `request.width` wide and `viewport_height`
+    /// tall at `scale_factor`, so `vh` units and height media queries
+    /// resolve as they would in a window of that size. The draw pass is
+    /// recorded into the returned display list.
+    ///
+    /// The container's scale factor and viewport are restored before
+    /// returning, so they still match the pixmap and later draws into it
+    /// behave as before the call.
+    pub fn lay_out_page(
+        &mut self,
+        request: &LayoutRequest<'_>,
+        viewport_height: u32,
+        scale_factor: f32,
+    ) -> Result<LaidOut, CreateError> {
+        let saved = (self.scale_factor, self.viewport);
+        self.scale_factor = scale_factor;
+        self.viewport.width = request.width;
+        self.viewport.height = self.clamp_height(viewport_height as f32);
+        let laid = lay_out(request, self);
+        (self.scale_factor, self.viewport) = saved;
+        laid
+    }
+
+    /// Lay out and draw a whole document, with the pixmap sized to its
+    /// content.
+    ///
+    /// Runs [`lay_out_page`](Self::lay_out_page), resizes the pixmap to the
+    /// document height (clamped to
+    /// [`max_height`](crate::ResourceLimits::with_max_height)) and replays
+    /// the recording into it, so the pixmap is allocated once at its final
+    /// size. The returned timings include the replay.
+    pub fn render_page(
+        &mut self,
+        request: &LayoutRequest<'_>,
+        viewport_height: u32,
+        scale_factor: f32,
+    ) -> Result<LaidOut, CreateError> {
+        let mut laid = self.lay_out_page(request, viewport_height, scale_factor)?;
+        let started = Instant::now();
+        let height = laid.height.ceil().max(1.0) as u32;
+        self.resize_with_scale(request.width.ceil() as u32, height, scale_factor);
+        laid.list
+            .replay(self, DrawContext::default(), 0.0, 0.0, None);
+        laid.timings.raster = started.elapsed();
+        Ok(laid)
+    }
+
     /// Rebuild the cached clip mask if the clip stack has changed since the
     /// last build. After this call `self.cached_clip_mask` is up to date and
     /// can be passed to draw operations via `self.cached_clip_mask.as_ref()`.
@@ -318,25 +515,200 @@ impl PixbufContainer {
     /// so it can be used independently of `&self` (e.g. passed into litehtml
     /// callbacks).
     pub fn text_measure_fn(&self) -> impl Fn(&str, FontHandle) -> f32 {
-        let fonts = Rc::clone(&self.fonts);
-        let font_system = Rc::clone(&self.font_system);
-        let scale_factor = self.scale_factor;
-        move |text: &str, font: FontHandle| -> f32 {
-            let fonts_ref = fonts.borrow();
-            let Some(font_data) = fonts_ref.get(&font.0) else {
-                return text.len() as f32 * 8.0;
-            };
-            let mut fs = font_system.borrow_mut();
-            let line_height = font_data.metrics.height * scale_factor;
-            let metrics = Metrics::new(font_data.size, line_height);
-            let mut buffer = cosmic_text::Buffer::new(&mut fs, metrics);
-            buffer.set_size(&mut fs, Some(f32::MAX), Some(line_height));
-            let attrs = attrs_from_font(font_data);
-            buffer.set_text(&mut fs, text, &attrs, Shaping::Advanced);
-            buffer.shape_until_scroll(&mut fs, false);
-            buffer.layout_runs().map(|run| run.line_w).sum::<f32>() / scale_factor
+        let measure = self.text_measure();
+        move |text: &str, font: FontHandle| measure.text_width(text, font)
+    }
+
+    /// Text measurement for [`Selection`](crate::selection::Selection) that
+    /// returns every character offset of a string from one shaping pass.
+    ///
+    /// Like [`text_measure_fn`](Self::text_measure_fn) it shares the font
+    /// system and font map, so it stays usable while a document holds the
+    /// container.
+    pub fn text_measure(&self) -> PixbufTextMeasure {
+        PixbufTextMeasure {
+            fonts: Rc::clone(&self.fonts),
+            font_system: Rc::clone(&self.font_system),
+            scale_factor: self.scale_factor,
+        }
+    }
+
+    /// Rasterize a recorded document in horizontal tiles on `threads` worker
+    /// threads (`0` uses the available parallelism).
+    ///
+    /// `height` is the logical document height and `tile_height` the height
+    /// of each tile in physical pixels. Every worker owns one tile-sized
+    /// container that shares this container's font database and decoded
+    /// images; tiles replay only the display list operations that intersect
+    /// them. Tiles are returned top to bottom, each as wide as this
+    /// container's viewport. Rows past the
+    /// [`max_height`](crate::ResourceLimits::with_max_height) limit are not
+    /// rasterized.
+    pub fn rasterize_tiles(
+        &mut self,
+        list: &DisplayList,
+        height: f32,
+        tile_height: u32,
+        threads: usize,
+    ) -> Vec<Tile> {
+        let height = self.clamp_height(height);
+        let s = self.scale_factor;
+        let phys_w = ((self.viewport.width * s).ceil() as u32).max(1);
+        let phys_h = ((height * s).ceil() as u32).max(1);
+        let tile_height = tile_height.clamp(1, phys_h);
+        let count = phys_h.div_ceil(tile_height) as usize;
+        let threads = match threads {
+            0 => std::thread::available_parallelism().map_or(1, |n| n.get()),
+            n => n,
+        }
+        .min(count);
+
+        let next = AtomicUsize::new(0);
+        let mut tiles: Vec<Tile> = std::thread::scope(|scope| {
+            let workers: Vec<_> = (0..threads)
+                .map(|_| {
+                    let seed = self.tile_seed();
+                    let next = &next;
+                    scope.spawn(move || {
+                        let mut container = seed.into_container();
+                        let mut done = Vec::new();
+                        loop {
+                            let i = next.fetch_add(1, Ordering::Relaxed);
+                            if i >= count {
+                                break;
+                            }
+                            let y = i as u32 * tile_height;
+                            let h = tile_height.min(phys_h - y);
+                            done.push(container.rasterize_tile(list, phys_w, y, h));
+                        }
+                        done
+                    })
+                })
+                .collect();
+            workers
+                .into_iter()
+                .flat_map(|w| w.join().expect("tile worker panicked"))
+                .collect()
+        });
+        tiles.sort_unstable_by_key(|t| t.y);
+        tiles
+    }
+
+    /// Capture what a tile worker needs to build its own container. Font
+    /// system and swash cache are not `Send`, so workers rebuild them from a
+    /// clone of the font database, which shares the loaded font data.
+    fn tile_seed(&self) -> TileSeed {
+        let fs = self.font_system.borrow();
+        TileSeed {
+            locale: fs.locale().to_string(),
+            db: fs.db().clone(),
+            images: Arc::clone(&self.images),
+            width: self.viewport.width,
+            scale_factor: self.scale_factor,
+            ignore_overflow_clips: self.ignore_overflow_clips,
         }
     }
+
+    /// Replay the rows `y..y + h` (physical pixels) of `list` into a fresh
+    /// pixmap and return it as a tile.
+    fn rasterize_tile(&mut self, list: &DisplayList, phys_w: u32, y: u32, h: u32) -> Tile {
+        let s = self.scale_factor;
+        self.pixmap = tiny_skia::Pixmap::new(phys_w, h).expect("failed to create pixmap");
+        self.viewport.height = h as f32 / s;
+        self.clip_stack.clear();
+        self.cached_clip_mask = None;
+        self.clip_mask_dirty = false;
+        let viewport = self.viewport;
+        list.replay(
+            self,
+            DrawContext::default(),
+            0.0,
+            -(y as f32) / s,
+            Some(viewport),
+        );
+        let pixmap = std::mem::replace(
+            &mut self.pixmap,
+            tiny_skia::Pixmap::new(1, 1).expect("failed to create pixmap"),
+        );
+        Tile {
+            y,
+            width: phys_w,
+            height: h,
+            pixels: pixmap.take(),
+        }
+    }
+}
+
+/// Approximate memory held by a [`PixbufContainer`], from
+/// [`PixbufContainer::memory_usage`].
+///
+/// Font file data is not included: cosmic-text maps system fonts from disk
+/// and shares them between containers.
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct PixbufMemory {
+    /// The target pixmap.
+    pub pixmap_bytes: usize,
+    /// The cached clip mask, if any.
+    pub clip_mask_bytes: usize,
+    /// Number of decoded images.
+    pub images: usize,
+    /// Decoded image pixels. Shared with tile workers, not copied.
+    pub image_bytes: usize,
+    /// Number of live font handles.
+    pub fonts: usize,
+    /// Font handle bookkeeping.
+    pub font_bytes: usize,
+    /// Faces known to the font database.
+    pub font_faces: usize,
+    /// Rasterized glyphs in the swash cache.
+    pub glyph_cache_bytes: usize,
+    /// Image URLs that are loaded, pending or requested.
+    pub url_bytes: usize,
+}
+
+impl PixbufMemory {
+    pub fn total_bytes(&self) -> usize {
+        self.pixmap_bytes
+            + self.clip_mask_bytes
+            + self.image_bytes
+            + self.font_bytes
+            + self.glyph_cache_bytes
+            + self.url_bytes
+    }
+}
+
+/// One horizontal band of a tiled rasterization.
+#[derive(Debug, Clone)]
+pub struct Tile {
+    /// Top edge in physical pixels.
+    pub y: u32,
+    /// Width in physical pixels.
+    pub width: u32,
+    /// Height in physical pixels.
+    pub height: u32,
+    /// Premultiplied RGBA bytes, `width * height * 4` long.
+    pub pixels: Vec<u8>,
+}
+
+/// `Send` state for building a tile worker's container.
+struct TileSeed {
+    locale: String,
+    db: cosmic_text::fontdb::Database,
+    images: Arc<HashMap<String, tiny_skia::Pixmap>>,
+    width: f32,
+    scale_factor: f32,
+    ignore_overflow_clips: bool,
+}
+
+impl TileSeed {
+    fn into_container(self) -> PixbufContainer {
+        let font_system = cosmic_text::FontSystem::new_with_locale_and_db(self.locale, self.db);
+        let mut container = PixbufContainer::with_font_system(1, 1, self.scale_factor, font_system);
+        container.images = self.images;
+        container.viewport.width = self.width;
+        container.ignore_overflow_clips = self.ignore_overflow_clips;
+        container
+    }
 }
 
 /// Create cosmic-text `Attrs` from internal font data.
@@ -622,8 +994,8 @@ impl DocumentContainer for PixbufContainer {
         let mut swash = self.swash_cache.borrow_mut();
 
         // Scale logical positions from litehtml to physical pixel coords
-        let draw_x = (pos.x * self.scale_factor) as i32;
-        let draw_y = (pos.y * self.scale_factor) as i32;
+        let draw_x = (pos.x * self.scale_factor).floor() as i32;
+        let draw_y = (pos.y * self.scale_factor).floor() as i32;
         let pix_w = self.pixmap.width() as i32;
         let pix_h = self.pixmap.height() as i32;
 
@@ -838,8 +1210,8 @@ impl DocumentContainer for PixbufContainer {
         let border = layer.border_box();
         let s = self.scale_factor;
 
-        let dst_x = (border.x * s) as i32;
-        let dst_y = (border.y * s) as i32;
+        let dst_x = (border.x * s).floor() as i32;
+        let dst_y = (border.y * s).floor() as i32;
 
         let img_paint = tiny_skia::PixmapPaint {
             opacity: 1.0,
@@ -915,7 +1287,7 @@ impl DocumentContainer for PixbufContainer {
         gradient: &LinearGradient,
     ) {
         let points = gradient.color_points();
-        let stops = color_points_to_stops(&points);
+        let stops = color_points_to_stops(points);
 
         if stops.len() < 2 {
             if let Some(cp) = points.first() {
@@ -967,7 +1339,7 @@ impl DocumentContainer for PixbufContainer {
         gradient: &RadialGradient,
     ) {
         let points = gradient.color_points();
-        let stops = color_points_to_stops(&points);
+        let stops = color_points_to_stops(points);
 
         if stops.len() < 2 {
             if let Some(cp) = points.first() {
@@ -1322,6 +1694,89 @@ fn draw_border_side(
     }
 }
 
+/// Shaping-based [`TextMeasure`], from [`PixbufContainer::text_measure`].
+#[derive(Clone)]
+pub struct PixbufTextMeasure {
+    fonts: Rc<RefCell<HashMap<usize, FontData>>>,
+    font_system: Rc<RefCell<cosmic_text::FontSystem>>,
+    scale_factor: f32,
+}
+
+impl PixbufTextMeasure {
+    /// Shape `text` on one line and hand the buffer to `f`. `None` for an
+    /// unknown font.
+    fn shape<R>(
+        &self,
+        text: &str,
+        font: FontHandle,
+        f: impl FnOnce(&cosmic_text::Buffer) -> R,
+    ) -> Option<R> {
+        let fonts = self.fonts.borrow();
+        let font_data = fonts.get(&font.0)?;
+        let mut fs = self.font_system.borrow_mut();
+        let line_height = font_data.metrics.height * self.scale_factor;
+        let metrics = Metrics::new(font_data.size, line_height);
+        let mut buffer = cosmic_text::Buffer::new(&mut fs, metrics);
+        buffer.set_size(&mut fs, Some(f32::MAX), Some(line_height));
+        let attrs = attrs_from_font(font_data);
+        buffer.set_text(&mut fs, text, &attrs, Shaping::Advanced);
+        buffer.shape_until_scroll(&mut fs, false);
+        Some(f(&buffer))
+    }
+}
+
+impl TextMeasure for PixbufTextMeasure {
+    fn text_width(&self, text: &str, font: FontHandle) -> f32 {
+        self.shape(text, font, |buffer| {
+            buffer.layout_runs().map(|run| run.line_w).sum::<f32>() / self.scale_factor
+        })
+        .unwrap_or(text.len() as f32 * 8.0)
+    }
+
+    fn char_offsets(&self, text: &str, font: FontHandle, out: &mut Vec<f32>) {
+        // Glyph byte ranges are relative to each buffer line, so text that
+        // spans lines takes the prefix route.
+        if text.contains(['\n', '\r']) {
+            prefix_offsets(self, text, font, out);
+            return;
+        }
+
+        // Advance owed to the character starting at each byte. A glyph
+        // covering several characters (a ligature) is split evenly.
+        let mut advance = vec![0.0f32; text.len()];
+        let shaped = self.shape(text, font, |buffer| {
+            for run in buffer.layout_runs() {
+                for glyph in run.glyphs {
+                    let Some(cluster) = text.get(glyph.start..glyph.end) else {
+                        continue;
+                    };
+                    let share = glyph.w / cluster.chars().count().max(1) as f32;
+                    for (i, _) in cluster.char_indices() {
+                        advance[glyph.start + i] += share;
+                    }
+                }
+            }
+        });
+        out.clear();
+        if shaped.is_none() {
+            out.extend(
+                text.char_indices()
+                    .map(|(i, c)| (i + c.len_utf8()) as f32 * 8.0),
+            );
+            return;
+        }
+        let mut end = 0.0f32;
+        for (i, _) in text.char_indices() {
+            end += advance[i];
+            out.push(end / self.scale_factor);
+        }
+    }
+
+    fn measures_offsets_in_one_pass(&self) -> bool {
+        true
+    }
+}
+
 /// Build a circle path approximated with cubic beziers.
 fn build_circle_path(cx: f32, cy: f32, r: f32) -> Option<tiny_skia::Path> {
     if r <= 0.0 {
@@ -1385,3 +1840,74 @@ pub fn render_to_rgba_scaled(html: &str, width: u32, height: u32, scale_factor:
     }
     container.pixels().to_vec()
 }
+
+/// Render a whole document to an RGBA pixel buffer, rasterizing it in
+/// parallel tiles.
+///
+/// The document is laid out once at `width` and recorded into a
+/// [`DisplayList`]; tiles of `tile_height` physical pixels are then drawn on
+/// `threads` workers (`0` uses the available parallelism) and stitched
+/// together. Returns the physical width, height and pixels of the full
+/// document, or an empty buffer if the document cannot be created.
+pub fn render_to_rgba_tiled(
+    html: &str,
+    width: u32,
+    scale_factor: f32,
+    tile_height: u32,
+    threads: usize,
+) -> (u32, u32, Vec<u8>) {
+    let mut container = PixbufContainer::new_with_scale(width, 1, scale_factor);
+    let request = LayoutRequest::new(html, width as f32);
+    let Ok(laid) = container.lay_out_page(&request, DEFAULT_VIEWPORT_HEIGHT, scale_factor) else {
+        return (0, 0, Vec::new());
+    };
+
+    let tiles = container.rasterize_tiles(&laid.list, laid.height, tile_height, threads);
+    let phys_w = tiles.first().map_or(0, |t| t.width);
+    let phys_h = tiles.iter().map(|t| t.height).sum();
+    let mut pixels = Vec::with_capacity(phys_w as usize * phys_h as usize * 4);
+    for tile in tiles {
+        pixels.extend_from_slice(&tile.pixels);
+    }
+    (phys_w, phys_h, pixels)
+}
+
+/// Render a whole document to an RGBA pixel buffer, reusing an earlier
+/// render of the same HTML, width and scale from `cache`.
+///
+/// Returns the physical width, height and pixels, like
+/// [`render_to_rgba_tiled`]. A hit costs one file read and decompression;
+/// a miss renders on the calling thread and stores the result; a document
+/// that cannot be created yields an empty buffer and is not stored. Storage
+/// errors are logged and otherwise ignored. The key does not cover images
+/// or fonts: use [`RenderKey`](crate::render_cache::RenderKey) and
+/// [`RenderCache::put_pixels`] directly when those vary.
+#[cfg(all(feature = "pixbuf", feature = "render-cache"))]
+pub fn render_to_rgba_cached(
+    cache: &RenderCache,
+    html: &str,
+    width: u32,
+    scale_factor: f32,
+) -> (u32, u32, Vec<u8>) {
+    let key = RenderKey::new(html)
+        .with_width(width)
+        .with_scale(scale_factor);
+    if let Some(hit) = cache.get_pixels(&key) {
+        return (hit.width, hit.height, hit.pixels);
+    }
+
+    let mut container = PixbufContainer::new_with_scale(width, 1, scale_factor);
+    let request = LayoutRequest::new(html, width as f32);
+    if container
+        .render_page(&request, DEFAULT_VIEWPORT_HEIGHT, scale_factor)
+        .is_err()
+    {
+        return (0, 0, Vec::new());
+    }
+
+    let (phys_w, phys_h) = (container.width(), container.height());
+    if let Err(e) = cache.put_pixels(&key, phys_w, phys_h, container.pixels()) {
+        log::warn!("render cache write failed: {e}");
+    }
+    (phys_w, phys_h, container.pixels().to_vec())
+}
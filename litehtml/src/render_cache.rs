@@ -0,0 +1,705 @@
+//! Content-addressed on-disk cache of rendered output.
+//!
+//! A [`RenderKey`] digests (SHA-256) everything that determines the pixels of a
+//! render: the prepared HTML, the bytes of every resolved image, the width,
+//! the scale factor, a caller-chosen font-set version, and the library
+//! version. A [`RenderCache`] maps keys to files in one directory, holding
+//! either caller-encoded output (PNG, JPEG, ...) or run-length compressed
+//! RGBA pixels, and evicts least recently used entries once the directory
+//! grows past its byte budget.
+//!
+//! ```ignore
+//! let cache = RenderCache::open("/var/cache/mail-render", 2 << 30)?;
+//! let key = RenderKey::new(&prepared.html)
+//!     .with_images(prepared.images.iter().map(|i| (i.url.as_str(), i.data.as_slice())))
+//!     .with_width(800)
+//!     .with_scale(2.0)
+//!     .with_font_set(FONTS_VERSION);
+//! let png = match cache.get_encoded(&key) {
+//!     Some(png) => png,
+//!     None => {
+//!         let png = render_png(&prepared);
+//!         cache.put_encoded(&key, &png)?;
+//!         png
+//!     }
+//! };
+//! ```
+//!
+//! Entries are written to a temporary file and renamed into place, so
+//! several processes can share one directory; each keeps its own LRU order
+//! and byte count, refreshed from file modification times when opened.
+//! Temporary files left behind by a crashed writer are swept on open.
+
+use std::collections::{BTreeMap, HashMap};
+use std::fs;
+use std::io::{self, Write};
+use std::path::{Path, PathBuf};
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::{Mutex, MutexGuard};
+use std::time::{Duration, SystemTime};
+
+use sha2::{Digest as _, Sha256};
+
+/// Leading bytes of a cache entry.
+const MAGIC: &[u8; 4] = b"LHRC";
+
+/// Current entry layout. Bump whenever the file format changes.
+const VERSION: u8 = 2;
+
+/// Magic, version, kind, width and height.
+const HEADER_LEN: usize = 4 + 1 + 1 + 4 + 4;
+
+const KIND_ENCODED: u8 = 0;
+const KIND_PIXELS: u8 = 1;
+
+/// File extension of cache entries.
+const EXTENSION: &str = "lhrc";
+
+/// Temporary files older than this belong to a crashed writer.
+const STALE_TMP: Duration = Duration::from_secs(600);
+
+/// SHA-256 digest. The cache may be shared between users, so keys must not
+/// be forgeable: a collision would serve one user's render to another.
+pub type Digest = [u8; 32];
+
+/// Hash a length-prefixed field, so adjacent fields cannot run together.
+fn field(h: &mut Sha256, bytes: &[u8]) {
+    h.update((bytes.len() as u64).to_le_bytes());
+    h.update(bytes);
+}
+
+/// Identity of one render, built from its inputs.
+///
+/// Images are hashed by URL and content and may be added in any order.
+/// Anything else that changes the output (a custom master stylesheet, the
+/// viewport height of a fixed-size render, container options) belongs in
+/// [`with_variant`](Self::with_variant).
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct RenderKey {
+    html: Digest,
+    images: Vec<Digest>,
+    width: u32,
+    scale_bits: u32,
+    font_set: u64,
+    variant: Digest,
+}
+
+impl RenderKey {
+    /// Key for `html` at width 0, scale 1, font set 0 and no images.
+    pub fn new(html: &str) -> Self {
+        Self {
+            html: Sha256::digest(html.as_bytes()).into(),
+            images: Vec::new(),
+            width: 0,
+            scale_bits: 1.0f32.to_bits(),
+            font_set: 0,
+            variant: Digest::default(),
+        }
+    }
+
+    /// Add one resolved image.
+    pub fn with_image(mut self, url: &str, data: &[u8]) -> Self {
+        let mut h = Sha256::new();
+        field(&mut h, url.as_bytes());
+        field(&mut h, data);
+        self.images.push(h.finalize().into());
+        self
+    }
+
+    /// Add several resolved images as `(url, data)` pairs.
+    pub fn with_images<'d>(self, images: impl IntoIterator<Item = (&'d str, &'d [u8])>) -> Self {
+        images
+            .into_iter()
+            .fold(self, |key, (url, data)| key.with_image(url, data))
+    }
+
+    /// Layout width in CSS pixels.
+    pub fn with_width(mut self, width: u32) -> Self {
+        self.width = width;
+        self
+    }
+
+    /// Device scale factor.
+    pub fn with_scale(mut self, scale: f32) -> Self {
+        self.scale_bits = scale.to_bits();
+        self
+    }
+
+    /// Version of the installed fonts. Bump it whenever the fonts available
+    /// to the renderer change, since text metrics and glyphs change with
+    /// them.
+    pub fn with_font_set(mut self, version: u64) -> Self {
+        self.font_set = version;
+        self
+    }
+
+    /// Fold arbitrary extra input into the key.
+    pub fn with_variant(mut self, bytes: &[u8]) -> Self {
+        let mut h = Sha256::new();
+        h.update(self.variant);
+        field(&mut h, bytes);
+        self.variant = h.finalize().into();
+        self
+    }
+
+    /// Digest of every input plus the library version.
+    pub fn digest(&self) -> Digest {
+        let mut images = self.images.clone();
+        images.sort_unstable();
+
+        let mut h = Sha256::new();
+        field(&mut h, env!("CARGO_PKG_VERSION").as_bytes());
+        h.update(self.html);
+        h.update((images.len() as u64).to_le_bytes());
+        for image in images {
+            h.update(image);
+        }
+        h.update(self.width.to_le_bytes());
+        h.update(self.scale_bits.to_le_bytes());
+        h.update(self.font_set.to_le_bytes());
+        h.update(self.variant);
+        h.finalize().into()
+    }
+}
+
+/// Pixels read back from a [`RenderCache`].
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct CachedPixels {
+    /// Width in physical pixels.
+    pub width: u32,
+    /// Height in physical pixels.
+    pub height: u32,
+    /// Premultiplied RGBA8, `width * height * 4` bytes.
+    pub pixels: Vec<u8>,
+}
+
+/// Counters of a [`RenderCache`] since it was opened.
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct RenderCacheStats {
+    pub hits: u64,
+    pub misses: u64,
+    pub insertions: u64,
+    pub evictions: u64,
+    /// Entries currently indexed.
+    pub entries: usize,
+    /// Bytes on disk of the indexed entries.
+    pub bytes: u64,
+}
+
+struct Entry {
+    size: u64,
+    tick: u64,
+}
+
+/// LRU bookkeeping: entries by digest and digests by last use.
+#[derive(Default)]
+struct Index {
+    entries: HashMap<Digest, Entry>,
+    order: BTreeMap<u64, Digest>,
+    bytes: u64,
+    tick: u64,
+}
+
+impl Index {
+    fn touch(&mut self, digest: Digest) {
+        self.tick += 1;
+        let tick = self.tick;
+        if let Some(entry) = self.entries.get_mut(&digest) {
+            self.order.remove(&entry.tick);
+            entry.tick = tick;
+            self.order.insert(tick, digest);
+        }
+    }
+
+    fn insert(&mut self, digest: Digest, size: u64) {
+        self.remove(digest);
+        self.tick += 1;
+        self.entries.insert(
+            digest,
+            Entry {
+                size,
+                tick: self.tick,
+            },
+        );
+        self.order.insert(self.tick, digest);
+        self.bytes += size;
+    }
+
+    fn remove(&mut self, digest: Digest) {
+        if let Some(entry) = self.entries.remove(&digest) {
+            self.order.remove(&entry.tick);
+            self.bytes -= entry.size;
+        }
+    }
+
+    fn oldest(&self) -> Option<Digest> {
+        self.order.values().next().copied()
+    }
+}
+
+/// Size-bounded, least-recently-used render cache in a directory.
+///
+/// All methods take `&self`; the cache can be shared between threads.
+/// Lookups never fail: a missing, truncated or corrupt entry is a miss
+/// (and a corrupt one is deleted).
+pub struct RenderCache {
+    dir: PathBuf,
+    max_bytes: u64,
+    index: Mutex<Index>,
+    hits: AtomicU64,
+    misses: AtomicU64,
+    insertions: AtomicU64,
+    evictions: AtomicU64,
+}
+
+impl RenderCache {
+    /// Open or create the cache at `dir`, keeping at most `max_bytes` of
+    /// entries on disk. Existing entries are indexed oldest first by
+    /// modification time, and evicted at once if they exceed the budget.
+    /// Temporary files untouched for ten minutes are deleted.
+    pub fn open(dir: impl AsRef<Path>, max_bytes: u64) -> io::Result<Self> {
+        let dir = dir.as_ref().to_path_buf();
+        fs::create_dir_all(&dir)?;
+
+        let mut found = Vec::new();
+        for item in fs::read_dir(&dir)? {
+            let item = item?;
+            let path = item.path();
+            let meta = item.metadata()?;
+            let mtime = meta.modified().unwrap_or(SystemTime::UNIX_EPOCH);
+            if path.extension().is_some_and(|ext| ext == "tmp") {
+                // Another process may still be writing a fresh one.
+                let age = SystemTime::now().duration_since(mtime).unwrap_or_default();
+                if age > STALE_TMP {
+                    let _ = fs::remove_file(&path);
+                }
+                continue;
+            }
+            let Some(digest) = parse_file_name(&path) else {
+                continue;
+            };
+            found.push((mtime, digest, meta.len()));
+        }
+        found.sort();
+
+        let mut index = Index::default();
+        for (_, digest, size) in found {
+            index.insert(digest, size);
+        }
+        let cache = Self {
+            dir,
+            max_bytes,
+            index: Mutex::new(index),
+            hits: AtomicU64::new(0),
+            misses: AtomicU64::new(0),
+            insertions: AtomicU64::new(0),
+            evictions: AtomicU64::new(0),
+        };
+        cache.evict(&mut cache.lock());
+        Ok(cache)
+    }
+
+    /// Encoded output stored under `key` by [`put_encoded`](Self::put_encoded).
+    pub fn get_encoded(&self, key: &RenderKey) -> Option<Vec<u8>> {
+        let (kind, _, _, mut bytes) = self.read(key)?;
+        if kind != KIND_ENCODED {
+            return self.miss();
+        }
+        bytes.drain(..HEADER_LEN);
+        self.hits.fetch_add(1, Ordering::Relaxed);
+        Some(bytes)
+    }
+
+    /// Store encoded output (PNG, JPEG, ...) under `key`.
+    pub fn put_encoded(&self, key: &RenderKey, data: &[u8]) -> io::Result<()> {
+        self.write(key, KIND_ENCODED, 0, 0, data)
+    }
+
+    /// Pixels stored under `key` by [`put_pixels`](Self::put_pixels).
+    pub fn get_pixels(&self, key: &RenderKey) -> Option<CachedPixels> {
+        let (kind, width, height, bytes) = self.read(key)?;
+        if kind != KIND_PIXELS {
+            return self.miss();
+        }
+        let pixels = (width as usize)
+            .checked_mul(height as usize)
+            .and_then(|n| n.checked_mul(4))
+            .and_then(|len| rle_decode(&bytes[HEADER_LEN..], len));
+        match pixels {
+            Some(pixels) => {
+                self.hits.fetch_add(1, Ordering::Relaxed);
+                Some(CachedPixels {
+                    width,
+                    height,
+                    pixels,
+                })
+            }
+            None => {
+                self.discard(key.digest());
+                self.miss()
+            }
+        }
+    }
+
+    /// Store premultiplied RGBA pixels under `key`, run-length compressed.
+    ///
+    /// # Panics
+    ///
+    /// If `pixels` is not `width * height * 4` bytes long.
+    pub fn put_pixels(
+        &self,
+        key: &RenderKey,
+        width: u32,
+        height: u32,
+        pixels: &[u8],
+    ) -> io::Result<()> {
+        assert_eq!(pixels.len(), width as usize * height as usize * 4);
+        self.write(key, KIND_PIXELS, width, height, &rle_encode(pixels))
+    }
+
+    /// Remove the entry for `key`, if any.
+    pub fn remove(&self, key: &RenderKey) -> io::Result<()> {
+        let digest = key.digest();
+        self.lock().remove(digest);
+        match fs::remove_file(self.path(digest)) {
+            Err(e) if e.kind() != io::ErrorKind::NotFound => Err(e),
+            _ => Ok(()),
+        }
+    }
+
+    /// Counters since the cache was opened.
+    pub fn stats(&self) -> RenderCacheStats {
+        let index = self.lock();
+        RenderCacheStats {
+            hits: self.hits.load(Ordering::Relaxed),
+            misses: self.misses.load(Ordering::Relaxed),
+            insertions: self.insertions.load(Ordering::Relaxed),
+            evictions: self.evictions.load(Ordering::Relaxed),
+            entries: index.entries.len(),
+            bytes: index.bytes,
+        }
+    }
+
+    fn lock(&self) -> MutexGuard<'_, Index> {
+        self.index.lock().unwrap_or_else(|e| e.into_inner())
+    }
+
+    fn path(&self, digest: Digest) -> PathBuf {
+        self.dir.join(format!("{}.{EXTENSION}", hex(&digest)))
+    }
+
+    fn miss<T>(&self) -> Option<T> {
+        self.misses.fetch_add(1, Ordering::Relaxed);
+        None
+    }
+
+    /// Read and validate an entry: kind, width, height and the whole file.
+    fn read(&self, key: &RenderKey) -> Option<(u8, u32, u32, Vec<u8>)> {
+        let digest = key.digest();
+        let path = self.path(digest);
+        let bytes = match fs::read(&path) {
+            Ok(bytes) => bytes,
+            Err(_) => {
+                // Evicted by another process sharing the directory.
+                self.lock().remove(digest);
+                return self.miss();
+            }
+        };
+        if bytes.len() < HEADER_LEN || &bytes[..4] != MAGIC || bytes[4] != VERSION {
+            self.discard(digest);
+            return self.miss();
+        }
+        let kind = bytes[5];
+        let width = u32::from_le_bytes(bytes[6..10].try_into().unwrap());
+        let height = u32::from_le_bytes(bytes[10..14].try_into().unwrap());
+
+        {
+            let mut index = self.lock();
+            if !index.entries.contains_key(&digest) {
+                // Written by another process since this one opened the cache.
+                index.insert(digest, bytes.len() as u64);
+            }
+            index.touch(digest);
+            self.evict(&mut index);
+        }
+        // Persist recency so the order survives a restart.
+        if let Ok(file) = fs::File::options().write(true).open(&path) {
+            let _ = file.set_modified(SystemTime::now());
+        }
+        Some((kind, width, height, bytes))
+    }
+
+    fn write(
+        &self,
+        key: &RenderKey,
+        kind: u8,
+        width: u32,
+        height: u32,
+        payload: &[u8],
+    ) -> io::Result<()> {
+        let digest = key.digest();
+        let size = (HEADER_LEN + payload.len()) as u64;
+        if size > self.max_bytes {
+            return Ok(());
+        }
+
+        // Write beside the final path and rename, so readers never observe a
+        // partial entry.
+        static SEQUENCE: AtomicU64 = AtomicU64::new(0);
+        let tmp = self.dir.join(format!(
+            "{}.{}-{}.tmp",
+            hex(&digest),
+            std::process::id(),
+            SEQUENCE.fetch_add(1, Ordering::Relaxed)
+        ));
+        let result = (|| {
+            let mut file = fs::File::create(&tmp)?;
+            let mut header = [0u8; HEADER_LEN];
+            header[..4].copy_from_slice(MAGIC);
+            header[4] = VERSION;
+            header[5] = kind;
+            header[6..10].copy_from_slice(&width.to_le_bytes());
+            header[10..14].copy_from_slice(&height.to_le_bytes());
+            file.write_all(&header)?;
+            file.write_all(payload)?;
+            fs::rename(&tmp, self.path(digest))
+        })();
+        if result.is_err() {
+            let _ = fs::remove_file(&tmp);
+            return result;
+        }
+
+        let mut index = self.lock();
+        index.insert(digest, size);
+        self.insertions.fetch_add(1, Ordering::Relaxed);
+        self.evict(&mut index);
+        Ok(())
+    }
+
+    /// Delete a corrupt entry.
+    fn discard(&self, digest: Digest) {
+        self.lock().remove(digest);
+        let _ = fs::remove_file(self.path(digest));
+    }
+
+    /// Delete least recently used entries until the budget is met.
+    fn evict(&self, index: &mut Index) {
+        while index.bytes > self.max_bytes {
+            let Some(digest) = index.oldest() else {
+                break;
+            };
+            index.remove(digest);
+            let _ = fs::remove_file(self.path(digest));
+            self.evictions.fetch_add(1, Ordering::Relaxed);
+        }
+    }
+}
+
+fn hex(digest: &Digest) -> String {
+    digest.iter().map(|b| format!("{b:02x}")).collect()
+}
+
+/// Digest from a `<64 hex digits>.lhrc` file name.
+fn parse_file_name(path: &Path) -> Option<Digest> {
+    if path.extension()? != EXTENSION {
+        return None;
+    }
+    let stem = path.file_stem()?.to_str()?;
+    if stem.len() != 64 || !stem.is_ascii() {
+        return None;
+    }
+    let mut digest = Digest::default();
+    for (byte, pair) in digest.iter_mut().zip(stem.as_bytes().chunks_exact(2)) {
+        *byte = u8::from_str_radix(std::str::from_utf8(pair).ok()?, 16).ok()?;
+    }
+    Some(digest)
+}
+
+/// Longest run a single control byte can describe.
+const MAX_RUN: usize = 128;
+
+/// Run-length encode RGBA pixels. Each control byte `c` is followed by
+/// either `c + 1` literal pixels (`c < 128`) or one pixel repeated
+/// `c - 126` times (`c >= 128`, runs of 2 to 129). Rendered pages are
+/// mostly flat background, which this collapses to a few bytes per row.
+fn rle_encode(pixels: &[u8]) -> Vec<u8> {
+    let px: Vec<&[u8]> = pixels.chunks_exact(4).collect();
+    let mut out = Vec::with_capacity(pixels.len() / 8);
+    let mut i = 0;
+    while i < px.len() {
+        let mut run = 1;
+        while i + run < px.len() && run < MAX_RUN + 1 && px[i + run] == px[i] {
+            run += 1;
+        }
+        if run >= 2 {
+            out.push((run + 126) as u8);
+            out.extend_from_slice(px[i]);
+            i += run;
+            continue;
+        }
+        // Literal stretch up to the next pair of equal pixels.
+        let start = i;
+        while i < px.len() && i - start < MAX_RUN && !(i + 1 < px.len() && px[i + 1] == px[i]) {
+            i += 1;
+        }
+        out.push((i - start - 1) as u8);
+        for p in &px[start..i] {
+            out.extend_from_slice(p);
+        }
+    }
+    out
+}
+
+/// Inverse of [`rle_encode`]. `None` unless the data decodes to exactly
+/// `len` bytes. `len` comes from the entry header, so it is checked against
+/// the most `data` can expand to (every 5 bytes a run of 129 pixels) before
+/// anything is allocated.
+fn rle_decode(data: &[u8], len: usize) -> Option<Vec<u8>> {
+    if len > data.len() / 5 * (MAX_RUN + 1) * 4 {
+        return None;
+    }
+    let mut out = Vec::with_capacity(len);
+    let mut i = 0;
+    while i < data.len() {
+        let c = data[i] as usize;
+        i += 1;
+        if c < 128 {
+            let n = (c + 1) * 4;
+            out.extend_from_slice(data.get(i..i + n)?);
+            i += n;
+        } else {
+            let px = data.get(i..i + 4)?;
+            for _ in 0..c - 126 {
+                out.extend_from_slice(px);
+            }
+            i += 4;
+        }
+        if out.len() > len {
+            return None;
+        }
+    }
+    (out.len() == len).then_some(out)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn temp_dir(name: &str) -> PathBuf {
+        let dir = std::env::temp_dir().join(format!("litehtml-{name}-{}", std::process::id()));
+        let _ = fs::remove_dir_all(&dir);
+        dir
+    }
+
+    #[test]
+    fn test_rle_roundtrip() {
+        let mut pixels = vec![255u8; 300 * 4];
+        for (i, b) in pixels[40..400].iter_mut().enumerate() {
+            *b = (i * 7) as u8;
+        }
+        pixels[1000..1004].copy_from_slice(&[1, 2, 3, 4]);
+        let encoded = rle_encode(&pixels);
+        assert!(encoded.len() < pixels.len() / 2);
+        assert_eq!(
+            rle_decode(&encoded, pixels.len()).as_deref(),
+            Some(&pixels[..])
+        );
+        assert_eq!(rle_decode(&encoded, pixels.len() - 4), None);
+        assert_eq!(
+            rle_decode(&encoded[..encoded.len() - 1], pixels.len()),
+            None
+        );
+    }
+
+    #[test]
+    fn test_key_inputs() {
+        let base = RenderKey::new("<p>x</p>").with_width(800);
+        let a = base.clone().with_image("a", b"1").with_image("b", b"2");
+        let b = base.clone().with_image("b", b"2").with_image("a", b"1");
+        assert_eq!(a.digest(), b.digest());
+        assert_ne!(base.digest(), a.digest());
+        assert_ne!(base.digest(), base.clone().with_scale(2.0).digest());
+        assert_ne!(base.digest(), base.clone().with_font_set(1).digest());
+        assert_ne!(base.digest(), base.clone().with_variant(b"h=600").digest());
+        assert_ne!(
+            base.clone().with_image("ab", b"c").digest(),
+            base.clone().with_image("a", b"bc").digest()
+        );
+    }
+
+    #[test]
+    fn test_cache_lru_eviction() {
+        let dir = temp_dir("render-cache");
+        let key = |i: u32| RenderKey::new("<p>x</p>").with_width(i);
+        let blob = vec![7u8; 1000];
+        let entry = (HEADER_LEN + blob.len()) as u64;
+        let cache = RenderCache::open(&dir, entry * 3).unwrap();
+
+        for i in 0..3 {
+            cache.put_encoded(&key(i), &blob).unwrap();
+        }
+        // Using entry 0 makes entry 1 the least recently used.
+        assert_eq!(cache.get_encoded(&key(0)).as_deref(), Some(&blob[..]));
+        cache.put_encoded(&key(3), &blob).unwrap();
+        assert!(cache.get_encoded(&key(1)).is_none());
+        assert!(cache.get_encoded(&key(0)).is_some());
+
+        let pixels: Vec<u8> = (0..16 * 16 * 4).map(|i| (i / 64) as u8).collect();
+        cache.put_pixels(&key(9), 16, 16, &pixels).unwrap();
+        let hit = cache.get_pixels(&key(9)).unwrap();
+        assert_eq!((hit.width, hit.height), (16, 16));
+        assert_eq!(hit.pixels, pixels);
+        assert!(cache.get_encoded(&key(9)).is_none());
+
+        let stats = cache.stats();
+        assert!(stats.bytes <= entry * 3);
+        assert!(stats.evictions >= 1);
+        drop(cache);
+
+        // Reopening indexes what is on disk.
+        let cache = RenderCache::open(&dir, entry * 3).unwrap();
+        assert_eq!(cache.stats().entries, stats.entries);
+        assert_eq!(cache.get_pixels(&key(9)).unwrap().pixels, pixels);
+        let _ = fs::remove_dir_all(&dir);
+    }
+
+    #[test]
+    fn test_cache_bad_entries() {
+        let dir = temp_dir("render-cache-bad");
+        let cache = RenderCache::open(&dir, 1 << 20).unwrap();
+        let key = RenderKey::new("<p>x</p>");
+        let pixels = vec![9u8; 8 * 8 * 4];
+
+        // Asking for the other kind is a miss that keeps the entry.
+        cache.put_encoded(&key, b"png").unwrap();
+        assert!(cache.get_pixels(&key).is_none());
+        assert_eq!(cache.get_encoded(&key).as_deref(), Some(&b"png"[..]));
+
+        // A header claiming more pixels than the payload can hold is
+        // rejected before anything is allocated, and the entry is dropped.
+        cache.put_pixels(&key, 8, 8, &pixels).unwrap();
+        let path = cache.path(key.digest());
+        let mut bytes = fs::read(&path).unwrap();
+        bytes[6..14].copy_from_slice(&[0xff; 8]);
+        fs::write(&path, &bytes).unwrap();
+        assert!(cache.get_pixels(&key).is_none());
+        assert!(!path.exists());
+
+        // Temporary files are swept on open once they are stale.
+        let stale = dir.join("orphan.1-0.tmp");
+        let fresh = dir.join("orphan.1-1.tmp");
+        fs::write(&stale, b"x").unwrap();
+        fs::write(&fresh, b"x").unwrap();
+        fs::File::options()
+            .write(true)
+            .open(&stale)
+            .unwrap()
+            .set_modified(SystemTime::now() - STALE_TMP * 2)
+            .unwrap();
+        drop(cache);
+        let _cache = RenderCache::open(&dir, 1 << 20).unwrap();
+        assert!(!stale.exists());
+        assert!(fresh.exists());
+        let _ = fs::remove_dir_all(&dir);
+    }
+}
@@ -0,0 +1,572 @@
+//! Priority- and deadline-aware scheduling of render work.
+//!
+//! A [`RenderQueue`] runs [`RenderJob`]s on a fixed set of worker threads.
+//! Jobs are split into phases: [`RenderJob::step`] runs one phase and either
+//! yields or finishes. Between phases a worker checks whether a job of
+//! higher [`Priority`] is waiting. If so, it parks the current job in its own
+//! local queue and switches. An interactive request therefore waits at most
+//! one phase of background work instead of a whole batch.
+//!
+//! Scheduling order is priority first, then earliest deadline, then
+//! submission order. A worker takes the best job from either the shared
+//! queue or its own parked jobs. When both are empty it steals parked jobs
+//! from other workers, so a preempted job never waits on a busy thread. A job
+//! whose deadline has passed is dropped at the next phase boundary and
+//! reported as [`JobError::DeadlineExceeded`].
+//!
+//! [`DocumentJob`] wraps the common case of laying a document out (phase 1)
+//! and rasterizing its display list (phase 2):
+//!
+//! ```ignore
+//! let queue = RenderQueue::new(4);
+//! let job = DocumentJob::new(html, 800.0, || PixbufContainer::new(800, 600), |laid: LaidOut| {
+//!     let mut pixbuf = PixbufContainer::new(800, laid.height.ceil() as u32);
+//!     laid.list.replay(&mut pixbuf, DrawContext::default(), 0.0, 0.0, None);
+//!     pixbuf.pixels().to_vec()
+//! });
+//! let pixels = queue.submit(Priority::Interactive, None, job).wait()??;
+//! ```
+
+use std::collections::BinaryHeap;
+use std::panic::{catch_unwind, AssertUnwindSafe};
+use std::sync::atomic::{AtomicBool, AtomicU64, Ordering};
+use std::sync::mpsc::{self, Receiver, Sender};
+use std::sync::{Arc, Condvar, Mutex, MutexGuard};
+use std::thread::JoinHandle;
+use std::time::Instant;
+
+use crate::pipeline::{lay_out, LaidOut, LayoutRequest};
+use crate::{CreateError, DocumentContainer};
+
+/// Scheduling class of a job. Higher classes run first and preempt lower
+/// ones at phase boundaries.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, PartialOrd, Ord, Hash, Default)]
+pub enum Priority {
+    /// Backfill and other work nobody is waiting on.
+    Background,
+    #[default]
+    Normal,
+    /// A user is waiting for this result.
+    Interactive,
+}
+
+/// Outcome of one [`RenderJob::step`].
+#[derive(Debug)]
+pub enum Step<T> {
+    /// The phase finished; call `step` again to run the next one.
+    Yield,
+    /// The job is complete.
+    Done(T),
+}
+
+/// Work that can be run by a [`RenderQueue`], one phase at a time.
+///
+/// Jobs must be `Send` because a parked job may resume on another worker.
+/// Anything kept between phases (for example a
+/// [`DisplayList`](crate::display_list::DisplayList)) must be owned; a
+/// [`Document`](crate::Document) has to be created and dropped within a
+/// single phase.
+pub trait RenderJob: Send + 'static {
+    type Output: Send + 'static;
+
+    /// Run the next phase.
+    fn step(&mut self) -> Step<Self::Output>;
+}
+
+/// Why a job produced no output.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum JobError {
+    /// The deadline passed before the job finished.
+    DeadlineExceeded,
+    /// The job panicked.
+    Panicked,
+    /// The queue shut down before the result was delivered.
+    Cancelled,
+}
+
+impl std::fmt::Display for JobError {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        match self {
+            Self::DeadlineExceeded => write!(f, "render job missed its deadline"),
+            Self::Panicked => write!(f, "render job panicked"),
+            Self::Cancelled => write!(f, "render job was cancelled"),
+        }
+    }
+}
+
+impl std::error::Error for JobError {}
+
+/// Receives the result of a submitted job.
+pub struct JobHandle<T> {
+    rx: Receiver<Result<T, JobError>>,
+}
+
+impl<T> JobHandle<T> {
+    /// Block until the job finishes.
+    pub fn wait(self) -> Result<T, JobError> {
+        self.rx.recv().unwrap_or(Err(JobError::Cancelled))
+    }
+
+    /// Return the result if the job has finished, or `None` if it is still
+    /// queued or running.
+    pub fn try_wait(&self) -> Option<Result<T, JobError>> {
+        match self.rx.try_recv() {
+            Ok(result) => Some(result),
+            Err(mpsc::TryRecvError::Empty) => None,
+            Err(mpsc::TryRecvError::Disconnected) => Some(Err(JobError::Cancelled)),
+        }
+    }
+}
+
+/// Lay a document out against a measuring container, then rasterize the
+/// recorded display list. Each of the two is one phase, so higher-priority
+/// work can run in between.
+pub struct DocumentJob<M, R> {
+    html: String,
+    width: f32,
+    measure: Option<M>,
+    raster: Option<R>,
+    laid: Option<LaidOut>,
+}
+
+impl<M, R> DocumentJob<M, R> {
+    /// `measure` creates the container used for layout on whichever worker
+    /// runs the first phase; `raster` turns the result into the output.
+    pub fn new(html: impl Into<String>, width: f32, measure: M, raster: R) -> Self {
+        Self {
+            html: html.into(),
+            width,
+            measure: Some(measure),
+            raster: Some(raster),
+            laid: None,
+        }
+    }
+}
+
+impl<C, M, R, T> RenderJob for DocumentJob<M, R>
+where
+    C: DocumentContainer,
+    M: FnOnce() -> C + Send + 'static,
+    R: FnOnce(LaidOut) -> T + Send + 'static,
+    T: Send + 'static,
+{
+    type Output = Result<T, CreateError>;
+
+    fn step(&mut self) -> Step<Self::Output> {
+        if let Some(measure) = self.measure.take() {
+            let mut container = measure();
+            return match lay_out(&LayoutRequest::new(&self.html, self.width), &mut container) {
+                Ok(laid) => {
+                    self.laid = Some(laid);
+                    Step::Yield
+                }
+                Err(e) => Step::Done(Err(e)),
+            };
+        }
+        let raster = self
+            .raster
+            .take()
+            .expect("DocumentJob stepped after completion");
+        let laid = self
+            .laid
+            .take()
+            .expect("DocumentJob stepped after completion");
+        Step::Done(Ok(raster(laid)))
+    }
+}
+
+/// Single-phase job built from a closure by [`RenderQueue::submit_fn`].
+struct FnJob<F>(Option<F>);
+
+impl<F, T> RenderJob for FnJob<F>
+where
+    F: FnOnce() -> T + Send + 'static,
+    T: Send + 'static,
+{
+    type Output = T;
+
+    fn step(&mut self) -> Step<T> {
+        let f = self.0.take().expect("FnJob stepped after completion");
+        Step::Done(f())
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Scheduling
+// ---------------------------------------------------------------------------
+
+/// Type-erased job plus its result channel.
+trait Erased: Send {
+    /// Run one phase; returns `true` once the result has been delivered.
+    fn step(&mut self) -> bool;
+    fn fail(&mut self, error: JobError);
+}
+
+struct Slot<J: RenderJob> {
+    job: J,
+    tx: Sender<Result<J::Output, JobError>>,
+}
+
+impl<J: RenderJob> Erased for Slot<J> {
+    fn step(&mut self) -> bool {
+        match self.job.step() {
+            Step::Yield => false,
+            Step::Done(output) => {
+                let _ = self.tx.send(Ok(output));
+                true
+            }
+        }
+    }
+
+    fn fail(&mut self, error: JobError) {
+        let _ = self.tx.send(Err(error));
+    }
+}
+
+/// Scheduling key. Greater keys run first.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+struct Key {
+    priority: Priority,
+    deadline: Option<Instant>,
+    seq: u64,
+}
+
+impl Ord for Key {
+    fn cmp(&self, other: &Self) -> std::cmp::Ordering {
+        use std::cmp::Ordering::*;
+        self.priority
+            .cmp(&other.priority)
+            .then_with(|| match (self.deadline, other.deadline) {
+                (Some(a), Some(b)) => b.cmp(&a),
+                (Some(_), None) => Greater,
+                (None, Some(_)) => Less,
+                (None, None) => Equal,
+            })
+            .then_with(|| other.seq.cmp(&self.seq))
+    }
+}
+
+impl PartialOrd for Key {
+    fn partial_cmp(&self, other: &Self) -> Option<std::cmp::Ordering> {
+        Some(self.cmp(other))
+    }
+}
+
+struct Entry {
+    key: Key,
+    job: Box<dyn Erased>,
+}
+
+impl PartialEq for Entry {
+    fn eq(&self, other: &Self) -> bool {
+        self.key == other.key
+    }
+}
+
+impl Eq for Entry {}
+
+impl Ord for Entry {
+    fn cmp(&self, other: &Self) -> std::cmp::Ordering {
+        self.key.cmp(&other.key)
+    }
+}
+
+impl PartialOrd for Entry {
+    fn partial_cmp(&self, other: &Self) -> Option<std::cmp::Ordering> {
+        Some(self.cmp(other))
+    }
+}
+
+/// State shared by the queue and its workers. Lock order is always
+/// `global` before any entry of `parked`.
+struct Shared {
+    global: Mutex<BinaryHeap<Entry>>,
+    /// Jobs preempted at a phase boundary, one heap per worker.
+    parked: Vec<Mutex<BinaryHeap<Entry>>>,
+    ready: Condvar,
+    shutdown: AtomicBool,
+}
+
+fn lock<T>(m: &Mutex<T>) -> MutexGuard<'_, T> {
+    m.lock().unwrap_or_else(|e| e.into_inner())
+}
+
+impl Shared {
+    /// Best waiting job for worker `me`: its own parked jobs or the shared
+    /// queue, then jobs parked on other workers. Blocks while there is
+    /// nothing to do; returns `None` on shutdown once all work is drained.
+    fn next(&self, me: usize) -> Option<Entry> {
+        let mut global = lock(&self.global);
+        loop {
+            {
+                let mut own = lock(&self.parked[me]);
+                let take_own = match (own.peek(), global.peek()) {
+                    (Some(a), Some(b)) => a.key > b.key,
+                    (Some(_), None) => true,
+                    (None, _) => false,
+                };
+                if take_own {
+                    return own.pop();
+                }
+            }
+            if let Some(entry) = global.pop() {
+                return Some(entry);
+            }
+            if let Some(entry) = self.steal(me) {
+                return Some(entry);
+            }
+            if self.shutdown.load(Ordering::Acquire) {
+                return None;
+            }
+            global = self.ready.wait(global).unwrap_or_else(|e| e.into_inner());
+        }
+    }
+
+    /// Take the best job parked on any other worker.
+    fn steal(&self, me: usize) -> Option<Entry> {
+        let victim = (0..self.parked.len())
+            .filter(|&i| i != me)
+            .filter_map(|i| lock(&self.parked[i]).peek().map(|e| (e.key, i)))
+            .max_by_key(|&(key, _)| key)?
+            .1;
+        lock(&self.parked[victim]).pop()
+    }
+
+    /// Whether a job of higher priority than `key` is waiting anywhere.
+    fn should_preempt(&self, key: &Key) -> bool {
+        let higher = |e: Option<&Entry>| e.is_some_and(|e| e.key.priority > key.priority);
+        let global = lock(&self.global);
+        higher(global.peek()) || self.parked.iter().any(|p| higher(lock(p).peek()))
+    }
+
+    fn park(&self, me: usize, entry: Entry) {
+        let _global = lock(&self.global);
+        lock(&self.parked[me]).push(entry);
+        self.ready.notify_one();
+    }
+}
+
+fn run_worker(shared: &Shared, me: usize) {
+    while let Some(mut entry) = shared.next(me) {
+        loop {
+            if entry.key.deadline.is_some_and(|d| Instant::now() >= d) {
+                entry.job.fail(JobError::DeadlineExceeded);
+                break;
+            }
+            match catch_unwind(AssertUnwindSafe(|| entry.job.step())) {
+                Ok(true) => break,
+                Ok(false) => {}
+                Err(_) => {
+                    entry.job.fail(JobError::Panicked);
+                    break;
+                }
+            }
+            if shared.should_preempt(&entry.key) {
+                shared.park(me, entry);
+                break;
+            }
+        }
+    }
+}
+
+/// A pool of workers that runs [`RenderJob`]s by priority and deadline.
+/// See the [module docs](self).
+///
+/// Dropping the queue waits for every submitted job to finish.
+pub struct RenderQueue {
+    shared: Arc<Shared>,
+    seq: AtomicU64,
+    workers: Vec<JoinHandle<()>>,
+}
+
+impl RenderQueue {
+    /// Start `workers` threads (`0` uses the available parallelism).
+    pub fn new(workers: usize) -> Self {
+        let workers = match workers {
+            0 => std::thread::available_parallelism().map_or(1, |n| n.get()),
+            n => n,
+        };
+        let shared = Arc::new(Shared {
+            global: Mutex::new(BinaryHeap::new()),
+            parked: (0..workers)
+                .map(|_| Mutex::new(BinaryHeap::new()))
+                .collect(),
+            ready: Condvar::new(),
+            shutdown: AtomicBool::new(false),
+        });
+        let handles = (0..workers)
+            .map(|me| {
+                let shared = Arc::clone(&shared);
+                std::thread::spawn(move || run_worker(&shared, me))
+            })
+            .collect();
+        Self {
+            shared,
+            seq: AtomicU64::new(0),
+            workers: handles,
+        }
+    }
+
+    /// Queue `job`. If `deadline` passes before the job finishes, it is
+    /// dropped at the next phase boundary.
+    pub fn submit<J: RenderJob>(
+        &self,
+        priority: Priority,
+        deadline: Option<Instant>,
+        job: J,
+    ) -> JobHandle<J::Output> {
+        let (tx, rx) = mpsc::channel();
+        let entry = Entry {
+            key: Key {
+                priority,
+                deadline,
+                seq: self.seq.fetch_add(1, Ordering::Relaxed),
+            },
+            job: Box::new(Slot { job, tx }),
+        };
+        lock(&self.shared.global).push(entry);
+        self.shared.ready.notify_one();
+        JobHandle { rx }
+    }
+
+    /// Queue a closure as a single-phase job.
+    pub fn submit_fn<F, T>(
+        &self,
+        priority: Priority,
+        deadline: Option<Instant>,
+        f: F,
+    ) -> JobHandle<T>
+    where
+        F: FnOnce() -> T + Send + 'static,
+        T: Send + 'static,
+    {
+        self.submit(priority, deadline, FnJob(Some(f)))
+    }
+
+    /// Number of jobs waiting to start or resume.
+    pub fn pending(&self) -> usize {
+        let global = lock(&self.shared.global);
+        global.len()
+            + self
+                .shared
+                .parked
+                .iter()
+                .map(|p| lock(p).len())
+                .sum::<usize>()
+    }
+}
+
+impl Drop for RenderQueue {
+    fn drop(&mut self) {
+        {
+            let _global = lock(&self.shared.global);
+            self.shared.shutdown.store(true, Ordering::Release);
+            self.shared.ready.notify_all();
+        }
+        for worker in self.workers.drain(..) {
+            let _ = worker.join();
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::time::Duration;
+
+    /// Logs its name once per phase. The first phase optionally reports that
+    /// it started and then blocks until released.
+    struct Phases {
+        name: &'static str,
+        remaining: usize,
+        gate: Option<(Sender<()>, Receiver<()>)>,
+        log: Arc<Mutex<Vec<&'static str>>>,
+    }
+
+    impl RenderJob for Phases {
+        type Output = ();
+
+        fn step(&mut self) -> Step<()> {
+            if let Some((started, release)) = self.gate.take() {
+                started.send(()).unwrap();
+                release.recv().unwrap();
+            }
+            self.log.lock().unwrap().push(self.name);
+            self.remaining -= 1;
+            if self.remaining == 0 {
+                Step::Done(())
+            } else {
+                Step::Yield
+            }
+        }
+    }
+
+    #[test]
+    fn test_interactive_preempts_background_at_phase_boundary() {
+        let queue = RenderQueue::new(1);
+        let log = Arc::new(Mutex::new(Vec::new()));
+        let (started_tx, started_rx) = mpsc::channel();
+        let (release_tx, release_rx) = mpsc::channel();
+
+        let background = queue.submit(
+            Priority::Background,
+            None,
+            Phases {
+                name: "bg",
+                remaining: 3,
+                gate: Some((started_tx, release_rx)),
+                log: Arc::clone(&log),
+            },
+        );
+        started_rx.recv().unwrap();
+        let interactive = queue.submit(
+            Priority::Interactive,
+            None,
+            Phases {
+                name: "fg",
+                remaining: 1,
+                gate: None,
+                log: Arc::clone(&log),
+            },
+        );
+        release_tx.send(()).unwrap();
+
+        interactive.wait().unwrap();
+        background.wait().unwrap();
+        assert_eq!(*log.lock().unwrap(), ["bg", "fg", "bg", "bg"]);
+    }
+
+    #[test]
+    fn test_expired_deadline_is_reported() {
+        let queue = RenderQueue::new(2);
+        let past = Instant::now() - Duration::from_millis(1);
+        let handle = queue.submit_fn(Priority::Normal, Some(past), || 1);
+        assert_eq!(handle.wait(), Err(JobError::DeadlineExceeded));
+    }
+
+    #[test]
+    fn test_panicking_job_does_not_kill_worker() {
+        let queue = RenderQueue::new(1);
+        let bad = queue.submit_fn(Priority::Normal, None, || -> i32 { panic!("boom") });
+        let good = queue.submit_fn(Priority::Normal, None, || 2);
+        assert_eq!(bad.wait(), Err(JobError::Panicked));
+        assert_eq!(good.wait(), Ok(2));
+    }
+
+    #[test]
+    fn test_key_order() {
+        let now = Instant::now();
+        let key = |priority, deadline, seq| Key {
+            priority,
+            deadline,
+            seq,
+        };
+        assert!(key(Priority::Interactive, None, 9) > key(Priority::Normal, Some(now), 0));
+        assert!(
+            key(Priority::Normal, Some(now), 5)
+                > key(Priority::Normal, Some(now + Duration::from_secs(1)), 0)
+        );
+        assert!(key(Priority::Normal, Some(now), 5) > key(Priority::Normal, None, 0));
+        assert!(key(Priority::Normal, None, 0) > key(Priority::Normal, None, 1));
+    }
+}
@@ -5,32 +5,101 @@
 //! placement, so hit testing and rectangle computation use the element's
 //! placement directly rather than simulating line wrapping.
 //!
+//! Text leaves, their boxes and their document order are read once per
+//! layout into a [`TextIndex`]; pointer moves then compare ranks and search
+//! sorted boxes instead of walking the DOM.
+//!
 //! # Safety
 //!
-//! `Selection` stores raw element pointers internally. The caller must ensure
-//! the parent `Document` outlives the `Selection` — element pointers become
-//! invalid once the document is dropped.
+//! `Selection` and `TextIndex` store raw element pointers internally. The
+//! caller must ensure the parent `Document` outlives them — element pointers
+//! become invalid once the document is dropped.
 //!
 //! # Usage
 //!
-//! The selection API accepts a text measurement function `&dyn Fn(&str, usize) -> f32`
-//! rather than `&dyn DocumentContainer`, because `Document` already holds a mutable
-//! borrow of the container. Consumers should capture their own measurement function
-//! before creating the document, or use a separate measurement path.
+//! The selection API accepts a [`TextMeasure`] rather than `&dyn DocumentContainer`,
+//! because `Document` already holds a mutable borrow of the container. Any
+//! `Fn(&str, FontHandle) -> f32` is a `TextMeasure`; implementations that shape
+//! text can also return every character offset from a single pass, which keeps
+//! hit testing and highlighting linear in the text length. Consumers should
+//! capture their measurement before creating the document, or use a separate
+//! measurement path.
 //!
 //! ```ignore
-//! let measure = container.text_measure_fn();
+//! let measure = container.text_measure();
 //! let mut doc = Document::from_html(&html, &mut container, None, None)?;
 //! doc.render(width);
 //! selection.start_at(&doc, &measure, x, y, cx, cy);
 //! ```
 
-use crate::{Document, Element, FontHandle, Position};
+use crate::{Document, DocumentContainer, Element, FontHandle, Position};
+use std::collections::HashMap;
 use std::marker::PhantomData;
+use std::ops::{Range, RangeInclusive};
 
 /// Text measurement function signature: `(text, font_handle) -> width_in_pixels`.
 pub type MeasureTextFn<'a> = dyn Fn(&str, FontHandle) -> f32 + 'a;
 
+/// Text measurement for hit testing and highlight rectangles.
+pub trait TextMeasure {
+    /// Pixel width of `text` rendered with `font`.
+    fn text_width(&self, text: &str, font: FontHandle) -> f32;
+
+    /// Replace `out` with the offset from the start of `text` to the end of
+    /// each character, one entry per `char`, in logical order. Offsets never
+    /// decrease.
+    ///
+    /// The default measures every prefix, which is quadratic in the length
+    /// of `text`; implementations that shape text should override it with
+    /// one shaping pass.
+    fn char_offsets(&self, text: &str, font: FontHandle, out: &mut Vec<f32>) {
+        prefix_offsets(self, text, font, out);
+    }
+
+    /// Whether [`char_offsets`](Self::char_offsets) measures `text` in one
+    /// pass. Implementations that override it should return `true`; while it
+    /// is `false`, selection measures only the prefixes it needs instead of
+    /// asking for every offset.
+    fn measures_offsets_in_one_pass(&self) -> bool {
+        false
+    }
+}
+
+/// Width of the text before byte `end`, `0` for an empty prefix.
+fn prefix_width<M: TextMeasure + ?Sized>(
+    measure: &M,
+    text: &str,
+    font: FontHandle,
+    end: usize,
+) -> f32 {
+    if end == 0 {
+        0.0
+    } else {
+        measure.text_width(&text[..end], font)
+    }
+}
+
+/// [`TextMeasure::char_offsets`] by measuring every prefix of `text`.
+pub(crate) fn prefix_offsets<M: TextMeasure + ?Sized>(
+    measure: &M,
+    text: &str,
+    font: FontHandle,
+    out: &mut Vec<f32>,
+) {
+    out.clear();
+    let mut end = 0.0f32;
+    for (i, ch) in text.char_indices() {
+        end = end.max(measure.text_width(&text[..i + ch.len_utf8()], font));
+        out.push(end);
+    }
+}
+
+impl<F: Fn(&str, FontHandle) -> f32 + ?Sized> TextMeasure for F {
+    fn text_width(&self, text: &str, font: FontHandle) -> f32 {
+        self(text, font)
+    }
+}
+
 /// A position within a text element: which element and which character offset.
 #[derive(Debug, Clone)]
 pub struct SelectionEndpoint {
@@ -39,38 +108,19 @@ pub struct SelectionEndpoint {
     pub x: f32,
 }
 
-impl SelectionEndpoint {
-    /// Get the element this endpoint refers to.
-    ///
-    /// # Safety (conceptual)
-    ///
-    /// The returned `Element` is only valid while the parent `Document` is alive.
-    fn element(&self) -> Element<'_> {
-        Element {
-            ptr: self.element,
-            _phantom: PhantomData,
-        }
-    }
-}
-
-/// Cached result of a document-order comparison between two elements.
-#[derive(Clone)]
-struct OrderCache {
-    a: *mut crate::sys::lh_element_t,
-    b: *mut crate::sys::lh_element_t,
-    a_before_b: bool,
-}
-
 /// Text selection state for a litehtml document.
 ///
 /// The `'doc` lifetime ties this selection to its parent [`Document`], preventing
 /// use-after-free if the document is dropped while the selection holds element
 /// pointers. Use [`Selection::for_document`] to create a lifetime-bound selection.
+///
+/// The selection keeps a [`TextIndex`] of the document, built on the first
+/// hit test and reused until the document's layout generation changes.
 pub struct Selection<'doc> {
     start: Option<SelectionEndpoint>,
     end: Option<SelectionEndpoint>,
     rectangles: Vec<Position>,
-    order_cache: Option<OrderCache>,
+    index: Option<TextIndex>,
     _doc: PhantomData<&'doc ()>,
 }
 
@@ -84,7 +134,7 @@ impl<'doc> Selection<'doc> {
             start: None,
             end: None,
             rectangles: Vec::new(),
-            order_cache: None,
+            index: None,
             _doc: PhantomData,
         }
     }
@@ -93,25 +143,27 @@ impl<'doc> Selection<'doc> {
     ///
     /// The returned `Selection` cannot outlive `doc`, enforced by the compiler.
     /// The document is NOT borrowed persistently — only the lifetime is captured.
-    pub fn for_document(_doc: &'doc Document<'_>) -> Self {
+    pub fn for_document<C: DocumentContainer + ?Sized>(_doc: &'doc Document<'_, C>) -> Self {
         Self::new()
     }
 
     /// Begin a selection at document coordinates `(x, y)`.
     ///
     /// `measure_text` should return the pixel width of a string rendered with
-    /// the given font handle — typically wrapping `DocumentContainer::text_width`.
-    pub fn start_at(
+    /// the given font handle — typically wrapping `DocumentContainer::text_width`,
+    /// or a [`TextMeasure`] that returns all character offsets in one pass.
+    pub fn start_at<C: DocumentContainer + ?Sized, M: TextMeasure + ?Sized>(
         &mut self,
-        doc: &Document<'_>,
-        measure_text: &MeasureTextFn<'_>,
+        doc: &Document<'_, C>,
+        measure_text: &M,
         x: f32,
         y: f32,
         client_x: f32,
         client_y: f32,
     ) {
         self.clear();
-        if let Some(endpoint) = hit_test_char(doc, measure_text, x, y, client_x, client_y) {
+        let index = self.index_for(doc);
+        if let Some(endpoint) = hit_test_char(doc, index, measure_text, x, y, client_x, client_y) {
             self.start = Some(endpoint);
         }
     }
@@ -119,10 +171,10 @@ impl<'doc> Selection<'doc> {
     /// Extend the selection to document coordinates `(x, y)`.
     ///
     /// Recomputes the selected text and highlight rectangles.
-    pub fn extend_to(
+    pub fn extend_to<C: DocumentContainer + ?Sized, M: TextMeasure + ?Sized>(
         &mut self,
-        doc: &Document<'_>,
-        measure_text: &MeasureTextFn<'_>,
+        doc: &Document<'_, C>,
+        measure_text: &M,
         x: f32,
         y: f32,
         client_x: f32,
@@ -131,18 +183,18 @@ impl<'doc> Selection<'doc> {
         if self.start.is_none() {
             return;
         }
-        if let Some(endpoint) = hit_test_char(doc, measure_text, x, y, client_x, client_y) {
+        let index = self.index_for(doc);
+        if let Some(endpoint) = hit_test_char(doc, index, measure_text, x, y, client_x, client_y) {
             self.end = Some(endpoint);
             self.recompute_rectangles(measure_text);
         }
     }
 
-    /// Clear the selection.
+    /// Clear the selection. The text index is kept for the next one.
     pub fn clear(&mut self) {
         self.start = None;
         self.end = None;
         self.rectangles.clear();
-        self.order_cache = None;
     }
 
     /// Returns `true` if there is an active selection with both start and end.
@@ -150,46 +202,34 @@ impl<'doc> Selection<'doc> {
         self.start.is_some() && self.end.is_some()
     }
 
-    /// Extract the selected text, walking the DOM between start and end.
+    /// Extract the selected text from the text index.
     ///
-    /// Returns `None` if the selection is not active.
+    /// Returns `None` if the selection is not active, or if an endpoint's
+    /// element was dropped by a relayout since it was hit.
     pub fn selected_text(&self) -> Option<String> {
-        let start = self.start.as_ref()?;
-        let end = self.end.as_ref()?;
-
-        // Normalize into document order (use cache if available)
-        let (first, second) = normalize_endpoints(start, end, &self.order_cache);
-        let first_el = first.element();
-        let second_el = second.element();
+        let index = self.index.as_ref()?;
+        let (first, second) = normalize_endpoints(index, self.start.as_ref()?, self.end.as_ref()?)?;
 
         // Same element: slice the text
-        if first.element == second.element {
-            let text = first_el.get_text();
-            let (lo, hi) = ordered_indices(first.char_index, second.char_index);
-            return Some(safe_char_slice(&text, lo, hi));
+        let first_text = index.text(first.rank);
+        if first.rank == second.rank {
+            return Some(safe_char_slice(
+                first_text,
+                first.char_index,
+                second.char_index,
+            ));
         }
 
-        // Multi-element: walk from first to second, collecting text
-        let mut result = String::new();
-
-        // Text from first element (from char_index to end)
-        let first_text = first_el.get_text();
-        result.push_str(&safe_char_slice_from(&first_text, first.char_index));
-
-        // Walk intermediate text nodes
-        let mut current = next_text_leaf(&first_el, &second_el);
-        while let Some(ref el) = current {
-            if el.as_ptr() == second.element {
-                break;
-            }
-            result.push_str(&el.get_text());
-            current = next_text_leaf(el, &second_el);
+        // Multi-element: the tail of the first leaf, every leaf in between,
+        // then the head of the second.
+        let mut result = safe_char_slice_from(first_text, first.char_index);
+        for rank in first.rank + 1..second.rank {
+            result.push_str(index.text(rank));
         }
-
-        // Text from second element (from 0 to char_index)
-        let second_text = second_el.get_text();
-        result.push_str(&safe_char_slice_to(&second_text, second.char_index));
-
+        result.push_str(&safe_char_slice_to(
+            index.text(second.rank),
+            second.char_index,
+        ));
         Some(result)
     }
 
@@ -198,79 +238,61 @@ impl<'doc> Selection<'doc> {
         &self.rectangles
     }
 
+    /// The text index for `doc` as currently laid out, rebuilt if the
+    /// layout generation moved since it was built.
+    fn index_for<C: DocumentContainer + ?Sized>(&mut self, doc: &Document<'_, C>) -> &TextIndex {
+        let generation = doc.layout_generation();
+        if self
+            .index
+            .as_ref()
+            .is_some_and(|index| index.generation != generation)
+        {
+            self.index = None;
+        }
+        self.index.get_or_insert_with(|| TextIndex::build(doc))
+    }
+
     /// Recompute highlight rectangles based on current start/end.
-    fn recompute_rectangles(&mut self, measure_text: &MeasureTextFn<'_>) {
+    fn recompute_rectangles<M: TextMeasure + ?Sized>(&mut self, measure_text: &M) {
         self.rectangles.clear();
 
-        let (start, end) = match (self.start.as_ref(), self.end.as_ref()) {
-            (Some(s), Some(e)) => (s, e),
-            _ => return,
+        let (Some(index), Some(start), Some(end)) =
+            (self.index.as_ref(), self.start.as_ref(), self.end.as_ref())
+        else {
+            return;
         };
+        let Some((first, second)) = normalize_endpoints(index, start, end) else {
+            return;
+        };
+        let out = &mut self.rectangles;
 
-        // Update order cache if endpoints changed
-        if start.element != end.element {
-            let needs_update = self
-                .order_cache
-                .as_ref()
-                .is_none_or(|c| c.a != start.element || c.b != end.element);
-            if needs_update {
-                let a_before_b = is_before(&start.element(), &end.element());
-                self.order_cache = Some(OrderCache {
-                    a: start.element,
-                    b: end.element,
-                    a_before_b,
-                });
-            }
-        }
-
-        // Normalize into document order
-        let (first, second) = normalize_endpoints(start, end, &self.order_cache);
-
-        if first.element == second.element {
-            let el = first.element();
+        if first.rank == second.rank {
             compute_text_rect(
-                &el,
+                index,
+                first.rank,
                 measure_text,
                 first.char_index,
                 second.char_index,
-                &mut self.rectangles,
+                out,
             );
             return;
         }
 
-        // First element: from char_index to end of text
-        let first_el = first.element();
-        let first_text = first_el.get_text();
-        let first_len = first_text.chars().count();
+        // First leaf to the end of its text, intermediate leaves in full,
+        // then the second leaf up to its char_index. Ranges past the end of
+        // a leaf's text are clamped.
         compute_text_rect(
-            &first_el,
+            index,
+            first.rank,
             measure_text,
             first.char_index,
-            first_len,
-            &mut self.rectangles,
+            usize::MAX,
+            out,
         );
-
-        // Intermediate elements: full highlight
-        let second_el = second.element();
-        let mut current = next_text_leaf(&first_el, &second_el);
-        while let Some(ref el) = current {
-            if el.as_ptr() == second.element {
-                break;
-            }
-            let text = el.get_text();
-            let len = text.chars().count();
-            compute_text_rect(el, measure_text, 0, len, &mut self.rectangles);
-            current = next_text_leaf(el, &second_el);
+        for rank in first.rank + 1..second.rank {
+            compute_text_rect(index, rank, measure_text, 0, usize::MAX, out);
         }
-
-        // Second element: from 0 to char_index
-        compute_text_rect(
-            &second_el,
-            measure_text,
-            0,
-            second.char_index,
-            &mut self.rectangles,
-        );
+        compute_text_rect(index, second.rank, measure_text, 0, second.char_index, out);
     }
 }
 
@@ -281,83 +303,305 @@ impl Default for Selection<'_> {
 }
 
 // ---------------------------------------------------------------------------
-// Document order
+// Text index
 // ---------------------------------------------------------------------------
 
-/// Determine if element `a` comes before `b` in document order.
-/// Walks forward from `a` using `next_text_leaf`; if we reach `b`, then a < b.
-fn is_before(a: &Element<'_>, b: &Element<'_>) -> bool {
-    if a.as_ptr() == b.as_ptr() {
-        return false;
+/// A text leaf in a [`TextIndex`].
+#[derive(Debug, Clone)]
+pub struct TextLeaf {
+    element: *mut crate::sys::lh_element_t,
+    /// Absolute box of the leaf, or of its parent if litehtml did not
+    /// place the leaf itself.
+    pub pos: Position,
+    /// Font the leaf is drawn with (its parent's if it has none).
+    pub font: FontHandle,
+    /// Characters in all earlier leaves: the document offset of this
+    /// leaf's first character.
+    pub char_start: usize,
+    bytes: Range<usize>,
+    blank: bool,
+}
+
+/// Run of non-blank leaves whose boxes overlap vertically.
+#[derive(Debug, Clone)]
+struct Row {
+    top: f32,
+    bottom: f32,
+    /// Slots in [`TextIndex::by_row`].
+    slots: Range<usize>,
+}
+
+/// Text leaves of a laid-out document in document order.
+///
+/// Built from one walk of the DOM, the index answers what selection asks on
+/// every pointer move without going back to the tree: two leaves compare in
+/// document order by their rank (their position in
+/// [`leaves`](Self::leaves)), the leaf nearest a point is found by binary
+/// search over rows of boxes, and the text between two leaves is a walk
+/// over a slice.
+///
+/// The index holds raw element pointers and describes one layout. It is
+/// stale once [`Document::layout_generation`] differs from
+/// [`generation`](Self::generation); [`Selection`] rebuilds its own.
+#[derive(Debug, Clone)]
+pub struct TextIndex {
+    generation: u64,
+    text: String,
+    leaves: Vec<TextLeaf>,
+    ranks: HashMap<*mut crate::sys::lh_element_t, usize>,
+    /// Ranks of the non-blank leaves, grouped by row, left to right.
+    by_row: Vec<usize>,
+    rows: Vec<Row>,
+}
+
+impl TextIndex {
+    /// Index the text leaves of `doc` as currently laid out.
+    pub fn build<C: DocumentContainer + ?Sized>(doc: &Document<'_, C>) -> Self {
+        let mut text = String::new();
+        let mut leaves = Vec::new();
+        doc.for_each_text_leaf(|element, leaf_text, pos, font| {
+            push_leaf(&mut text, &mut leaves, element, leaf_text, pos, font);
+        });
+        Self::from_leaves(doc.layout_generation(), text, leaves)
     }
-    let mut cursor = next_text_leaf(a, b);
-    while let Some(ref el) = cursor {
-        if el.as_ptr() == b.as_ptr() {
-            return true;
+
+    fn from_leaves(generation: u64, text: String, leaves: Vec<TextLeaf>) -> Self {
+        let ranks = leaves
+            .iter()
+            .enumerate()
+            .map(|(rank, leaf)| (leaf.element, rank))
+            .collect();
+        let (by_row, rows) = build_rows(&leaves);
+        Self {
+            generation,
+            text,
+            leaves,
+            ranks,
+            by_row,
+            rows,
         }
-        cursor = next_text_leaf(el, b);
     }
-    false
-}
 
-/// Normalize user-order endpoints into document order: returns (first, second).
-///
-/// Uses the cached order result when available to avoid repeated DOM walks.
-fn normalize_endpoints<'a>(
-    a: &'a SelectionEndpoint,
-    b: &'a SelectionEndpoint,
-    cache: &Option<OrderCache>,
-) -> (&'a SelectionEndpoint, &'a SelectionEndpoint) {
-    if a.element == b.element {
-        if a.char_index <= b.char_index {
-            (a, b)
-        } else {
-            (b, a)
+    /// Layout generation of the document when the index was built.
+    pub fn generation(&self) -> u64 {
+        self.generation
+    }
+
+    /// Every text leaf, in document order.
+    pub fn leaves(&self) -> &[TextLeaf] {
+        &self.leaves
+    }
+
+    /// Text of the leaf at `rank`. Panics if `rank` is out of range.
+    pub fn text(&self, rank: usize) -> &str {
+        &self.text[self.leaves[rank].bytes.clone()]
+    }
+
+    /// Rank of a text leaf; `None` for elements that are not text leaves.
+    pub fn rank_of(&self, el: &Element<'_>) -> Option<usize> {
+        self.ranks.get(&el.as_ptr()).copied()
+    }
+
+    /// Rank of the leaf with visible text nearest `(x, y)`: on the nearest
+    /// row of text, the box nearest along it.
+    pub fn leaf_at(&self, x: f32, y: f32) -> Option<usize> {
+        let last = self.leaves.len().checked_sub(1)?;
+        self.closest_leaf(x, y, 0..=last)
+    }
+
+    /// Ranks of the text leaves inside `el`, which are contiguous in
+    /// document order. `None` if `el` contains no text.
+    fn subtree(&self, el: &Element<'_>) -> Option<RangeInclusive<usize>> {
+        Some(self.edge_leaf(el, false)?..=self.edge_leaf(el, true)?)
+    }
+
+    /// Rank of the first (or last) text leaf inside `el`.
+    fn edge_leaf(&self, el: &Element<'_>, last: bool) -> Option<usize> {
+        if let Some(rank) = self.rank_of(el) {
+            return Some(rank);
         }
-    } else {
-        let a_before_b = cache
-            .as_ref()
-            .filter(|c| c.a == a.element && c.b == b.element)
-            .map_or_else(|| is_before(&a.element(), &b.element()), |c| c.a_before_b);
-        if a_before_b {
-            (a, b)
+        if last {
+            let children: Vec<_> = el.children().collect();
+            children
+                .iter()
+                .rev()
+                .find_map(|child| self.edge_leaf(child, true))
         } else {
-            (b, a)
+            el.children()
+                .find_map(|child| self.edge_leaf(&child, false))
+        }
+    }
+
+    /// Rank of the non-blank leaf among `ranks` nearest `(x, y)`.
+    fn closest_leaf(&self, x: f32, y: f32, ranks: RangeInclusive<usize>) -> Option<usize> {
+        // Rows are disjoint and sorted, so the nearest one either contains
+        // `y` or borders the gap it falls in.
+        let below = self.rows.partition_point(|row| row.bottom <= y);
+        let mut near: Vec<&Row> = [below.checked_sub(1), Some(below)]
+            .into_iter()
+            .flatten()
+            .filter_map(|i| self.rows.get(i))
+            .collect();
+        near.sort_by(|a, b| {
+            let da = axis_distance(y, a.top, a.bottom - a.top);
+            let db = axis_distance(y, b.top, b.bottom - b.top);
+            da.total_cmp(&db)
+        });
+        if let Some(rank) = near
+            .into_iter()
+            .find_map(|row| self.closest_in_row(row, x, &ranks))
+        {
+            return Some(rank);
+        }
+
+        // Neither row has a leaf in range (a hit inside a small element
+        // that shares no row with the point): scan the range itself.
+        let distance = |rank: usize| {
+            let p = self.leaves[rank].pos;
+            (
+                axis_distance(y, p.y, p.height),
+                axis_distance(x, p.x, p.width),
+            )
+        };
+        ranks
+            .filter(|&rank| self.leaves.get(rank).is_some_and(|leaf| !leaf.blank))
+            .min_by(|&a, &b| {
+                let (ay, ax) = distance(a);
+                let (by, bx) = distance(b);
+                ay.total_cmp(&by).then(ax.total_cmp(&bx))
+            })
+    }
+
+    /// Rank of the leaf among `ranks` in `row` nearest `x`.
+    fn closest_in_row(&self, row: &Row, x: f32, ranks: &RangeInclusive<usize>) -> Option<usize> {
+        let slots = &self.by_row[row.slots.clone()];
+        let split = slots.partition_point(|&rank| {
+            let p = self.leaves[rank].pos;
+            p.x + p.width <= x
+        });
+        let right = slots[split..].iter().find(|rank| ranks.contains(rank));
+        let left = slots[..split]
+            .iter()
+            .rev()
+            .find(|rank| ranks.contains(rank));
+        let distance = |rank: usize| {
+            let p = self.leaves[rank].pos;
+            axis_distance(x, p.x, p.width)
+        };
+        match (left, right) {
+            (Some(&l), Some(&r)) => Some(if distance(l) < distance(r) { l } else { r }),
+            (l, r) => l.or(r).copied(),
         }
     }
 }
 
-// ---------------------------------------------------------------------------
-// Hit testing
-// ---------------------------------------------------------------------------
+/// Append a leaf to the text and leaves of an index under construction.
+fn push_leaf(
+    text: &mut String,
+    leaves: &mut Vec<TextLeaf>,
+    element: *mut crate::sys::lh_element_t,
+    leaf_text: &str,
+    pos: Position,
+    font: FontHandle,
+) {
+    let char_start = leaves.last().map_or(0, |prev: &TextLeaf| {
+        prev.char_start + text[prev.bytes.clone()].chars().count()
+    });
+    let start = text.len();
+    text.push_str(leaf_text);
+    leaves.push(TextLeaf {
+        element,
+        pos,
+        font,
+        char_start,
+        bytes: start..text.len(),
+        blank: leaf_text.trim().is_empty(),
+    });
+}
 
-/// Get the font handle for a text element, falling back to its parent.
-fn font_for_text(text_el: &Element<'_>) -> FontHandle {
-    let f = text_el.font();
-    if f != FontHandle(0) {
-        return f;
+/// Group the non-blank leaves into rows of vertically overlapping boxes,
+/// top to bottom, and sort each row left to right.
+fn build_rows(leaves: &[TextLeaf]) -> (Vec<usize>, Vec<Row>) {
+    let mut by_row: Vec<usize> = (0..leaves.len()).filter(|&r| !leaves[r].blank).collect();
+    by_row.sort_by(|&a, &b| leaves[a].pos.y.total_cmp(&leaves[b].pos.y));
+
+    let mut rows: Vec<Row> = Vec::new();
+    for (slot, &rank) in by_row.iter().enumerate() {
+        let p = leaves[rank].pos;
+        match rows.last_mut() {
+            Some(row) if p.y < row.bottom => {
+                row.bottom = row.bottom.max(p.y + p.height);
+                row.slots.end = slot + 1;
+            }
+            _ => rows.push(Row {
+                top: p.y,
+                bottom: p.y + p.height,
+                slots: slot..slot + 1,
+            }),
+        }
     }
-    text_el.parent().map_or(FontHandle(0), |p| p.font())
+    for row in &rows {
+        by_row[row.slots.clone()].sort_by(|&a, &b| leaves[a].pos.x.total_cmp(&leaves[b].pos.x));
+    }
+    (by_row, rows)
 }
 
-/// Get the placement for a text element. Falls back to the parent's placement
-/// if the text element's own placement has zero width (some text nodes don't
-/// have their own render-item position).
-fn placement_for_text(text_el: &Element<'_>) -> Position {
-    let p = text_el.placement();
-    if p.width > 0.0 {
-        return p;
+/// Distance from `target` to a span: zero inside it, otherwise to its centre.
+fn axis_distance(target: f32, start: f32, len: f32) -> f32 {
+    if target >= start && target < start + len {
+        0.0
+    } else {
+        (target - (start + len / 2.0)).abs()
     }
-    text_el.parent().map_or(p, |parent| parent.placement())
 }
 
+// ---------------------------------------------------------------------------
+// Document order
+// ---------------------------------------------------------------------------
+
+/// A selection endpoint resolved against a [`TextIndex`].
+#[derive(Debug, Clone, Copy)]
+struct LeafPoint {
+    rank: usize,
+    char_index: usize,
+}
+
+/// Normalize user-order endpoints into document order: returns (first, second).
+///
+/// Compares document character offsets, so this is O(1). `None` if either
+/// endpoint's element is not a leaf of `index`.
+fn normalize_endpoints(
+    index: &TextIndex,
+    a: &SelectionEndpoint,
+    b: &SelectionEndpoint,
+) -> Option<(LeafPoint, LeafPoint)> {
+    let resolve = |e: &SelectionEndpoint| {
+        Some(LeafPoint {
+            rank: *index.ranks.get(&e.element)?,
+            char_index: e.char_index,
+        })
+    };
+    let (a, b) = (resolve(a)?, resolve(b)?);
+    // The rank breaks the tie between the end of one leaf and the start
+    // of the next.
+    let key = |p: LeafPoint| (index.leaves[p.rank].char_start + p.char_index, p.rank);
+    Some(if key(a) <= key(b) { (a, b) } else { (b, a) })
+}
+
+// ---------------------------------------------------------------------------
+// Hit testing
+// ---------------------------------------------------------------------------
+
 /// Character-level hit testing: find which character in which element is at (x, y).
 ///
-/// Uses the text element's own render-engine placement — litehtml splits text
-/// into per-word elements and positions each one during layout.
-fn hit_test_char(
-    doc: &Document<'_>,
-    measure_text: &MeasureTextFn<'_>,
+/// Uses the text leaf's own render-engine placement — litehtml splits text
+/// into per-word elements and positions each one during layout. A hit on
+/// anything but a text leaf resolves to the nearest leaf with visible text
+/// inside the element hit.
+fn hit_test_char<C: DocumentContainer + ?Sized, M: TextMeasure + ?Sized>(
+    doc: &Document<'_, C>,
+    index: &TextIndex,
+    measure_text: &M,
     x: f32,
     y: f32,
     client_x: f32,
@@ -365,29 +609,25 @@ fn hit_test_char(
 ) -> Option<SelectionEndpoint> {
     let el = doc.get_element_by_point(x, y, client_x, client_y)?;
 
-    let text_el = if el.is_text() {
-        el
-    } else {
-        closest_text_leaf(&el, x, y).or_else(|| first_text_leaf(&el))?
+    let rank = match index.rank_of(&el) {
+        Some(rank) => rank,
+        None => {
+            let inside = index.subtree(&el)?;
+            let first = *inside.start();
+            index.closest_leaf(x, y, inside).unwrap_or(first)
+        }
     };
 
-    let text = text_el.get_text();
-    if text.is_empty() || text.trim().is_empty() {
-        return Some(SelectionEndpoint {
-            element: text_el.as_ptr(),
-            char_index: 0,
-            x,
-        });
-    }
-
-    let font = font_for_text(&text_el);
-    let placement = placement_for_text(&text_el);
-
-    let local_x = x - placement.x;
-    let char_index = find_char_at_x(measure_text, &text, font, local_x);
+    let leaf = &index.leaves[rank];
+    let text = index.text(rank);
+    let char_index = if leaf.blank {
+        0
+    } else {
+        find_char_at_x(measure_text, text, leaf.font, x - leaf.pos.x)
+    };
 
     Some(SelectionEndpoint {
-        element: text_el.as_ptr(),
+        element: leaf.element,
         char_index,
         x,
     })
@@ -396,9 +636,12 @@ fn hit_test_char(
 /// Find which character index corresponds to pixel offset `target_x` within
 /// the given text rendered with `font`.
 ///
-/// Builds the prefix string incrementally to avoid O(n) allocations per call.
-fn find_char_at_x(
-    measure_text: &MeasureTextFn<'_>,
+/// With a one-pass [`TextMeasure::char_offsets`], measures every offset
+/// once and binary-searches them for the first character whose midpoint
+/// lies past `target_x`. Otherwise binary-searches on prefix widths, which
+/// takes about log n measurements.
+fn find_char_at_x<M: TextMeasure + ?Sized>(
+    measure_text: &M,
     text: &str,
     font: FontHandle,
     target_x: f32,
@@ -407,231 +650,108 @@ fn find_char_at_x(
         return 0;
     }
 
-    let mut prefix = String::with_capacity(text.len());
-    let mut prev_width = 0.0f32;
-    let mut count = 0;
-
-    for ch in text.chars() {
-        prefix.push(ch);
-        count += 1;
-        let width = measure_text(&prefix, font);
-        let midpoint = (prev_width + width) / 2.0;
-
-        if target_x < midpoint {
-            return count - 1;
-        }
-        prev_width = width;
+    if measure_text.measures_offsets_in_one_pass() {
+        let mut offsets = Vec::new();
+        measure_text.char_offsets(text, font, &mut offsets);
+        return char_at_offset(&offsets, target_x);
     }
 
-    count
-}
-
-// ---------------------------------------------------------------------------
-// Tree walking
-// ---------------------------------------------------------------------------
+    // ends[k - 1] is the byte length of the first k characters.
+    let ends: Vec<usize> = text.char_indices().map(|(i, c)| i + c.len_utf8()).collect();
+    let width = |k: usize| {
+        prefix_width(
+            measure_text,
+            text,
+            font,
+            if k == 0 { 0 } else { ends[k - 1] },
+        )
+    };
 
-/// Descend to the first text leaf child of `el`.
-fn first_text_leaf<'a>(el: &Element<'a>) -> Option<Element<'a>> {
-    if el.is_text() {
-        return Some(Element {
-            ptr: el.as_ptr(),
-            _phantom: PhantomData,
-        });
-    }
-    let count = el.children_count();
-    for i in 0..count {
-        if let Some(child) = el.child_at(i) {
-            if let Some(leaf) = first_text_leaf(&child) {
-                return Some(leaf);
-            }
+    // Smallest k whose prefix ends past target_x.
+    let (mut lo, mut hi) = (1, ends.len() + 1);
+    while lo < hi {
+        let mid = lo + (hi - lo) / 2;
+        if width(mid) > target_x {
+            hi = mid;
+        } else {
+            lo = mid + 1;
         }
     }
-    None
-}
-
-/// Returns true if this text element contains only whitespace.
-fn is_whitespace_only(el: &Element<'_>) -> bool {
-    el.get_text().trim().is_empty()
-}
-
-/// Find the closest non-whitespace text leaf descendant by both Y and X.
-///
-/// First filters to text leaves whose placement vertically overlaps or is
-/// closest to `target_y`, then among those picks the one closest to `target_x`.
-fn closest_text_leaf<'a>(el: &Element<'a>, target_x: f32, target_y: f32) -> Option<Element<'a>> {
-    let mut candidates: Vec<(Element<'a>, Position)> = Vec::new();
-
-    fn collect<'a>(el: &Element<'a>, out: &mut Vec<(Element<'a>, Position)>) {
-        if el.is_text() && !is_whitespace_only(el) {
-            let p = placement_for_text(el);
-            out.push((
-                Element {
-                    ptr: el.as_ptr(),
-                    _phantom: PhantomData,
-                },
-                p,
-            ));
-            return;
-        }
-        let count = el.children_count();
-        for i in 0..count {
-            if let Some(child) = el.child_at(i) {
-                collect(&child, out);
-            }
-        }
+    if lo > ends.len() {
+        return ends.len();
     }
-
-    collect(el, &mut candidates);
-    if candidates.is_empty() {
-        return None;
+    // Character lo - 1 straddles target_x.
+    let (start, end) = (width(lo - 1), width(lo));
+    if (start + end) / 2.0 <= target_x {
+        lo
+    } else {
+        lo - 1
     }
-
-    // Find minimum Y distance
-    let min_y_dist = candidates
-        .iter()
-        .map(|(_, p)| {
-            if target_y >= p.y && target_y < p.y + p.height {
-                0.0f32
-            } else {
-                let center = p.y + p.height / 2.0;
-                (target_y - center).abs()
-            }
-        })
-        .fold(f32::MAX, f32::min);
-
-    // Filter to candidates within a small tolerance of the best Y distance
-    let y_tolerance = 2.0;
-    let y_candidates: Vec<_> = candidates
-        .into_iter()
-        .filter(|(_, p)| {
-            let d = if target_y >= p.y && target_y < p.y + p.height {
-                0.0f32
-            } else {
-                let center = p.y + p.height / 2.0;
-                (target_y - center).abs()
-            };
-            d <= min_y_dist + y_tolerance
-        })
-        .collect();
-
-    // Among Y-matching candidates, pick closest by X
-    y_candidates
-        .into_iter()
-        .min_by(|(_, a), (_, b)| {
-            let da = if target_x >= a.x && target_x < a.x + a.width {
-                0.0f32
-            } else {
-                let center = a.x + a.width / 2.0;
-                (target_x - center).abs()
-            };
-            let db = if target_x >= b.x && target_x < b.x + b.width {
-                0.0f32
-            } else {
-                let center = b.x + b.width / 2.0;
-                (target_x - center).abs()
-            };
-            da.partial_cmp(&db).unwrap_or(std::cmp::Ordering::Equal)
-        })
-        .map(|(el, _)| el)
 }
 
-/// Maximum ancestor levels to traverse before giving up.
-/// Prevents infinite loops on malformed DOMs.
-const MAX_TREE_DEPTH: usize = 256;
-
-/// Walk to the next text leaf after `el`, stopping before `stop`.
-/// Walks up to the parent, then to the next sibling, then descends.
-/// Gives up after [`MAX_TREE_DEPTH`] ancestor levels to guard against
-/// malformed or extremely deep DOMs.
-fn next_text_leaf<'a>(el: &Element<'a>, stop: &Element<'a>) -> Option<Element<'a>> {
-    let mut current_ptr = el.as_ptr();
-
-    for _ in 0..MAX_TREE_DEPTH {
-        let current = Element {
-            ptr: current_ptr,
-            _phantom: PhantomData,
-        };
-        let parent = current.parent()?;
-        let sibling_count = parent.children_count();
-
-        // Find current's index among parent's children
-        let mut found_idx = None;
-        for i in 0..sibling_count {
-            if let Some(child) = parent.child_at(i) {
-                if child.as_ptr() == current_ptr {
-                    found_idx = Some(i);
-                    break;
-                }
-            }
-        }
-
-        if let Some(idx) = found_idx {
-            for i in (idx + 1)..sibling_count {
-                if let Some(sibling) = parent.child_at(i) {
-                    if sibling.as_ptr() == stop.as_ptr() {
-                        return Some(sibling);
-                    }
-                    if let Some(leaf) = first_text_leaf(&sibling) {
-                        if leaf.as_ptr() == stop.as_ptr() {
-                            return Some(leaf);
-                        }
-                        return Some(leaf);
-                    }
-                }
-            }
+/// Number of characters whose midpoint is at or before `target_x`, given
+/// the end offset of each character.
+fn char_at_offset(offsets: &[f32], target_x: f32) -> usize {
+    let midpoint = |i: usize| {
+        let start = if i == 0 { 0.0 } else { offsets[i - 1] };
+        (start + offsets[i]) / 2.0
+    };
+    let (mut lo, mut hi) = (0, offsets.len());
+    while lo < hi {
+        let mid = lo + (hi - lo) / 2;
+        if midpoint(mid) <= target_x {
+            lo = mid + 1;
+        } else {
+            hi = mid;
         }
-
-        // No more siblings at this level, walk up
-        current_ptr = parent.as_ptr();
     }
-
-    None
+    lo
 }
 
 // ---------------------------------------------------------------------------
 // Rectangle computation
 // ---------------------------------------------------------------------------
 
-/// Compute a highlight rectangle for a character range within a single text element.
+/// Compute a highlight rectangle for a character range within one text leaf.
 ///
-/// Uses the element's render-engine placement directly.
-fn compute_text_rect(
-    el: &Element<'_>,
-    measure_text: &MeasureTextFn<'_>,
+/// Uses the leaf's render-engine placement directly. A range covering the
+/// whole leaf takes one [`TextMeasure::text_width`]; otherwise both ends
+/// come from one [`TextMeasure::char_offsets`] pass when that is a single
+/// pass, or from measuring the two prefixes.
+fn compute_text_rect<M: TextMeasure + ?Sized>(
+    index: &TextIndex,
+    rank: usize,
+    measure_text: &M,
     from_char: usize,
     to_char: usize,
     out: &mut Vec<Position>,
 ) {
     let (lo, hi) = ordered_indices(from_char, to_char);
-    if lo == hi {
+    let leaf = &index.leaves[rank];
+    if lo == hi || leaf.blank {
         return;
     }
 
-    let text = el.get_text();
-    if text.trim().is_empty() {
-        return;
-    }
-    let chars: Vec<char> = text.chars().collect();
-    if chars.is_empty() {
+    let placement = leaf.pos;
+    let text = index.text(rank);
+    let len = text.chars().count();
+    let (lo, hi) = (lo.min(len), hi.min(len));
+    if lo == hi {
         return;
     }
-
-    let font = font_for_text(el);
-    let placement = placement_for_text(el);
-
-    let lo = lo.min(chars.len());
-    let hi = hi.min(chars.len());
-
-    let start_px = if lo == 0 {
-        0.0
+    let (start_px, end_px) = if lo == 0 && hi == len {
+        (0.0, measure_text.text_width(text, leaf.font))
+    } else if measure_text.measures_offsets_in_one_pass() {
+        let mut offsets = Vec::new();
+        measure_text.char_offsets(text, leaf.font, &mut offsets);
+        let offset_at = |n: usize| if n == 0 { 0.0 } else { offsets[n - 1] };
+        (offset_at(lo), offset_at(hi))
     } else {
-        let prefix: String = chars[..lo].iter().collect();
-        measure_text(&prefix, font)
-    };
-
-    let end_px = {
-        let prefix: String = chars[..hi].iter().collect();
-        measure_text(&prefix, font)
+        let byte_at = |n: usize| text.char_indices().nth(n).map_or(text.len(), |(i, _)| i);
+        (
+            prefix_width(measure_text, text, leaf.font, byte_at(lo)),
+            prefix_width(measure_text, text, leaf.font, byte_at(hi)),
+        )
     };
 
     if end_px > start_px {
@@ -893,6 +1013,76 @@ mod tests {
         );
     }
 
+    /// Measure that shapes once per call and counts its calls.
+    #[derive(Default)]
+    struct CountingMeasure {
+        calls: std::cell::Cell<usize>,
+    }
+
+    impl TextMeasure for CountingMeasure {
+        fn text_width(&self, text: &str, _font: FontHandle) -> f32 {
+            self.calls.set(self.calls.get() + 1);
+            text.len() as f32 * 8.0
+        }
+
+        fn char_offsets(&self, text: &str, _font: FontHandle, out: &mut Vec<f32>) {
+            self.calls.set(self.calls.get() + 1);
+            out.clear();
+            out.extend(
+                text.char_indices()
+                    .map(|(i, c)| (i + c.len_utf8()) as f32 * 8.0),
+            );
+        }
+
+        fn measures_offsets_in_one_pass(&self) -> bool {
+            true
+        }
+    }
+
+    #[test]
+    fn test_default_char_offsets_measure_prefixes() {
+        let mut offsets = Vec::new();
+        measure_text.char_offsets("Hëy", FontHandle(1), &mut offsets);
+        assert_eq!(offsets, [8.0, 24.0, 32.0]);
+    }
+
+    #[test]
+    fn test_find_char_at_x_single_pass() {
+        let text = "word ".repeat(200);
+        let measure = CountingMeasure::default();
+        for x in [0.5, 3.9, 4.0, 12.0, 3999.0, 5000.0] {
+            measure.calls.set(0);
+            let index = find_char_at_x(&measure, &text, FontHandle(1), x);
+            assert_eq!(measure.calls.get(), 1);
+            assert_eq!(
+                index,
+                find_char_at_x(&measure_text, &text, FontHandle(1), x)
+            );
+        }
+    }
+
+    #[test]
+    fn test_find_char_at_x_closure_measures_log_prefixes() {
+        let text = "wörd ".repeat(200);
+        let calls = std::cell::Cell::new(0usize);
+        let closure = |t: &str, _: FontHandle| {
+            calls.set(calls.get() + 1);
+            t.chars().count() as f32 * 8.0
+        };
+        let reference = |t: &str, _: FontHandle| t.chars().count() as f32 * 8.0;
+        let offsets_of = |x: f32| {
+            let mut offsets = Vec::new();
+            prefix_offsets(&reference, &text, FontHandle(1), &mut offsets);
+            char_at_offset(&offsets, x)
+        };
+        for x in [0.5, 3.9, 4.0, 12.0, 3999.0, 7999.0, 9000.0] {
+            calls.set(0);
+            let index = find_char_at_x(&closure, &text, FontHandle(1), x);
+            assert!(calls.get() <= 13, "{x}: {} calls", calls.get());
+            assert_eq!(index, offsets_of(x), "{x}");
+        }
+    }
+
     // -------------------------------------------------------------------
     // Selection construction and state tests
     // -------------------------------------------------------------------
@@ -1298,4 +1488,106 @@ mod tests {
         // When from > to, saturating_sub makes take(0) => empty string
         assert_eq!(safe_char_slice("hello", 4, 1), "");
     }
+
+    // -------------------------------------------------------------------
+    // Text index
+    // -------------------------------------------------------------------
+
+    /// Index of `(text, x, y, width)` leaves, 20px tall, standing in for a
+    /// laid-out document. Element pointers are fake and never dereferenced.
+    fn synthetic_index(leaves: &[(&str, f32, f32, f32)]) -> TextIndex {
+        let mut text = String::new();
+        let mut out = Vec::new();
+        for (i, &(leaf_text, x, y, width)) in leaves.iter().enumerate() {
+            let pos = Position {
+                x,
+                y,
+                width,
+                height: 20.0,
+            };
+            let element = (i + 1) as *mut crate::sys::lh_element_t;
+            push_leaf(&mut text, &mut out, element, leaf_text, pos, FontHandle(1));
+        }
+        TextIndex::from_leaves(0, text, out)
+    }
+
+    fn two_lines() -> TextIndex {
+        synthetic_index(&[
+            ("Hello", 0.0, 0.0, 40.0),
+            (" ", 40.0, 0.0, 8.0),
+            ("wörld", 48.0, 0.0, 48.0),
+            ("Next", 0.0, 30.0, 32.0),
+        ])
+    }
+
+    #[test]
+    fn test_text_index_offsets_and_lookup() {
+        let index = two_lines();
+        let starts: Vec<_> = index.leaves().iter().map(|l| l.char_start).collect();
+        assert_eq!(starts, [0, 5, 6, 11]);
+        assert_eq!(index.text(2), "wörld");
+
+        assert_eq!(index.leaf_at(50.0, 5.0), Some(2));
+        // The blank leaf under the point is skipped for the nearer word.
+        assert_eq!(index.leaf_at(41.0, 5.0), Some(0));
+        assert_eq!(index.leaf_at(10.0, 100.0), Some(3));
+        assert_eq!(index.leaf_at(500.0, 35.0), Some(3));
+        assert_eq!(synthetic_index(&[]).leaf_at(0.0, 0.0), None);
+    }
+
+    #[test]
+    fn test_text_index_closest_leaf_within_range() {
+        let index = two_lines();
+        // Nearest row has nothing in range: falls back to scanning it.
+        assert_eq!(index.closest_leaf(50.0, 5.0, 3..=3), Some(3));
+        assert_eq!(index.closest_leaf(50.0, 5.0, 0..=1), Some(0));
+        assert_eq!(index.closest_leaf(50.0, 5.0, 1..=1), None);
+    }
+
+    #[test]
+    fn test_normalize_endpoints_by_rank() {
+        let index = two_lines();
+        let at = |rank: usize, char_index: usize| SelectionEndpoint {
+            element: index.leaves()[rank].element,
+            char_index,
+            x: 0.0,
+        };
+        let order = |a: &SelectionEndpoint, b: &SelectionEndpoint| {
+            normalize_endpoints(&index, a, b).map(|(f, s)| (f.rank, f.char_index, s.rank))
+        };
+        assert_eq!(order(&at(3, 1), &at(0, 2)), Some((0, 2, 3)));
+        assert_eq!(order(&at(2, 3), &at(2, 1)), Some((2, 1, 2)));
+        // End of one leaf against the start of the next.
+        assert_eq!(order(&at(2, 0), &at(0, 5)), Some((0, 5, 2)));
+
+        let stray = SelectionEndpoint {
+            element: std::ptr::null_mut(),
+            char_index: 0,
+            x: 0.0,
+        };
+        assert_eq!(order(&stray, &at(0, 0)), None);
+    }
+
+    #[test]
+    fn test_text_index_rebuilt_after_relayout() {
+        let mut container = TestContainer::new();
+        let mut doc =
+            Document::from_html("<p>Hello World</p>", &mut container, None, None).unwrap();
+        let _ = doc.render(800.0);
+
+        let index = TextIndex::build(&doc);
+        let text: String = (0..index.leaves().len()).map(|r| index.text(r)).collect();
+        assert!(text.contains("Hello World"), "indexed text: '{text}'");
+
+        let mut sel = Selection::new();
+        sel.start_at(&doc, &measure_text, 5.0, 10.0, 5.0, 10.0);
+        let built = sel.index.as_ref().map(TextIndex::generation);
+        assert_eq!(built, Some(doc.layout_generation()));
+
+        let _ = doc.render(400.0);
+        sel.extend_to(&doc, &measure_text, 80.0, 10.0, 80.0, 10.0);
+        let rebuilt = sel.index.as_ref().map(TextIndex::generation);
+        assert_eq!(rebuilt, Some(doc.layout_generation()));
+        assert!(sel.selected_text().is_some());
+    }
 }
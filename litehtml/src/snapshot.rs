@@ -0,0 +1,1165 @@
+//! Serializable snapshots of a laid-out document.
+//!
+//! A [`LayoutSnapshot`] is the output of one full draw pass, captured as
+//! owned data. It holds every box, text run, background, border and clip
+//! operation litehtml issued, along with the font descriptions and image
+//! references those operations use. It can be encoded into a compact binary
+//! form, stored next to the source document, and replayed into any
+//! [`DocumentContainer`] later without parsing, styling or laying out again.
+//!
+//! ```ignore
+//! let snapshot = LayoutSnapshot::capture(&html, &mut container, 800.0, &Default::default())?;
+//! store(snapshot.encode());
+//!
+//! // Later, possibly in another process:
+//! let snapshot = LayoutSnapshot::decode(&load())?;
+//! snapshot.replay(&mut container, DrawContext::default(), 0.0, 0.0, None);
+//! ```
+//!
+//! Replay creates each font through [`DocumentContainer::create_font`] on
+//! first use and deletes it afterwards. It also calls
+//! [`DocumentContainer::load_image`] once per referenced image before that
+//! image is first drawn. A snapshot is only valid for the width it was
+//! captured at.
+
+use std::marker::PhantomData;
+
+use crate::display_list::RecordingContainer;
+use crate::{
+    BackgroundAttachment, BackgroundLayer, BackgroundRepeat, Border, BorderRadiuses, BorderStyle,
+    Borders, Color, ColorPoint, ColorSpace, ConicGradient, CreateError, DecorationThickness,
+    Document, DocumentContainer, DocumentOptions, DrawContext, FontDescription, FontHandle,
+    FontStyle, HueInterpolation, LinearGradient, ListMarker, ListStyleType, Point, Position,
+    RadialGradient, TextDecorationLine, TextDecorationStyle, TextEmphasisPosition,
+};
+
+/// Leading bytes of an encoded snapshot.
+const MAGIC: &[u8; 4] = b"LHLS";
+
+/// Current encoding version. Bump whenever the binary layout changes.
+const VERSION: u16 = 1;
+
+// ---------------------------------------------------------------------------
+// Owned draw data
+// ---------------------------------------------------------------------------
+
+/// Index into [`LayoutSnapshot::fonts`].
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash)]
+pub struct FontId(pub u32);
+
+/// Index into [`LayoutSnapshot::images`].
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash)]
+pub struct ImageId(pub u32);
+
+/// Owned copy of a [`FontDescription`].
+#[derive(Debug, Clone, PartialEq)]
+pub struct FontDescriptor {
+    pub family: String,
+    pub size: f32,
+    pub style: FontStyle,
+    pub weight: i32,
+    pub decoration_line: TextDecorationLine,
+    pub decoration_thickness: DecorationThickness,
+    pub decoration_style: TextDecorationStyle,
+    pub decoration_color: Color,
+    pub emphasis_style: String,
+    pub emphasis_color: Color,
+    pub emphasis_position: TextEmphasisPosition,
+}
+
+impl FontDescriptor {
+    /// Copy a description received in [`DocumentContainer::create_font`].
+    pub fn from_description(descr: &FontDescription<'_>) -> Self {
+        Self {
+            family: descr.family.to_string(),
+            size: descr.size,
+            style: descr.style,
+            weight: descr.weight,
+            decoration_line: descr.decoration_line,
+            decoration_thickness: descr.decoration_thickness,
+            decoration_style: descr.decoration_style,
+            decoration_color: descr.decoration_color,
+            emphasis_style: descr.emphasis_style.to_string(),
+            emphasis_color: descr.emphasis_color,
+            emphasis_position: descr.emphasis_position,
+        }
+    }
+
+    /// Borrow as the description type passed to
+    /// [`DocumentContainer::create_font`].
+    pub fn as_description(&self) -> FontDescription<'_> {
+        FontDescription {
+            family: &self.family,
+            size: self.size,
+            style: self.style,
+            weight: self.weight,
+            decoration_line: self.decoration_line,
+            decoration_thickness: self.decoration_thickness,
+            decoration_style: self.decoration_style,
+            decoration_color: self.decoration_color,
+            emphasis_style: &self.emphasis_style,
+            emphasis_color: self.emphasis_color,
+            emphasis_position: self.emphasis_position,
+        }
+    }
+}
+
+/// An image referenced by a draw operation.
+#[derive(Debug, Clone, PartialEq, Eq, Hash)]
+pub struct ImageRef {
+    pub url: String,
+    pub base_url: String,
+}
+
+/// Color stops and interpolation settings shared by all gradient kinds.
+#[derive(Debug, Clone, PartialEq)]
+pub struct GradientStops {
+    pub points: Vec<ColorPoint>,
+    pub color_space: ColorSpace,
+    pub hue_interpolation: HueInterpolation,
+}
+
+/// One container call made while drawing a document.
+///
+/// Positions are in document coordinates, as drawn at offset `(0, 0)`.
+#[derive(Debug, Clone, PartialEq)]
+pub enum DrawOp {
+    Text {
+        text: String,
+        font: FontId,
+        color: Color,
+        pos: Position,
+    },
+    ListMarker {
+        image: Option<ImageId>,
+        marker_type: ListStyleType,
+        color: Color,
+        pos: Position,
+        index: i32,
+        font: FontId,
+    },
+    Image {
+        layer: BackgroundLayer<'static>,
+        image: ImageId,
+    },
+    SolidFill {
+        layer: BackgroundLayer<'static>,
+        color: Color,
+    },
+    LinearGradient {
+        layer: BackgroundLayer<'static>,
+        start: Point,
+        end: Point,
+        stops: GradientStops,
+    },
+    RadialGradient {
+        layer: BackgroundLayer<'static>,
+        position: Point,
+        radius: Point,
+        stops: GradientStops,
+    },
+    ConicGradient {
+        layer: BackgroundLayer<'static>,
+        position: Point,
+        angle: f32,
+        radius: f32,
+        stops: GradientStops,
+    },
+    Borders {
+        borders: Borders,
+        draw_pos: Position,
+        root: bool,
+    },
+    SetClip {
+        pos: Position,
+        radius: BorderRadiuses,
+    },
+    DelClip,
+}
+
+/// Extra room around every painted area for antialiasing, in CSS pixels:
+/// at least one physical pixel down to a scale factor of 0.5.
+const PAINT_MARGIN: f32 = 2.0;
+
+impl DrawOp {
+    /// Area this operation may paint, in document coordinates. Returns
+    /// `None` for clip operations, which paint nothing but must always be
+    /// replayed to keep the clip stack balanced.
+    ///
+    /// The recorded box is grown by [`PAINT_MARGIN`] and half the widest
+    /// border, so culling against these bounds never drops antialiased
+    /// edges or stroke overhang. Text also gets a quarter of its line
+    /// height for glyphs that reach past their advance box (italics,
+    /// swashes, accents).
+    pub fn bounds(&self) -> Option<Position> {
+        let (pos, overhang) = match self {
+            Self::Text { pos, .. } => (*pos, pos.height / 4.0),
+            Self::ListMarker { pos, .. } => (*pos, 0.0),
+            Self::Image { layer, .. }
+            | Self::SolidFill { layer, .. }
+            | Self::LinearGradient { layer, .. }
+            | Self::RadialGradient { layer, .. }
+            | Self::ConicGradient { layer, .. } => (layer.clip_box, 0.0),
+            Self::Borders {
+                borders, draw_pos, ..
+            } => {
+                let widest = [borders.left, borders.top, borders.right, borders.bottom]
+                    .iter()
+                    .fold(0.0f32, |w, b| w.max(b.width));
+                (*draw_pos, widest / 2.0)
+            }
+            Self::SetClip { .. } | Self::DelClip => return None,
+        };
+        Some(inflate(pos, PAINT_MARGIN + overhang))
+    }
+}
+
+fn inflate(pos: Position, by: f32) -> Position {
+    Position {
+        x: pos.x - by,
+        y: pos.y - by,
+        width: pos.width + 2.0 * by,
+        height: pos.height + 2.0 * by,
+    }
+}
+
+/// Returns `true` if the two rectangles overlap.
+pub(crate) fn intersects(a: &Position, b: &Position) -> bool {
+    a.x < b.x + b.width && b.x < a.x + a.width && a.y < b.y + b.height && b.y < a.y + a.height
+}
+
+fn offset(pos: Position, dx: f32, dy: f32) -> Position {
+    Position {
+        x: pos.x + dx,
+        y: pos.y + dy,
+        ..pos
+    }
+}
+
+fn offset_layer(layer: &BackgroundLayer<'static>, dx: f32, dy: f32) -> BackgroundLayer<'static> {
+    BackgroundLayer {
+        border_box: offset(layer.border_box, dx, dy),
+        clip_box: offset(layer.clip_box, dx, dy),
+        origin_box: offset(layer.origin_box, dx, dy),
+        ..*layer
+    }
+}
+
+// ---------------------------------------------------------------------------
+// LayoutSnapshot
+// ---------------------------------------------------------------------------
+
+/// The laid-out result of a document at one width, as owned draw data.
+#[derive(Debug, Clone, PartialEq)]
+pub struct LayoutSnapshot {
+    width: f32,
+    height: f32,
+    fonts: Vec<FontDescriptor>,
+    images: Vec<ImageRef>,
+    ops: Vec<DrawOp>,
+}
+
+impl LayoutSnapshot {
+    /// Parse `html`, lay it out at `width` and record one full draw pass.
+    ///
+    /// `container` answers every layout callback (fonts, text measurement,
+    /// images, stylesheets) exactly as it would for a [`Document`], but none
+    /// of its draw methods are called.
+    pub fn capture<C: DocumentContainer + ?Sized>(
+        html: &str,
+        container: &mut C,
+        width: f32,
+        options: &DocumentOptions<'_>,
+    ) -> Result<Self, CreateError> {
+        let mut recorder = RecordingContainer::new(container);
+        let (width, height) = {
+            let mut doc = Document::from_html_with_options(html, &mut recorder, options)?;
+            let _ = doc.render(width);
+            doc.draw(DrawContext::default(), 0.0, 0.0, None);
+            (doc.width(), doc.height())
+        };
+        let (fonts, images, ops) = recorder.finish().into_parts();
+        Ok(Self {
+            width,
+            height,
+            fonts,
+            images,
+            ops,
+        })
+    }
+
+    pub(crate) fn into_parts(self) -> (Vec<FontDescriptor>, Vec<ImageRef>, Vec<DrawOp>) {
+        (self.fonts, self.images, self.ops)
+    }
+
+    /// Content width after layout.
+    pub fn width(&self) -> f32 {
+        self.width
+    }
+
+    /// Content height after layout.
+    pub fn height(&self) -> f32 {
+        self.height
+    }
+
+    /// Fonts referenced by [`FontId`].
+    pub fn fonts(&self) -> &[FontDescriptor] {
+        &self.fonts
+    }
+
+    /// Images referenced by [`ImageId`].
+    pub fn images(&self) -> &[ImageRef] {
+        &self.images
+    }
+
+    /// Recorded operations in draw order.
+    pub fn ops(&self) -> &[DrawOp] {
+        &self.ops
+    }
+
+    /// Replay the recorded draw pass into `container`, offset by `(x, y)`.
+    ///
+    /// If `clip` is `Some`, operations whose bounds lie entirely outside it
+    /// are skipped.
+    pub fn replay<C: DocumentContainer + ?Sized>(
+        &self,
+        container: &mut C,
+        hdc: DrawContext,
+        x: f32,
+        y: f32,
+        clip: Option<Position>,
+    ) {
+        let mut session = ReplaySession::new(&self.fonts, &self.images);
+        for op in &self.ops {
+            if let (Some(clip), Some(bounds)) = (clip, op.bounds()) {
+                if !intersects(&offset(bounds, x, y), &clip) {
+                    continue;
+                }
+            }
+            session.draw(container, hdc, op, x, y);
+        }
+        session.finish(container);
+    }
+
+    /// Encode into the compact binary snapshot format.
+    pub fn encode(&self) -> Vec<u8> {
+        let mut w = Writer::default();
+        w.buf.extend_from_slice(MAGIC);
+        w.u16(VERSION);
+        w.f32(self.width);
+        w.f32(self.height);
+
+        w.len(self.fonts.len());
+        for font in &self.fonts {
+            w.font(font);
+        }
+        w.len(self.images.len());
+        for image in &self.images {
+            w.str(&image.url);
+            w.str(&image.base_url);
+        }
+        w.len(self.ops.len());
+        for op in &self.ops {
+            w.op(op);
+        }
+        w.buf
+    }
+
+    /// Decode a snapshot produced by [`encode`](Self::encode).
+    pub fn decode(bytes: &[u8]) -> Result<Self, SnapshotError> {
+        let mut r = Reader { bytes, pos: 0 };
+        if r.take(MAGIC.len())? != MAGIC {
+            return Err(SnapshotError::BadMagic);
+        }
+        let version = r.u16()?;
+        if version != VERSION {
+            return Err(SnapshotError::UnsupportedVersion(version));
+        }
+        let width = r.f32()?;
+        let height = r.f32()?;
+
+        let count = r.len()?;
+        let mut fonts = Vec::with_capacity(count.min(1024));
+        for _ in 0..count {
+            fonts.push(r.font()?);
+        }
+        let count = r.len()?;
+        let mut images = Vec::with_capacity(count.min(1024));
+        for _ in 0..count {
+            images.push(ImageRef {
+                url: r.string()?,
+                base_url: r.string()?,
+            });
+        }
+        let count = r.len()?;
+        let mut ops = Vec::with_capacity(count.min(65536));
+        for _ in 0..count {
+            ops.push(r.op(fonts.len(), images.len())?);
+        }
+        if r.pos != bytes.len() {
+            return Err(SnapshotError::TrailingData);
+        }
+        Ok(Self {
+            width,
+            height,
+            fonts,
+            images,
+            ops,
+        })
+    }
+}
+
+/// Per-replay state: fonts created and images loaded in the target
+/// container so far.
+pub(crate) struct ReplaySession<'s> {
+    fonts: &'s [FontDescriptor],
+    images: &'s [ImageRef],
+    handles: Vec<Option<FontHandle>>,
+    loaded: Vec<bool>,
+}
+
+impl<'s> ReplaySession<'s> {
+    pub(crate) fn new(fonts: &'s [FontDescriptor], images: &'s [ImageRef]) -> Self {
+        Self {
+            fonts,
+            images,
+            handles: vec![None; fonts.len()],
+            loaded: vec![false; images.len()],
+        }
+    }
+
+    fn font<C: DocumentContainer + ?Sized>(&mut self, container: &mut C, id: FontId) -> FontHandle {
+        let slot = &mut self.handles[id.0 as usize];
+        *slot.get_or_insert_with(|| {
+            container
+                .create_font(&self.fonts[id.0 as usize].as_description())
+                .0
+        })
+    }
+
+    fn image<C: DocumentContainer + ?Sized>(
+        &mut self,
+        container: &mut C,
+        id: ImageId,
+    ) -> &'s ImageRef {
+        let image = &self.images[id.0 as usize];
+        if !std::mem::replace(&mut self.loaded[id.0 as usize], true) {
+            container.load_image(&image.url, &image.base_url, false);
+        }
+        image
+    }
+
+    /// Issue the container call for one operation, offset by `(dx, dy)`.
+    pub(crate) fn draw<C: DocumentContainer + ?Sized>(
+        &mut self,
+        container: &mut C,
+        hdc: DrawContext,
+        op: &DrawOp,
+        dx: f32,
+        dy: f32,
+    ) {
+        match op {
+            DrawOp::Text {
+                text,
+                font,
+                color,
+                pos,
+            } => {
+                let font = self.font(container, *font);
+                container.draw_text(hdc, text, font, *color, offset(*pos, dx, dy));
+            }
+            DrawOp::ListMarker {
+                image,
+                marker_type,
+                color,
+                pos,
+                index,
+                font,
+            } => {
+                let font = self.font(container, *font);
+                let (image, baseurl) = match image {
+                    Some(id) => {
+                        let image = self.image(container, *id);
+                        (image.url.as_str(), image.base_url.as_str())
+                    }
+                    None => ("", ""),
+                };
+                let marker = ListMarker {
+                    image,
+                    baseurl,
+                    marker_type: *marker_type,
+                    color: *color,
+                    pos: offset(*pos, dx, dy),
+                    index: *index,
+                    font,
+                };
+                container.draw_list_marker(hdc, &marker);
+            }
+            DrawOp::Image { layer, image } => {
+                let image = self.image(container, *image);
+                container.draw_image(
+                    hdc,
+                    &offset_layer(layer, dx, dy),
+                    &image.url,
+                    &image.base_url,
+                );
+            }
+            DrawOp::SolidFill { layer, color } => {
+                container.draw_solid_fill(hdc, &offset_layer(layer, dx, dy), *color);
+            }
+            DrawOp::LinearGradient {
+                layer,
+                start,
+                end,
+                stops,
+            } => {
+                let gradient = LinearGradient {
+                    start: *start,
+                    end: *end,
+                    color_points: &stops.points,
+                    color_space: stops.color_space,
+                    hue_interpolation: stops.hue_interpolation,
+                };
+                container.draw_linear_gradient(hdc, &offset_layer(layer, dx, dy), &gradient);
+            }
+            DrawOp::RadialGradient {
+                layer,
+                position,
+                radius,
+                stops,
+            } => {
+                let gradient = RadialGradient {
+                    position: *position,
+                    radius: *radius,
+                    color_points: &stops.points,
+                    color_space: stops.color_space,
+                    hue_interpolation: stops.hue_interpolation,
+                };
+                container.draw_radial_gradient(hdc, &offset_layer(layer, dx, dy), &gradient);
+            }
+            DrawOp::ConicGradient {
+                layer,
+                position,
+                angle,
+                radius,
+                stops,
+            } => {
+                let gradient = ConicGradient {
+                    position: *position,
+                    angle: *angle,
+                    radius: *radius,
+                    color_points: &stops.points,
+                    color_space: stops.color_space,
+                    hue_interpolation: stops.hue_interpolation,
+                };
+                container.draw_conic_gradient(hdc, &offset_layer(layer, dx, dy), &gradient);
+            }
+            DrawOp::Borders {
+                borders,
+                draw_pos,
+                root,
+            } => {
+                container.draw_borders(hdc, borders, offset(*draw_pos, dx, dy), *root);
+            }
+            DrawOp::SetClip { pos, radius } => {
+                container.set_clip(offset(*pos, dx, dy), *radius);
+            }
+            DrawOp::DelClip => container.del_clip(),
+        }
+    }
+
+    /// Delete every font created during the replay.
+    pub(crate) fn finish<C: DocumentContainer + ?Sized>(self, container: &mut C) {
+        for handle in self.handles.into_iter().flatten() {
+            container.delete_font(handle);
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Binary encoding
+// ---------------------------------------------------------------------------
+
+/// Error returned by [`LayoutSnapshot::decode`].
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub enum SnapshotError {
+    /// The data does not start with the snapshot magic bytes.
+    BadMagic,
+    /// The data was written by an incompatible encoder version.
+    UnsupportedVersion(u16),
+    /// The data ended in the middle of a value.
+    Truncated,
+    /// A string was not valid UTF-8.
+    InvalidUtf8,
+    /// An unknown operation or enum tag was encountered.
+    InvalidTag(u8),
+    /// An operation referenced a font or image that is not in the snapshot.
+    InvalidReference,
+    /// Extra bytes followed the last operation.
+    TrailingData,
+}
+
+impl std::fmt::Display for SnapshotError {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        match self {
+            Self::BadMagic => write!(f, "not a layout snapshot"),
+            Self::UnsupportedVersion(v) => write!(f, "unsupported snapshot version {v}"),
+            Self::Truncated => write!(f, "snapshot data is truncated"),
+            Self::InvalidUtf8 => write!(f, "snapshot contains invalid UTF-8"),
+            Self::InvalidTag(t) => write!(f, "invalid tag {t} in snapshot"),
+            Self::InvalidReference => write!(f, "snapshot references a missing font or image"),
+            Self::TrailingData => write!(f, "unexpected data after snapshot"),
+        }
+    }
+}
+
+impl std::error::Error for SnapshotError {}
+
+const OP_TEXT: u8 = 0;
+const OP_LIST_MARKER: u8 = 1;
+const OP_IMAGE: u8 = 2;
+const OP_SOLID_FILL: u8 = 3;
+const OP_LINEAR_GRADIENT: u8 = 4;
+const OP_RADIAL_GRADIENT: u8 = 5;
+const OP_CONIC_GRADIENT: u8 = 6;
+const OP_BORDERS: u8 = 7;
+const OP_SET_CLIP: u8 = 8;
+const OP_DEL_CLIP: u8 = 9;
+
+/// Little-endian writer for the snapshot format.
+#[derive(Default)]
+struct Writer {
+    buf: Vec<u8>,
+}
+
+impl Writer {
+    fn u8(&mut self, v: u8) {
+        self.buf.push(v);
+    }
+
+    fn u16(&mut self, v: u16) {
+        self.buf.extend_from_slice(&v.to_le_bytes());
+    }
+
+    fn u32(&mut self, v: u32) {
+        self.buf.extend_from_slice(&v.to_le_bytes());
+    }
+
+    fn i32(&mut self, v: i32) {
+        self.buf.extend_from_slice(&v.to_le_bytes());
+    }
+
+    fn f32(&mut self, v: f32) {
+        self.buf.extend_from_slice(&v.to_le_bytes());
+    }
+
+    fn len(&mut self, n: usize) {
+        self.u32(n as u32);
+    }
+
+    fn str(&mut self, s: &str) {
+        self.len(s.len());
+        self.buf.extend_from_slice(s.as_bytes());
+    }
+
+    fn color(&mut self, c: Color) {
+        self.buf.extend_from_slice(&[c.r, c.g, c.b, c.a]);
+    }
+
+    fn point(&mut self, p: Point) {
+        self.f32(p.x);
+        self.f32(p.y);
+    }
+
+    fn position(&mut self, p: Position) {
+        self.f32(p.x);
+        self.f32(p.y);
+        self.f32(p.width);
+        self.f32(p.height);
+    }
+
+    fn radii(&mut self, r: &BorderRadiuses) {
+        for v in [
+            r.top_left_x,
+            r.top_left_y,
+            r.top_right_x,
+            r.top_right_y,
+            r.bottom_right_x,
+            r.bottom_right_y,
+            r.bottom_left_x,
+            r.bottom_left_y,
+        ] {
+            self.f32(v);
+        }
+    }
+
+    fn border(&mut self, b: &Border) {
+        self.f32(b.width);
+        self.i32(b.style as i32);
+        self.color(b.color);
+    }
+
+    fn layer(&mut self, l: &BackgroundLayer<'_>) {
+        self.position(l.border_box);
+        self.radii(&l.border_radius);
+        self.position(l.clip_box);
+        self.position(l.origin_box);
+        self.i32(l.attachment as i32);
+        self.i32(l.repeat as i32);
+        self.u8(l.is_root as u8);
+    }
+
+    fn stops(&mut self, s: &GradientStops) {
+        self.len(s.points.len());
+        for p in &s.points {
+            self.f32(p.offset);
+            self.color(p.color);
+        }
+        self.i32(s.color_space as i32);
+        self.i32(s.hue_interpolation as i32);
+    }
+
+    fn font(&mut self, f: &FontDescriptor) {
+        self.str(&f.family);
+        self.f32(f.size);
+        self.i32(f.style as i32);
+        self.i32(f.weight);
+        self.i32(f.decoration_line.0);
+        match f.decoration_thickness {
+            DecorationThickness::Auto => self.u8(0),
+            DecorationThickness::FromFont => self.u8(1),
+            DecorationThickness::Length(v) => {
+                self.u8(2);
+                self.f32(v);
+            }
+        }
+        self.i32(f.decoration_style as i32);
+        self.color(f.decoration_color);
+        self.str(&f.emphasis_style);
+        self.color(f.emphasis_color);
+        self.i32(f.emphasis_position.0);
+    }
+
+    fn op(&mut self, op: &DrawOp) {
+        match op {
+            DrawOp::Text {
+                text,
+                font,
+                color,
+                pos,
+            } => {
+                self.u8(OP_TEXT);
+                self.str(text);
+                self.u32(font.0);
+                self.color(*color);
+                self.position(*pos);
+            }
+            DrawOp::ListMarker {
+                image,
+                marker_type,
+                color,
+                pos,
+                index,
+                font,
+            } => {
+                self.u8(OP_LIST_MARKER);
+                self.u32(image.map_or(u32::MAX, |id| id.0));
+                self.i32(*marker_type as i32);
+                self.color(*color);
+                self.position(*pos);
+                self.i32(*index);
+                self.u32(font.0);
+            }
+            DrawOp::Image { layer, image } => {
+                self.u8(OP_IMAGE);
+                self.layer(layer);
+                self.u32(image.0);
+            }
+            DrawOp::SolidFill { layer, color } => {
+                self.u8(OP_SOLID_FILL);
+                self.layer(layer);
+                self.color(*color);
+            }
+            DrawOp::LinearGradient {
+                layer,
+                start,
+                end,
+                stops,
+            } => {
+                self.u8(OP_LINEAR_GRADIENT);
+                self.layer(layer);
+                self.point(*start);
+                self.point(*end);
+                self.stops(stops);
+            }
+            DrawOp::RadialGradient {
+                layer,
+                position,
+                radius,
+                stops,
+            } => {
+                self.u8(OP_RADIAL_GRADIENT);
+                self.layer(layer);
+                self.point(*position);
+                self.point(*radius);
+                self.stops(stops);
+            }
+            DrawOp::ConicGradient {
+                layer,
+                position,
+                angle,
+                radius,
+                stops,
+            } => {
+                self.u8(OP_CONIC_GRADIENT);
+                self.layer(layer);
+                self.point(*position);
+                self.f32(*angle);
+                self.f32(*radius);
+                self.stops(stops);
+            }
+            DrawOp::Borders {
+                borders,
+                draw_pos,
+                root,
+            } => {
+                self.u8(OP_BORDERS);
+                for b in [&borders.left, &borders.top, &borders.right, &borders.bottom] {
+                    self.border(b);
+                }
+                self.radii(&borders.radius);
+                self.position(*draw_pos);
+                self.u8(*root as u8);
+            }
+            DrawOp::SetClip { pos, radius } => {
+                self.u8(OP_SET_CLIP);
+                self.position(*pos);
+                self.radii(radius);
+            }
+            DrawOp::DelClip => self.u8(OP_DEL_CLIP),
+        }
+    }
+}
+
+/// Little-endian reader for the snapshot format.
+struct Reader<'b> {
+    bytes: &'b [u8],
+    pos: usize,
+}
+
+impl<'b> Reader<'b> {
+    fn take(&mut self, n: usize) -> Result<&'b [u8], SnapshotError> {
+        let end = self.pos.checked_add(n).ok_or(SnapshotError::Truncated)?;
+        let slice = self
+            .bytes
+            .get(self.pos..end)
+            .ok_or(SnapshotError::Truncated)?;
+        self.pos = end;
+        Ok(slice)
+    }
+
+    fn array<const N: usize>(&mut self) -> Result<[u8; N], SnapshotError> {
+        let mut out = [0; N];
+        out.copy_from_slice(self.take(N)?);
+        Ok(out)
+    }
+
+    fn u8(&mut self) -> Result<u8, SnapshotError> {
+        Ok(self.array::<1>()?[0])
+    }
+
+    fn u16(&mut self) -> Result<u16, SnapshotError> {
+        Ok(u16::from_le_bytes(self.array()?))
+    }
+
+    fn u32(&mut self) -> Result<u32, SnapshotError> {
+        Ok(u32::from_le_bytes(self.array()?))
+    }
+
+    fn i32(&mut self) -> Result<i32, SnapshotError> {
+        Ok(i32::from_le_bytes(self.array()?))
+    }
+
+    fn f32(&mut self) -> Result<f32, SnapshotError> {
+        Ok(f32::from_le_bytes(self.array()?))
+    }
+
+    fn len(&mut self) -> Result<usize, SnapshotError> {
+        Ok(self.u32()? as usize)
+    }
+
+    fn bool(&mut self) -> Result<bool, SnapshotError> {
+        Ok(self.u8()? != 0)
+    }
+
+    fn string(&mut self) -> Result<String, SnapshotError> {
+        let n = self.len()?;
+        let bytes = self.take(n)?;
+        std::str::from_utf8(bytes)
+            .map(str::to_string)
+            .map_err(|_| SnapshotError::InvalidUtf8)
+    }
+
+    fn color(&mut self) -> Result<Color, SnapshotError> {
+        let [r, g, b, a] = self.array()?;
+        Ok(Color { r, g, b, a })
+    }
+
+    fn point(&mut self) -> Result<Point, SnapshotError> {
+        Ok(Point {
+            x: self.f32()?,
+            y: self.f32()?,
+        })
+    }
+
+    fn position(&mut self) -> Result<Position, SnapshotError> {
+        Ok(Position {
+            x: self.f32()?,
+            y: self.f32()?,
+            width: self.f32()?,
+            height: self.f32()?,
+        })
+    }
+
+    fn radii(&mut self) -> Result<BorderRadiuses, SnapshotError> {
+        Ok(BorderRadiuses {
+            top_left_x: self.f32()?,
+            top_left_y: self.f32()?,
+            top_right_x: self.f32()?,
+            top_right_y: self.f32()?,
+            bottom_right_x: self.f32()?,
+            bottom_right_y: self.f32()?,
+            bottom_left_x: self.f32()?,
+            bottom_left_y: self.f32()?,
+        })
+    }
+
+    fn border(&mut self) -> Result<Border, SnapshotError> {
+        Ok(Border {
+            width: self.f32()?,
+            style: BorderStyle::from_c_int(self.i32()?),
+            color: self.color()?,
+        })
+    }
+
+    fn layer(&mut self) -> Result<BackgroundLayer<'static>, SnapshotError> {
+        Ok(BackgroundLayer {
+            border_box: self.position()?,
+            border_radius: self.radii()?,
+            clip_box: self.position()?,
+            origin_box: self.position()?,
+            attachment: BackgroundAttachment::from_c_int(self.i32()?),
+            repeat: BackgroundRepeat::from_c_int(self.i32()?),
+            is_root: self.bool()?,
+            _phantom: PhantomData,
+        })
+    }
+
+    fn stops(&mut self) -> Result<GradientStops, SnapshotError> {
+        let n = self.len()?;
+        let mut points = Vec::with_capacity(n.min(256));
+        for _ in 0..n {
+            points.push(ColorPoint {
+                offset: self.f32()?,
+                color: self.color()?,
+            });
+        }
+        Ok(GradientStops {
+            points,
+            color_space: ColorSpace::from_c_int(self.i32()?),
+            hue_interpolation: HueInterpolation::from_c_int(self.i32()?),
+        })
+    }
+
+    fn font(&mut self) -> Result<FontDescriptor, SnapshotError> {
+        Ok(FontDescriptor {
+            family: self.string()?,
+            size: self.f32()?,
+            style: FontStyle::from_c_int(self.i32()?),
+            weight: self.i32()?,
+            decoration_line: TextDecorationLine(self.i32()?),
+            decoration_thickness: match self.u8()? {
+                0 => DecorationThickness::Auto,
+                1 => DecorationThickness::FromFont,
+                2 => DecorationThickness::Length(self.f32()?),
+                t => return Err(SnapshotError::InvalidTag(t)),
+            },
+            decoration_style: TextDecorationStyle::from_c_int(self.i32()?),
+            decoration_color: self.color()?,
+            emphasis_style: self.string()?,
+            emphasis_color: self.color()?,
+            emphasis_position: TextEmphasisPosition(self.i32()?),
+        })
+    }
+
+    fn font_id(&mut self, fonts: usize) -> Result<FontId, SnapshotError> {
+        let id = self.u32()?;
+        if id as usize >= fonts {
+            return Err(SnapshotError::InvalidReference);
+        }
+        Ok(FontId(id))
+    }
+
+    fn image_id(&mut self, images: usize) -> Result<ImageId, SnapshotError> {
+        let id = self.u32()?;
+        if id as usize >= images {
+            return Err(SnapshotError::InvalidReference);
+        }
+        Ok(ImageId(id))
+    }
+
+    fn op(&mut self, fonts: usize, images: usize) -> Result<DrawOp, SnapshotError> {
+        let op = match self.u8()? {
+            OP_TEXT => DrawOp::Text {
+                text: self.string()?,
+                font: self.font_id(fonts)?,
+                color: self.color()?,
+                pos: self.position()?,
+            },
+            OP_LIST_MARKER => {
+                let image = match self.u32()? {
+                    u32::MAX => None,
+                    id if (id as usize) < images => Some(ImageId(id)),
+                    _ => return Err(SnapshotError::InvalidReference),
+                };
+                DrawOp::ListMarker {
+                    image,
+                    marker_type: ListStyleType::from_c_int(self.i32()?),
+                    color: self.color()?,
+                    pos: self.position()?,
+                    index: self.i32()?,
+                    font: self.font_id(fonts)?,
+                }
+            }
+            OP_IMAGE => DrawOp::Image {
+                layer: self.layer()?,
+                image: self.image_id(images)?,
+            },
+            OP_SOLID_FILL => DrawOp::SolidFill {
+                layer: self.layer()?,
+                color: self.color()?,
+            },
+            OP_LINEAR_GRADIENT => DrawOp::LinearGradient {
+                layer: self.layer()?,
+                start: self.point()?,
+                end: self.point()?,
+                stops: self.stops()?,
+            },
+            OP_RADIAL_GRADIENT => DrawOp::RadialGradient {
+                layer: self.layer()?,
+                position: self.point()?,
+                radius: self.point()?,
+                stops: self.stops()?,
+            },
+            OP_CONIC_GRADIENT => DrawOp::ConicGradient {
+                layer: self.layer()?,
+                position: self.point()?,
+                angle: self.f32()?,
+                radius: self.f32()?,
+                stops: self.stops()?,
+            },
+            OP_BORDERS => DrawOp::Borders {
+                borders: Borders {
+                    left: self.border()?,
+                    top: self.border()?,
+                    right: self.border()?,
+                    bottom: self.border()?,
+                    radius: self.radii()?,
+                },
+                draw_pos: self.position()?,
+                root: self.bool()?,
+            },
+            OP_SET_CLIP => DrawOp::SetClip {
+                pos: self.position()?,
+                radius: self.radii()?,
+            },
+            OP_DEL_CLIP => DrawOp::DelClip,
+            t => return Err(SnapshotError::InvalidTag(t)),
+        };
+        Ok(op)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::test_util::Canvas;
+
+    const HTML: &str = r#"<body style="background: #eee">
+        <h1>Archive</h1>
+        <p style="border: 1px solid red; background: linear-gradient(red, blue)">Hello snapshot</p>
+        <ul><li>one</li><li>two</li></ul>
+    </body>"#;
+
+    #[test]
+    fn test_replay_matches_direct_draw() {
+        let mut direct = Canvas::default();
+        {
+            let mut doc = Document::from_html(HTML, &mut direct, None, None).unwrap();
+            let _ = doc.render(600.0);
+            doc.draw(DrawContext::default(), 0.0, 0.0, None);
+        }
+
+        let mut layout = Canvas::default();
+        let snapshot = LayoutSnapshot::capture(HTML, &mut layout, 600.0, &Default::default())
+            .expect("capture");
+        assert!(layout.texts.is_empty(), "capture must not draw");
+        assert!(snapshot.height() > 0.0);
+
+        let mut replayed = Canvas::default();
+        snapshot.replay(&mut replayed, DrawContext::default(), 0.0, 0.0, None);
+        assert_eq!(replayed.texts, direct.texts);
+        assert_eq!(replayed.fills, direct.fills);
+        assert_eq!(replayed.clips, 0);
+        assert_eq!(
+            replayed.live_fonts, 0,
+            "replay deletes the fonts it creates"
+        );
+    }
+
+    #[test]
+    fn test_encode_decode_roundtrip() {
+        let mut container = Canvas::default();
+        let snapshot =
+            LayoutSnapshot::capture(HTML, &mut container, 600.0, &Default::default()).unwrap();
+        let bytes = snapshot.encode();
+        let decoded = LayoutSnapshot::decode(&bytes).expect("decode");
+        assert_eq!(decoded, snapshot);
+
+        assert_eq!(
+            LayoutSnapshot::decode(&bytes[..bytes.len() - 1]),
+            Err(SnapshotError::Truncated)
+        );
+        assert_eq!(
+            LayoutSnapshot::decode(b"nope"),
+            Err(SnapshotError::BadMagic)
+        );
+    }
+
+    #[test]
+    fn test_replay_offset_and_clip() {
+        let mut container = Canvas::default();
+        let snapshot =
+            LayoutSnapshot::capture(HTML, &mut container, 600.0, &Default::default()).unwrap();
+
+        let mut full = Canvas::default();
+        snapshot.replay(&mut full, DrawContext::default(), 10.0, 20.0, None);
+        let mut plain = Canvas::default();
+        snapshot.replay(&mut plain, DrawContext::default(), 0.0, 0.0, None);
+        for ((_, a), (_, b)) in full.texts.iter().zip(&plain.texts) {
+            assert_eq!(a.x, b.x + 10.0);
+            assert_eq!(a.y, b.y + 20.0);
+        }
+
+        let clip = Position {
+            x: 0.0,
+            y: 0.0,
+            width: 600.0,
+            height: 1.0,
+        };
+        let mut clipped = Canvas::default();
+        snapshot.replay(&mut clipped, DrawContext::default(), 0.0, 0.0, Some(clip));
+        assert!(clipped.texts.len() < plain.texts.len());
+        assert_eq!(clipped.clips, 0);
+    }
+}
@@ -0,0 +1,80 @@
+//! Containers shared by the crate's unit tests.
+
+use crate::{
+    BackgroundLayer, BorderRadiuses, Color, DocumentContainer, DrawContext, FontDescription,
+    FontHandle, FontMetrics, MediaFeatures, Position,
+};
+
+/// Container that measures 8 px per byte and records what it is asked
+/// to draw.
+#[derive(Default)]
+pub(crate) struct Canvas {
+    pub(crate) next_font: usize,
+    pub(crate) live_fonts: usize,
+    pub(crate) texts: Vec<(String, Position)>,
+    pub(crate) fills: usize,
+    pub(crate) clips: i32,
+}
+
+impl DocumentContainer for Canvas {
+    fn create_font(&mut self, _descr: &FontDescription) -> (FontHandle, FontMetrics) {
+        self.next_font += 1;
+        self.live_fonts += 1;
+        let metrics = FontMetrics {
+            font_size: 16.0,
+            height: 20.0,
+            ascent: 16.0,
+            descent: 4.0,
+            x_height: 8.0,
+            ch_width: 8.0,
+            ..Default::default()
+        };
+        (FontHandle(self.next_font), metrics)
+    }
+
+    fn delete_font(&mut self, _font: FontHandle) {
+        self.live_fonts -= 1;
+    }
+
+    fn text_width(&self, text: &str, _font: FontHandle) -> f32 {
+        text.len() as f32 * 8.0
+    }
+
+    fn draw_text(&mut self, _: DrawContext, text: &str, _: FontHandle, _: Color, pos: Position) {
+        self.texts.push((text.to_string(), pos));
+    }
+
+    fn draw_solid_fill(&mut self, _: DrawContext, _: &BackgroundLayer, _: Color) {
+        self.fills += 1;
+    }
+
+    fn set_clip(&mut self, _: Position, _: BorderRadiuses) {
+        self.clips += 1;
+    }
+
+    fn del_clip(&mut self) {
+        self.clips -= 1;
+    }
+
+    fn get_viewport(&self) -> Position {
+        Position {
+            x: 0.0,
+            y: 0.0,
+            width: 800.0,
+            height: 600.0,
+        }
+    }
+
+    fn get_media_features(&self) -> MediaFeatures {
+        MediaFeatures {
+            media_type: crate::MediaType::Screen,
+            width: 800.0,
+            height: 600.0,
+            device_width: 800.0,
+            device_height: 600.0,
+            color: 8,
+            resolution: 96.0,
+            ..Default::default()
+        }
+    }
+}
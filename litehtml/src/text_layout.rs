@@ -0,0 +1,753 @@
+//! Positioned text extraction without rasterization.
+//!
+//! [`TextLayoutContainer`] sits between a [`Document`] and a measuring
+//! container, like [`RecordingContainer`](crate::display_list::RecordingContainer).
+//! Layout callbacks go through to the measuring container, `draw_text` is
+//! captured, and every other draw callback is dropped. The result is a
+//! [`TextLayout`]: runs of text with their absolute boxes, font size,
+//! weight, style and link target, grouped into lines and blocks.
+//!
+//! [`ApproxMetrics`] is a measuring container that needs no fonts at all.
+//! It estimates advances from per-character width classes, which is enough
+//! for search indexing and reading order; pass a real container such as
+//! `PixbufContainer` when boxes must match the rendered output.
+//!
+//! ```ignore
+//! let mut metrics = ApproxMetrics::new(800.0);
+//! let layout = TextLayout::extract(&html, &mut metrics, 800.0, &Default::default())?;
+//! for block in &layout.blocks {
+//!     index.add(layout.block_text(block), block.bounds);
+//! }
+//! ```
+
+use std::collections::HashMap;
+use std::ops::Range;
+
+use crate::{
+    CreateError, Document, DocumentContainer, DocumentOptions, DrawContext, FontDescription,
+    FontHandle, FontMetrics, FontStyle, LinkBoxes, MediaFeatures, MediaType, Position, Size,
+    TextTransform,
+};
+
+/// Height of one band of the link lookup grid, in CSS pixels.
+const LINK_BAND: f32 = 64.0;
+
+/// A horizontal gap wider than this fraction of the font size between two
+/// words on one line is taken as a space.
+const SPACE_GAP: f32 = 0.15;
+
+/// A vertical gap wider than this fraction of the shorter of two adjacent
+/// lines starts a new block.
+const BLOCK_GAP: f32 = 0.5;
+
+/// A run of text drawn in one font, on one line, with one link target.
+#[derive(Debug, Clone, PartialEq)]
+pub struct TextRun {
+    pub text: String,
+    /// Absolute box in CSS pixels.
+    pub pos: Position,
+    pub font_size: f32,
+    /// CSS weight, 100 to 900.
+    pub weight: u16,
+    pub italic: bool,
+    /// Index into [`TextLayout::links`].
+    pub link: Option<u32>,
+    /// Whether a space separates this run from the previous one on its
+    /// line: a whitespace leaf was drawn between them, or the gap is wider
+    /// than a space. Adjacent inline boxes (`<b>Import</b>ant`) have none.
+    pub space_before: bool,
+}
+
+/// Runs sharing one baseline.
+#[derive(Debug, Clone, PartialEq)]
+pub struct TextLine {
+    /// Indices into [`TextLayout::runs`].
+    pub runs: Range<usize>,
+    pub bounds: Position,
+}
+
+/// Lines stacked without a paragraph-sized gap between them.
+#[derive(Debug, Clone, PartialEq)]
+pub struct TextBlock {
+    /// Indices into [`TextLayout::lines`].
+    pub lines: Range<usize>,
+    pub bounds: Position,
+}
+
+/// Text of a laid-out document, in reading order.
+///
+/// Runs follow litehtml's paint order, which is document order except for
+/// floats and positioned boxes, so columns and table cells stay together
+/// instead of being interleaved by height.
+#[derive(Debug, Clone, Default, PartialEq)]
+pub struct TextLayout {
+    pub runs: Vec<TextRun>,
+    pub lines: Vec<TextLine>,
+    pub blocks: Vec<TextBlock>,
+    /// Link targets, unresolved, referenced by [`TextRun::link`].
+    pub links: Vec<String>,
+}
+
+impl TextLayout {
+    /// Parse `html`, lay it out at `width` and capture the text of one draw
+    /// pass.
+    ///
+    /// `container` answers layout callbacks; none of its draw methods are
+    /// called.
+    pub fn extract<C: DocumentContainer + ?Sized>(
+        html: &str,
+        container: &mut C,
+        width: f32,
+        options: &DocumentOptions<'_>,
+    ) -> Result<Self, CreateError> {
+        let mut capture = TextLayoutContainer::new(container);
+        let links = {
+            let mut doc = Document::from_html_with_options(html, &mut capture, options)?;
+            let _ = doc.render(width);
+            doc.draw(DrawContext::default(), 0.0, 0.0, None);
+            doc.links()
+        };
+        Ok(capture.finish(&links))
+    }
+
+    /// Text of one line, runs joined as they were merged.
+    pub fn line_text(&self, line: &TextLine) -> String {
+        let mut out = String::new();
+        for run in &self.runs[line.runs.clone()] {
+            if !out.is_empty() && run.space_before {
+                out.push(' ');
+            }
+            out.push_str(&run.text);
+        }
+        out
+    }
+
+    /// Text of one block, lines joined with newlines.
+    pub fn block_text(&self, block: &TextBlock) -> String {
+        let lines: Vec<String> = self.lines[block.lines.clone()]
+            .iter()
+            .map(|l| self.line_text(l))
+            .collect();
+        lines.join("\n")
+    }
+
+    /// All text, blocks separated by blank lines.
+    pub fn text(&self) -> String {
+        let blocks: Vec<String> = self.blocks.iter().map(|b| self.block_text(b)).collect();
+        blocks.join("\n\n")
+    }
+}
+
+/// Style of a font handle, captured when the font is created.
+#[derive(Debug, Clone, Copy)]
+struct FontStyleInfo {
+    size: f32,
+    weight: u16,
+    italic: bool,
+}
+
+/// One `draw_text` call.
+#[derive(Debug, Clone)]
+struct DrawnText {
+    text: String,
+    pos: Position,
+    font: FontStyleInfo,
+    /// Whitespace was drawn since the previous word.
+    space_before: bool,
+}
+
+/// Container adapter that forwards layout callbacks to `inner` and keeps
+/// the text of draw callbacks.
+///
+/// Create a [`Document`] over it, render and draw once, collect
+/// [`Document::links`], drop the document, then call
+/// [`finish`](Self::finish). [`TextLayout::extract`] does all of this.
+///
+/// Fonts are handed to the document under handles of this adapter's own,
+/// never reused, so a handle the inner container recycles after
+/// `delete_font`, or shares between descriptions, cannot pick up another
+/// font's style.
+pub struct TextLayoutContainer<'c, C: ?Sized> {
+    inner: &'c mut C,
+    /// The inner container's handle and the style, by our handle.
+    fonts: HashMap<FontHandle, (FontHandle, FontStyleInfo)>,
+    next_font: usize,
+    drawn: Vec<DrawnText>,
+    space_pending: bool,
+}
+
+impl<'c, C: DocumentContainer + ?Sized> TextLayoutContainer<'c, C> {
+    /// Capture text, forwarding layout callbacks to `inner`.
+    pub fn new(inner: &'c mut C) -> Self {
+        Self {
+            inner,
+            fonts: HashMap::new(),
+            next_font: 0,
+            drawn: Vec::new(),
+            space_pending: false,
+        }
+    }
+
+    fn inner_font(&self, font: FontHandle) -> FontHandle {
+        self.fonts.get(&font).map_or(font, |&(inner, _)| inner)
+    }
+
+    /// Style of `font`. Handles `create_font` did not register (0 when the
+    /// inner container could not create a font) get the default font's
+    /// style, so their text is still captured.
+    fn font_style(&self, font: FontHandle) -> FontStyleInfo {
+        self.fonts.get(&font).map_or_else(
+            || FontStyleInfo {
+                size: self.inner.default_font_size(),
+                weight: 400,
+                italic: false,
+            },
+            |&(_, style)| style,
+        )
+    }
+
+    /// Group the captured text into runs, lines and blocks, attaching each
+    /// run to the link whose text boxes contain it.
+    pub fn finish(self, links: &[LinkBoxes]) -> TextLayout {
+        build_layout(self.drawn, links)
+    }
+}
+
+impl<C: DocumentContainer + ?Sized> DocumentContainer for TextLayoutContainer<'_, C> {
+    fn create_font(&mut self, descr: &FontDescription) -> (FontHandle, FontMetrics) {
+        let (inner, metrics) = self.inner.create_font(descr);
+        if inner.0 == 0 {
+            return (inner, metrics);
+        }
+        self.next_font += 1;
+        let handle = FontHandle(self.next_font);
+        let style = FontStyleInfo {
+            size: descr.size(),
+            weight: descr.weight().clamp(1, 1000) as u16,
+            italic: descr.style() == FontStyle::Italic,
+        };
+        self.fonts.insert(handle, (inner, style));
+        (handle, metrics)
+    }
+
+    fn delete_font(&mut self, font: FontHandle) {
+        if let Some((inner, _)) = self.fonts.remove(&font) {
+            self.inner.delete_font(inner);
+        }
+    }
+
+    fn text_width(&self, text: &str, font: FontHandle) -> f32 {
+        self.inner.text_width(text, self.inner_font(font))
+    }
+
+    fn draw_text(
+        &mut self,
+        _hdc: DrawContext,
+        text: &str,
+        font: FontHandle,
+        _color: crate::Color,
+        pos: Position,
+    ) {
+        if text.trim().is_empty() {
+            self.space_pending = true;
+            return;
+        }
+        let font = self.font_style(font);
+        self.drawn.push(DrawnText {
+            text: text.to_string(),
+            pos,
+            font,
+            space_before: std::mem::take(&mut self.space_pending),
+        });
+    }
+
+    fn pt_to_px(&self, pt: f32) -> f32 {
+        self.inner.pt_to_px(pt)
+    }
+
+    fn default_font_size(&self) -> f32 {
+        self.inner.default_font_size()
+    }
+
+    fn default_font_name(&self) -> &str {
+        self.inner.default_font_name()
+    }
+
+    fn load_image(&mut self, src: &str, baseurl: &str, redraw_on_ready: bool) {
+        self.inner.load_image(src, baseurl, redraw_on_ready);
+    }
+
+    fn get_image_size(&self, src: &str, baseurl: &str) -> Size {
+        self.inner.get_image_size(src, baseurl)
+    }
+
+    fn set_caption(&mut self, caption: &str) {
+        self.inner.set_caption(caption);
+    }
+
+    fn set_base_url(&mut self, base_url: &str) {
+        self.inner.set_base_url(base_url);
+    }
+
+    fn transform_text(&self, text: &str, tt: TextTransform) -> String {
+        self.inner.transform_text(text, tt)
+    }
+
+    fn import_css(&self, url: &str, baseurl: &str) -> (String, Option<String>) {
+        self.inner.import_css(url, baseurl)
+    }
+
+    fn get_viewport(&self) -> Position {
+        self.inner.get_viewport()
+    }
+
+    fn get_media_features(&self) -> MediaFeatures {
+        self.inner.get_media_features()
+    }
+
+    fn get_language(&self) -> (String, String) {
+        self.inner.get_language()
+    }
+}
+
+/// Link boxes bucketed by horizontal band, for point lookups.
+struct LinkGrid {
+    bands: HashMap<i32, Vec<(Position, u32)>>,
+}
+
+impl LinkGrid {
+    fn new(links: &[LinkBoxes]) -> Self {
+        let mut bands: HashMap<i32, Vec<(Position, u32)>> = HashMap::new();
+        for (i, link) in links.iter().enumerate() {
+            for b in &link.boxes {
+                let first = (b.y / LINK_BAND).floor() as i32;
+                let last = ((b.y + b.height) / LINK_BAND).floor() as i32;
+                for band in first..=last {
+                    bands.entry(band).or_default().push((*b, i as u32));
+                }
+            }
+        }
+        Self { bands }
+    }
+
+    fn link_at(&self, x: f32, y: f32) -> Option<u32> {
+        let band = self.bands.get(&((y / LINK_BAND).floor() as i32))?;
+        band.iter()
+            .find(|(b, _)| b.x <= x && x < b.x + b.width && b.y <= y && y < b.y + b.height)
+            .map(|(_, link)| *link)
+    }
+}
+
+fn union(a: &Position, b: &Position) -> Position {
+    let x = a.x.min(b.x);
+    let y = a.y.min(b.y);
+    Position {
+        x,
+        y,
+        width: (a.x + a.width).max(b.x + b.width) - x,
+        height: (a.y + a.height).max(b.y + b.height) - y,
+    }
+}
+
+/// Whether `pos` sits on the line spanning `line` and continues it to the
+/// right of `last`.
+fn continues_line(line: &Position, last: &Position, pos: &Position) -> bool {
+    let center = pos.y + pos.height / 2.0;
+    center >= line.y && center < line.y + line.height && pos.x >= last.x + last.width * 0.5
+}
+
+fn build_layout(drawn: Vec<DrawnText>, links: &[LinkBoxes]) -> TextLayout {
+    let grid = LinkGrid::new(links);
+    let mut layout = TextLayout {
+        links: links.iter().map(|l| l.href.clone()).collect(),
+        ..TextLayout::default()
+    };
+
+    // Lines: consecutive words that share a vertical band and move right.
+    let mut line_start = 0;
+    let mut line_bounds: Option<Position> = None;
+    let mut last: Option<Position> = None;
+    for word in drawn {
+        let link = grid.link_at(
+            word.pos.x + word.pos.width / 2.0,
+            word.pos.y + word.pos.height / 2.0,
+        );
+        let same_line = match (&line_bounds, &last) {
+            (Some(line), Some(prev)) => continues_line(line, prev, &word.pos),
+            _ => false,
+        };
+        if !same_line {
+            if let Some(bounds) = line_bounds.take() {
+                layout.lines.push(TextLine {
+                    runs: line_start..layout.runs.len(),
+                    bounds,
+                });
+            }
+            line_start = layout.runs.len();
+        }
+
+        // Merge into the previous run when nothing but a space separates
+        // them.
+        let merge = same_line
+            && layout.runs.last().is_some_and(|run| {
+                run.link == link
+                    && run.font_size == word.font.size
+                    && run.weight == word.font.weight
+                    && run.italic == word.font.italic
+            });
+        let space = same_line
+            && (word.space_before
+                || layout.runs.last().is_some_and(|run| {
+                    word.pos.x - (run.pos.x + run.pos.width) > word.font.size * SPACE_GAP
+                }));
+        if merge {
+            let run = layout.runs.last_mut().unwrap();
+            if space {
+                run.text.push(' ');
+            }
+            run.text.push_str(&word.text);
+            run.pos = union(&run.pos, &word.pos);
+        } else {
+            layout.runs.push(TextRun {
+                text: word.text,
+                pos: word.pos,
+                font_size: word.font.size,
+                weight: word.font.weight,
+                italic: word.font.italic,
+                link,
+                space_before: space,
+            });
+        }
+        line_bounds = Some(match line_bounds {
+            Some(b) => union(&b, &word.pos),
+            None => word.pos,
+        });
+        last = Some(word.pos);
+    }
+    if let Some(bounds) = line_bounds {
+        layout.lines.push(TextLine {
+            runs: line_start..layout.runs.len(),
+            bounds,
+        });
+    }
+
+    // Blocks: lines that follow closely below one another and overlap
+    // horizontally.
+    let mut block_start = 0;
+    for i in 0..layout.lines.len() {
+        let bounds = layout.lines[i].bounds;
+        let joins = i > 0 && {
+            let prev = layout.lines[i - 1].bounds;
+            let gap = bounds.y - (prev.y + prev.height);
+            let line_height = prev.height.min(bounds.height);
+            gap >= -line_height * 0.5
+                && gap <= line_height * BLOCK_GAP
+                && bounds.x < prev.x + prev.width
+                && prev.x < bounds.x + bounds.width
+        };
+        if !joins && i > 0 {
+            push_block(&mut layout, block_start..i);
+            block_start = i;
+        }
+    }
+    let end = layout.lines.len();
+    if end > 0 {
+        push_block(&mut layout, block_start..end);
+    }
+    layout
+}
+
+fn push_block(layout: &mut TextLayout, lines: Range<usize>) {
+    let bounds = layout.lines[lines.clone()]
+        .iter()
+        .map(|l| l.bounds)
+        .reduce(|a, b| union(&a, &b))
+        .unwrap_or_default();
+    layout.blocks.push(TextBlock { lines, bounds });
+}
+
+// ---------------------------------------------------------------------------
+// ApproxMetrics
+// ---------------------------------------------------------------------------
+
+/// Measuring container that estimates text widths without loading fonts.
+///
+/// Each character advances by a fixed fraction of the font size chosen by
+/// its width class (narrow punctuation, capitals, wide letters, CJK and so
+/// on), with bold text 7% wider. Line breaks therefore fall close to, but
+/// not exactly where, a real font would put them.
+pub struct ApproxMetrics {
+    width: f32,
+    height: f32,
+    fonts: HashMap<FontHandle, (f32, bool)>,
+    next_font: usize,
+}
+
+impl ApproxMetrics {
+    /// Metrics for a `width` CSS pixel wide viewport.
+    pub fn new(width: f32) -> Self {
+        Self {
+            width,
+            height: 10_000.0,
+            fonts: HashMap::new(),
+            next_font: 0,
+        }
+    }
+
+    /// Advance of `c` as a fraction of the font size.
+    fn advance(c: char) -> f32 {
+        match c {
+            ' ' | 'i' | 'j' | 'l' | '.' | ',' | ':' | ';' | '\'' | '|' | '!' | 'I' => 0.28,
+            'f' | 'r' | 't' | '(' | ')' | '[' | ']' | '-' | '"' => 0.36,
+            'm' | 'w' => 0.8,
+            'M' | 'W' | '@' => 0.92,
+            'A'..='Z' | '&' | '%' => 0.68,
+            '0'..='9' => 0.55,
+            '\u{1100}'..='\u{115f}'
+            | '\u{2e80}'..='\u{a4cf}'
+            | '\u{ac00}'..='\u{d7a3}'
+            | '\u{f900}'..='\u{faff}'
+            | '\u{fe30}'..='\u{fe4f}'
+            | '\u{ff00}'..='\u{ff60}'
+            | '\u{1f300}'..='\u{1faff}' => 1.0,
+            c if c.is_control() => 0.0,
+            _ => 0.52,
+        }
+    }
+}
+
+impl DocumentContainer for ApproxMetrics {
+    fn create_font(&mut self, descr: &FontDescription) -> (FontHandle, FontMetrics) {
+        self.next_font += 1;
+        let handle = FontHandle(self.next_font);
+        let size = descr.size();
+        self.fonts.insert(handle, (size, descr.weight() >= 600));
+        let metrics = FontMetrics {
+            font_size: size,
+            height: (size * 1.2).round(),
+            ascent: (size * 0.9).round(),
+            descent: (size * 0.3).round(),
+            x_height: (size * 0.5).round(),
+            ch_width: (size * 0.55).round(),
+            draw_spaces: false,
+            sub_shift: (size * 0.2).round(),
+            super_shift: (size * 0.35).round(),
+        };
+        (handle, metrics)
+    }
+
+    fn delete_font(&mut self, font: FontHandle) {
+        self.fonts.remove(&font);
+    }
+
+    fn text_width(&self, text: &str, font: FontHandle) -> f32 {
+        let (size, bold) = self.fonts.get(&font).copied().unwrap_or((16.0, false));
+        let em: f32 = text.chars().map(Self::advance).sum();
+        em * size * if bold { 1.07 } else { 1.0 }
+    }
+
+    fn draw_text(
+        &mut self,
+        _hdc: DrawContext,
+        _text: &str,
+        _font: FontHandle,
+        _color: crate::Color,
+        _pos: Position,
+    ) {
+    }
+
+    fn get_viewport(&self) -> Position {
+        Position {
+            x: 0.0,
+            y: 0.0,
+            width: self.width,
+            height: self.height,
+        }
+    }
+
+    fn get_media_features(&self) -> MediaFeatures {
+        MediaFeatures {
+            media_type: MediaType::Screen,
+            width: self.width,
+            height: self.height,
+            device_width: self.width,
+            device_height: self.height,
+            color: 8,
+            resolution: 96.0,
+            ..Default::default()
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn word(text: &str, x: f32, y: f32, size: f32, weight: u16) -> DrawnText {
+        DrawnText {
+            text: text.to_string(),
+            pos: Position {
+                x,
+                y,
+                width: text.len() as f32 * 8.0,
+                height: size * 1.2,
+            },
+            font: FontStyleInfo {
+                size,
+                weight,
+                italic: false,
+            },
+            space_before: false,
+        }
+    }
+
+    #[test]
+    fn test_group_runs_lines_blocks() {
+        let drawn = vec![
+            word("Title", 0.0, 0.0, 32.0, 700),
+            word("Hello", 0.0, 60.0, 16.0, 400),
+            word("there", 44.0, 60.0, 16.0, 400),
+            word("link", 88.0, 60.0, 16.0, 400),
+            word("next", 0.0, 80.0, 16.0, 400),
+            word("line", 36.0, 80.0, 16.0, 700),
+            word("Footer", 0.0, 200.0, 16.0, 400),
+        ];
+        let links = vec![LinkBoxes {
+            href: "https://example.com".into(),
+            boxes: vec![Position {
+                x: 88.0,
+                y: 60.0,
+                width: 32.0,
+                height: 19.2,
+            }],
+        }];
+        let layout = build_layout(drawn, &links);
+
+        let runs: Vec<&str> = layout.runs.iter().map(|r| r.text.as_str()).collect();
+        assert_eq!(
+            runs,
+            ["Title", "Hello there", "link", "next", "line", "Footer"]
+        );
+        assert_eq!(layout.runs[2].link, Some(0));
+        assert_eq!(layout.runs[1].link, None);
+        assert_eq!(layout.lines.len(), 4);
+        assert_eq!(layout.blocks.len(), 3);
+        assert_eq!(
+            layout.text(),
+            "Title\n\nHello there link\nnext line\n\nFooter"
+        );
+    }
+
+    #[test]
+    fn test_adjacent_runs_join_without_space() {
+        // "Import" in bold runs straight into "ant"; "now" follows a drawn
+        // space although it touches "ant" as well.
+        let mut now = word("now", 72.0, 0.0, 16.0, 400);
+        now.space_before = true;
+        let drawn = vec![
+            word("Import", 0.0, 0.0, 16.0, 700),
+            word("ant", 48.0, 0.0, 16.0, 400),
+            now,
+            word("later", 140.0, 0.0, 16.0, 700),
+        ];
+        let layout = build_layout(drawn, &[]);
+        assert_eq!(layout.runs.len(), 3);
+        assert_eq!(layout.text(), "Important now later");
+    }
+
+    #[test]
+    fn test_font_handles_are_not_reused() {
+        let mut metrics = ApproxMetrics::new(600.0);
+        let mut capture = TextLayoutContainer::new(&mut metrics);
+        let font = |size: f32, weight: i32| FontDescription {
+            family: "serif",
+            size,
+            style: FontStyle::Normal,
+            weight,
+            decoration_line: Default::default(),
+            decoration_thickness: Default::default(),
+            decoration_style: Default::default(),
+            decoration_color: Default::default(),
+            emphasis_style: "",
+            emphasis_color: Default::default(),
+            emphasis_position: Default::default(),
+        };
+        let (regular, bold) = (font(16.0, 400), font(32.0, 700));
+        let (a, _) = capture.create_font(&regular);
+        capture.delete_font(a);
+        let (b, _) = capture.create_font(&bold);
+        assert_ne!(a, b);
+        let pos = Position {
+            x: 0.0,
+            y: 0.0,
+            width: 40.0,
+            height: 38.0,
+        };
+        capture.draw_text(
+            DrawContext::default(),
+            "Hi",
+            b,
+            crate::Color::default(),
+            pos,
+        );
+        // A freed handle must not pick up the bold font's style.
+        capture.draw_text(
+            DrawContext::default(),
+            "stale",
+            a,
+            crate::Color::default(),
+            Position { y: 100.0, ..pos },
+        );
+        let layout = capture.finish(&[]);
+        let runs: Vec<_> = layout
+            .runs
+            .iter()
+            .map(|r| (r.text.as_str(), r.font_size, r.weight))
+            .collect();
+        assert_eq!(runs, [("Hi", 32.0, 700), ("stale", 16.0, 400)]);
+    }
+
+    #[test]
+    fn test_text_without_a_font_is_kept() {
+        let mut metrics = ApproxMetrics::new(600.0);
+        let mut capture = TextLayoutContainer::new(&mut metrics);
+        let pos = Position {
+            x: 0.0,
+            y: 0.0,
+            width: 40.0,
+            height: 20.0,
+        };
+        capture.draw_text(
+            DrawContext::default(),
+            "fallback",
+            FontHandle(0),
+            crate::Color::default(),
+            pos,
+        );
+        let layout = capture.finish(&[]);
+        assert_eq!(layout.text(), "fallback");
+        let run = &layout.runs[0];
+        assert_eq!((run.font_size, run.weight, run.italic), (16.0, 400, false));
+    }
+
+    #[test]
+    fn test_extract_with_approx_metrics() {
+        let html = r#"<h1>Archive</h1>
+            <p>Read the <a href="/post/1">first post</a> today.</p>"#;
+        let mut metrics = ApproxMetrics::new(600.0);
+        let layout = TextLayout::extract(html, &mut metrics, 600.0, &Default::default()).unwrap();
+
+        assert_eq!(layout.links, ["/post/1"]);
+        let link: Vec<&str> = layout
+            .runs
+            .iter()
+            .filter(|r| r.link == Some(0))
+            .map(|r| r.text.as_str())
+            .collect();
+        assert_eq!(link, ["first post"]);
+        let heading = &layout.runs[0];
+        assert_eq!(heading.text, "Archive");
+        assert!(heading.weight >= 700 && heading.font_size > 16.0);
+        assert_eq!(layout.blocks.len(), 2);
+    }
+}